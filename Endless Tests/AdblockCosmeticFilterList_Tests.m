@@ -0,0 +1,74 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "AdblockCosmeticFilterList.h"
+
+@interface AdblockCosmeticFilterList_Tests : XCTestCase
+@end
+
+@implementation AdblockCosmeticFilterList_Tests {
+	AdblockCosmeticFilterList *list;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	NSString *path = [[NSBundle bundleForClass:[self class]] pathForResource:@"adblock_mock_cosmetic_filters" ofType:@"txt"];
+	NSData *data = [NSData dataWithContentsOfFile:path];
+	if (data == nil)
+		abort();
+
+	list = [[AdblockCosmeticFilterList alloc] initWithData:data];
+}
+
+- (NSSet<NSString *> *)genericFor:(NSString *)key host:(NSString *)host {
+	return [NSSet setWithArray:[list genericSelectorsForKey:key host:host]];
+}
+
+- (void)testLoadsEveryFilter {
+	XCTAssertEqual([list count], 12);
+}
+
+- (void)testDomainSelectors {
+	NSArray *expected = @[ @".paywall-ad", @".promo" ];
+	XCTAssertEqualObjects([list selectorsForHost:@"news.example.com"], expected);
+	XCTAssertEqualObjects([list selectorsForHost:@"NEWS.Example.COM"], expected);
+	XCTAssertEqualObjects([list selectorsForHost:@"example.com"], @[ @".promo" ]);
+	XCTAssertEqualObjects([list selectorsForHost:@"example.org"], @[]);
+	XCTAssertEqualObjects([list selectorsForHost:nil], @[]);
+
+	/* filters for a domain don't leak into lookalikes */
+	XCTAssertEqualObjects([list selectorsForHost:@"badexample.com"], @[]);
+}
+
+- (void)testDomainExceptions {
+	XCTAssertEqualObjects([list selectorsForHost:@"shop.example.com"], @[]);
+	XCTAssertEqualObjects([list selectorsForHost:@"a.shop.example.com"], @[]);
+}
+
+- (void)testGenericSelectors {
+	NSSet *banner = [NSSet setWithObjects:@".ad-banner", @".ad-banner.wide", nil];
+	XCTAssertEqualObjects([self genericFor:@".ad-banner" host:@"example.org"], banner);
+	XCTAssertEqualObjects([self genericFor:@".ad-banner" host:nil], banner);
+	XCTAssertEqualObjects([self genericFor:@"#sidebar-ad" host:@"example.org"], [NSSet setWithObject:@"div > #sidebar-ad"]);
+	XCTAssertEqualObjects([self genericFor:@".nothing" host:@"example.org"], [NSSet set]);
+
+	/* keys are case-sensitive, like classes and ids */
+	XCTAssertEqualObjects([self genericFor:@"#TOP-AD" host:@"example.org"], [NSSet set]);
+}
+
+- (void)testGenericExceptions {
+	XCTAssertEqualObjects([self genericFor:@".ad-banner" host:@"www.example.com"], [NSSet setWithObject:@".ad-banner.wide"]);
+	XCTAssertEqualObjects([self genericFor:@".banner-ad" host:@"forum.example.com"], [NSSet set]);
+	XCTAssertEqualObjects([self genericFor:@".banner-ad" host:@"example.com"], [NSSet setWithObject:@".banner-ad"]);
+}
+
+- (void)testStyleElement {
+	NSData *style = [AdblockCosmeticFilterList styleElementHidingSelectors:@[ @".one", @"div > #two" ] nonce:@"N1"];
+	NSString *s = [[NSString alloc] initWithData:style encoding:NSUTF8StringEncoding];
+	XCTAssertEqualObjects(s, @"<style nonce=\"N1\">.one{display:none!important}div > #two{display:none!important}</style>");
+
+	XCTAssertNil([AdblockCosmeticFilterList styleElementHidingSelectors:@[] nonce:@"N1"]);
+}
+
+@end
@@ -0,0 +1,147 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "AdblockFilterList.h"
+
+#define PAGE @"https://www.example.org/"
+
+@interface AdblockFilterList_Tests : XCTestCase
+@end
+
+@implementation AdblockFilterList_Tests {
+	AdblockFilterList *list;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	NSString *path = [[NSBundle bundleForClass:[self class]] pathForResource:@"adblock_mock_network_filters" ofType:@"txt"];
+	NSData *data = [NSData dataWithContentsOfFile:path];
+	if (data == nil)
+		abort();
+
+	list = [[AdblockFilterList alloc] initWithData:data];
+}
+
+- (NSString *)filterFor:(NSString *)url type:(AdblockRequestType)type page:(NSString *)page {
+	return [list filterBlockingURL:[NSURL URLWithString:url] type:type mainDocumentURL:(page != nil ? [NSURL URLWithString:page] : nil)];
+}
+
+- (void)testLoadsEveryFilter {
+	XCTAssertEqual([list count], 11);
+}
+
+- (void)testHostAnchor {
+	XCTAssertEqualObjects([self filterFor:@"https://ads.example.com/x.js" type:AdblockRequestTypeScript page:PAGE], @"ads.example.com^");
+	XCTAssertEqualObjects([self filterFor:@"https://sub.ads.example.com/x.js" type:AdblockRequestTypeScript page:PAGE], @"ads.example.com^");
+	XCTAssertNil([self filterFor:@"https://badads.example.com/x.js" type:AdblockRequestTypeScript page:PAGE]);
+	XCTAssertNil([self filterFor:@"https://ads.example.com.example.net/" type:AdblockRequestTypeScript page:PAGE]);
+}
+
+- (void)testPatterns {
+	XCTAssertEqualObjects([self filterFor:@"https://x.com/banner/123/img" type:AdblockRequestTypeImage page:PAGE], @"/banner/*/img^");
+	XCTAssertEqualObjects([self filterFor:@"https://x.com/banner/123/img?x" type:AdblockRequestTypeImage page:PAGE], @"/banner/*/img^");
+	XCTAssertNil([self filterFor:@"https://x.com/banner/123/imgs" type:AdblockRequestTypeImage page:PAGE]);
+
+	XCTAssertEqualObjects([self filterFor:@"https://start.example.org/a" type:AdblockRequestTypeOther page:PAGE], @"https://start.example.org/");
+	XCTAssertNil([self filterFor:@"http://start.example.org/a" type:AdblockRequestTypeOther page:PAGE]);
+
+	XCTAssertEqualObjects([self filterFor:@"https://x.com/a/movie.swf" type:AdblockRequestTypeObject page:PAGE], @".swf");
+	XCTAssertNil([self filterFor:@"https://x.com/a/movie.swf?x" type:AdblockRequestTypeObject page:PAGE]);
+
+	XCTAssertEqualObjects([self filterFor:@"https://x.com/pixel.gif?id=1" type:AdblockRequestTypeImage page:PAGE], @"/pixel.gif?");
+}
+
+- (void)testUntokenizedFilters {
+	XCTAssertEqualObjects([self filterFor:@"https://x.com/top_adbox123.png" type:AdblockRequestTypeImage page:PAGE], @"_adbox");
+	XCTAssertEqualObjects([self filterFor:@"https://X.COM/TOP_ADBOX" type:AdblockRequestTypeImage page:PAGE], @"_adbox");
+}
+
+- (void)testOptions {
+	XCTAssertEqualObjects([self filterFor:@"https://tracker.example.net/p" type:AdblockRequestTypeOther page:PAGE], @"tracker.example.net^");
+	XCTAssertNil([self filterFor:@"https://tracker.example.net/p" type:AdblockRequestTypeOther page:@"https://www.example.net/"]);
+
+	XCTAssertEqualObjects([self filterFor:@"https://cdn.example.net/ad.js" type:AdblockRequestTypeScript page:PAGE], @"cdn.example.net/ad.js");
+	XCTAssertNil([self filterFor:@"https://cdn.example.net/ad.js" type:AdblockRequestTypeImage page:PAGE]);
+
+	XCTAssertEqualObjects([self filterFor:@"https://widgets.example.net/w" type:AdblockRequestTypeOther page:@"https://news.example.com/"], @"widgets.example.net^");
+	XCTAssertEqualObjects([self filterFor:@"https://widgets.example.net/w" type:AdblockRequestTypeOther page:@"https://a.news.example.com/"], @"widgets.example.net^");
+	XCTAssertNil([self filterFor:@"https://widgets.example.net/w" type:AdblockRequestTypeOther page:@"https://sports.news.example.com/"]);
+	XCTAssertNil([self filterFor:@"https://widgets.example.net/w" type:AdblockRequestTypeOther page:PAGE]);
+}
+
+- (void)testExceptions {
+	XCTAssertNil([self filterFor:@"https://ads.example.com/allowed/x.js" type:AdblockRequestTypeScript page:PAGE]);
+	XCTAssertNil([self filterFor:@"https://ads.example.com/x.js" type:AdblockRequestTypeScript page:@"https://trusted.example.com/page"]);
+}
+
+- (void)testUnsupportedFiltersAreDropped {
+	/* a regular expression and a $popup filter in the source list */
+	XCTAssertNil([self filterFor:@"https://x.com/ads.js" type:AdblockRequestTypeScript page:PAGE]);
+	XCTAssertNil([self filterFor:@"https://ignored.example.com/" type:AdblockRequestTypeOther page:PAGE]);
+}
+
+- (void)testTypeOfRequest {
+	NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:@"https://x.com/a/app.JS?v=1"]];
+	XCTAssertEqual([AdblockFilterList typeOfRequest:request], AdblockRequestTypeScript);
+
+	[request setURL:[NSURL URLWithString:@"https://x.com/pixel"]];
+	[request setValue:@"image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5" forHTTPHeaderField:@"Accept"];
+	XCTAssertEqual([AdblockFilterList typeOfRequest:request], AdblockRequestTypeImage);
+
+	[request setValue:@"*/*" forHTTPHeaderField:@"Accept"];
+	XCTAssertEqual([AdblockFilterList typeOfRequest:request], AdblockRequestTypeOther);
+}
+
+/* a list the size of EasyList and EasyPrivacy together: host filters, path filters, a
+ * crowded "ads" bucket, exceptions and $domain= filters */
+- (AdblockFilterList *)generatedListOfSize:(NSUInteger)size {
+	NSMutableString *lines = [NSMutableString stringWithString:@"! generated for AdblockFilterList_Tests\n"];
+	for (NSUInteger i = 0; i < size; i++) {
+		switch (i % 5) {
+			case 0:
+			case 1:
+				[lines appendFormat:@"tracker%lu\t3ff2\ttracker%lu.example.net^\t\n", (unsigned long)i, (unsigned long)i];
+				break;
+			case 2:
+				[lines appendFormat:@"banner%lu\t1ff0\t/banner%lu/*/img^\t\n", (unsigned long)i, (unsigned long)i];
+				break;
+			case 3:
+				[lines appendFormat:@"ads\t1ff0\t/ads/slot%lu.\t\n", (unsigned long)i];
+				break;
+			case 4:
+				[lines appendFormat:@"widget%lu\t3ff1\twidget%lu.example.org^\tsite%lu.example.com\n", (unsigned long)i, (unsigned long)i, (unsigned long)i];
+				break;
+		}
+	}
+	return [[AdblockFilterList alloc] initWithData:[lines dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)testLookupPerformance {
+	AdblockFilterList *big = [self generatedListOfSize:50000];
+	XCTAssertEqual([big count], 50000);
+
+	NSURL *page = [NSURL URLWithString:@"https://news.example.com/story/2024/10/a-long-article-title"];
+	NSArray<NSURL *> *urls = @[
+		[NSURL URLWithString:@"https://tracker12345.example.net/collect?v=1&tid=UA-1"],
+		[NSURL URLWithString:@"https://cdn.example.com/ads/slot778.js"],
+		[NSURL URLWithString:@"https://cdn.example.com/ads/unlisted/slot.js"],
+		[NSURL URLWithString:@"https://img.example.com/banner42/300x250/img"],
+		[NSURL URLWithString:@"https://static.example.com/assets/app.min.js?v=20241019"],
+		[NSURL URLWithString:@"https://fonts.example.com/css2?family=Open+Sans:wght@400;700&display=swap"],
+	];
+	XCTAssertNotNil([big filterBlockingURL:urls[0] type:AdblockRequestTypeScript mainDocumentURL:page]);
+	XCTAssertNil([big filterBlockingURL:urls[4] type:AdblockRequestTypeScript mainDocumentURL:page]);
+
+	[self measureBlock:^{
+		NSUInteger blocked = 0;
+		for (int i = 0; i < 100000; i++) {
+			if ([big filterBlockingURL:urls[i % [urls count]] type:AdblockRequestTypeScript mainDocumentURL:page] != nil) {
+				blocked++;
+			}
+		}
+		XCTAssertGreaterThan(blocked, 0);
+	}];
+}
+
+@end
@@ -0,0 +1,115 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPContentSecurityPolicy.h"
+
+@interface JAHPContentSecurityPolicy_Tests : XCTestCase
+@end
+
+@implementation JAHPContentSecurityPolicy_Tests
+
+/* policies as sent by a few large sites, for the benchmarks */
++ (NSArray<NSString *> *)realWorldPolicies {
+	return @[
+		@"default-src 'none'; base-uri 'self'; child-src github.com/assets-cdn/worker/ gist.github.com/assets-cdn/worker/; connect-src 'self' uploads.github.com www.githubstatus.com collector.github.com raw.githubusercontent.com api.github.com github-cloud.s3.amazonaws.com github-production-repository-file-5c1aeb.s3.amazonaws.com github-production-upload-manifest-file-7fdce7.s3.amazonaws.com github-production-user-asset-6210df.s3.amazonaws.com wss://alive.github.com; font-src github.githubassets.com; form-action 'self' github.com gist.github.com; frame-ancestors 'none'; frame-src viewscreen.githubusercontent.com notebooks.githubusercontent.com; img-src 'self' data: github.githubassets.com media.githubusercontent.com camo.githubusercontent.com identicons.github.com avatars.githubusercontent.com github-cloud.s3.amazonaws.com objects.githubusercontent.com; manifest-src 'self'; media-src github.com user-images.githubusercontent.com/ secured-user-images.githubusercontent.com/; script-src github.githubassets.com; style-src 'unsafe-inline' github.githubassets.com; upgrade-insecure-requests; worker-src github.com/assets-cdn/worker/ gist.github.com/assets-cdn/worker/",
+		@"script-src 'nonce-r4nd0mN0nc3' 'unsafe-inline' 'unsafe-eval' 'strict-dynamic' https: http:; object-src 'none'; base-uri 'self'; report-uri https://csp.withgoogle.com/csp/gws/other-hp",
+		@"connect-src 'self' blob: https://*.giphy.com https://*.pscp.tv https://*.video.pscp.tv https://*.twimg.com https://api.twitter.com https://api-stream.twitter.com https://ads-api.twitter.com https://aa.twitter.com https://caps.twitter.com wss://*.pscp.tv; default-src 'self'; form-action 'self' https://twitter.com https://*.twitter.com; font-src 'self' https://*.twimg.com; frame-src 'self' https://twitter.com https://mobile.twitter.com https://pay.twitter.com https://cards-frame.twitter.com; img-src 'self' blob: data: https://*.cdn.twitter.com https://ton.twitter.com https://*.twimg.com https://www.google-analytics.com; manifest-src 'self'; media-src 'self' blob: https://twitter.com https://*.twimg.com https://*.vine.co https://*.pscp.tv; object-src 'none'; script-src 'self' 'unsafe-inline' https://*.twimg.com https://www.google-analytics.com 'nonce-NGI2ZTc5MjgtYTA4Zi00ZTQ4'; style-src 'self' 'unsafe-inline' https://*.twimg.com; worker-src 'self' blob:; report-uri https://twitter.com/i/csp_report",
+		@"upgrade-insecure-requests; frame-ancestors 'self' https://stackexchange.com",
+		@"default-src * data: blob: 'self'; script-src *.facebook.com *.fbcdn.net *.facebook.net 127.0.0.1:* 'unsafe-inline' blob: data: 'self' 'wasm-unsafe-eval'; style-src data: blob: 'unsafe-inline' *; connect-src *.facebook.com facebook.com *.fbcdn.net *.facebook.net wss://*.facebook.com:* attachment.fbsbx.com blob: 'self'; block-all-mixed-content; upgrade-insecure-requests;",
+	];
+}
+
+- (void)testParse {
+	JAHPContentSecurityPolicy *csp = [[JAHPContentSecurityPolicy alloc] initWithHeaderValue:@" Script-Src  'self'\thttps://a.example ;;img-src *; script-src 'none'; bad_name x; upgrade-insecure-requests"];
+	XCTAssertEqual([csp.policies count], 1);
+
+	NSArray<JAHPCSPDirective *> *directives = csp.policies[0];
+	XCTAssertEqual([directives count], 3);
+	XCTAssertEqualObjects(directives[0].name, @"script-src");
+	XCTAssertEqualObjects(directives[0].values, (@[ @"'self'", @"https://a.example" ]));
+	XCTAssertEqualObjects(directives[1].name, @"img-src");
+	XCTAssertEqualObjects(directives[2].name, @"upgrade-insecure-requests");
+	XCTAssertEqual([directives[2].values count], 0);
+
+	XCTAssertEqualObjects([csp headerValue], @"script-src 'self' https://a.example; img-src *; upgrade-insecure-requests");
+}
+
+- (void)testParsePolicyList {
+	JAHPContentSecurityPolicy *csp = [[JAHPContentSecurityPolicy alloc] initWithHeaderValue:@"default-src 'self', script-src 'none', ;"];
+	XCTAssertEqual([csp.policies count], 2);
+	XCTAssertEqualObjects([csp headerValue], @"default-src 'self', script-src 'none'");
+}
+
+- (void)testNonceOrHash {
+	XCTAssertTrue([[[JAHPCSPDirective alloc] initWithName:@"script-src" values:@[ @"'self'", @"'NONCE-abc'" ]] hasNonceOrHash]);
+	XCTAssertTrue([[[JAHPCSPDirective alloc] initWithName:@"script-src" values:@[ @"'sha256-abc='" ]] hasNonceOrHash]);
+	XCTAssertFalse([[[JAHPCSPDirective alloc] initWithName:@"script-src" values:@[ @"'self'", @"'unsafe-inline'" ]] hasNonceOrHash]);
+	XCTAssertTrue([[[JAHPCSPDirective alloc] initWithName:@"script-src" values:@[ @"'None'" ]] isNone]);
+	XCTAssertFalse([[[JAHPCSPDirective alloc] initWithName:@"script-src" values:@[ @"'none'", @"'self'" ]] isNone]);
+}
+
+- (void)testAddRequiredSources {
+	NSString *value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:@"default-src 'self'; script-src 'self' 'unsafe-inline'; media-src https:; img-src *" nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"default-src endlessipc: 'self'; script-src 'self' 'unsafe-inline'; media-src http://127.0.0.1:*/tunneled-rewrite/ https:; img-src *");
+}
+
+- (void)testAddRequiredSourcesWithNonce {
+	NSString *header = @"default-src 'none'; script-src 'nonce-site' 'strict-dynamic'";
+
+	NSString *value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:header nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"default-src 'nonce-N1' endlessipc:; script-src 'nonce-N1' 'nonce-site' 'strict-dynamic'");
+
+	/* the second time comes from the cache, with only the nonce changed */
+	value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:header nonce:@"N2"];
+	XCTAssertEqualObjects(value, @"default-src 'nonce-N2' endlessipc:; script-src 'nonce-N2' 'nonce-site' 'strict-dynamic'");
+}
+
+- (void)testAddRequiredStyleSources {
+	NSString *value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:@"style-src 'self' 'nonce-site'" nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"style-src 'nonce-N1' 'self' 'nonce-site'");
+
+	/* without a nonce, adding ours would turn off 'unsafe-inline' */
+	value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:@"style-src 'self' 'unsafe-inline'" nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"style-src 'self' 'unsafe-inline'");
+}
+
+- (void)testAddRequiredSourcesToEachPolicy {
+	NSString *value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:@"frame-src 'self', child-src 'none'" nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"frame-src endlessipc: 'self', child-src endlessipc:");
+}
+
+- (void)testRestrictScripts {
+	NSString *value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:nil restrictingScriptsTo:@"" nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"script-src 'nonce-N1'");
+
+	/* the site's policy is kept, with ours added to the list */
+	value = [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:@"default-src 'self'; script-src *" restrictingScriptsTo:@"'self' example.com *.example.com" nonce:@"N1"];
+	XCTAssertEqualObjects(value, @"default-src endlessipc: 'self'; script-src *, script-src 'self' example.com *.example.com 'nonce-N1'");
+
+	JAHPContentSecurityPolicy *csp = [[JAHPContentSecurityPolicy alloc] initWithHeaderValue:value];
+	XCTAssertEqual([csp.policies count], 2);
+}
+
+- (void)testParsePerformance {
+	NSArray<NSString *> *policies = [[self class] realWorldPolicies];
+	[self measureBlock:^{
+		for (int i = 0; i < 200; i++) {
+			for (NSString *policy in policies) {
+				[[JAHPContentSecurityPolicy alloc] initWithHeaderValue:policy];
+			}
+		}
+	}];
+}
+
+- (void)testCachedRewritePerformance {
+	NSArray<NSString *> *policies = [[self class] realWorldPolicies];
+	[self measureBlock:^{
+		for (int i = 0; i < 200; i++) {
+			for (NSString *policy in policies) {
+				[JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:policy nonce:@"bm9uY2Vub25jZW5vbmNl"];
+			}
+		}
+	}];
+}
+
+@end
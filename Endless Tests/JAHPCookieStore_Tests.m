@@ -0,0 +1,132 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPCookieStore.h"
+
+@interface JAHPCookieStore_Tests : XCTestCase
+@end
+
+@implementation JAHPCookieStore_Tests {
+	JAHPCookieStore *store;
+}
+
+- (void)setUp {
+	[super setUp];
+	store = [[JAHPCookieStore alloc] initWithPath:nil cookieStorage:nil];
+}
+
+- (void)setCookie:(NSString *)setCookie forURL:(NSString *)url partition:(NSString *)partition inStore:(JAHPCookieStore *)s {
+	NSURL *URL = [NSURL URLWithString:url];
+	[s setCookies:[NSHTTPCookie cookiesWithResponseHeaderFields:@{ @"Set-Cookie": setCookie } forURL:URL] forURL:URL partition:partition];
+}
+
+- (void)setCookie:(NSString *)setCookie forURL:(NSString *)url {
+	[self setCookie:setCookie forURL:url partition:nil inStore:store];
+}
+
+- (NSString *)headerForURL:(NSString *)url {
+	return [store cookieHeaderForURL:[NSURL URLWithString:url] partition:nil];
+}
+
+- (void)testDomainAndPathMatching {
+	[self setCookie:@"host=1; Path=/" forURL:@"https://www.example.com/"];
+	[self setCookie:@"domain=2; Domain=example.com; Path=/" forURL:@"https://www.example.com/"];
+	[self setCookie:@"deep=3; Path=/a/b" forURL:@"https://www.example.com/a/b"];
+
+	XCTAssertEqualObjects([self headerForURL:@"https://www.example.com/"], @"host=1; domain=2");
+	XCTAssertEqualObjects([self headerForURL:@"https://www.example.com/a/b/c"], @"deep=3; host=1; domain=2");
+	XCTAssertEqualObjects([self headerForURL:@"https://www.example.com/a/bc"], @"host=1; domain=2");
+	XCTAssertEqualObjects([self headerForURL:@"https://static.example.com/a/b"], @"domain=2");
+	XCTAssertEqualObjects([self headerForURL:@"https://WWW.EXAMPLE.COM"], @"host=1; domain=2");
+	XCTAssertNil([self headerForURL:@"https://example.org/"]);
+}
+
+- (void)testReplacingKeepsOrder {
+	[self setCookie:@"a=1; Path=/" forURL:@"https://example.com/"];
+	[self setCookie:@"b=2; Path=/" forURL:@"https://example.com/"];
+	[self setCookie:@"a=3; Path=/" forURL:@"https://example.com/"];
+
+	XCTAssertEqualObjects([self headerForURL:@"https://example.com/"], @"a=3; b=2");
+	XCTAssertEqual([[store cookies] count], 2);
+}
+
+- (void)testSecureCookies {
+	[self setCookie:@"s=1; Path=/; Secure" forURL:@"https://example.com/"];
+	[self setCookie:@"t=2; Path=/; Secure" forURL:@"http://example.com/"];
+
+	XCTAssertEqualObjects([self headerForURL:@"https://example.com/"], @"s=1");
+	XCTAssertNil([self headerForURL:@"http://example.com/"]);
+}
+
+- (void)testCookiesForOtherSitesAreIgnored {
+	[self setCookie:@"a=1; Domain=example.org; Path=/" forURL:@"https://example.com/"];
+	[self setCookie:@"b=2; Domain=com; Path=/" forURL:@"https://example.com/"];
+	[self setCookie:@"c=3; Domain=co.uk; Path=/" forURL:@"https://example.co.uk/"];
+
+	XCTAssertNil([self headerForURL:@"https://example.org/"]);
+	XCTAssertNil([self headerForURL:@"https://example.com/"]);
+	XCTAssertNil([self headerForURL:@"https://other.co.uk/"]);
+	XCTAssertEqual([[store cookies] count], 0);
+}
+
+- (void)testExpiredCookieRemovesCookie {
+	[self setCookie:@"a=1; Path=/; Max-Age=3600" forURL:@"https://example.com/"];
+	[self setCookie:@"b=2; Path=/" forURL:@"https://example.com/"];
+	XCTAssertEqualObjects([self headerForURL:@"https://example.com/"], @"a=1; b=2");
+
+	[self setCookie:@"a=; Path=/; Expires=Thu, 01 Jan 1970 00:00:00 GMT" forURL:@"https://example.com/"];
+	XCTAssertEqualObjects([self headerForURL:@"https://example.com/"], @"b=2");
+}
+
+- (void)testPartitions {
+	[self setCookie:@"id=1; Path=/" forURL:@"https://tracker.example/" partition:nil inStore:store];
+	[self setCookie:@"id=2; Path=/" forURL:@"https://tracker.example/" partition:@"news.example" inStore:store];
+	[self setCookie:@"id=3; Path=/" forURL:@"https://tracker.example/" partition:@"shop.example" inStore:store];
+
+	NSURL *tracker = [NSURL URLWithString:@"https://tracker.example/pixel"];
+	XCTAssertEqualObjects([store cookieHeaderForURL:tracker partition:nil], @"id=1");
+	XCTAssertEqualObjects([store cookieHeaderForURL:tracker partition:@"news.example"], @"id=2");
+	XCTAssertEqualObjects([store cookieHeaderForURL:tracker partition:@"shop.example"], @"id=3");
+	XCTAssertNil([store cookieHeaderForURL:tracker partition:@"other.example"]);
+	XCTAssertEqual([[store cookies] count], 3);
+}
+
+- (void)testRemoveCookiesForSite {
+	[self setCookie:@"a=1; Path=/" forURL:@"https://www.news.example/"];
+	[self setCookie:@"id=2; Path=/" forURL:@"https://tracker.example/" partition:@"news.example" inStore:store];
+	[self setCookie:@"b=3; Path=/" forURL:@"https://shop.example/"];
+
+	[store removeCookiesForSite:@"news.example"];
+
+	XCTAssertNil([self headerForURL:@"https://www.news.example/"]);
+	XCTAssertNil([store cookieHeaderForURL:[NSURL URLWithString:@"https://tracker.example/"] partition:@"news.example"]);
+	XCTAssertEqualObjects([self headerForURL:@"https://shop.example/"], @"b=3");
+
+	[self setCookie:@"c=4; Path=/" forURL:@"https://other.example/"];
+	[store removeCookiesExceptForSites:[NSSet setWithObject:@"www.shop.example"]];
+	XCTAssertNil([self headerForURL:@"https://other.example/"]);
+	XCTAssertEqualObjects([self headerForURL:@"https://shop.example/"], @"b=3");
+
+	[store removeAllCookies];
+	XCTAssertNil([self headerForURL:@"https://shop.example/"]);
+	XCTAssertEqual([[store cookies] count], 0);
+}
+
+- (void)testPersistence {
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+
+	JAHPCookieStore *written = [[JAHPCookieStore alloc] initWithPath:path cookieStorage:nil];
+	[self setCookie:@"session=1; Path=/" forURL:@"https://example.com/" partition:nil inStore:written];
+	[self setCookie:@"persistent=2; Path=/; Max-Age=3600" forURL:@"https://example.com/" partition:nil inStore:written];
+	[self setCookie:@"id=3; Path=/; Max-Age=3600" forURL:@"https://tracker.example/" partition:@"example.com" inStore:written];
+	[written flush];
+
+	JAHPCookieStore *read = [[JAHPCookieStore alloc] initWithPath:path cookieStorage:nil];
+	XCTAssertEqualObjects([read cookieHeaderForURL:[NSURL URLWithString:@"https://example.com/"] partition:nil], @"persistent=2");
+	XCTAssertEqualObjects([read cookieHeaderForURL:[NSURL URLWithString:@"https://tracker.example/"] partition:@"example.com"], @"id=3");
+	XCTAssertNil([read cookieHeaderForURL:[NSURL URLWithString:@"https://tracker.example/"] partition:nil]);
+
+	[[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+@end
@@ -0,0 +1,170 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPDiskCache.h"
+
+@interface JAHPDiskCache_Tests : XCTestCase
+@end
+
+@implementation JAHPDiskCache_Tests {
+	NSString *directory;
+	NSData *key;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+	key = [NSMutableData dataWithLength:32];
+}
+
+- (void)tearDown {
+	[[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+	[super tearDown];
+}
+
+- (NSURLRequest *)requestForPath:(NSString *)path {
+	return [NSURLRequest requestWithURL:[NSURL URLWithString:[@"https://example.com/" stringByAppendingString:path]]];
+}
+
+- (NSCachedURLResponse *)cachedResponseForRequest:(NSURLRequest *)request headers:(NSDictionary *)headers body:(NSData *)body {
+	NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:headers];
+	return [[NSCachedURLResponse alloc] initWithResponse:response data:body];
+}
+
+- (void)testStoreAndReopen {
+	JAHPDiskCache *cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	NSURLRequest *request = [self requestForPath:@"a.js"];
+	NSData *body = [@"var a = 1;" dataUsingEncoding:NSUTF8StringEncoding];
+
+	[cache storeCachedResponse:[self cachedResponseForRequest:request headers:@{ @"ETag": @"\"1\"" } body:body] forRequest:request];
+
+	NSCachedURLResponse *cached = [cache cachedResponseForRequest:request];
+	XCTAssertEqualObjects([cached data], body);
+	XCTAssertEqualObjects([(NSHTTPURLResponse *)[cached response] allHeaderFields][@"ETag"], @"\"1\"");
+	XCTAssertNil([cache cachedResponseForRequest:[self requestForPath:@"b.js"]]);
+
+	cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	XCTAssertEqualObjects([[cache cachedResponseForRequest:request] data], body);
+
+	/* nothing written under another key can be read */
+	NSMutableData *otherKey = [key mutableCopy];
+	((uint8_t *)[otherKey mutableBytes])[0] = 1;
+	cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:otherKey capacity:1024 * 1024];
+	XCTAssertNil([cache cachedResponseForRequest:request]);
+	XCTAssertEqual([cache currentDiskUsage], 0);
+}
+
+- (void)testRemovingSites {
+	JAHPDiskCache *cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	NSURLRequest *example = [self requestForPath:@"a.js"];
+	NSURLRequest *cdn = [NSURLRequest requestWithURL:[NSURL URLWithString:@"https://static.cdn.example.org/b.js"]];
+	NSURLRequest *other = [NSURLRequest requestWithURL:[NSURL URLWithString:@"https://other.example.net/c.js"]];
+
+	for (NSURLRequest *request in @[ example, cdn, other ]) {
+		[cache storeCachedResponse:[self cachedResponseForRequest:request headers:@{} body:[[[request URL] path] dataUsingEncoding:NSUTF8StringEncoding]] forRequest:request];
+	}
+
+	[cache removeCachedResponsesForSite:@"www.example.com"];
+	XCTAssertNil([cache cachedResponseForRequest:example]);
+	XCTAssertNotNil([cache cachedResponseForRequest:cdn]);
+	XCTAssertNotNil([cache cachedResponseForRequest:other]);
+
+	[cache removeCachedResponsesExceptForSites:[NSSet setWithObject:@"cdn.example.org"]];
+	XCTAssertNotNil([cache cachedResponseForRequest:cdn]);
+	XCTAssertNil([cache cachedResponseForRequest:other]);
+}
+
+- (void)testBodiesAreEncrypted {
+	JAHPDiskCache *cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	NSURLRequest *request = [self requestForPath:@"secret.txt"];
+	NSData *body = [@"the secret body" dataUsingEncoding:NSUTF8StringEncoding];
+
+	[cache storeCachedResponse:[self cachedResponseForRequest:request headers:@{} body:body] forRequest:request];
+	XCTAssertNotNil([cache cachedResponseForRequest:request]);
+
+	NSDirectoryEnumerator *files = [[NSFileManager defaultManager] enumeratorAtPath:directory];
+	for (NSString *file in files) {
+		NSData *contents = [NSData dataWithContentsOfFile:[directory stringByAppendingPathComponent:file]];
+		XCTAssertEqual([contents rangeOfData:body options:0 range:NSMakeRange(0, [contents length])].location, NSNotFound);
+	}
+}
+
+- (void)testIdenticalBodiesAreStoredOnce {
+	JAHPDiskCache *cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	NSData *body = [NSMutableData dataWithLength:16 * 1024];
+
+	NSURLRequest *first = [self requestForPath:@"v1/lib.js"];
+	[cache storeCachedResponse:[self cachedResponseForRequest:first headers:@{} body:body] forRequest:first];
+	NSUInteger usage = [cache currentDiskUsage];
+
+	NSURLRequest *second = [self requestForPath:@"v2/lib.js"];
+	[cache storeCachedResponse:[self cachedResponseForRequest:second headers:@{} body:body] forRequest:second];
+	XCTAssertLessThan([cache currentDiskUsage], usage + [body length]);
+
+	[cache removeCachedResponseForRequest:first];
+	XCTAssertEqualObjects([[cache cachedResponseForRequest:second] data], body);
+}
+
+- (void)testEviction {
+	JAHPDiskCache *cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:32 * 1024];
+	NSData *body = [NSMutableData dataWithLength:1024];
+	NSURLRequest *request;
+
+	for (int i = 0; i < 64; i++) {
+		request = [self requestForPath:[NSString stringWithFormat:@"%d", i]];
+		NSMutableData *unique = [body mutableCopy];
+		((uint8_t *)[unique mutableBytes])[0] = (uint8_t)i;
+		[cache storeCachedResponse:[self cachedResponseForRequest:request headers:@{} body:unique] forRequest:request];
+	}
+
+	XCTAssertLessThanOrEqual([cache currentDiskUsage], 32 * 1024);
+	XCTAssertNotNil([cache cachedResponseForRequest:request]);
+	XCTAssertNil([cache cachedResponseForRequest:[self requestForPath:@"0"]]);
+
+	[cache removeAllCachedResponses];
+	XCTAssertEqual([cache currentDiskUsage], 0);
+	XCTAssertNil([cache cachedResponseForRequest:request]);
+}
+
+- (void)testShred {
+	JAHPDiskCache *cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	NSURLRequest *request = [self requestForPath:@"a.js"];
+	NSData *body = [@"var a = 1;" dataUsingEncoding:NSUTF8StringEncoding];
+
+	[cache storeCachedResponse:[self cachedResponseForRequest:request headers:@{} body:body] forRequest:request];
+	XCTAssertNotNil([cache cachedResponseForRequest:request]);
+
+	[cache shred];
+	XCTAssertNil([cache cachedResponseForRequest:request]);
+	XCTAssertEqual([cache currentDiskUsage], 0);
+	XCTAssertEqual([[[NSFileManager defaultManager] contentsOfDirectoryAtPath:[directory stringByAppendingPathComponent:@"bodies"] error:nil] count], 0);
+
+	/* still usable, under a key that the old one can't read */
+	[cache storeCachedResponse:[self cachedResponseForRequest:request headers:@{} body:body] forRequest:request];
+	XCTAssertEqualObjects([[cache cachedResponseForRequest:request] data], body);
+
+	cache = [[JAHPDiskCache alloc] initWithDirectory:directory key:key capacity:1024 * 1024];
+	XCTAssertNil([cache cachedResponseForRequest:request]);
+}
+
+- (void)testCacheability {
+	NSURLRequest *request = [self requestForPath:@"a"];
+	NSURLResponse *(^response)(NSInteger, NSDictionary *) = ^(NSInteger status, NSDictionary *headers) {
+		return (NSURLResponse *)[[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:status HTTPVersion:@"HTTP/1.1" headerFields:headers];
+	};
+
+	XCTAssertTrue([JAHPDiskCache isCacheableResponse:response(200, @{ @"Vary": @"Accept-Encoding" }) forRequest:request]);
+	XCTAssertFalse([JAHPDiskCache isCacheableResponse:response(200, @{ @"Vary": @"Accept-Encoding, Cookie" }) forRequest:request]);
+	XCTAssertFalse([JAHPDiskCache isCacheableResponse:response(200, @{ @"set-cookie": @"a=b" }) forRequest:request]);
+	XCTAssertFalse([JAHPDiskCache isCacheableResponse:response(200, @{ @"Cache-Control": @"private, no-store" }) forRequest:request]);
+	XCTAssertFalse([JAHPDiskCache isCacheableResponse:response(200, @{ @"Cache-Control": @"private, max-age=600" }) forRequest:request]);
+	XCTAssertTrue([JAHPDiskCache isCacheableResponse:response(200, @{ @"Cache-Control": @"public, max-age=600" }) forRequest:request]);
+	XCTAssertFalse([JAHPDiskCache isCacheableResponse:response(206, @{}) forRequest:request]);
+
+	NSMutableURLRequest *post = [request mutableCopy];
+	[post setHTTPMethod:@"POST"];
+	XCTAssertFalse([JAHPDiskCache isCacheableResponse:response(200, @{}) forRequest:post]);
+}
+
+@end
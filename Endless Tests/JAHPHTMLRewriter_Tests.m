@@ -0,0 +1,137 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPHTMLRewriter.h"
+
+#define BOOTSTRAP @"<script>boot</script>"
+
+@interface JAHPHTMLRewriter_Tests : XCTestCase
+@end
+
+@implementation JAHPHTMLRewriter_Tests {
+	JAHPHTMLRewriter *rewriter;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	const char *bootstrap = [BOOTSTRAP UTF8String];
+	rewriter = [[JAHPHTMLRewriter alloc] initWithDocumentURL:[NSURL URLWithString:@"https://example.com/dir/page.html"] bootstrap:dispatch_data_create(bootstrap, strlen(bootstrap), NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT) urlProxyPort:8080];
+}
+
+/* feeds chunks through the rewriter and returns everything it produced */
+- (NSString *)rewriteChunks:(NSArray<NSString *> *)chunks {
+	NSMutableData *output = [[NSMutableData alloc] init];
+	for (NSString *chunk in chunks) {
+		[output appendData:[rewriter rewriteData:[chunk dataUsingEncoding:NSUTF8StringEncoding]]];
+	}
+	[output appendData:[rewriter finish]];
+	return [[NSString alloc] initWithData:output encoding:NSUTF8StringEncoding];
+}
+
+- (NSString *)proxied:(NSString *)url {
+	return [JAHPHTMLRewriter urlProxyURLStringForURL:[NSURL URLWithString:url] port:8080];
+}
+
+- (void)testInjectsAfterHead {
+	NSString *out = [self rewriteChunks:@[ @"<!doctype html><html><head><title>t</title></head><body>x</body></html>" ]];
+	XCTAssertEqualObjects(out, @"<!doctype html><html><head>" BOOTSTRAP @"<title>t</title></head><body>x</body></html>");
+}
+
+- (void)testAddsDoctypeWhenMissing {
+	NSString *out = [self rewriteChunks:@[ @"<html><head></head></html>" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html><html><head>" BOOTSTRAP @"</head></html>");
+}
+
+- (void)testInjectsBeforeImpliedHead {
+	NSString *out = [self rewriteChunks:@[ @"<!-- hi -->\n<p>text</p>" ]];
+	XCTAssertEqualObjects(out, @"<!-- hi -->\n<!DOCTYPE html>" BOOTSTRAP @"<p>text</p>");
+}
+
+- (void)testInjectsBeforeText {
+	NSString *out = [self rewriteChunks:@[ @"<!DOCTYPE html>\n  plain text" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html>\n  " BOOTSTRAP @"plain text");
+}
+
+- (void)testInjectsIntoEmptyDocument {
+	NSString *out = [self rewriteChunks:@[ @"" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html>" BOOTSTRAP);
+}
+
+- (void)testTagSplitAcrossChunks {
+	NSString *out = [self rewriteChunks:@[ @"<!DOCTYPE html><he", @"ad lang=\"a>b\"", @">rest" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html><head lang=\"a>b\">" BOOTSTRAP @"rest");
+}
+
+- (void)testAbruptlyClosedComments {
+	NSString *out = [self rewriteChunks:@[ @"<!--><!---><head></head>" ]];
+	XCTAssertEqualObjects(out, @"<!--><!---><!DOCTYPE html><head>" BOOTSTRAP @"</head>");
+}
+
+- (void)testGivesUpAfterOverlongTag {
+	NSString *value = [@"" stringByPaddingToLength:20 * 1024 withString:@"x" startingAtIndex:0];
+	NSString *in = [NSString stringWithFormat:@"<div title=\"%@ <head></head>\"><script>document.write('<video src=v.mp4>')</script><video src=\"v.mp4\"></video>", value];
+	XCTAssertEqualObjects([self rewriteChunks:@[ [in substringToIndex:1000], [in substringFromIndex:1000] ]], in);
+}
+
+- (void)testRewritesMediaSrc {
+	NSString *out = [self rewriteChunks:@[ @"<head></head><video src='v.mp4'><source src=\"/a.webm?x=1&amp;y=2\" type=\"video/webm\"></video><source src=\"s.mp4\">" ]];
+	NSString *expected = [NSString stringWithFormat:@"<!DOCTYPE html><head>" BOOTSTRAP @"</head><video src=\"%@\"><source src=\"%@\" type=\"video/webm\"></video><source src=\"s.mp4\">",
+						  [self proxied:@"https://example.com/dir/v.mp4"],
+						  [self proxied:@"https://example.com/a.webm?x=1&y=2"]];
+	XCTAssertEqualObjects(out, expected);
+}
+
+- (void)testLeavesDataAndProxiedMediaAlone {
+	NSString *proxied = [self proxied:@"https://example.com/a.mp3"];
+	NSString *in = [NSString stringWithFormat:@"<head></head><audio src=\"data:audio/mp3;base64,AAAA\"></audio><audio src=\"%@\"></audio>", proxied];
+	NSString *out = [self rewriteChunks:@[ in ]];
+	XCTAssertEqualObjects(out, [@"<!DOCTYPE html><head>" BOOTSTRAP stringByAppendingString:[in substringFromIndex:[@"<head>" length]]]);
+}
+
+- (void)testHonorsBaseHref {
+	NSString *out = [self rewriteChunks:@[ @"<head><base href=\"https://cdn.example.org/media/\"></head><audio src=a.mp3></audio>" ]];
+	NSString *expected = [NSString stringWithFormat:@"<!DOCTYPE html><head>" BOOTSTRAP @"<base href=\"https://cdn.example.org/media/\"></head><audio src=\"%@\"></audio>",
+						  [self proxied:@"https://cdn.example.org/media/a.mp3"]];
+	XCTAssertEqualObjects(out, expected);
+}
+
+- (void)testScriptContentIsNotMarkup {
+	NSString *script = @"<head><script>var s = '<video src=\"x.mp4\">'; if (a<b) {}</scr' + 'ipt>';</script><video src=\"y.mp4\"></video>";
+	NSString *out = [self rewriteChunks:@[ [script substringToIndex:30], [script substringFromIndex:30] ]];
+	XCTAssertTrue([out containsString:@"'<video src=\"x.mp4\">'"]);
+	XCTAssertTrue([out containsString:[self proxied:@"https://example.com/dir/y.mp4"]]);
+}
+
+- (void)testDataSaverDefersImages {
+	rewriter.dataSaver = YES;
+	NSString *out = [self rewriteChunks:@[ @"<head></head><img src=\"a.png\" srcset=\"b.png 2x\" alt=x><img src=\"data:image/png;base64,AAAA\"><IMG SRC=c.png>" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html><head>" BOOTSTRAP @"</head><img data-psiphon-src=\"a.png\" data-psiphon-srcset=\"b.png 2x\" alt=x><img src=\"data:image/png;base64,AAAA\"><IMG data-psiphon-src=c.png>");
+}
+
+- (void)testDataSaverStopsAutoplay {
+	rewriter.dataSaver = YES;
+	NSString *out = [self rewriteChunks:@[ @"<head></head><video autoplay muted src=\"v.mp4\"></video><audio preload=auto></audio>" ]];
+	NSString *expected = [NSString stringWithFormat:@"<!DOCTYPE html><head>" BOOTSTRAP @"</head><video preload=\"none\" data-psiphon-autoplay muted src=\"%@\"></video><audio preload=\"none\" preload=auto></audio>",
+						  [self proxied:@"https://example.com/dir/v.mp4"]];
+	XCTAssertEqualObjects(out, expected);
+}
+
+- (void)testImagesLoadWithoutDataSaver {
+	NSString *out = [self rewriteChunks:@[ @"<head></head><img src=\"a.png\"><video autoplay></video>" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html><head>" BOOTSTRAP @"</head><img src=\"a.png\"><video autoplay></video>");
+}
+
+- (void)testMarkupForNewClassesAndIDs {
+	rewriter.markupForNewClassesAndIDs = ^NSData *(NSArray<NSString *> *classesAndIDs) {
+		return [[NSString stringWithFormat:@"[%@]", [classesAndIDs componentsJoinedByString:@","]] dataUsingEncoding:NSUTF8StringEncoding];
+	};
+	NSString *out = [self rewriteChunks:@[ @"<html class=h><head></head><body><div class=\"a  b\" id=x></div><p class=a></p><p class='b c'></p></body>" ]];
+	XCTAssertEqualObjects(out, @"<!DOCTYPE html><html class=h><head>" BOOTSTRAP @"</head><body>[.a,.b,#x]<div class=\"a  b\" id=x></div><p class=a></p>[.c]<p class='b c'></p></body>");
+}
+
+- (void)testURLProxyEncoding {
+	XCTAssertEqualObjects([self proxied:@"https://example.com/a?c=d&e=(f)"], @"http://127.0.0.1:8080/tunneled-rewrite/https%3A%2F%2Fexample.com%2Fa%3Fc%3Dd%26e%3D(f)?m3u8=true");
+}
+
+@end
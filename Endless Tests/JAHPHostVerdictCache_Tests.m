@@ -0,0 +1,82 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import <OCMock/OCMock.h>
+
+#import "HSTSCache.h"
+#import "JAHPHostVerdictCache.h"
+#import "URLBlocker.h"
+
+@interface JAHPHostVerdictCache_Tests : XCTestCase
+@end
+
+@implementation JAHPHostVerdictCache_Tests {
+	id urlBlockerMock;
+	HSTSCache *hstsCache;
+	JAHPHostVerdictCache *verdicts;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	urlBlockerMock = OCMClassMock([URLBlocker class]);
+	OCMStub([urlBlockerMock targets]).andReturn(@{ @"twitter.com": @"Twitter" });
+	/* build the index now, since building it invalidates verdicts */
+	[URLBlocker blockingTargetForHost:@"example.com"];
+
+	hstsCache = [[HSTSCache alloc] init];
+	hstsCache.dict = [@{ @"example.com": @{ HSTS_KEY_EXPIRATION: [NSDate dateWithTimeIntervalSinceNow:3600], HSTS_KEY_ALLOW_SUBDOMAINS: @YES } } mutableCopy];
+
+	verdicts = [[JAHPHostVerdictCache alloc] initWithHSTSCache:hstsCache];
+}
+
+- (void)tearDown {
+	[urlBlockerMock stopMocking];
+	[super tearDown];
+}
+
+- (void)testVerdict {
+	JAHPHostVerdict *verdict = [verdicts verdictForHost:@"WWW.Example.com"];
+	XCTAssertTrue(verdict.upgradesToHTTPS);
+	XCTAssertNil(verdict.blockingTarget);
+	XCTAssertEqual([verdicts verdictForHost:@"www.example.com"], verdict);
+
+	verdict = [verdicts verdictForHost:@"api.twitter.com"];
+	XCTAssertFalse(verdict.upgradesToHTTPS);
+	XCTAssertEqualObjects(verdict.blockingTarget, @"Twitter");
+
+	XCTAssertNil([verdicts verdictForHost:nil]);
+}
+
+- (void)testInvalidate {
+	XCTAssertTrue([verdicts verdictForHost:@"example.com"].upgradesToHTTPS);
+
+	hstsCache.dict = [[NSMutableDictionary alloc] init];
+	XCTAssertTrue([verdicts verdictForHost:@"example.com"].upgradesToHTTPS);
+
+	[JAHPHostVerdictCache invalidate];
+	XCTAssertFalse([verdicts verdictForHost:@"example.com"].upgradesToHTTPS);
+}
+
+- (void)testExpiredHSTSEntry {
+	hstsCache.dict = [@{ @"example.com": @{ HSTS_KEY_EXPIRATION: [NSDate dateWithTimeIntervalSinceNow:-1] } } mutableCopy];
+	XCTAssertFalse([verdicts verdictForHost:@"example.com"].upgradesToHTTPS);
+}
+
+- (void)testBlockerTargetsChange {
+	NSURL *url = [NSURL URLWithString:@"https://api.twitter.com/1.1/jot"];
+	NSURL *page = [NSURL URLWithString:@"https://example.com/"];
+
+	XCTAssertNil([verdicts verdictForHost:@"example.com"].blockingTarget);
+	XCTAssertEqualObjects([verdicts blockingTargetForURL:url fromMainDocumentURL:page], @"Twitter");
+
+	/* rebuilding the index must throw away verdicts and first party answers made from the old one */
+	[urlBlockerMock stopMocking];
+	urlBlockerMock = OCMClassMock([URLBlocker class]);
+	OCMStub([urlBlockerMock targets]).andReturn((@{ @"twitter.com": @"Twitter", @"example.com": @"Twitter" }));
+	[URLBlocker blockingTargetForHost:@"example.com"];
+
+	XCTAssertEqualObjects([verdicts verdictForHost:@"example.com"].blockingTarget, @"Twitter");
+	XCTAssertNil([verdicts blockingTargetForURL:url fromMainDocumentURL:page]);
+}
+
+@end
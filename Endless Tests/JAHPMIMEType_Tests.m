@@ -0,0 +1,48 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPAuthenticatingHTTPProtocol.h"
+#import "JAHPMIMEType.h"
+
+@interface JAHPMIMEType_Tests : XCTestCase
+@end
+
+@implementation JAHPMIMEType_Tests
+
+- (NSData *)dataWithBytes:(const char *)bytes length:(NSUInteger)length {
+	return [NSData dataWithBytes:bytes length:length];
+}
+
+- (void)testEssence {
+	XCTAssertEqualObjects([JAHPMIMEType essenceOfContentType:@" Text/HTML ; charset=UTF-8"], @"text/html");
+	XCTAssertNil([JAHPMIMEType essenceOfContentType:@" ; charset=UTF-8"]);
+	XCTAssertNil([JAHPMIMEType essenceOfContentType:nil]);
+}
+
+- (void)testClassify {
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"text/html; charset=utf-8"], CONTENT_TYPE_HTML);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"application/xhtml+xml"], CONTENT_TYPE_HTML);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"application/pdf"], CONTENT_TYPE_FILE);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"IMAGE/SVG+XML"], CONTENT_TYPE_FILE);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"video/mp4"], CONTENT_TYPE_FILE);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"text/css"], CONTENT_TYPE_OTHER);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:@"text/htmlish"], CONTENT_TYPE_OTHER);
+	XCTAssertEqual([JAHPMIMEType classifyContentType:nil], CONTENT_TYPE_OTHER);
+}
+
+- (void)testSniff {
+	XCTAssertEqualObjects([JAHPMIMEType sniffMIMETypeOfData:[self dataWithBytes:"%PDF-1.7\n" length:9]], @"application/pdf");
+	XCTAssertEqualObjects([JAHPMIMEType sniffMIMETypeOfData:[self dataWithBytes:"\x89PNG\r\n\x1A\n\0\0" length:10]], @"image/png");
+	XCTAssertEqualObjects([JAHPMIMEType sniffMIMETypeOfData:[self dataWithBytes:"RIFF\x10\0\0\0WEBPVP8 " length:16]], @"image/webp");
+	XCTAssertEqualObjects([JAHPMIMEType sniffMIMETypeOfData:[self dataWithBytes:"\0\0\0\x18" "ftypmp42" length:12]], @"video/mp4");
+	XCTAssertNil([JAHPMIMEType sniffMIMETypeOfData:[@"<!DOCTYPE html>" dataUsingEncoding:NSUTF8StringEncoding]]);
+	XCTAssertNil([JAHPMIMEType sniffMIMETypeOfData:[self dataWithBytes:"%PD" length:3]]);
+	XCTAssertEqualObjects([JAHPMIMEType fileExtensionForMIMEType:@"application/pdf"], @"pdf");
+}
+
+- (void)testBinary {
+	XCTAssertFalse([JAHPMIMEType isBinaryData:[@"<html>\r\n\t<body>\x1B[0m</body>" dataUsingEncoding:NSUTF8StringEncoding]]);
+	XCTAssertTrue([JAHPMIMEType isBinaryData:[self dataWithBytes:"<html>\0" length:7]]);
+}
+
+@end
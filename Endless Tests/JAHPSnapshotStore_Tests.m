@@ -0,0 +1,59 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPSnapshotStore.h"
+
+@interface JAHPSnapshotStore_Tests : XCTestCase
+@end
+
+@implementation JAHPSnapshotStore_Tests
+
+- (NSHTTPURLResponse *)responseForURL:(NSString *)url headers:(NSDictionary *)headers {
+	return [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:url] statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:headers];
+}
+
+- (void)testRoundTrip {
+	NSData *html = [@"<!DOCTYPE html><p>hello\r\n\r\nworld</p>" dataUsingEncoding:NSUTF8StringEncoding];
+	NSData *css = [@"p { color: red }" dataUsingEncoding:NSUTF8StringEncoding];
+
+	NSMutableData *archive = [NSMutableData data];
+	[archive appendData:[JAHPSnapshotStore WARCRecordForResponse:[self responseForURL:@"https://example.com/#top" headers:@{ @"Content-Type": @"text/html", @"Content-Encoding": @"gzip", @"Content-Length": @"12", @"Set-Cookie": @"a=b" }] data:html]];
+	[archive appendData:[JAHPSnapshotStore WARCRecordForResponse:[self responseForURL:@"https://example.com/a.css" headers:@{ @"Content-Type": @"text/css" }] data:css]];
+
+	NSDictionary<NSString *, NSCachedURLResponse *> *responses = [JAHPSnapshotStore responsesInWARCArchive:archive];
+	XCTAssertEqual([responses count], 2);
+
+	NSCachedURLResponse *document = responses[@"https://example.com/"];
+	NSDictionary *headers = [(NSHTTPURLResponse *)[document response] allHeaderFields];
+	XCTAssertEqualObjects([document data], html);
+	XCTAssertEqual([(NSHTTPURLResponse *)[document response] statusCode], 200);
+	XCTAssertEqualObjects(headers[@"Content-Type"], @"text/html");
+	XCTAssertEqualObjects(headers[@"Content-Length"], ([NSString stringWithFormat:@"%lu", (unsigned long)[html length]]));
+	XCTAssertNil(headers[@"Content-Encoding"]);
+	XCTAssertNil(headers[@"Set-Cookie"]);
+
+	XCTAssertEqualObjects([responses[@"https://example.com/a.css"] data], css);
+}
+
+- (void)testLaterRecordsWin {
+	NSMutableData *archive = [NSMutableData data];
+	[archive appendData:[JAHPSnapshotStore WARCRecordForResponse:[self responseForURL:@"https://example.com/" headers:@{}] data:[@"old" dataUsingEncoding:NSUTF8StringEncoding]]];
+	[archive appendData:[JAHPSnapshotStore WARCRecordForResponse:[self responseForURL:@"https://example.com/" headers:@{}] data:[@"new" dataUsingEncoding:NSUTF8StringEncoding]]];
+
+	NSDictionary<NSString *, NSCachedURLResponse *> *responses = [JAHPSnapshotStore responsesInWARCArchive:archive];
+	XCTAssertEqualObjects([responses[@"https://example.com/"] data], [@"new" dataUsingEncoding:NSUTF8StringEncoding]);
+}
+
+- (void)testTruncatedArchive {
+	NSMutableData *archive = [NSMutableData data];
+	[archive appendData:[JAHPSnapshotStore WARCRecordForResponse:[self responseForURL:@"https://example.com/" headers:@{}] data:[@"first" dataUsingEncoding:NSUTF8StringEncoding]]];
+	NSData *second = [JAHPSnapshotStore WARCRecordForResponse:[self responseForURL:@"https://example.com/b" headers:@{}] data:[@"second" dataUsingEncoding:NSUTF8StringEncoding]];
+	[archive appendData:[second subdataWithRange:NSMakeRange(0, [second length] - 10)]];
+
+	NSDictionary<NSString *, NSCachedURLResponse *> *responses = [JAHPSnapshotStore responsesInWARCArchive:archive];
+	XCTAssertEqual([responses count], 1);
+	XCTAssertNotNil(responses[@"https://example.com/"]);
+	XCTAssertEqual([[JAHPSnapshotStore responsesInWARCArchive:[NSData data]] count], 0);
+}
+
+@end
@@ -0,0 +1,110 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "JAHPTextOnlyReducer.h"
+
+#define BOOTSTRAP @"<script>boot</script>"
+
+@interface JAHPTextOnlyReducer_Tests : XCTestCase
+@end
+
+@implementation JAHPTextOnlyReducer_Tests {
+	JAHPTextOnlyReducer *reducer;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	reducer = [self reducerWithImages:NO];
+}
+
+- (JAHPTextOnlyReducer *)reducerWithImages:(BOOL)images {
+	const char *bootstrap = [BOOTSTRAP UTF8String];
+	return [[JAHPTextOnlyReducer alloc] initWithDocumentURL:[NSURL URLWithString:@"https://example.com/dir/page.html"] bootstrap:dispatch_data_create(bootstrap, strlen(bootstrap), NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT) images:images];
+}
+
+/* feeds chunks through the reducer and returns everything it produced */
+- (NSString *)reduceChunks:(NSArray<NSString *> *)chunks {
+	NSMutableData *output = [[NSMutableData alloc] init];
+	for (NSString *chunk in chunks) {
+		[output appendData:[reducer reduceData:[chunk dataUsingEncoding:NSUTF8StringEncoding]]];
+	}
+	[output appendData:[reducer finish]];
+	return [[NSString alloc] initWithData:output encoding:NSUTF8StringEncoding];
+}
+
+/* returns what the reduced document has in its body */
+- (NSString *)bodyOf:(NSString *)document {
+	NSRange start = [document rangeOfString:@"</head><body>"];
+	NSRange end = [document rangeOfString:@"</body></html>" options:NSBackwardsSearch];
+	XCTAssertNotEqual(start.location, NSNotFound);
+	XCTAssertNotEqual(end.location, NSNotFound);
+	return [document substringWithRange:NSMakeRange(NSMaxRange(start), end.location - NSMaxRange(start))];
+}
+
+/* returns what the reduced document has in its head, before our stylesheet */
+- (NSString *)headOf:(NSString *)document {
+	NSRange start = [document rangeOfString:@"<!DOCTYPE html><html><head>"];
+	NSRange end = [document rangeOfString:@"<meta name=\"viewport\""];
+	XCTAssertEqual(start.location, 0);
+	XCTAssertNotEqual(end.location, NSNotFound);
+	return [document substringWithRange:NSMakeRange(NSMaxRange(start), end.location - NSMaxRange(start))];
+}
+
+- (void)testKeepsStructureWithoutAttributes {
+	NSString *out = [self reduceChunks:@[ @"<html><head><title>T &amp; U</title><style>p{}</style></head><body><div class=\"x\"><h1 id=a>Hi</h1><p style=\"c\">Some <b>bold</b> <span>text</span>.</p></div></body></html>" ]];
+	XCTAssertEqualObjects([self headOf:out], @"<title>T &amp; U</title>");
+	XCTAssertEqualObjects([self bodyOf:out], @"<div><h1>Hi</h1><p>Some <b>bold</b> text.</p></div>");
+	XCTAssertTrue([out containsString:BOOTSTRAP @"</head><body>"]);
+}
+
+- (void)testDropsScriptsAndNavigation {
+	NSString *out = [self reduceChunks:@[ @"<body><nav><ul><li><a href=\"/\">Home</a></li></ul><nav>x</nav></nav><script>if (a<b) document.write(\"<p>no</p>\")</script><p>Yes</p><footer>f</footer><iframe src=\"ad.html\"><p>no</p></iframe></body>" ]];
+	XCTAssertEqualObjects([self bodyOf:out], @"<p>Yes</p>");
+}
+
+- (void)testMakesLinksAbsolute {
+	NSString *out = [self reduceChunks:@[ @"<base href=\"https://cdn.example.org/x/\"><p><a href=\"a.html?b=1&amp;c=2\">one</a> <a href=\"javascript:alert(1)\">two</a> <a href=\" mailto:me@example.com \">three</a></p>" ]];
+	XCTAssertEqualObjects([self bodyOf:out], @"<p><a href=\"https://cdn.example.org/x/a.html?b=1&amp;c=2\">one</a> <a>two</a> <a href=\"mailto:me@example.com\">three</a></p>");
+}
+
+- (void)testReplacesImagesWithAltText {
+	NSString *out = [self reduceChunks:@[ @"<p><img src=\"/a.png\" alt=\"A\"><img src=\"/b.png\"></p>" ]];
+	XCTAssertEqualObjects([self bodyOf:out], @"<p>A</p>");
+}
+
+- (void)testKeepsOwnImages {
+	reducer = [self reducerWithImages:YES];
+	NSString *out = [self reduceChunks:@[ @"<p><img src=\"/a.png\" alt=\"A\"><img src=\"https://other.example/b.png\" alt=\"B &lt;3\"><img src=\"data:image/gif;base64,R0\" data-src=\"c.png\"></p>" ]];
+	XCTAssertEqualObjects([self bodyOf:out], @"<p><img src=\"https://example.com/a.png\" alt=\"A\">B &lt;3<img src=\"https://example.com/dir/c.png\"></p>");
+}
+
+- (void)testChunkBoundaries {
+	NSString *document = @"\uFEFF<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>A</title ><!-- <p>c</p> --></head>\n<body><p title=\"a>b\">x &lt; y < z</p><script>\"</scr\" + \"ipt>\"</script><pre>  q</pre></body></html>";
+
+	NSString *whole = [self reduceChunks:@[ document ]];
+	XCTAssertEqualObjects([self headOf:whole], @"<meta charset=\"utf-8\"><title>A</title>");
+	XCTAssertEqualObjects([self bodyOf:whole], @"<p>x &lt; y &lt; z</p><pre>  q</pre>");
+
+	NSMutableArray<NSString *> *characters = [[NSMutableArray alloc] init];
+	[document enumerateSubstringsInRange:NSMakeRange(0, [document length]) options:NSStringEnumerationByComposedCharacterSequences usingBlock:^(NSString *substring, NSRange substringRange, NSRange enclosingRange, BOOL *stop) {
+		[characters addObject:substring];
+	}];
+	reducer = [self reducerWithImages:NO];
+	XCTAssertEqualObjects([self reduceChunks:characters], whole);
+}
+
+- (void)testReadableText {
+	[reducer reduceData:[@"<html><head><title>t</title></head>\n<body>\n" dataUsingEncoding:NSUTF8StringEncoding]];
+	XCTAssertFalse([reducer hasReadableText]);
+	[reducer reduceData:[@"<div><p>Hi" dataUsingEncoding:NSUTF8StringEncoding]];
+	XCTAssertTrue([reducer hasReadableText]);
+}
+
+- (void)testEmptyDocument {
+	NSString *out = [self reduceChunks:@[ @"" ]];
+	XCTAssertTrue([out hasPrefix:@"<!DOCTYPE html><html><head>"]);
+	XCTAssertTrue([out hasSuffix:BOOTSTRAP @"</head><body></body></html>"]);
+}
+
+@end
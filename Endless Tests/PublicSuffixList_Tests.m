@@ -0,0 +1,103 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "PublicSuffixList.h"
+
+/*
+ * public_suffix_mock_list.dat is compiled by convert_rules.rb from these rules:
+ *
+ *   com, uk, co.uk, jp, *.kawasaki.jp, !city.kawasaki.jp, *.ck, !www.ck, cn, 公司.cn,
+ *   github.io
+ */
+
+@interface PublicSuffixList_Tests : XCTestCase
+@end
+
+@implementation PublicSuffixList_Tests {
+	PublicSuffixList *list;
+}
+
+- (void)setUp {
+	[super setUp];
+
+	NSString *path = [[NSBundle bundleForClass:[self class]] pathForResource:@"public_suffix_mock_list" ofType:@"dat"];
+	NSData *data = [NSData dataWithContentsOfFile:path];
+	if (data == nil)
+		abort();
+
+	list = [[PublicSuffixList alloc] initWithData:data];
+}
+
+- (void)testRegistrableDomain {
+	XCTAssertEqualObjects([list registrableDomainForHost:@"example.com"], @"example.com");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"www.static.example.com"], @"example.com");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"WWW.Example.COM."], @"example.com");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"www.example.co.uk"], @"example.co.uk");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"example.uk"], @"example.uk");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"user.github.io"], @"user.github.io");
+}
+
+- (void)testPublicSuffixesHaveNoRegistrableDomain {
+	XCTAssertNil([list registrableDomainForHost:@"com"]);
+	XCTAssertNil([list registrableDomainForHost:@"co.uk"]);
+	XCTAssertNil([list registrableDomainForHost:@"github.io"]);
+	XCTAssertNil([list registrableDomainForHost:@""]);
+	XCTAssertNil([list registrableDomainForHost:nil]);
+}
+
+- (void)testUnlistedTopLevelDomains {
+	XCTAssertEqualObjects([list registrableDomainForHost:@"a.b.example"], @"b.example");
+	XCTAssertNil([list registrableDomainForHost:@"localhost"]);
+}
+
+- (void)testWildcardsAndExceptions {
+	XCTAssertNil([list registrableDomainForHost:@"foo.ck"]);
+	XCTAssertEqualObjects([list registrableDomainForHost:@"a.b.foo.ck"], @"b.foo.ck");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"www.ck"], @"www.ck");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"a.www.ck"], @"www.ck");
+
+	XCTAssertEqualObjects([list registrableDomainForHost:@"kawasaki.jp"], @"kawasaki.jp");
+	XCTAssertNil([list registrableDomainForHost:@"x.kawasaki.jp"]);
+	XCTAssertEqualObjects([list registrableDomainForHost:@"a.x.kawasaki.jp"], @"a.x.kawasaki.jp");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"a.city.kawasaki.jp"], @"city.kawasaki.jp");
+}
+
+- (void)testInternationalizedDomains {
+	XCTAssertEqualObjects([list registrableDomainForHost:@"www.example.公司.cn"], @"example.公司.cn");
+	XCTAssertEqualObjects([list registrableDomainForHost:@"www.example.xn--55qx5d.cn"], @"example.xn--55qx5d.cn");
+}
+
+- (void)testIPAddresses {
+	XCTAssertNil([list registrableDomainForHost:@"192.168.1.1"]);
+	XCTAssertNil([list registrableDomainForHost:@"::1"]);
+	XCTAssertEqual([list registrableDomainStartInHost:"10.0.0.1" length:8], NSNotFound);
+}
+
+- (void)testSameSite {
+	XCTAssertTrue([list isHost:@"www.example.com" sameSiteAsHost:@"static.example.com"]);
+	XCTAssertTrue([list isHost:@"example.com" sameSiteAsHost:@"EXAMPLE.com"]);
+	XCTAssertFalse([list isHost:@"example.co.uk" sameSiteAsHost:@"example2.co.uk"]);
+	XCTAssertFalse([list isHost:@"a.github.io" sameSiteAsHost:@"b.github.io"]);
+	XCTAssertTrue([list isHost:@"localhost" sameSiteAsHost:@"localhost"]);
+	XCTAssertFalse([list isHost:@"10.0.0.1" sameSiteAsHost:@"10.0.0.2"]);
+	XCTAssertFalse([list isHost:nil sameSiteAsHost:@"example.com"]);
+}
+
+- (void)testMalformedListIsEmpty {
+	PublicSuffixList *empty = [[PublicSuffixList alloc] initWithData:[@"not a list" dataUsingEncoding:NSUTF8StringEncoding]];
+	XCTAssertEqualObjects([empty registrableDomainForHost:@"www.example.co.uk"], @"co.uk");
+}
+
+- (void)testLookupPerformance {
+	const char *hosts[] = { "www.example.com", "static.example.co.uk", "a.b.foo.ck", "user.github.io" };
+	[self measureBlock:^{
+		NSUInteger sum = 0;
+		for (int i = 0; i < 100000; i++) {
+			const char *host = hosts[i % 4];
+			sum += [list registrableDomainStartInHost:host length:strlen(host)];
+		}
+		XCTAssertGreaterThan(sum, 0);
+	}];
+}
+
+@end
@@ -0,0 +1,46 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "SiteDataIndex.h"
+
+@interface SiteDataIndex_Tests : XCTestCase
+@end
+
+@implementation SiteDataIndex_Tests
+
+- (void)testHostOfFileName {
+	XCTAssertEqualObjects([SiteDataIndex hostOfFileName:@"https_m.imgur.com_0.localstorage"], @"m.imgur.com");
+	XCTAssertEqualObjects([SiteDataIndex hostOfFileName:@"https_m.imgur.com_0.localstorage-journal"], @"m.imgur.com");
+	XCTAssertEqualObjects([SiteDataIndex hostOfFileName:@"http_samy.pl_0"], @"samy.pl");
+	XCTAssertEqualObjects([SiteDataIndex hostOfFileName:@"http_under_score.example_8080"], @"under_score.example");
+
+	XCTAssertNil([SiteDataIndex hostOfFileName:@"___IndexedDB"]);
+	XCTAssertNil([SiteDataIndex hostOfFileName:@"JAHPSnapshots"]);
+	XCTAssertNil([SiteDataIndex hostOfFileName:@"ftp_example.com_0"]);
+	XCTAssertNil([SiteDataIndex hostOfFileName:@"https__0"]);
+	XCTAssertNil([SiteDataIndex hostOfFileName:@"https_example.com_x"]);
+}
+
+- (void)testFilesBySite {
+	NSFileManager *fm = [NSFileManager defaultManager];
+	NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+	NSString *indexedDB = [directory stringByAppendingPathComponent:@"___IndexedDB"];
+	[fm createDirectoryAtPath:[indexedDB stringByAppendingPathComponent:@"https_example.com_0"] withIntermediateDirectories:YES attributes:nil error:nil];
+	[fm createDirectoryAtPath:[directory stringByAppendingPathComponent:@"http_www.example.com_0"] withIntermediateDirectories:YES attributes:nil error:nil];
+	[fm createFileAtPath:[directory stringByAppendingPathComponent:@"https_m.example.com_0.localstorage"] contents:nil attributes:nil];
+	[fm createFileAtPath:[directory stringByAppendingPathComponent:@"https_other.example.net_0.localstorage"] contents:nil attributes:nil];
+	[fm createFileAtPath:[directory stringByAppendingPathComponent:@"unrelated.db"] contents:nil attributes:nil];
+
+	SiteDataIndex *index = [[SiteDataIndex alloc] initWithDirectory:directory];
+	NSDictionary<NSString *, NSArray<NSString *> *> *files = [index filesBySite];
+
+	XCTAssertEqual([files count], 2);
+	XCTAssertEqual([files[@"example.com"] count], 3);
+	XCTAssertEqualObjects(files[@"example.net"], @[ [directory stringByAppendingPathComponent:@"https_other.example.net_0.localstorage"] ]);
+	XCTAssertEqual([[index filesForSite:@"www.example.com"] count], 3);
+	XCTAssertEqual([[index filesForSite:@"example.org"] count], 0);
+
+	[fm removeItemAtPath:directory error:nil];
+}
+
+@end
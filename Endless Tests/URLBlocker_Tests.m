@@ -0,0 +1,56 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import <OCMock/OCMock.h>
+
+#import "URLBlocker.h"
+
+@interface URLBlocker_Tests : XCTestCase
+@end
+
+@implementation URLBlocker_Tests
+
+id UBMocked;
+
+- (void)setUp {
+	[super setUp];
+
+	UBMocked = OCMClassMock([URLBlocker class]);
+
+	NSString *path = [[NSBundle bundleForClass:[self class]] pathForResource:@"urlblocker_mock_targets" ofType:@"plist"];
+	if (![[NSFileManager defaultManager] fileExistsAtPath:path])
+		abort();
+
+	OCMStub([UBMocked targets]).andReturn([NSDictionary dictionaryWithContentsOfFile:path]);
+}
+
+- (void)tearDown {
+	[UBMocked stopMocking];
+	[super tearDown];
+}
+
+- (NSString *)targetFor:(NSString *)url {
+	return [URLBlocker blockingTargetForURL:[NSURL URLWithString:url]];
+}
+
+- (void)testBlocksDomainAndSubdomains {
+	XCTAssertEqualObjects([self targetFor:@"https://twitter.com/"], @"Twitter");
+	XCTAssertEqualObjects([self targetFor:@"https://api.twitter.com/1.1/jot"], @"Twitter");
+	XCTAssertEqualObjects([self targetFor:@"https://A.B.Twitter.COM./x"], @"Twitter");
+}
+
+- (void)testDoesNotBlockLookalikes {
+	XCTAssertNil([self targetFor:@"https://nottwitter.com/"]);
+	XCTAssertNil([self targetFor:@"https://twitter.com.example.net/"]);
+	XCTAssertNil([self targetFor:@"https://com/"]);
+	XCTAssertNil([self targetFor:@"https://example.com/twitter.com"]);
+}
+
+- (void)testFirstPartyIsNotBlocked {
+	NSURL *url = [NSURL URLWithString:@"https://api.twitter.com/1.1/jot"];
+
+	XCTAssertNil([URLBlocker blockingTargetForURL:url fromMainDocumentURL:[NSURL URLWithString:@"https://mobile.twitter.com/home"]]);
+	XCTAssertEqualObjects([URLBlocker blockingTargetForURL:url fromMainDocumentURL:[NSURL URLWithString:@"https://example.com/"]], @"Twitter");
+	XCTAssertEqualObjects([URLBlocker blockingTargetForURL:url fromMainDocumentURL:nil], @"Twitter");
+}
+
+@end
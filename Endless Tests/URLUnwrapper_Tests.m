@@ -0,0 +1,58 @@
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+
+#import "URLUnwrapper.h"
+
+@interface URLUnwrapper_Tests : XCTestCase
+@end
+
+@implementation URLUnwrapper_Tests
+
+- (NSString *)unwrap:(NSString *)url hops:(NSUInteger *)hops {
+	return [[URLUnwrapper unwrappedURLForURL:[NSURL URLWithString:url] hops:hops] absoluteString];
+}
+
+- (void)testUnwrapsRedirector {
+	NSUInteger hops = 0;
+	XCTAssertEqualObjects([self unwrap:@"https://l.facebook.com/l.php?u=https%3A%2F%2Fexample.com%2Fa%3Fb%3D1&h=AT0abc" hops:&hops], @"https://example.com/a?b=1");
+	XCTAssertEqual(hops, 1);
+}
+
+- (void)testUnwrapsNestedRedirectors {
+	NSUInteger hops = 0;
+	XCTAssertEqualObjects([self unwrap:@"https://www.google.com/url?sa=t&url=https%3A%2F%2Fl.facebook.com%2Fl.php%3Fu%3Dhttp%253A%252F%252Fexample.com%252F&usg=x" hops:&hops], @"http://example.com/");
+	XCTAssertEqual(hops, 2);
+}
+
+- (void)testUnwrapsWholeQueryRedirector {
+	NSUInteger hops = 0;
+	XCTAssertEqualObjects([self unwrap:@"https://href.li/?https://example.com/x" hops:&hops], @"https://example.com/x");
+	XCTAssertEqual(hops, 1);
+}
+
+- (void)testStripsTrackingParameters {
+	NSUInteger hops = 1;
+	XCTAssertEqualObjects([self unwrap:@"https://example.com/p?id=3&utm_source=news&UTM_Medium=mail&fbclid=abc#top" hops:&hops], @"https://example.com/p?id=3#top");
+	XCTAssertEqual(hops, 0);
+
+	XCTAssertEqualObjects([self unwrap:@"https://example.com/p?gclid=abc" hops:NULL], @"https://example.com/p");
+}
+
+- (void)testStripsTrackingParametersFromDestination {
+	XCTAssertEqualObjects([self unwrap:@"https://out.reddit.com/t3_x?url=https%3A%2F%2Fexample.com%2F%3Fq%3Da%2520b%26utm_campaign%3Dc" hops:NULL], @"https://example.com/?q=a%20b");
+}
+
+- (void)testLeavesOtherURLsAlone {
+	NSURL *url = [NSURL URLWithString:@"https://www.google.com/search?q=https%3A%2F%2Fexample.com%2F&utm=1"];
+	NSUInteger hops = 1;
+	XCTAssertEqual([URLUnwrapper unwrappedURLForURL:url hops:&hops], url);
+	XCTAssertEqual(hops, 0);
+}
+
+- (void)testRefusesNonHTTPDestinations {
+	XCTAssertNil([URLUnwrapper destinationOfRedirectorURL:[NSURL URLWithString:@"https://www.google.com/url?q=javascript%3Aalert(1)"]]);
+	XCTAssertNil([URLUnwrapper destinationOfRedirectorURL:[NSURL URLWithString:@"https://l.facebook.com/l.php?u=%2Frelative"]]);
+	XCTAssertNil([URLUnwrapper destinationOfRedirectorURL:[NSURL URLWithString:@"https://l.facebook.com/l.php"]]);
+}
+
+@end
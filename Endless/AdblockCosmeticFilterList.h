@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Picks the Adblock Plus element hiding filters (##selector) that apply to a page.
+ *  \details convert_rules.rb compiles the filters into adblock_cosmetic_filters.txt, one
+ *  selector per line filed under a key: the domain it applies to, "@" and a domain it is
+ *  excepted on, or, for a generic filter, the class (".name") or id ("#name") that an
+ *  element it hides must have.  Generic filters with no class or id to file them under
+ *  are left out, since they would have to go to every page.
+ *
+ *  Rather than a global stylesheet, a page gets the filters for its host in its head, and
+ *  each generic filter just before the first element that has its class or id; see
+ *  JAHPHTMLRewriter.  The selectors for a host are looked up once and cached, so the
+ *  lookups on the way through a document are one hash lookup each.
+ *
+ *  The compiled list is mapped rather than read, and selectors are copied out of it only
+ *  when they're delivered.  Besides the mapping it costs 20 bytes per filter plus its hash
+ *  table, and no more than MAX_FILTERS filters are loaded.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface AdblockCosmeticFilterList : NSObject
+
++ (nonnull instancetype)sharedList;
+
+/*! Loads a list compiled by convert_rules.rb.
+ */
+
+- (nonnull instancetype)initWithData:(nonnull NSData *)data;
+
+@property (readonly) NSUInteger count;
+
+/*! Returns the selectors to hide on pages from host: those of the filters for host and
+ *  its parent domains that aren't excepted on any of them.
+ */
+
+- (nonnull NSArray<NSString *> *)selectorsForHost:(nullable NSString *)host;
+
+/*! Returns the selectors of the generic filters filed under key (".class" or "#id") that
+ *  aren't excepted on host.
+ */
+
+- (nonnull NSArray<NSString *> *)genericSelectorsForKey:(nonnull NSString *)key host:(nullable NSString *)host;
+
+/*! Returns a <style> element hiding everything selectors match, or nil if there are none.
+ *  \param nonce The CSP nonce of the document, which the element needs if the document's
+ *  policy limits styles.
+ */
+
++ (nullable NSData *)styleElementHidingSelectors:(nonnull NSArray<NSString *> *)selectors nonce:(nonnull NSString *)nonce;
+
+@end
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "AdblockCosmeticFilterList.h"
+
+#define MAX_FILTERS 262144
+#define MIN_BUCKETS 256
+
+/* hosts whose selectors are kept */
+#define HOST_CACHE_SIZE 64
+
+#define NO_FILTER UINT32_MAX
+
+typedef struct {
+	uint32_t next;			/* the next filter in the same bucket, or NO_FILTER */
+	uint32_t keyHash;
+	uint32_t key;			/* offset of the key in the compiled list */
+	uint32_t selector;		/* offset of the selector */
+	uint16_t keyLength;
+	uint16_t selectorLength;
+} AdblockCosmeticFilter;
+
+static uint32_t hashKey(const char *s, size_t length)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)s[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/*! The selectors for one host, and the selectors excepted on it.
+ */
+
+@interface AdblockCosmeticHostFilters : NSObject
+@property (nonatomic, strong) NSArray<NSString *> *selectors;
+@property (nonatomic, strong) NSSet<NSString *> *exceptions;
+@end
+
+@implementation AdblockCosmeticHostFilters
+@end
+
+@implementation AdblockCosmeticFilterList {
+	NSData *_data;
+	AdblockCosmeticFilter *_filters;
+	uint32_t _count;
+	uint32_t *_buckets;
+	uint32_t _bucketMask;
+	NSCache<NSString *, AdblockCosmeticHostFilters *> *_hostFilters;
+}
+
++ (instancetype)sharedList
+{
+	static AdblockCosmeticFilterList *list;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSString *path = [[NSBundle mainBundle] pathForResource:@"adblock_cosmetic_filters" ofType:@"txt"];
+		NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+		if (data == nil) {
+			NSLog(@"[AdblockCosmeticFilterList] no compiled filter list at %@", path);
+			abort();
+		}
+
+		list = [[AdblockCosmeticFilterList alloc] initWithData:data];
+		NSLog(@"[AdblockCosmeticFilterList] loaded %lu filters", (unsigned long)[list count]);
+	});
+	return list;
+}
+
+- (instancetype)initWithData:(NSData *)data
+{
+	self = [super init];
+	if (self == nil) {
+		return nil;
+	}
+
+	_data = data;
+	_hostFilters = [[NSCache alloc] init];
+	[_hostFilters setCountLimit:HOST_CACHE_SIZE];
+
+	const char *bytes = [_data bytes];
+	size_t length = [_data length];
+
+	uint32_t lines = 1;
+	for (size_t i = 0; i < length; i++) {
+		if (bytes[i] == '\n') {
+			lines++;
+		}
+	}
+	lines = MIN(lines, MAX_FILTERS);
+
+	uint32_t buckets = MIN_BUCKETS;
+	while (buckets < lines * 2) {
+		buckets <<= 1;
+	}
+	_bucketMask = buckets - 1;
+
+	_filters = calloc(lines, sizeof(AdblockCosmeticFilter));
+	_buckets = malloc(buckets * sizeof(uint32_t));
+	memset(_buckets, 0xff, buckets * sizeof(uint32_t));
+
+	for (size_t start = 0; start < length && _count < lines; ) {
+		size_t end = start;
+		while (end < length && bytes[end] != '\n') {
+			end++;
+		}
+
+		/* key, selector */
+		const char *tab = memchr(bytes + start, '\t', end - start);
+
+		if (end > start && bytes[start] != '!' && tab != NULL) {
+			size_t keyLength = (size_t)(tab - (bytes + start));
+			size_t selectorLength = end - start - keyLength - 1;
+
+			if (keyLength > 0 && keyLength <= UINT16_MAX && selectorLength > 0 && selectorLength <= UINT16_MAX) {
+				AdblockCosmeticFilter *filter = &_filters[_count];
+
+				filter->keyHash = hashKey(bytes + start, keyLength);
+				filter->key = (uint32_t)start;
+				filter->keyLength = (uint16_t)keyLength;
+				filter->selector = (uint32_t)(start + keyLength + 1);
+				filter->selectorLength = (uint16_t)selectorLength;
+
+				uint32_t *bucket = _buckets + (filter->keyHash & _bucketMask);
+				filter->next = *bucket;
+				*bucket = _count;
+				_count++;
+			}
+		}
+
+		start = end + 1;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	free(_filters);
+	free(_buckets);
+}
+
+- (NSUInteger)count
+{
+	return _count;
+}
+
+/*! Adds the selectors filed under key to selectors.
+ */
+
+- (void)addSelectorsForKey:(NSString *)key to:(NSMutableArray<NSString *> *)selectors
+{
+	const char *base = [_data bytes];
+	const char *k = [key UTF8String];
+	size_t kl = strlen(k);
+	uint32_t hash = hashKey(k, kl);
+
+	for (uint32_t n = _buckets[hash & _bucketMask]; n != NO_FILTER; n = _filters[n].next) {
+		const AdblockCosmeticFilter *f = &_filters[n];
+
+		if (f->keyHash == hash && f->keyLength == kl && memcmp(base + f->key, k, kl) == 0) {
+			[selectors addObject:[[NSString alloc] initWithBytes:(base + f->selector) length:f->selectorLength encoding:NSUTF8StringEncoding]];
+		}
+	}
+}
+
+- (AdblockCosmeticHostFilters *)filtersForHost:(NSString *)host
+{
+	host = [host lowercaseString];
+	if (host == nil || [host length] == 0) {
+		return nil;
+	}
+
+	AdblockCosmeticHostFilters *hostFilters = [_hostFilters objectForKey:host];
+	if (hostFilters != nil) {
+		return hostFilters;
+	}
+
+	NSMutableArray<NSString *> *selectors = [[NSMutableArray alloc] init];
+	NSMutableArray<NSString *> *exceptions = [[NSMutableArray alloc] init];
+
+	/* the host itself and each domain above it */
+	NSArray<NSString *> *labels = [host componentsSeparatedByString:@"."];
+	for (NSUInteger i = 0; i < [labels count]; i++) {
+		NSString *domain = [[labels subarrayWithRange:NSMakeRange(i, [labels count] - i)] componentsJoinedByString:@"."];
+		[self addSelectorsForKey:domain to:selectors];
+		[self addSelectorsForKey:[@"@" stringByAppendingString:domain] to:exceptions];
+	}
+
+	hostFilters = [[AdblockCosmeticHostFilters alloc] init];
+	hostFilters.exceptions = [NSSet setWithArray:exceptions];
+	[selectors removeObjectsInArray:exceptions];
+	hostFilters.selectors = [[NSOrderedSet orderedSetWithArray:selectors] array];
+
+	[_hostFilters setObject:hostFilters forKey:host];
+	return hostFilters;
+}
+
+- (NSArray<NSString *> *)selectorsForHost:(NSString *)host
+{
+	return [[self filtersForHost:host] selectors] ?: @[];
+}
+
+- (NSArray<NSString *> *)genericSelectorsForKey:(NSString *)key host:(NSString *)host
+{
+	NSMutableArray<NSString *> *selectors = [[NSMutableArray alloc] init];
+	[self addSelectorsForKey:key to:selectors];
+
+	NSSet<NSString *> *exceptions = [[self filtersForHost:host] exceptions];
+	if ([exceptions count] > 0) {
+		[selectors filterUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(NSString *selector, NSDictionary *bindings) {
+			return ![exceptions containsObject:selector];
+		}]];
+	}
+
+	return selectors;
+}
+
++ (NSData *)styleElementHidingSelectors:(NSArray<NSString *> *)selectors nonce:(NSString *)nonce
+{
+	if ([selectors count] == 0) {
+		return nil;
+	}
+
+	/* a rule is dropped whole if any selector in it is invalid, so each gets its own */
+	NSMutableString *style = [[NSMutableString alloc] initWithFormat:@"<style nonce=\"%@\">", nonce];
+	for (NSString *selector in selectors) {
+		[style appendFormat:@"%@{display:none!important}", selector];
+	}
+	[style appendString:@"</style>"];
+
+	return [style dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+@end
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+typedef NS_ENUM(NSInteger, AdblockRequestType) {
+	AdblockRequestTypeOther = 0,
+	AdblockRequestTypeScript,
+	AdblockRequestTypeImage,
+	AdblockRequestTypeStylesheet,
+	AdblockRequestTypeXMLHTTPRequest,
+	AdblockRequestTypeSubdocument,
+	AdblockRequestTypeFont,
+	AdblockRequestTypeMedia,
+	AdblockRequestTypeObject,
+};
+
+/*! Matches requests against Adblock Plus network filters (EasyList, EasyPrivacy and our
+ *  own adblock.txt).
+ *  \details convert_rules.rb compiles the filter lists into adblock_network_filters.txt,
+ *  one filter per line with its options already parsed, and picks for each filter the
+ *  rarest run of letters and digits that any URL it matches must contain.  Filters are
+ *  indexed by a hash of that token, so a URL is only checked against the filters filed
+ *  under its own tokens, a handful out of tens of thousands.
+ *
+ *  The compiled list is mapped rather than read, and patterns are matched where they lie
+ *  in it.  Besides the mapping a list costs a fixed 24 bytes per filter plus its hash
+ *  tables, and no more than MAX_FILTERS filters are loaded.
+ *
+ *  Regular expression filters and options that make no sense for a browser that only
+ *  sees requests (popup, csp, redirect...) are dropped when the list is compiled.
+ *
+ *  A list is immutable once loaded, so all methods can be called on any thread.
+ */
+
+@interface AdblockFilterList : NSObject
+
+/*! The list compiled from the bundled filter lists.
+ */
+
++ (nonnull instancetype)sharedList;
+
+/*! Loads a list compiled by convert_rules.rb.
+ */
+
+- (nonnull instancetype)initWithData:(nonnull NSData *)data;
+
+@property (readonly) NSUInteger count;
+
+/*! Guesses what the page wants a request for, from its URL and Accept header, since
+ *  NSURLProtocol isn't told.
+ */
+
++ (AdblockRequestType)typeOfRequest:(nonnull NSURLRequest *)request;
+
+/*! Returns the filter that blocks url, or nil if url may be loaded.
+ *  \details A request matched by an exception filter (@@), or made from a page matched
+ *  by a $document exception filter, is never blocked.
+ *  \param mainDocumentURL The URL of the page loading url, may be nil.
+ *  \returns The pattern of the blocking filter, for logging.
+ */
+
+- (nullable NSString *)filterBlockingURL:(nonnull NSURL *)url type:(AdblockRequestType)type mainDocumentURL:(nullable NSURL *)mainDocumentURL;
+
+@end
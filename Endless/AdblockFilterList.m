@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "AdblockFilterList.h"
+#import "PublicSuffixList.h"
+
+/* flags compiled into each filter by convert_rules.rb */
+#define FILTER_EXCEPTION	0x0001
+#define FILTER_THIRD_PARTY	0x0002
+#define FILTER_FIRST_PARTY	0x0004
+#define FILTER_DOCUMENT		0x0008
+#define FILTER_HOST_ANCHOR	0x2000
+#define FILTER_START_ANCHOR	0x4000
+#define FILTER_END_ANCHOR	0x8000
+
+/* the type bits of the flags, by AdblockRequestType */
+static const uint16_t typeFlags[] = {
+	[AdblockRequestTypeOther] = 0x1000,
+	[AdblockRequestTypeScript] = 0x0010,
+	[AdblockRequestTypeImage] = 0x0020,
+	[AdblockRequestTypeStylesheet] = 0x0040,
+	[AdblockRequestTypeXMLHTTPRequest] = 0x0080,
+	[AdblockRequestTypeSubdocument] = 0x0100,
+	[AdblockRequestTypeFont] = 0x0200,
+	[AdblockRequestTypeMedia] = 0x0400,
+	[AdblockRequestTypeObject] = 0x0800,
+};
+
+#define MAX_FILTERS 262144
+#define MIN_BUCKETS 256
+
+/* longer URLs are only matched up to here, they are almost always data we don't care about */
+#define MAX_URL_LENGTH 2048
+
+#define NO_FILTER UINT32_MAX
+
+typedef struct {
+	uint32_t next;			/* the next filter in the same bucket, or NO_FILTER */
+	uint32_t tokenHash;
+	uint32_t pattern;		/* offset of the pattern in the compiled list */
+	uint32_t domains;		/* offset of the domain list, '|' separated with '~' for exclusions */
+	uint16_t patternLength;
+	uint16_t domainsLength;
+	uint16_t flags;
+} AdblockFilter;
+
+/* what a filter is matched against */
+typedef struct {
+	const char *url;		/* lowercased */
+	size_t length;
+	size_t hostStart;
+	size_t hostEnd;
+	const char *documentHost;	/* lowercased, or NULL */
+	size_t documentHostLength;
+	uint16_t typeFlag;
+	BOOL thirdParty;
+} AdblockMatchContext;
+
+static inline BOOL isTokenChar(unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '%';
+}
+
+/* what "^" in a pattern matches, besides the end of the URL */
+static inline BOOL isSeparator(unsigned char c)
+{
+	return !(isalnum(c) || c == '_' || c == '-' || c == '.' || c == '%' || c >= 0x80);
+}
+
+static uint32_t hashToken(const char *s, size_t length)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)s[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* matches pattern against the start of text, or all of it if endAnchor */
+static BOOL globMatch(const char *p, size_t pl, const char *t, size_t tl, BOOL endAnchor)
+{
+	size_t pi = 0, ti = 0;
+	size_t starP = SIZE_MAX, starT = 0;
+
+	for (;;) {
+		if (pi == pl) {
+			if (!endAnchor || ti == tl) {
+				return YES;
+			}
+		} else if (p[pi] == '*') {
+			starP = ++pi;
+			starT = ti;
+			continue;
+		} else if (ti < tl && (p[pi] == '^' ? isSeparator(t[ti]) : p[pi] == t[ti])) {
+			pi++;
+			ti++;
+			continue;
+		} else if (ti == tl && p[pi] == '^') {
+			pi++;
+			continue;
+		}
+
+		/* let the last wildcard swallow one more character and try again */
+		if (starP == SIZE_MAX || starT == tl) {
+			return NO;
+		}
+		pi = starP;
+		ti = ++starT;
+	}
+}
+
+/* whether host is domain or one of its subdomains */
+static BOOL hostMatchesDomain(const char *host, size_t hostLength, const char *domain, size_t domainLength)
+{
+	if (domainLength == 0 || hostLength < domainLength) {
+		return NO;
+	}
+	if (memcmp(host + hostLength - domainLength, domain, domainLength) != 0) {
+		return NO;
+	}
+	return (hostLength == domainLength || host[hostLength - domainLength - 1] == '.');
+}
+
+static BOOL domainsApply(const char *domains, size_t length, const AdblockMatchContext *c)
+{
+	BOOL included = NO, anyIncluded = NO;
+
+	for (size_t start = 0; start < length; ) {
+		size_t end = start;
+		while (end < length && domains[end] != '|') {
+			end++;
+		}
+
+		BOOL exclusion = (domains[start] == '~');
+		const char *domain = domains + start + (exclusion ? 1 : 0);
+		size_t domainLength = end - start - (exclusion ? 1 : 0);
+		BOOL matches = (c->documentHost != NULL && hostMatchesDomain(c->documentHost, c->documentHostLength, domain, domainLength));
+
+		if (exclusion && matches) {
+			return NO;
+		}
+		if (!exclusion) {
+			anyIncluded = YES;
+			included = included || matches;
+		}
+
+		start = end + 1;
+	}
+
+	return (!anyIncluded || included);
+}
+
+static BOOL patternMatches(const char *p, size_t pl, uint16_t flags, const AdblockMatchContext *c)
+{
+	const char *t = c->url;
+	size_t tl = c->length;
+	BOOL endAnchor = ((flags & FILTER_END_ANCHOR) != 0);
+
+	if (flags & FILTER_HOST_ANCHOR) {
+		for (size_t i = c->hostStart; i < c->hostEnd; i++) {
+			if ((i == c->hostStart || t[i - 1] == '.') && globMatch(p, pl, t + i, tl - i, endAnchor)) {
+				return YES;
+			}
+		}
+		return NO;
+	}
+
+	if (flags & FILTER_START_ANCHOR) {
+		return globMatch(p, pl, t, tl, endAnchor);
+	}
+
+	for (size_t i = 0; i <= tl; i++) {
+		/* cheap check of the first character before starting a match there */
+		if (pl > 0 && p[0] != '*' && p[0] != '^' && (i == tl || t[i] != p[0])) {
+			continue;
+		}
+		if (globMatch(p, pl, t + i, tl - i, endAnchor)) {
+			return YES;
+		}
+	}
+	return NO;
+}
+
+/* the registrable domain of host, or all of it if it has none */
+static size_t siteOfHost(const char *host, size_t length)
+{
+	NSUInteger start = [[PublicSuffixList sharedList] registrableDomainStartInHost:host length:length];
+	return (start != NSNotFound ? start : 0);
+}
+
+static BOOL isThirdParty(const char *host, size_t hostLength, const char *documentHost, size_t documentHostLength)
+{
+	size_t a = siteOfHost(host, hostLength);
+	size_t b = siteOfHost(documentHost, documentHostLength);
+	return (hostLength - a != documentHostLength - b || memcmp(host + a, documentHost + b, hostLength - a) != 0);
+}
+
+/* finds the host in a lowercased absolute URL */
+static void findHost(const char *url, size_t length, size_t *hostStart, size_t *hostEnd)
+{
+	const char *scheme = strstr(url, "://");
+	size_t start = (scheme != NULL ? (size_t)(scheme - url) + 3 : 0);
+	size_t end = start;
+
+	while (end < length && url[end] != '/' && url[end] != '?' && url[end] != '#' && url[end] != ':') {
+		if (url[end] == '@') {
+			start = end + 1;
+		}
+		end++;
+	}
+
+	*hostStart = start;
+	*hostEnd = end;
+}
+
+static uint16_t parseFlags(const char *hex, size_t length)
+{
+	uint16_t flags = 0;
+	for (size_t i = 0; i < length; i++) {
+		flags = (uint16_t)(flags << 4) | (uint16_t)digittoint(hex[i]);
+	}
+	return flags;
+}
+
+/* copies url lowercased into buffer, which must hold MAX_URL_LENGTH + 1 bytes */
+static size_t copyLowercaseURL(NSURL *url, char *buffer)
+{
+	const char *s = [[url absoluteString] UTF8String];
+	size_t length = 0;
+
+	while (s != NULL && s[length] != '\0' && length < MAX_URL_LENGTH) {
+		buffer[length] = (char)tolower((unsigned char)s[length]);
+		length++;
+	}
+	buffer[length] = '\0';
+
+	return length;
+}
+
+/* returns the first filter in the bucket chain starting at n that applies and matches, or NULL */
+static const AdblockFilter *matchInBucket(const AdblockFilter *filters, const char *base, uint32_t n, uint32_t hash, const AdblockMatchContext *c, BOOL document)
+{
+	for (; n != NO_FILTER; n = filters[n].next) {
+		const AdblockFilter *f = &filters[n];
+
+		if (f->tokenHash != hash) {
+			continue;
+		}
+		/* $document exceptions only apply to the page, everything else only to the request */
+		if (((f->flags & FILTER_DOCUMENT) != 0) != document) {
+			continue;
+		}
+		if (!document && !(f->flags & c->typeFlag)) {
+			continue;
+		}
+		if ((f->flags & FILTER_THIRD_PARTY) && !c->thirdParty) {
+			continue;
+		}
+		if ((f->flags & FILTER_FIRST_PARTY) && c->thirdParty) {
+			continue;
+		}
+		if (f->domainsLength > 0 && !domainsApply(base + f->domains, f->domainsLength, c)) {
+			continue;
+		}
+		if (patternMatches(base + f->pattern, f->patternLength, f->flags, c)) {
+			return f;
+		}
+	}
+
+	return NULL;
+}
+
+/* returns the first filter that matches, trying the untokenized filters and then those filed under each of the URL's tokens */
+static const AdblockFilter *matchFilters(const AdblockFilter *filters, const char *base, const uint32_t *buckets, uint32_t bucketMask, uint32_t untokenizedHash, const AdblockMatchContext *c, BOOL document)
+{
+	const AdblockFilter *f = matchInBucket(filters, base, buckets[untokenizedHash & bucketMask], untokenizedHash, c, document);
+
+	for (size_t i = 0; f == NULL && i < c->length; ) {
+		if (!isTokenChar(c->url[i])) {
+			i++;
+			continue;
+		}
+
+		size_t start = i;
+		while (i < c->length && isTokenChar(c->url[i])) {
+			i++;
+		}
+
+		uint32_t hash = hashToken(c->url + start, i - start);
+		f = matchInBucket(filters, base, buckets[hash & bucketMask], hash, c, document);
+	}
+
+	return f;
+}
+
+@implementation AdblockFilterList {
+	NSData *_data;
+	AdblockFilter *_filters;
+	uint32_t _count;
+	uint32_t *_blockBuckets;
+	uint32_t *_exceptionBuckets;
+	uint32_t _bucketMask;
+	uint32_t _untokenizedHash;
+}
+
++ (instancetype)sharedList
+{
+	static AdblockFilterList *list;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSString *path = [[NSBundle mainBundle] pathForResource:@"adblock_network_filters" ofType:@"txt"];
+		NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+		if (data == nil) {
+			NSLog(@"[AdblockFilterList] no compiled filter list at %@", path);
+			abort();
+		}
+
+		list = [[AdblockFilterList alloc] initWithData:data];
+		NSLog(@"[AdblockFilterList] loaded %lu filters", (unsigned long)[list count]);
+	});
+	return list;
+}
+
+- (instancetype)initWithData:(NSData *)data
+{
+	self = [super init];
+	if (self == nil) {
+		return nil;
+	}
+
+	_data = data;
+	const char *bytes = [_data bytes];
+	size_t length = [_data length];
+
+	uint32_t lines = 1;
+	for (size_t i = 0; i < length; i++) {
+		if (bytes[i] == '\n') {
+			lines++;
+		}
+	}
+	lines = MIN(lines, MAX_FILTERS);
+
+	uint32_t buckets = MIN_BUCKETS;
+	while (buckets < lines * 2) {
+		buckets <<= 1;
+	}
+	_bucketMask = buckets - 1;
+
+	_filters = calloc(lines, sizeof(AdblockFilter));
+	_blockBuckets = malloc(buckets * sizeof(uint32_t));
+	_exceptionBuckets = malloc(buckets * sizeof(uint32_t));
+	memset(_blockBuckets, 0xff, buckets * sizeof(uint32_t));
+	memset(_exceptionBuckets, 0xff, buckets * sizeof(uint32_t));
+	_untokenizedHash = hashToken("", 0);
+
+	for (size_t start = 0; start < length && _count < lines; ) {
+		size_t end = start;
+		while (end < length && bytes[end] != '\n') {
+			end++;
+		}
+
+		/* token, flags, pattern, domains */
+		size_t fields[4][2];
+		int nfields = 0;
+		size_t f = start;
+		for (size_t i = start; i <= end && nfields < 4; i++) {
+			if (i == end || bytes[i] == '\t') {
+				fields[nfields][0] = f;
+				fields[nfields][1] = i - f;
+				nfields++;
+				f = i + 1;
+			}
+		}
+
+		if (end > start && bytes[start] != '!' && nfields >= 3 && fields[2][1] <= UINT16_MAX && (nfields < 4 || fields[3][1] <= UINT16_MAX)) {
+			AdblockFilter *filter = &_filters[_count];
+
+			filter->tokenHash = hashToken(bytes + fields[0][0], fields[0][1]);
+			filter->flags = parseFlags(bytes + fields[1][0], fields[1][1]);
+			filter->pattern = (uint32_t)fields[2][0];
+			filter->patternLength = (uint16_t)fields[2][1];
+			if (nfields == 4) {
+				filter->domains = (uint32_t)fields[3][0];
+				filter->domainsLength = (uint16_t)fields[3][1];
+			}
+
+			uint32_t *bucket = ((filter->flags & FILTER_EXCEPTION) ? _exceptionBuckets : _blockBuckets) + (filter->tokenHash & _bucketMask);
+			filter->next = *bucket;
+			*bucket = _count;
+			_count++;
+		}
+
+		start = end + 1;
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	free(_filters);
+	free(_blockBuckets);
+	free(_exceptionBuckets);
+}
+
+- (NSUInteger)count
+{
+	return _count;
+}
+
++ (AdblockRequestType)typeOfRequest:(NSURLRequest *)request
+{
+	static NSDictionary *typesByExtension;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		typesByExtension = @{
+			@"js": @(AdblockRequestTypeScript),
+			@"css": @(AdblockRequestTypeStylesheet),
+			@"png": @(AdblockRequestTypeImage),
+			@"jpg": @(AdblockRequestTypeImage),
+			@"jpeg": @(AdblockRequestTypeImage),
+			@"gif": @(AdblockRequestTypeImage),
+			@"webp": @(AdblockRequestTypeImage),
+			@"svg": @(AdblockRequestTypeImage),
+			@"ico": @(AdblockRequestTypeImage),
+			@"woff": @(AdblockRequestTypeFont),
+			@"woff2": @(AdblockRequestTypeFont),
+			@"ttf": @(AdblockRequestTypeFont),
+			@"otf": @(AdblockRequestTypeFont),
+			@"eot": @(AdblockRequestTypeFont),
+			@"mp4": @(AdblockRequestTypeMedia),
+			@"webm": @(AdblockRequestTypeMedia),
+			@"mp3": @(AdblockRequestTypeMedia),
+			@"m4a": @(AdblockRequestTypeMedia),
+			@"m3u8": @(AdblockRequestTypeMedia),
+			@"swf": @(AdblockRequestTypeObject),
+		};
+	});
+
+	NSNumber *type = [typesByExtension objectForKey:[[[request URL] pathExtension] lowercaseString]];
+	if (type != nil) {
+		return [type integerValue];
+	}
+
+	if ([[request valueForHTTPHeaderField:@"X-Requested-With"] isEqualToString:@"XMLHttpRequest"]) {
+		return AdblockRequestTypeXMLHTTPRequest;
+	}
+
+	NSString *accept = [request valueForHTTPHeaderField:@"Accept"];
+	if ([accept hasPrefix:@"image/"]) {
+		return AdblockRequestTypeImage;
+	} else if ([accept hasPrefix:@"text/css"]) {
+		return AdblockRequestTypeStylesheet;
+	} else if ([accept hasPrefix:@"text/html"]) {
+		/* a page asking for another page is loading a frame */
+		return AdblockRequestTypeSubdocument;
+	}
+
+	return AdblockRequestTypeOther;
+}
+
+- (NSString *)filterBlockingURL:(NSURL *)url type:(AdblockRequestType)type mainDocumentURL:(NSURL *)mainDocumentURL
+{
+	char urlBuffer[MAX_URL_LENGTH + 1];
+	char documentBuffer[MAX_URL_LENGTH + 1];
+	AdblockMatchContext c = { 0 };
+
+	if (_count == 0 || type < 0 || type >= (AdblockRequestType)(sizeof(typeFlags) / sizeof(typeFlags[0]))) {
+		return nil;
+	}
+
+	c.url = urlBuffer;
+	c.length = copyLowercaseURL(url, urlBuffer);
+	c.typeFlag = typeFlags[type];
+	findHost(c.url, c.length, &c.hostStart, &c.hostEnd);
+
+	AdblockMatchContext d = { 0 };
+	if (mainDocumentURL != nil) {
+		d.url = documentBuffer;
+		d.length = copyLowercaseURL(mainDocumentURL, documentBuffer);
+		findHost(d.url, d.length, &d.hostStart, &d.hostEnd);
+		d.documentHost = d.url + d.hostStart;
+		d.documentHostLength = d.hostEnd - d.hostStart;
+
+		c.documentHost = d.documentHost;
+		c.documentHostLength = d.documentHostLength;
+		c.thirdParty = isThirdParty(c.url + c.hostStart, c.hostEnd - c.hostStart, c.documentHost, c.documentHostLength);
+	}
+
+	const char *base = [_data bytes];
+	const AdblockFilter *filter = matchFilters(_filters, base, _blockBuckets, _bucketMask, _untokenizedHash, &c, NO);
+	if (filter == NULL) {
+		return nil;
+	}
+
+	if (matchFilters(_filters, base, _exceptionBuckets, _bucketMask, _untokenizedHash, &c, NO) != NULL) {
+		return nil;
+	}
+	if (d.url != NULL && matchFilters(_filters, base, _exceptionBuckets, _bucketMask, _untokenizedHash, &d, YES) != NULL) {
+		return nil;
+	}
+
+	return [[NSString alloc] initWithBytes:(base + filter->pattern) length:filter->patternLength encoding:NSASCIIStringEncoding];
+}
+
+@end
@@ -59,6 +59,7 @@
 + (AppDelegate *)sharedAppDelegate;
 
 - (BOOL)areTesting;
+- (BOOL)clearAllWhenBackgrounded;
 
 
 @property(strong, nonatomic) PsiphonTunnel* psiphonTunnel;
@@ -31,9 +31,12 @@
 #import "AppDelegate.h"
 #import "Bookmark.h"
 #import "HTTPSEverywhere.h"
+#import "JAHPCookieStore.h"
+#import "JAHPTrash.h"
 #import "Privacy.h"
 #import "PsiphonData.h"
 #import "PsiphonClientCommonLibraryHelpers.h"
+#import "SiteDataIndex.h"
 #import "UpstreamProxySettings.h"
 
 NSString* _Nonnull const clearAllWhenBackgroundedUserDefaultsKey = @"clearAllWhenBackgrounded";
@@ -62,6 +65,11 @@ NSString* _Nonnull const clearAllWhenBackgroundedUserDefaultsKey = @"clearAllWhe
 	self.hstsCache = [HSTSCache retrieve];
 	[CookieJar syncCookieAcceptPolicy];
 	[Bookmark retrieveList];
+	// file local storage by site as the web view creates it
+	[SiteDataIndex sharedIndex];
+	// finish deleting what was cleared if we were suspended before
+	[JAHPTrash empty];
+	[[JAHPCookieStore sharedStore] setInMemoryOnly:[self clearAllWhenBackgrounded]];
 	self.sslCertCache = [[NSCache alloc] init];
 
 	self.certificateAuthentication = [[CertificateAuthentication alloc] init];
@@ -186,6 +194,11 @@ NSString* _Nonnull const clearAllWhenBackgroundedUserDefaultsKey = @"clearAllWhe
 		[Privacy clearWebsiteData];
 	}
 
+	if (![self areTesting]) {
+		[[JAHPCookieStore sharedStore] setInMemoryOnly:[self clearAllWhenBackgrounded]];
+		[[JAHPCookieStore sharedStore] flush];
+	}
+
 	if(_appActiveTimer && [_appActiveTimer isValid]) {
 		// make timer selector get called on its target immediately
 		[_appActiveTimer fire];
@@ -282,6 +295,9 @@ NSString* _Nonnull const clearAllWhenBackgroundedUserDefaultsKey = @"clearAllWhe
 		[self.certificateAuthentication persist];
 	}
 
+	// Cookies
+	[[JAHPCookieStore sharedStore] flush];
+
 	[application ignoreSnapshotOnNextApplicationLaunch];
 }
 
@@ -15,23 +15,24 @@
 
 #define kAllowCurrentWebsiteOnly @"AllowCurrentWebsiteOnly"
 // - Storing: Allow all first-party cookies and block all third-party cookies.
-// - Sending: Send cookies only for the requests that are of same origin as the main document request URL.
+// - Sending: Send cookies only for the requests that are of same site (registrable domain) as the main document request URL.
 
 #define kAllowWebsitesIVisit @"AllowWebsitesIVisit"
 // - Storing: Allow all first-party cookies and block all third-party cookies
 // - Sending: Send cookies for the request URL if found in storage - current default for us and Safari
 
 #define kAlwaysAllow @"AlwaysAllow"
-// - Storing: Store all first-party cookies and all third-party cookies.
-// - Sending: Send cookies for the request URL if found in storage.
+// - Storing: Store all first-party cookies and all third-party cookies, the latter kept apart for each website they're set on.
+// - Sending: Send cookies for the request URL if found in storage under the website being visited.
 
 
 @interface CookieJar : NSObject
 +(void)migrateOldValuesForVersion:(int)version;
 + (NSString*) cookiePolicy;
 + (BOOL)isSameOrigin:(NSURL *)aURL toURL:(NSURL *)bURL;
++ (BOOL)isSameSite:(NSURL *)aURL toURL:(NSURL *)bURL;
 + (void)clearAllData;
 + (void)syncCookieAcceptPolicy;
-+ (NSArray<NSHTTPCookie *> *)cookiesForURL:(NSURL *)URL;
++ (NSString *)cookieHeaderForURL:(NSURL *)URL mainDocumentURL:(NSURL *)mainDocumentURL;
 + (void)setCookies:(NSArray<NSHTTPCookie *> *)cookies forURL:(NSURL *)URL mainDocumentURL:(NSURL *)mainDocumentURL;
 @end
@@ -7,19 +7,14 @@
 
 #import "CookieJar.h"
 #import "HTTPSEverywhere.h"
+#import "JAHPCookieStore.h"
+#import "JAHPTrash.h"
+#import "PublicSuffixList.h"
+#import "SiteDataIndex.h"
 
-/*
- * local storage is found in NSCachesDirectory and can be a file or directory:
- *
- * ./AppData/Library/Caches/https_m.imgur.com_0.localstorage
- * ./AppData/Library/Caches/https_m.youtube.com_0.localstorage
- * ./AppData/Library/Caches/http_samy.pl_0
- * ./AppData/Library/Caches/http_samy.pl_0/.lock
- * ./AppData/Library/Caches/http_samy.pl_0/0000000000000001.db
- * ./AppData/Library/Caches/http_samy.pl_0.localstorage
- */
+/* under kAlwaysAllow, keep third-party cookies separately for each website they're set on */
+#define PARTITION_THIRD_PARTY_COOKIES 1
 
-#define LOCAL_STORAGE_REGEX @"/(https?_(.+)_\\d+|_*IndexedDB)"
 @implementation CookieJar
 
 +(void)migrateOldValuesForVersion:(int)version {
@@ -73,68 +68,69 @@
 
 + (void)clearAllCookies
 {
-	for (NSHTTPCookie *cookie in [[NSHTTPCookieStorage sharedHTTPCookieStorage] cookies]) {
 #ifdef TRACE_COOKIES
-		NSLog(@"[CookieJar] deleting cookie: %@", cookie);
+	NSLog(@"[CookieJar] deleting all cookies");
 #endif
-		[[NSHTTPCookieStorage sharedHTTPCookieStorage] deleteCookie:cookie];
-	}
+	[[JAHPCookieStore sharedStore] removeAllCookies];
 }
 
 + (void)clearAllLocalStorage
 {
-	NSDictionary *files = [self localStorageFiles];
-	for (NSString *file in [files allKeys]) {
+	[[[SiteDataIndex sharedIndex] filesBySite] enumerateKeysAndObjectsUsingBlock:^(NSString *site, NSArray<NSString *> *files, BOOL *stop) {
+		for (NSString *file in files) {
 #ifdef TRACE_COOKIES
-		NSString *fhost = [files objectForKey:file];
-		NSLog(@"[CookieJar] deleting local storage for %@: %@", fhost, file);
-#endif
-		NSError *error;
-
-		[[NSFileManager defaultManager] removeItemAtPath:file error:&error];
-
-		if (error) {
-#ifdef TRACE_COOKIES
-			NSLog(@"[CookieJar] Error removing local storage file %@ for %@: %@", file, fhost, error.localizedDescription);
+			NSLog(@"[CookieJar] deleting local storage for %@: %@", site, file);
 #endif
+			[JAHPTrash moveItemAtPathToTrash:file];
 		}
-	}
+	}];
 }
 
-+ (NSDictionary *)localStorageFiles
-{
-	NSFileManager *fm = [NSFileManager defaultManager];
-	NSString *cacheDir = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
-
-	NSMutableDictionary *files = [[NSMutableDictionary alloc] init];
-
-	NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:LOCAL_STORAGE_REGEX options:0 error:nil];
+/*! Decides whether a request may send or store cookies under the current policy.
+ *  \param partition Set to the site whose partition the request's cookies are in, or nil.
+ */
 
-	for (NSString *file in [fm contentsOfDirectoryAtPath:cacheDir error:nil]) {
-		NSString *absFile = [NSString stringWithFormat:@"%@/%@", cacheDir, file];
++ (BOOL)cookiePolicyAllowsURL:(NSURL *)URL mainDocumentURL:(NSURL *)mainDocumentURL storing:(BOOL)storing partition:(NSString **)partition {
+	NSString *cookiePolicy = [self cookiePolicy];
+	// a request without a main document is a top-level navigation
+	BOOL firstParty = (mainDocumentURL == nil || [self isSameSite:URL toURL:mainDocumentURL]);
 
-		NSArray *matches = [regex matchesInString:absFile options:0 range:NSMakeRange(0, [absFile length])];
-		if (!matches || ![matches count]) {
-			continue;
-		}
+	*partition = nil;
 
-		for (NSTextCheckingResult *match in matches) {
-			if ([match numberOfRanges] >= 1) {
-				NSString *host = [absFile substringWithRange:[match rangeAtIndex:1]];
-				[files setObject:host forKey:absFile];
-			}
+	if ([cookiePolicy isEqualToString:kAlwaysBlock]) {
+		return NO;
+	} else if ([cookiePolicy isEqualToString:kAlwaysAllow]) {
+#if PARTITION_THIRD_PARTY_COOKIES
+		if (!firstParty && [mainDocumentURL host] != nil) {
+			*partition = [JAHPCookieStore siteOfHost:[mainDocumentURL host]];
 		}
+#endif
+		return YES;
+	} else if ([cookiePolicy isEqualToString:kAllowWebsitesIVisit]) {
+		// third parties get the cookies they set when visited, but can't set any
+		return firstParty || !storing;
 	}
 
-	return files;
+	return firstParty;
 }
 
-+ (NSArray<NSHTTPCookie *> *)cookiesForURL:(NSURL *)URL {
-	return [[NSHTTPCookieStorage sharedHTTPCookieStorage] cookiesForURL:URL];
++ (NSString *)cookieHeaderForURL:(NSURL *)URL mainDocumentURL:(NSURL *)mainDocumentURL {
+	NSString *partition;
+	if (![self cookiePolicyAllowsURL:URL mainDocumentURL:mainDocumentURL storing:NO partition:&partition]) {
+		return nil;
+	}
+	return [[JAHPCookieStore sharedStore] cookieHeaderForURL:URL partition:partition];
 }
 
 + (void)setCookies:(NSArray<NSHTTPCookie *> *)cookies forURL:(NSURL *)URL mainDocumentURL:(NSURL *)mainDocumentURL {
-	[[NSHTTPCookieStorage sharedHTTPCookieStorage] setCookies:cookies forURL:URL mainDocumentURL:mainDocumentURL];
+	NSString *partition;
+	if (![self cookiePolicyAllowsURL:URL mainDocumentURL:mainDocumentURL storing:YES partition:&partition]) {
+#ifdef TRACE_COOKIES
+		NSLog(@"[CookieJar] not storing %lu cookie(s) from %@", (unsigned long)[cookies count], [URL host]);
+#endif
+		return;
+	}
+	[[JAHPCookieStore sharedStore] setCookies:cookies forURL:URL partition:partition];
 }
 
 + (BOOL)isSameOrigin:(NSURL *)aURL toURL:(NSURL *)bURL{
@@ -150,4 +146,9 @@
 	return YES;
 }
 
++ (BOOL)isSameSite:(NSURL *)aURL toURL:(NSURL *)bURL {
+	// www.example.com and static.example.com are one website, example.co.uk and example2.co.uk are not
+	return [[PublicSuffixList sharedList] isHost:[aURL host] sameSiteAsHost:[bURL host]];
+}
+
 @end
@@ -19,6 +19,7 @@
 
 
 #import "DownloadHelper.h"
+#import "JAHPTrash.h"
 
 #define kDownloadsDirectory @"downloads"
 
@@ -33,7 +34,7 @@
 
 + (void)deleteDownloadsDirectory {
 	NSString *downloadsPath = [DownloadHelper getDesiredDownloadsDirectory];
-	[[NSFileManager defaultManager] removeItemAtPath:downloadsPath error:nil];
+	[JAHPTrash moveItemAtPathToTrash:downloadsPath];
 }
 
 + (NSString*)getDownloadsDirectory {
@@ -25,6 +25,13 @@
 
 - (void)persist;
 - (NSURL *)rewrittenURI:(NSURL *)URL;
+
+/* the expiration of the entry that upgrades host to https, or nil if there's none */
+- (NSDate *)upgradeExpirationForHost:(NSString *)host;
+
+/* URL with its scheme upgraded, whether or not an entry covers it */
+- (NSURL *)upgradedURI:(NSURL *)URL;
+
 - (void)parseHSTSHeader:(NSString *)header forHost:(NSString *)host;
 
 /* NSMutableDictionary composition pass-throughs */
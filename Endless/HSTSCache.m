@@ -6,6 +6,7 @@
  */
 
 #import "HSTSCache.h"
+#import "JAHPHostVerdictCache.h"
 #import "NSString+IPAddress.h"
 
 /* rfc6797 HTTP Strict Transport Security */
@@ -93,12 +94,21 @@ static NSDictionary *_preloadedHosts;
 		return URL;
 	}
 
-	NSString *host = [[URL host] lowercaseString];
+	if ([self upgradeExpirationForHost:[URL host]] == nil) {
+		return URL;
+	}
+
+	return [self upgradedURI:URL];
+}
+
+- (NSDate *)upgradeExpirationForHost:(NSString *)host
+{
+	host = [host lowercaseString];
 	NSString *matchHost = [host copy];
 
 	/* 8.3: ignore when host is a bare ip address */
-	if ([host isValidIPAddress]) {
-		return URL;
+	if (host == nil || [host isValidIPAddress]) {
+		return nil;
 	}
 
 	NSDictionary *params = [self objectForKey:host];
@@ -115,18 +125,29 @@ static NSDictionary *_preloadedHosts;
 		}
 	}
 
-	if (params != nil) {
-		NSDate *exp = [params objectForKey:HSTS_KEY_EXPIRATION];
-		if ([exp timeIntervalSince1970] < [[NSDate date] timeIntervalSince1970]) {
+	if (params == nil) {
+		return nil;
+	}
+
+	NSDate *exp = [params objectForKey:HSTS_KEY_EXPIRATION];
+	if ([exp timeIntervalSince1970] < [[NSDate date] timeIntervalSince1970]) {
 #ifdef TRACE_HSTS
-			NSLog(@"[HSTSCache] entry for %@ expired at %@", matchHost, exp);
+		NSLog(@"[HSTSCache] entry for %@ expired at %@", matchHost, exp);
 #endif
-			[self removeObjectForKey:matchHost];
-			params = nil;
-		}
+		[self removeObjectForKey:matchHost];
+		return nil;
 	}
 
-	if (params == nil) {
+#ifdef TRACE_HSTS
+	NSLog(@"[HSTSCache] %@%@ covers %@", ([params objectForKey:HSTS_KEY_PRELOADED] ? @"[preloaded] " : @""), matchHost, host);
+#endif
+
+	return exp;
+}
+
+- (NSURL *)upgradedURI:(NSURL *)URL
+{
+	if (![[URL scheme] isEqualToString:@"http"]) {
 		return URL;
 	}
 
@@ -140,7 +161,7 @@ static NSDictionary *_preloadedHosts;
 	}
 
 #ifdef TRACE_HSTS
-	NSLog(@"[HSTSCache] %@rewrote %@ to %@", ([params objectForKey:HSTS_KEY_PRELOADED] ? @"[preloaded] " : @""), URL, [URLc URL]);
+	NSLog(@"[HSTSCache] rewrote %@ to %@", URL, [URLc URL]);
 #endif
 
 	return [URLc URL];
@@ -220,14 +241,23 @@ static NSDictionary *_preloadedHosts;
 - (void)setValue:(id)value forKey:(NSString *)key
 {
 	dispatch_async(hstsQueue, ^{
+		NSDictionary *old = [[self dict] objectForKey:key];
 		[[self dict] setValue:value forKey:key];
+
+		/* sites send the header with every response; only a change in what gets upgraded matters */
+		if (old == nil || ([old objectForKey:HSTS_KEY_ALLOW_SUBDOMAINS] != nil) != ([value objectForKey:HSTS_KEY_ALLOW_SUBDOMAINS] != nil)) {
+			[JAHPHostVerdictCache invalidate];
+		}
 	});
 }
 
 - (void)removeObjectForKey:(id)aKey
 {
 	dispatch_async(hstsQueue, ^{
-		[[self dict] removeObjectForKey:aKey];
+		if ([[self dict] objectForKey:aKey] != nil) {
+			[[self dict] removeObjectForKey:aKey];
+			[JAHPHostVerdictCache invalidate];
+		}
 	});
 }
 
@@ -18,6 +18,7 @@
 + (HTTPSEverywhereRule *)cachedRuleForName:(NSString *)name;
 + (NSArray *)potentiallyApplicableRulesForHost:(NSString *)host;
 + (NSURL *)rewrittenURI:(NSURL *)URL withRules:(NSArray *)rules;
++ (NSURL *)rewrittenURI:(NSURL *)URL withEnabledRules:(NSArray *)rules;
 + (BOOL)needsSecureCookieFromHost:(NSString *)fromHost forHost:(NSString *)forHost cookieName:(NSString *)cookie;
 + (void)noteInsecureRedirectionForURL:(NSURL *)URL;
 + (BOOL)ruleNameIsDisabled:(NSString *)name;
@@ -6,6 +6,7 @@
  */
 
 #import "HTTPSEverywhere.h"
+#import "JAHPHostVerdictCache.h"
 
 @implementation HTTPSEverywhere
 
@@ -171,6 +172,18 @@ static NSCache *ruleCache;
 	return URL;
 }
 
+/* like rewrittenURI:withRules: for rules already known to be enabled, even if there are none */
++ (NSURL *)rewrittenURI:(NSURL *)URL withEnabledRules:(NSArray *)rules
+{
+	for (HTTPSEverywhereRule *rule in rules) {
+		NSURL *rurl = [rule apply:URL];
+		if (rurl != nil)
+			return rurl;
+	}
+
+	return URL;
+}
+
 + (BOOL)needsSecureCookieFromHost:(NSString *)fromHost forHost:(NSString *)forHost cookieName:(NSString *)cookie
 {
 	for (HTTPSEverywhereRule *rule in [[self class] potentiallyApplicableRulesForHost:fromHost]) {
@@ -231,12 +244,14 @@ static NSCache *ruleCache;
 {
 	[[[self class] disabledRules] removeObjectForKey:name];
 	[[self class] saveDisabledRules];
+	[JAHPHostVerdictCache invalidate];
 }
 
 + (void)disableRuleByName:(NSString *)name withReason:(NSString *)reason
 {
 	[[[self class] disabledRules] setObject:reason forKey:name];
 	[[self class] saveDisabledRules];
+	[JAHPHostVerdictCache invalidate];
 }
 
 @end
@@ -31,8 +31,31 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @interface Privacy : NSObject
 
+/**
+ Deletes all website data.  This takes the same short time however much there is:
+ the HTTP cache is shredded, and files are moved to the trash to be deleted in the
+ background.
+ */
 + (void)clearWebsiteData;
 
+/**
+ Deletes the cookies, local storage and cached responses of the site host is in, along
+ with the offline snapshots, in parallel in the background.
+
+ @param progress Called on the main queue with the fraction of the work done.
+ @param completion Called on the main queue once everything is deleted.
+ */
++ (void)clearWebsiteDataForSite:(NSString *)host progress:(nullable void (^)(float fraction))progress completion:(nullable void (^)(void))completion;
+
+/**
+ Deletes all website data except the cookies, local storage and cached responses of
+ bookmarked sites, in parallel in the background.
+
+ @param progress Called on the main queue with the fraction of the work done.
+ @param completion Called on the main queue once everything is deleted.
+ */
++ (void)clearWebsiteDataExceptBookmarksWithProgress:(nullable void (^)(float fraction))progress completion:(nullable void (^)(void))completion;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -23,9 +23,15 @@
 
 #import "Privacy.h"
 
+#import "Bookmark.h"
 #import "CertificateAuthentication.h"
 #import "CookieJar.h"
 #import "DownloadHelper.h"
+#import "JAHPCookieStore.h"
+#import "JAHPDiskCache.h"
+#import "JAHPSnapshotStore.h"
+#import "JAHPTrash.h"
+#import "SiteDataIndex.h"
 
 @implementation Privacy
 
@@ -33,6 +39,105 @@
 	[CertificateAuthentication deletePersistedData];
 	[CookieJar clearAllData];
 	[DownloadHelper deleteDownloadsDirectory];
+	[[JAHPDiskCache sharedCache] removeAllCachedResponses];
+	[[JAHPSnapshotStore sharedStore] removeAllSnapshots];
+	[JAHPTrash empty];
+}
+
++ (void)clearWebsiteDataForSite:(NSString *)host progress:(void (^)(float))progress completion:(void (^)(void))completion {
+	NSMutableArray<dispatch_block_t> *deletions = [NSMutableArray array];
+
+	[deletions addObject:^{
+		[[JAHPCookieStore sharedStore] removeCookiesForSite:host];
+	}];
+	[deletions addObject:^{
+		[[JAHPDiskCache sharedCache] removeCachedResponsesForSite:host];
+	}];
+	// snapshots are named by a hash of their document, so there's no telling whose they are
+	[deletions addObject:^{
+		[[JAHPSnapshotStore sharedStore] removeAllSnapshots];
+	}];
+	for (NSString *file in [[SiteDataIndex sharedIndex] filesForSite:host]) {
+		[deletions addObject:^{
+			[JAHPTrash moveItemAtPathToTrash:file];
+		}];
+	}
+
+	[self performDeletions:deletions progress:progress completion:completion];
+}
+
++ (void)clearWebsiteDataExceptBookmarksWithProgress:(void (^)(float))progress completion:(void (^)(void))completion {
+	NSMutableSet<NSString *> *sites = [NSMutableSet set];
+	for (Bookmark *bookmark in [Bookmark list]) {
+		NSString *host = [[bookmark url] host];
+		if (host != nil) {
+			[sites addObject:[JAHPCookieStore siteOfHost:host]];
+		}
+	}
+
+	NSMutableArray<dispatch_block_t> *deletions = [NSMutableArray array];
+
+	[deletions addObject:^{
+		[CertificateAuthentication deletePersistedData];
+	}];
+	[deletions addObject:^{
+		[DownloadHelper deleteDownloadsDirectory];
+	}];
+	[deletions addObject:^{
+		[[JAHPCookieStore sharedStore] removeCookiesExceptForSites:sites];
+	}];
+	[deletions addObject:^{
+		[[JAHPDiskCache sharedCache] removeCachedResponsesExceptForSites:sites];
+	}];
+	[deletions addObject:^{
+		[[JAHPSnapshotStore sharedStore] removeAllSnapshots];
+	}];
+	[[[SiteDataIndex sharedIndex] filesBySite] enumerateKeysAndObjectsUsingBlock:^(NSString *site, NSArray<NSString *> *files, BOOL *stop) {
+		if ([sites containsObject:site]) {
+			return;
+		}
+		for (NSString *file in files) {
+			[deletions addObject:^{
+				[JAHPTrash moveItemAtPathToTrash:file];
+			}];
+		}
+	}];
+
+	[self performDeletions:deletions progress:progress completion:completion];
+}
+
+/*! Runs deletions concurrently in the background, reporting each one done, then empties
+ *  the trash they moved files into.
+ */
+
++ (void)performDeletions:(NSArray<dispatch_block_t> *)deletions progress:(void (^)(float))progress completion:(void (^)(void))completion {
+	dispatch_group_t group = dispatch_group_create();
+	dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+	NSUInteger total = [deletions count];
+	__block NSUInteger done = 0;
+
+	for (dispatch_block_t deletion in deletions) {
+		dispatch_group_async(group, queue, ^{
+			deletion();
+
+			NSUInteger n;
+			@synchronized (deletions) {
+				n = ++done;
+			}
+			if (progress != nil) {
+				dispatch_async(dispatch_get_main_queue(), ^{
+					progress((float)n / total);
+				});
+			}
+		});
+	}
+
+	dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+		[JAHPTrash empty];
+		if (completion != nil) {
+			completion();
+		}
+	});
 }
 
 @end
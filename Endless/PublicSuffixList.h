@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Finds the registrable domain of a host: the public suffix it's under (com, co.uk,
+ *  github.io) and one more label.  Hosts with the same registrable domain are the same
+ *  site, which is what cookie and third-party decisions go by.
+ *  \details convert_rules.rb compiles the Public Suffix List into public_suffix_list.dat,
+ *  a trie of reversed labels with each node's edges sorted, so a lookup is one pass over
+ *  the host from its end with a binary search per label, and allocates nothing.  The file
+ *  is mapped rather than read.  Rules for internationalized domains are in the trie in
+ *  both their Unicode and ASCII forms.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface PublicSuffixList : NSObject
+
++ (nonnull instancetype)sharedList;
+
+/*! Loads a list compiled by convert_rules.rb.  A list that isn't one is treated as empty,
+ *  which leaves only the implied rule that every top-level domain is a public suffix.
+ */
+
+- (nonnull instancetype)initWithData:(nonnull NSData *)data;
+
+/*! Returns the offset in host at which its registrable domain starts.
+ *  \param host A host name, in either case, with or without a trailing dot.
+ *  \returns NSNotFound if host has no registrable domain: it's an IP address, or itself a
+ *  public suffix.
+ */
+
+- (NSUInteger)registrableDomainStartInHost:(nonnull const char *)host length:(size_t)length;
+
+/*! Returns the lowercased registrable domain of host, or nil if it has none.
+ */
+
+- (nullable NSString *)registrableDomainForHost:(nullable NSString *)host;
+
+/*! Returns whether two hosts are the same site: they have the same registrable domain, or
+ *  they're the same host if either has none.
+ */
+
+- (BOOL)isHost:(nullable NSString *)aHost sameSiteAsHost:(nullable NSString *)bHost;
+
+@end
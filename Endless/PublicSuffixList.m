@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "PublicSuffixList.h"
+
+/* these must match convert_rules.rb */
+#define PUBLIC_SUFFIX_MAGIC "PSL1"
+#define PUBLIC_SUFFIX_RULE 0x01
+#define PUBLIC_SUFFIX_WILDCARD 0x02
+#define PUBLIC_SUFFIX_EXCEPTION 0x04
+
+typedef struct {
+	char magic[4];
+	uint32_t rootCount;
+	uint32_t edgeCount;
+	uint32_t stringsLength;
+} PublicSuffixHeader;
+
+typedef struct {
+	uint32_t label;			/* offset of the label in the strings */
+	uint8_t labelLength;
+	uint8_t flags;
+	uint16_t childCount;
+	uint32_t firstChild;	/* index of the first of the child node's edges */
+} PublicSuffixEdge;
+
+/* the file is little-endian, as is every device we run on */
+_Static_assert(sizeof(PublicSuffixEdge) == 12, "PublicSuffixEdge must match convert_rules.rb");
+
+/* orders a label of a host, in any case, against a lowercase label from the list */
+static int compareLabels(const char *host, size_t hostLength, const char *label, size_t labelLength)
+{
+	size_t length = MIN(hostLength, labelLength);
+	for (size_t i = 0; i < length; i++) {
+		unsigned char c = (unsigned char)host[i];
+		int d = ((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c) - (unsigned char)label[i];
+		if (d != 0) {
+			return d;
+		}
+	}
+	return (hostLength > labelLength) - (hostLength < labelLength);
+}
+
+/* an IPv6 address, or an IPv4 address, whose last label is numeric as no top-level domain is */
+static BOOL isIPAddress(const char *host, size_t length)
+{
+	if (memchr(host, ':', length) != NULL) {
+		return YES;
+	}
+	for (size_t i = length; i > 0 && host[i - 1] != '.'; i--) {
+		if (!isdigit((unsigned char)host[i - 1])) {
+			return NO;
+		}
+	}
+	return YES;
+}
+
+@implementation PublicSuffixList {
+	NSData *_data;
+	const PublicSuffixEdge *_edges;
+	uint32_t _rootCount;
+	const char *_strings;
+}
+
++ (instancetype)sharedList
+{
+	static PublicSuffixList *list;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSString *path = [[NSBundle mainBundle] pathForResource:@"public_suffix_list" ofType:@"dat"];
+		NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+		if (data == nil) {
+			NSLog(@"[PublicSuffixList] no compiled list at %@", path);
+			abort();
+		}
+
+		list = [[PublicSuffixList alloc] initWithData:data];
+	});
+	return list;
+}
+
+- (instancetype)initWithData:(NSData *)data
+{
+	self = [super init];
+	if (self == nil) {
+		return nil;
+	}
+
+	if (![self loadData:data]) {
+		NSLog(@"[PublicSuffixList] ignoring malformed list");
+		_edges = NULL;
+		_rootCount = 0;
+		_strings = NULL;
+	}
+
+	return self;
+}
+
+/*! Checks that every edge is within the file, so that lookups needn't.
+ */
+
+- (BOOL)loadData:(NSData *)data
+{
+	const PublicSuffixHeader *header = [data bytes];
+	size_t length = [data length];
+
+	if (length < sizeof(PublicSuffixHeader) || memcmp(header->magic, PUBLIC_SUFFIX_MAGIC, sizeof(header->magic)) != 0) {
+		return NO;
+	}
+
+	uint64_t edgesLength = (uint64_t)header->edgeCount * sizeof(PublicSuffixEdge);
+	if (header->rootCount > header->edgeCount || sizeof(PublicSuffixHeader) + edgesLength + header->stringsLength != length) {
+		return NO;
+	}
+
+	const PublicSuffixEdge *edges = (const PublicSuffixEdge *)(header + 1);
+	for (uint32_t i = 0; i < header->edgeCount; i++) {
+		if ((uint64_t)edges[i].label + edges[i].labelLength > header->stringsLength ||
+			(uint64_t)edges[i].firstChild + edges[i].childCount > header->edgeCount) {
+			return NO;
+		}
+	}
+
+	_data = data;
+	_edges = edges;
+	_rootCount = header->rootCount;
+	_strings = (const char *)(edges + header->edgeCount);
+	return YES;
+}
+
+/*! Returns the edge for label among count edges starting at first, or NULL.
+ */
+
+- (const PublicSuffixEdge *)edgeForLabel:(const char *)label length:(size_t)length first:(uint32_t)first count:(uint32_t)count
+{
+	uint32_t lo = first, hi = first + count;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		int d = compareLabels(label, length, _strings + _edges[mid].label, _edges[mid].labelLength);
+		if (d == 0) {
+			return &_edges[mid];
+		} else if (d < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return NULL;
+}
+
+- (NSUInteger)registrableDomainStartInHost:(const char *)host length:(size_t)length
+{
+	if (length > 0 && host[length - 1] == '.') {
+		length--;
+	}
+	if (length == 0 || isIPAddress(host, length)) {
+		return NSNotFound;
+	}
+
+	/* with no rule for it, a top-level domain is a public suffix: the root is a wildcard */
+	BOOL wildcard = YES;
+	uint32_t first = 0;
+	uint32_t count = _rootCount;
+	size_t suffixStart = length;
+	size_t labelEnd = length;
+
+	for (;;) {
+		size_t labelStart = labelEnd;
+		while (labelStart > 0 && host[labelStart - 1] != '.') {
+			labelStart--;
+		}
+
+		const PublicSuffixEdge *edge = [self edgeForLabel:(host + labelStart) length:(labelEnd - labelStart) first:first count:count];
+		if (edge != NULL && (edge->flags & PUBLIC_SUFFIX_EXCEPTION)) {
+			/* an exception to a wildcard is registrable itself */
+			return labelStart;
+		}
+		if (wildcard || (edge != NULL && (edge->flags & PUBLIC_SUFFIX_RULE))) {
+			suffixStart = labelStart;
+		}
+		if (edge == NULL || labelStart == 0) {
+			break;
+		}
+
+		wildcard = (edge->flags & PUBLIC_SUFFIX_WILDCARD) != 0;
+		first = edge->firstChild;
+		count = edge->childCount;
+		labelEnd = labelStart - 1;
+	}
+
+	if (suffixStart == 0) {
+		return NSNotFound;
+	}
+
+	/* the label in front of the public suffix */
+	size_t start = suffixStart - 1;
+	while (start > 0 && host[start - 1] != '.') {
+		start--;
+	}
+	return start;
+}
+
+- (NSString *)registrableDomainForHost:(NSString *)host
+{
+	const char *h = [host UTF8String];
+	if (h == NULL) {
+		return nil;
+	}
+
+	size_t length = strlen(h);
+	NSUInteger start = [self registrableDomainStartInHost:h length:length];
+	if (start == NSNotFound) {
+		return nil;
+	}
+
+	if (length > 0 && h[length - 1] == '.') {
+		length--;
+	}
+	return [[[NSString alloc] initWithBytes:(h + start) length:(length - start) encoding:NSUTF8StringEncoding] lowercaseString];
+}
+
+- (BOOL)isHost:(NSString *)aHost sameSiteAsHost:(NSString *)bHost
+{
+	if (aHost == nil || bHost == nil) {
+		return NO;
+	}
+
+	NSString *a = [self registrableDomainForHost:aHost];
+	NSString *b = [self registrableDomainForHost:bHost];
+	if (a == nil || b == nil) {
+		return [aHost caseInsensitiveCompare:bHost] == NSOrderedSame;
+	}
+	return [a isEqualToString:b];
+}
+
+@end
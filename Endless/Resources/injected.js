@@ -182,11 +182,17 @@ var __psiphon = {
 		/* ask obj C if js is disabled and noscript tags should be removed */
 		//__psiphon.ipcAndWaitForReply("noscript");
 
-		// URL proxify all current media elements
+		// URL proxify current media elements that JAHPHTMLRewriter never saw,
+		// such as media inserted through innerHTML or on pages that weren't
+		// rewritten; the ones it rewrote are skipped and not reloaded
 		__psiphon.urlProxyCurrentMediaElements(document);
 
 		/* setup URL proxy change listener */
 		__psiphon.listenToUrlProxyPortMessage();
+
+		if (__psiphon.dataSaver) {
+			__psiphon.loadImagesNearViewport();
+		}
 	},
 
 	/**
@@ -214,6 +220,52 @@ var __psiphon = {
 	}
 	*/
 
+	/**
+	 * Set by ObjC when data saver is on for this page. Images in the markup then
+	 * arrive with their src and srcset renamed (see JAHPHTMLRewriter), and get
+	 * them back when they come within a screen of the viewport.
+	 */
+	dataSaver: false,
+
+	loadImagesNearViewport: function () {
+		var pending = false;
+
+		var loadVisible = function () {
+			pending = false;
+
+			var images = document.querySelectorAll("img[data-psiphon-src], img[data-psiphon-srcset]");
+			var margin = window.innerHeight;
+			for (var i = 0; i < images.length; i++) {
+				var rect = images[i].getBoundingClientRect();
+				if (rect.bottom >= -margin && rect.top <= window.innerHeight + margin) {
+					__psiphon.loadDeferredImage(images[i]);
+				}
+			}
+		};
+
+		var schedule = function () {
+			if (!pending) {
+				pending = true;
+				setTimeout(loadVisible, 100);
+			}
+		};
+
+		window.addEventListener("scroll", schedule, false);
+		window.addEventListener("resize", schedule, false);
+		loadVisible();
+	},
+
+	loadDeferredImage: function (image) {
+		var attributes = ["srcset", "src"];
+		for (var i = 0; i < attributes.length; i++) {
+			var value = image.getAttribute("data-psiphon-" + attributes[i]);
+			if (value !== null) {
+				image.removeAttribute("data-psiphon-" + attributes[i]);
+				image.setAttribute(attributes[i], value);
+			}
+		}
+	},
+
 	isInIframe: function () {
 		try {
 			return window.self !== window.top;
@@ -407,24 +459,52 @@ var __psiphon = {
 		return urlProxyPrefix + encodeURIComponent(url) + '?m3u8=true';
 	},
 
+	// Returns true if url already goes through the URL proxy on its
+	// current port, e.g. because JAHPHTMLRewriter rewrote it
+	isUrlProxied: function (url) {
+		return !!url && url.indexOf('http://127.0.0.1:' + __psiphon.urlProxyPort + '/tunneled-rewrite/') === 0;
+	},
+
+	// URL proxifies element's src unless it's already proxied, in which
+	// case it's only patched so later changes get proxied too.
+	// Returns true if the src was changed.
+	urlProxyElementSrcIfNeeded: function (element) {
+		if (!element || typeof element.src === 'undefined') {
+			return false;
+		}
+		if (__psiphon.isUrlProxied(element.src)) {
+			try {
+				__psiphon.patchElementSrc(element);
+			} catch (e) {
+				__psiphon.log(e);
+			}
+			return false;
+		}
+		__psiphon.urlProxyElementSrc(element);
+		return !!element.src;
+	},
+
 	// Proxifies media data URL of the element.
 	// This will involve changing its and any
 	// <source> child element src attribute,
+	// skipping those that are already proxied
 	urlProxyMediaElement: function (element) {
 		// Modify any existing src attribute.
-		__psiphon.urlProxyElementSrc(element);
+		__psiphon.urlProxyElementSrcIfNeeded(element);
 
 		// If there's a <source> child element, modify and monitor it as well.
+		var changedSource = false;
 		if (element.children && element.children.length) {
 			for (var i = 0; i < element.children.length; i++) {
-				var child = element.children[i];
-				__psiphon.urlProxyElementSrc(child);
-				if (child.parentElement && child.parentElement instanceof HTMLMediaElement) {
-					// reload the media
-					child.parentElement.load();
+				if (__psiphon.urlProxyElementSrcIfNeeded(element.children[i])) {
+					changedSource = true;
 				}
 			}
 		}
+		if (changedSource && element instanceof HTMLMediaElement) {
+			// reload the media, once, to pick up the new sources
+			element.load();
+		}
 	},
 
 	// Proxifies all current media elements in the document
@@ -27,6 +27,16 @@
 // Disable Javascript settings key in Privacy.plist
 #define kDisableJavascript			@"disableJavascript"
 
+// Offline snapshots settings key in Privacy.plist
+#define kOfflineSnapshots			@"offlineSnapshots"
+
+// Data saver settings key in DataSaver.plist
+#define kDataSaver					@"dataSaver"
+
+// Text-only pages settings keys in DataSaver.plist
+#define kTextOnly					@"textOnly"
+#define kTextOnlyImages				@"textOnlyImages"
+
 // These strings correspond to the option's value in MinTLSSettings.plist
 #define kMinTlsVersionTLS_1_2 @"TLS_1_2"
 #define kMinTlsVersionTLS_1_1 @"TLS_1_1"
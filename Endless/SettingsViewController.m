@@ -20,12 +20,16 @@
 #import "SettingsViewController.h"
 
 #import "HTTPSEverywhereRuleController.h"
+#import "JAHPDataSaver.h"
+#import "JAHPJavaScriptPolicy.h"
 #import "Privacy.h"
 
 static AppDelegate *appDelegate;
 
 #define kHttpsEverywhereSpecifierKey @"httpsEverywhere"
 #define kTutorialSpecifierKey @"tutorial"
+#define kDataSaverSiteSpecifierKey @"dataSaverSite"
+#define kJavaScriptSiteSpecifierKey @"javaScriptSite"
 
 @implementation SettingsViewController {
 }
@@ -37,14 +41,74 @@ static AppDelegate *appDelegate;
 		[cell setAccessoryType:UITableViewCellAccessoryDisclosureIndicator];
 		[cell.textLabel setText:specifier.title];
 
-		// Set detail text label to # of https everywhere rules in use for current browser tab
+		// Set detail text label to # of https everywhere rules in use, requests blocked and redirects skipped for current browser tab
 		long ruleCount = [[[AppDelegate sharedAppDelegate] webViewController] curWebViewTabHttpsRulesCount];
+		WebViewTab *wvt = [[[AppDelegate sharedAppDelegate] webViewController] curWebViewTab];
+		unsigned long blockedCount = [wvt blockedRequests];
+		unsigned long hopCount = [wvt redirectorHopsSkipped];
+		NSString *rules = nil;
+		NSString *blocked = nil;
+		NSString *hops = nil;
 
 		if (ruleCount > 0) {
+			rules = [NSString stringWithFormat:(ruleCount == 1 ? NSLocalizedStringWithDefaultValue(@"RULES_IN_USE_SINGULAR", nil, [NSBundle mainBundle], @"%ld rule in use", @"%ld will be replaced with the number 1") : NSLocalizedStringWithDefaultValue(@"RULES_IN_USE_PLURAL", nil, [NSBundle mainBundle], @"%ld rules in use", @"%ld will be replaced with a natural number")), ruleCount];
+		}
+		if (blockedCount > 0) {
+			blocked = [NSString stringWithFormat:(blockedCount == 1 ? NSLocalizedStringWithDefaultValue(@"REQUESTS_BLOCKED_SINGULAR", nil, [NSBundle mainBundle], @"%lu tracker blocked", @"%lu will be replaced with the number 1") : NSLocalizedStringWithDefaultValue(@"REQUESTS_BLOCKED_PLURAL", nil, [NSBundle mainBundle], @"%lu trackers blocked", @"%lu will be replaced with a natural number")), blockedCount];
+		}
+		if (hopCount > 0) {
+			hops = [NSString stringWithFormat:(hopCount == 1 ? NSLocalizedStringWithDefaultValue(@"REDIRECTS_SKIPPED_SINGULAR", nil, [NSBundle mainBundle], @"%lu tracking redirect skipped", @"%lu will be replaced with the number 1") : NSLocalizedStringWithDefaultValue(@"REDIRECTS_SKIPPED_PLURAL", nil, [NSBundle mainBundle], @"%lu tracking redirects skipped", @"%lu will be replaced with a natural number")), hopCount];
+		}
+
+		NSMutableArray<NSString *> *details = [[NSMutableArray alloc] initWithCapacity:3];
+		for (NSString *detail in @[ rules ?: @"", blocked ?: @"", hops ?: @"" ]) {
+			if ([detail length] > 0) {
+				[details addObject:detail];
+			}
+		}
+		if ([details count] > 0) {
 			cell.detailTextLabel.adjustsFontSizeToFitWidth = YES;
-			cell.detailTextLabel.text = [NSString stringWithFormat:(ruleCount == 1 ? NSLocalizedStringWithDefaultValue(@"RULES_IN_USE_SINGULAR", nil, [NSBundle mainBundle], @"%ld rule in use", @"%ld will be replaced with the number 1") : NSLocalizedStringWithDefaultValue(@"RULES_IN_USE_PLURAL", nil, [NSBundle mainBundle], @"%ld rules in use", @"%ld will be replaced with a natural number")), ruleCount];
+			cell.detailTextLabel.text = [details componentsJoinedByString:@", "];
 			cell.detailTextLabel.textColor = [UIColor colorWithRed:0 green:0.5 blue:0 alpha:1];
 		}
+	} else if ([specifier.key isEqualToString:kDataSaverSiteSpecifierKey]) {
+		// Show whether data saver is on for the current browser tab's site, and what it has saved there
+		WebViewTab *wvt = [[[AppDelegate sharedAppDelegate] webViewController] curWebViewTab];
+		NSString *host = [[wvt url] host];
+
+		if (host == nil) {
+			[cell setAccessoryType:UITableViewCellAccessoryNone];
+			[cell.textLabel setText:NSLocalizedStringWithDefaultValue(@"DATA_SAVER_NO_SITE", nil, [NSBundle mainBundle], @"No website open", @"Shown in data saver settings in place of a website's name when the current tab has no website open")];
+			cell.detailTextLabel.text = nil;
+		} else {
+			[cell setAccessoryType:UITableViewCellAccessoryDisclosureIndicator];
+			[cell.textLabel setText:host];
+
+			NSString *state = ([JAHPDataSaver isEnabledForURL:[wvt url]] ? NSLocalizedStringWithDefaultValue(@"DATA_SAVER_SITE_ON", nil, [NSBundle mainBundle], @"On", @"Data saver is on for this website") : NSLocalizedStringWithDefaultValue(@"DATA_SAVER_SITE_OFF", nil, [NSBundle mainBundle], @"Off", @"Data saver is off for this website"));
+			if ([wvt dataSaverBytesSaved] > 0) {
+				NSString *saved = [NSByteCountFormatter stringFromByteCount:[wvt dataSaverBytesSaved] countStyle:NSByteCountFormatterCountStyleFile];
+				state = [NSString stringWithFormat:NSLocalizedStringWithDefaultValue(@"DATA_SAVER_SAVED", nil, [NSBundle mainBundle], @"%@, %@ saved", @"First %@ will be replaced with 'On' or 'Off', the second with an amount of data such as '1.2 MB'"), state, saved];
+				cell.detailTextLabel.textColor = [UIColor colorWithRed:0 green:0.5 blue:0 alpha:1];
+			}
+			cell.detailTextLabel.adjustsFontSizeToFitWidth = YES;
+			cell.detailTextLabel.text = state;
+		}
+	} else if ([specifier.key isEqualToString:kJavaScriptSiteSpecifierKey]) {
+		// Show which scripts the current browser tab's site may run
+		WebViewTab *wvt = [[[AppDelegate sharedAppDelegate] webViewController] curWebViewTab];
+		NSString *host = [[wvt url] host];
+
+		if (host == nil) {
+			[cell setAccessoryType:UITableViewCellAccessoryNone];
+			[cell.textLabel setText:NSLocalizedStringWithDefaultValue(@"DATA_SAVER_NO_SITE", nil, [NSBundle mainBundle], @"No website open", @"Shown in data saver settings in place of a website's name when the current tab has no website open")];
+			cell.detailTextLabel.text = nil;
+		} else {
+			[cell setAccessoryType:UITableViewCellAccessoryDisclosureIndicator];
+			[cell.textLabel setText:[NSString stringWithFormat:NSLocalizedStringWithDefaultValue(@"JAVASCRIPT_SITE_TITLE", nil, [NSBundle mainBundle], @"JavaScript on %@", @"Label of the per-website JavaScript setting in data saver settings. %@ will be replaced with the website's host name"), host]];
+			cell.textLabel.adjustsFontSizeToFitWidth = YES;
+			cell.detailTextLabel.adjustsFontSizeToFitWidth = YES;
+			cell.detailTextLabel.text = [[self class] titleForJavaScriptSetting:[JAHPJavaScriptPolicy settingForURL:[wvt url]]];
+		}
 	}
 
 	return cell;
@@ -58,6 +122,10 @@ static AppDelegate *appDelegate;
 	} else if ([specifier.key isEqualToString:kTutorialSpecifierKey]) {
 		[AppDelegate sharedAppDelegate].webViewController.showTutorial = YES;
 		[self dismiss:nil];
+	} else if ([specifier.key isEqualToString:kDataSaverSiteSpecifierKey]) {
+		[self menuDataSaverSiteFromTableView:tableView];
+	} else if ([specifier.key isEqualToString:kJavaScriptSiteSpecifierKey]) {
+		[self menuJavaScriptSiteFromTableView:tableView];
 	}
 }
 
@@ -65,24 +133,128 @@ static AppDelegate *appDelegate;
 	[super settingsViewController:sender buttonTappedForSpecifier:specifier];
 
 	if ([specifier.key isEqualToString:kClearWebsiteData]) {
-		UIAlertView *alert = [[UIAlertView alloc] initWithTitle:@""
-														message:NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEAR_ALL_COOKIES_PROMPT", nil, [NSBundle mainBundle], @"Remove all cookies and browsing data?", @"Title of alert to clear local cookies and browsing data")
-													   delegate:self
-											  cancelButtonTitle:NSLocalizedStringWithDefaultValue(@"CANCEL_ACTION", nil, [NSBundle mainBundle], @"Cancel", @"Cancel action")
-											  otherButtonTitles:NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEAR_ALL_COOKIES_PROMPT_BUTTON", nil, [NSBundle mainBundle], @"Clear Cookies and Data", @"Accept button on alert which triggers clearing all local cookies and browsing data"), nil];
-
-		[alert show];
+		[self menuClearWebsiteData];
 	}
 }
 
-- (void)alertView:(UIAlertView *)alertView clickedButtonAtIndex:(NSInteger)buttonIndex
+- (void)menuClearWebsiteData
 {
-	if (buttonIndex == [alertView cancelButtonIndex]) {
-		// do nothing, user has cancelled
-	} else if (buttonIndex == [alertView firstOtherButtonIndex]) {
+	NSString *host = [[[[[AppDelegate sharedAppDelegate] webViewController] curWebViewTab] url] host];
+
+	UIAlertController *alertController = [UIAlertController alertControllerWithTitle:nil message:NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEAR_ALL_COOKIES_PROMPT", nil, [NSBundle mainBundle], @"Remove all cookies and browsing data?", @"Title of alert to clear local cookies and browsing data") preferredStyle:UIAlertControllerStyleAlert];
+
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEAR_ALL_COOKIES_PROMPT_BUTTON", nil, [NSBundle mainBundle], @"Clear Cookies and Data", @"Accept button on alert which triggers clearing all local cookies and browsing data") style:UIAlertActionStyleDestructive handler:^(UIAlertAction *action) {
 		// clear history and website data
 		[Privacy clearWebsiteData];
+	}]];
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEAR_EXCEPT_BOOKMARKS_BUTTON", nil, [NSBundle mainBundle], @"Keep Data of Bookmarked Sites", @"Button on alert which triggers clearing the cookies and browsing data of every website except bookmarked ones") style:UIAlertActionStyleDestructive handler:^(UIAlertAction *action) {
+		[self clearWebsiteDataWithProgress:^(void (^progress)(float), void (^completion)(void)) {
+			[Privacy clearWebsiteDataExceptBookmarksWithProgress:progress completion:completion];
+		}];
+	}]];
+	if (host != nil) {
+		[alertController addAction:[UIAlertAction actionWithTitle:[NSString stringWithFormat:NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEAR_SITE_BUTTON", nil, [NSBundle mainBundle], @"Clear Only %@", @"Button on alert which triggers clearing the cookies and browsing data of the current website. %@ will be replaced with the website's host name"), host] style:UIAlertActionStyleDestructive handler:^(UIAlertAction *action) {
+			[self clearWebsiteDataWithProgress:^(void (^progress)(float), void (^completion)(void)) {
+				[Privacy clearWebsiteDataForSite:host progress:progress completion:completion];
+			}];
+		}]];
+	}
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"CANCEL_ACTION", nil, [NSBundle mainBundle], @"Cancel", @"Cancel action") style:UIAlertActionStyleCancel handler:nil]];
+
+	[self presentViewController:alertController animated:YES completion:nil];
+}
+
+/*! Shows the progress of clearing website data until it's done.
+ */
+
+- (void)clearWebsiteDataWithProgress:(void (^)(void (^progress)(float), void (^completion)(void)))clear
+{
+	NSString *title = NSLocalizedStringWithDefaultValue(@"SETTINGS_CLEARING_DATA_TITLE", nil, [NSBundle mainBundle], @"Clearing Data…", @"Title of alert shown while cookies and browsing data are being cleared");
+	UIAlertController *progressController = [UIAlertController alertControllerWithTitle:title message:@"0%" preferredStyle:UIAlertControllerStyleAlert];
+
+	[self presentViewController:progressController animated:YES completion:^{
+		clear(^(float fraction) {
+			progressController.message = [NSString stringWithFormat:@"%d%%", (int)(fraction * 100)];
+		}, ^{
+			[progressController dismissViewControllerAnimated:YES completion:nil];
+		});
+	}];
+}
+
+- (void)menuDataSaverSiteFromTableView:(UITableView *)tableView
+{
+	NSString *host = [[[[[AppDelegate sharedAppDelegate] webViewController] curWebViewTab] url] host];
+	if (host == nil) {
+		return;
+	}
+
+	UIAlertController *alertController = [UIAlertController alertControllerWithTitle:host message:nil preferredStyle:UIAlertControllerStyleActionSheet];
+
+	void (^choose)(NSNumber *) = ^(NSNumber *setting) {
+		[JAHPDataSaver setSetting:setting forHost:host];
+		[tableView reloadData];
+	};
+
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"DATA_SAVER_SITE_ON", nil, [NSBundle mainBundle], @"On", @"Data saver is on for this website") style:UIAlertActionStyleDefault handler:^(UIAlertAction *action) {
+		choose(@YES);
+	}]];
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"DATA_SAVER_SITE_OFF", nil, [NSBundle mainBundle], @"Off", @"Data saver is off for this website") style:UIAlertActionStyleDefault handler:^(UIAlertAction *action) {
+		choose(@NO);
+	}]];
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"DATA_SAVER_SITE_DEFAULT", nil, [NSBundle mainBundle], @"Same as all sites", @"Action that makes a website follow the data saver setting for all sites") style:UIAlertActionStyleDefault handler:^(UIAlertAction *action) {
+		choose(nil);
+	}]];
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"CANCEL_ACTION", nil, [NSBundle mainBundle], @"Cancel", @"Cancel action") style:UIAlertActionStyleCancel handler:nil]];
+
+	UIPopoverPresentationController *popover = [alertController popoverPresentationController];
+	if (popover) {
+		NSIndexPath *indexPath = [tableView indexPathForSelectedRow];
+		UITableViewCell *cell = (indexPath != nil ? [tableView cellForRowAtIndexPath:indexPath] : nil);
+		popover.sourceView = (cell != nil ? cell : tableView);
+		popover.sourceRect = [popover.sourceView bounds];
 	}
+
+	[self presentViewController:alertController animated:YES completion:nil];
+}
+
++ (NSString *)titleForJavaScriptSetting:(JAHPJavaScriptSetting)setting
+{
+	switch (setting) {
+		case JAHPJavaScriptSettingOn:
+			return NSLocalizedStringWithDefaultValue(@"JAVASCRIPT_SITE_ON", nil, [NSBundle mainBundle], @"On", @"JavaScript is on for this website");
+		case JAHPJavaScriptSettingFirstPartyOnly:
+			return NSLocalizedStringWithDefaultValue(@"JAVASCRIPT_SITE_FIRST_PARTY", nil, [NSBundle mainBundle], @"Website's own scripts only", @"JavaScript is limited to the website's own scripts on this website");
+		case JAHPJavaScriptSettingOff:
+			return NSLocalizedStringWithDefaultValue(@"JAVASCRIPT_SITE_OFF", nil, [NSBundle mainBundle], @"Off", @"JavaScript is off for this website");
+	}
+}
+
+- (void)menuJavaScriptSiteFromTableView:(UITableView *)tableView
+{
+	NSString *host = [[[[[AppDelegate sharedAppDelegate] webViewController] curWebViewTab] url] host];
+	if (host == nil) {
+		return;
+	}
+
+	UIAlertController *alertController = [UIAlertController alertControllerWithTitle:host message:nil preferredStyle:UIAlertControllerStyleActionSheet];
+
+	for (NSNumber *setting in @[ @(JAHPJavaScriptSettingOn), @(JAHPJavaScriptSettingFirstPartyOnly), @(JAHPJavaScriptSettingOff) ]) {
+		[alertController addAction:[UIAlertAction actionWithTitle:[[self class] titleForJavaScriptSetting:[setting integerValue]] style:UIAlertActionStyleDefault handler:^(UIAlertAction *action) {
+			[JAHPJavaScriptPolicy setSetting:[setting integerValue] forHost:host];
+			[tableView reloadData];
+		}]];
+	}
+	[alertController addAction:[UIAlertAction actionWithTitle:NSLocalizedStringWithDefaultValue(@"CANCEL_ACTION", nil, [NSBundle mainBundle], @"Cancel", @"Cancel action") style:UIAlertActionStyleCancel handler:nil]];
+
+	UIPopoverPresentationController *popover = [alertController popoverPresentationController];
+	if (popover) {
+		NSIndexPath *indexPath = [tableView indexPathForSelectedRow];
+		UITableViewCell *cell = (indexPath != nil ? [tableView cellForRowAtIndexPath:indexPath] : nil);
+		popover.sourceView = (cell != nil ? cell : tableView);
+		popover.sourceRect = [popover.sourceView bounds];
+	}
+
+	[self presentViewController:alertController animated:YES completion:nil];
 }
 
 - (void)menuHTTPSEverywhere
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Keeps track of which site owns each localStorage database and IndexedDB directory
+ *  the web view creates, so that one site's data can be found without scanning.
+ *  \details UIWebView keeps localStorage next to our own caches, in files and
+ *  directories named after the origin they belong to:
+ *
+ *    Library/Caches/https_m.imgur.com_0.localstorage
+ *    Library/Caches/http_samy.pl_0/0000000000000001.db
+ *    Library/Caches/___IndexedDB/https_example.com_0/
+ *
+ *  The directory is listed once when the index is created, and after that each entry is
+ *  filed under its site (see JAHPCookieStore) as it appears, by watching the directory
+ *  for changes.  IndexedDB origins live one level down, and are listed when asked for.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface SiteDataIndex : NSObject
+
+/*! Returns the index of Library/Caches, which starts watching it.
+ */
+
++ (nonnull instancetype)sharedIndex;
+
+/*! Indexes and watches directory.
+ */
+
+- (nonnull instancetype)initWithDirectory:(nonnull NSString *)directory;
+
+/*! Returns the paths of every localStorage and IndexedDB file and directory, keyed by
+ *  the site they belong to.
+ */
+
+- (nonnull NSDictionary<NSString *, NSArray<NSString *> *> *)filesBySite;
+
+/*! Returns the paths of the local storage of the site host is in.
+ */
+
+- (nonnull NSArray<NSString *> *)filesForSite:(nonnull NSString *)host;
+
+/*! Returns the host of the origin a localStorage or IndexedDB file or directory is named
+ *  after, or nil if it's something else.
+ */
+
++ (nullable NSString *)hostOfFileName:(nonnull NSString *)name;
+
+@end
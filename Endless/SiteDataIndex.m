@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "SiteDataIndex.h"
+
+#import <fcntl.h>
+
+#import "JAHPCookieStore.h"
+
+#define INDEXED_DB_DIRECTORY @"___IndexedDB"
+
+@implementation SiteDataIndex {
+	NSString *_directory;
+	NSMutableDictionary<NSString *, NSString *> *_siteByName;
+	dispatch_queue_t _queue;
+	dispatch_source_t _source;
+}
+
++ (instancetype)sharedIndex
+{
+	static SiteDataIndex *index;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+		index = [[SiteDataIndex alloc] initWithDirectory:caches];
+	});
+	return index;
+}
+
++ (NSString *)hostOfFileName:(NSString *)name
+{
+	/* scheme_host_port, possibly followed by .localstorage and a SQLite suffix */
+	NSRange dot = [name rangeOfString:@".localstorage"];
+	if (dot.location != NSNotFound) {
+		name = [name substringToIndex:dot.location];
+	}
+
+	NSRange scheme = [name rangeOfString:@"_"];
+	NSRange port = [name rangeOfString:@"_" options:NSBackwardsSearch];
+	if (scheme.location == NSNotFound || port.location <= scheme.location + 1 || port.location + 1 >= [name length]) {
+		return nil;
+	}
+
+	NSString *prefix = [name substringToIndex:scheme.location];
+	if (![prefix isEqualToString:@"http"] && ![prefix isEqualToString:@"https"]) {
+		return nil;
+	}
+
+	NSString *portString = [name substringFromIndex:(port.location + 1)];
+	if ([portString rangeOfCharacterFromSet:[[NSCharacterSet decimalDigitCharacterSet] invertedSet]].location != NSNotFound) {
+		return nil;
+	}
+
+	return [name substringWithRange:NSMakeRange(scheme.location + 1, port.location - scheme.location - 1)];
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory
+{
+	self = [super init];
+	if (self == nil) {
+		return nil;
+	}
+
+	_directory = directory;
+	_siteByName = [[NSMutableDictionary alloc] init];
+	_queue = dispatch_queue_create("SiteDataIndex", DISPATCH_QUEUE_SERIAL);
+
+	dispatch_sync(_queue, ^{
+		[self update];
+	});
+
+	int fd = open([_directory fileSystemRepresentation], O_EVTONLY);
+	if (fd >= 0) {
+		__weak SiteDataIndex *weakSelf = self;
+		_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, fd, DISPATCH_VNODE_WRITE, _queue);
+		dispatch_source_set_event_handler(_source, ^{
+			[weakSelf update];
+		});
+		dispatch_source_set_cancel_handler(_source, ^{
+			close(fd);
+		});
+		dispatch_resume(_source);
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_source != nil) {
+		dispatch_source_cancel(_source);
+	}
+}
+
+/*! Files the entries that appeared since the last update and forgets those that went.
+ *  Runs on _queue.
+ */
+
+- (void)update
+{
+	NSArray<NSString *> *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_directory error:nil];
+	NSSet<NSString *> *present = [NSSet setWithArray:names];
+
+	for (NSString *name in [_siteByName allKeys]) {
+		if (![present containsObject:name]) {
+			[_siteByName removeObjectForKey:name];
+		}
+	}
+
+	for (NSString *name in names) {
+		if ([_siteByName objectForKey:name] != nil) {
+			continue;
+		}
+		NSString *host = [[self class] hostOfFileName:name];
+		if (host != nil) {
+			[_siteByName setObject:[JAHPCookieStore siteOfHost:host] forKey:name];
+		}
+	}
+}
+
+- (NSDictionary<NSString *, NSArray<NSString *> *> *)filesBySite
+{
+	NSMutableDictionary<NSString *, NSMutableArray<NSString *> *> *files = [[NSMutableDictionary alloc] init];
+
+	void (^add)(NSString *, NSString *) = ^(NSString *site, NSString *path) {
+		NSMutableArray<NSString *> *paths = [files objectForKey:site];
+		if (paths == nil) {
+			paths = [[NSMutableArray alloc] init];
+			[files setObject:paths forKey:site];
+		}
+		[paths addObject:path];
+	};
+
+	dispatch_sync(_queue, ^{
+		[self->_siteByName enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *site, BOOL *stop) {
+			add(site, [self->_directory stringByAppendingPathComponent:name]);
+		}];
+	});
+
+	NSString *indexedDB = [_directory stringByAppendingPathComponent:INDEXED_DB_DIRECTORY];
+	for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:indexedDB error:nil]) {
+		NSString *host = [[self class] hostOfFileName:name];
+		if (host != nil) {
+			add([JAHPCookieStore siteOfHost:host], [indexedDB stringByAppendingPathComponent:name]);
+		}
+	}
+
+	return files;
+}
+
+- (NSArray<NSString *> *)filesForSite:(NSString *)host
+{
+	return [[self filesBySite] objectForKey:[JAHPCookieStore siteOfHost:host]] ?: @[];
+}
+
+@end
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Blocks requests to known ad and tracking hosts before they reach the tunnel.
+ *  \details The blocked hosts are compiled from urlblocker.json by convert_rules.rb, keyed
+ *  by domain with the name of the company behind them.  A domain blocks itself and all of
+ *  its subdomains.  Lookups go through an index of the domains' labels in reverse (com,
+ *  doubleclick, ...) so that checking a host costs one step per label however long the
+ *  list is.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface URLBlocker : NSObject
+
++ (NSDictionary *)targets;
+
+/*! Returns the company url's host is blocked as belonging to, or nil if it isn't blocked.
+ */
+
++ (NSString *)blockingTargetForURL:(NSURL *)url;
+
+/*! Returns the company host is blocked as belonging to, or nil if it isn't blocked.
+ */
+
++ (NSString *)blockingTargetForHost:(NSString *)host;
+
+/*! Returns the company url is blocked as belonging to when loaded by a page, or nil if it
+ *  should be loaded.
+ *  \details Nothing is blocked on a page belonging to the same company, since that is a
+ *  site the user chose to visit rather than a third party tracking them there.
+ *  \param mainDocumentURL The URL of the page loading url, may be nil.
+ */
+
++ (NSString *)blockingTargetForURL:(NSURL *)url fromMainDocumentURL:(NSURL *)mainDocumentURL;
+
+@end
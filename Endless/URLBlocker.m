@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "URLBlocker.h"
+
+#import "JAHPHostVerdictCache.h"
+
+/* the key a node of the index stores its company under; no label can be empty */
+#define TARGET_KEY @""
+
+@implementation URLBlocker
+
+static NSDictionary *_targets;
+
+/* the targets the index was built from, and the index itself */
+static NSDictionary *_indexedTargets;
+static NSDictionary *_index;
+
++ (NSDictionary *)targets
+{
+	if (_targets == nil) {
+		NSString *path = [[NSBundle mainBundle] pathForResource:@"urlblocker_targets" ofType:@"plist"];
+		if (![[NSFileManager defaultManager] fileExistsAtPath:path]) {
+			NSLog(@"[URLBlocker] no target plist at %@", path);
+			abort();
+		}
+
+		_targets = [NSDictionary dictionaryWithContentsOfFile:path];
+	}
+
+	return _targets;
+}
+
+/*! Returns the reversed-label index of the targets, building it the first time.
+ */
+
++ (NSDictionary *)targetIndex
+{
+	NSDictionary *targets = [[self class] targets];
+
+	@synchronized (self) {
+		if (_index == nil || _indexedTargets != targets) {
+			NSMutableDictionary *root = [[NSMutableDictionary alloc] init];
+
+			[targets enumerateKeysAndObjectsUsingBlock:^(NSString *domain, NSString *company, BOOL *stop) {
+				NSMutableDictionary *node = root;
+				for (NSString *label in [[[[domain lowercaseString] componentsSeparatedByString:@"."] reverseObjectEnumerator] allObjects]) {
+					if ([label length] == 0) {
+						continue;
+					}
+					NSMutableDictionary *child = [node objectForKey:label];
+					if (child == nil) {
+						child = [[NSMutableDictionary alloc] init];
+						[node setObject:child forKey:label];
+					}
+					node = child;
+				}
+				if (node != root) {
+					[node setObject:company forKey:TARGET_KEY];
+				}
+			}];
+
+			_index = root;
+			_indexedTargets = targets;
+			[JAHPHostVerdictCache invalidate];
+		}
+
+		return _index;
+	}
+}
+
++ (NSString *)blockingTargetForURL:(NSURL *)url
+{
+	return [[self class] blockingTargetForHost:[url host]];
+}
+
++ (NSString *)blockingTargetForHost:(NSString *)host
+{
+	host = [host lowercaseString];
+	if (host == nil || [host length] == 0) {
+		return nil;
+	}
+
+	NSDictionary *node = [[self class] targetIndex];
+	for (NSString *label in [[host componentsSeparatedByString:@"."] reverseObjectEnumerator]) {
+		if ([label length] == 0) {
+			continue;
+		}
+
+		node = [node objectForKey:label];
+		if (node == nil) {
+			return nil;
+		}
+
+		/* the shortest blocked domain wins, it covers everything below it */
+		NSString *company = [node objectForKey:TARGET_KEY];
+		if (company != nil) {
+			return company;
+		}
+	}
+
+	return nil;
+}
+
++ (NSString *)blockingTargetForURL:(NSURL *)url fromMainDocumentURL:(NSURL *)mainDocumentURL
+{
+	NSString *company = [[self class] blockingTargetForURL:url];
+	if (company == nil) {
+		return nil;
+	}
+
+	if (mainDocumentURL != nil && [company isEqualToString:[[self class] blockingTargetForURL:mainDocumentURL]]) {
+		return nil;
+	}
+
+	return company;
+}
+
+@end
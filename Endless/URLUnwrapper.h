@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Takes tracking redirectors and tracking query parameters out of navigations.
+ *  \details Links on many sites don't point at their destination but at a redirector
+ *  on the site's own domain (l.facebook.com/l.php?u=..., www.google.com/url?q=...) that
+ *  logs the click and then bounces the browser on.  Over the tunnel each of those bounces
+ *  costs a full round trip before the real page even starts loading.  Where the
+ *  destination is carried in the redirector's query it can be recovered locally and
+ *  the hop skipped entirely.
+ *
+ *  The redirectors and parameters are compiled from redirectors.json by convert_rules.rb.
+ */
+
+@interface URLUnwrapper : NSObject
+
++ (NSDictionary *)rules;
+
+/*! Returns the destination url leads to once any known redirectors in front of it have
+ *  been unwrapped and known tracking parameters have been stripped from its query.
+ *  \param hops Set to the number of redirector round trips skipped, may be NULL.
+ *  \returns url itself if there was nothing to take out.
+ */
+
++ (NSURL *)unwrappedURLForURL:(NSURL *)url hops:(NSUInteger *)hops;
+
+/*! Returns the destination embedded in a single redirector URL, or nil if url is not
+ *  a known redirector or does not carry a usable http(s) destination.
+ */
+
++ (NSURL *)destinationOfRedirectorURL:(NSURL *)url;
+
+/*! Returns url without any known tracking parameters in its query.
+ */
+
++ (NSURL *)URLByStrippingTrackingParametersFromURL:(NSURL *)url;
+
+@end
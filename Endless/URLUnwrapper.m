@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "URLUnwrapper.h"
+
+/* redirectors wrapping redirectors are common (search result -> social site -> link shortener) but bound it */
+#define MAX_UNWRAP_HOPS 8
+
+@implementation URLUnwrapper
+
+static NSDictionary *_rules;
+
++ (NSDictionary *)rules
+{
+	if (_rules == nil) {
+		NSString *path = [[NSBundle mainBundle] pathForResource:@"redirectors" ofType:@"plist"];
+		if (![[NSFileManager defaultManager] fileExistsAtPath:path]) {
+			NSLog(@"[URLUnwrapper] no redirector plist at %@", path);
+			abort();
+		}
+
+		_rules = [NSDictionary dictionaryWithContentsOfFile:path];
+	}
+
+	return _rules;
+}
+
++ (NSURL *)unwrappedURLForURL:(NSURL *)url hops:(NSUInteger *)hops
+{
+	NSUInteger n = 0;
+
+	for (NSURL *destination; n < MAX_UNWRAP_HOPS && (destination = [[self class] destinationOfRedirectorURL:url]) != nil; n++) {
+		url = destination;
+	}
+
+	if (hops != NULL) {
+		*hops = n;
+	}
+
+	return [[self class] URLByStrippingTrackingParametersFromURL:url];
+}
+
++ (NSURL *)destinationOfRedirectorURL:(NSURL *)url
+{
+	NSString *host = [[url host] lowercaseString];
+	if (host == nil) {
+		return nil;
+	}
+
+	NSArray *redirectors = [[[[self class] rules] objectForKey:@"redirectors"] objectForKey:host];
+	if (redirectors == nil) {
+		return nil;
+	}
+
+	NSURLComponents *components = [NSURLComponents componentsWithURL:url resolvingAgainstBaseURL:NO];
+	NSString *path = [components path];
+	NSString *query = [components percentEncodedQuery];
+	if (query == nil || [query length] == 0) {
+		return nil;
+	}
+	if (path == nil || [path length] == 0) {
+		path = @"/";
+	}
+
+	for (NSDictionary *redirector in redirectors) {
+		if (![path hasPrefix:[redirector objectForKey:@"path"]]) {
+			continue;
+		}
+
+		NSString *param = [redirector objectForKey:@"param"];
+		NSString *value = nil;
+
+		if ([param length] == 0) {
+			/* the whole query is the destination, encoded or not */
+			value = query;
+			if ([[value lowercaseString] hasPrefix:@"http%3a"]) {
+				value = [value stringByRemovingPercentEncoding];
+			}
+		} else {
+			for (NSURLQueryItem *item in [components queryItems]) {
+				if ([[item name] isEqualToString:param]) {
+					value = [item value];
+					break;
+				}
+			}
+		}
+
+		if (value == nil) {
+			continue;
+		}
+
+		NSURL *destination = [NSURL URLWithString:value];
+		NSString *scheme = [[destination scheme] lowercaseString];
+
+		/* never let a redirector take us somewhere a link couldn't, like javascript: */
+		if (destination != nil && [destination host] != nil && ([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"])) {
+			return destination;
+		}
+	}
+
+	return nil;
+}
+
++ (BOOL)isTrackingParameter:(NSString *)name
+{
+	NSDictionary *rules = [[self class] rules];
+
+	name = [[name stringByRemovingPercentEncoding] lowercaseString];
+	if (name == nil) {
+		return NO;
+	}
+
+	if ([[rules objectForKey:@"tracking_parameters"] containsObject:name]) {
+		return YES;
+	}
+
+	for (NSString *prefix in [rules objectForKey:@"tracking_parameter_prefixes"]) {
+		if ([name hasPrefix:prefix]) {
+			return YES;
+		}
+	}
+
+	return NO;
+}
+
++ (NSURL *)URLByStrippingTrackingParametersFromURL:(NSURL *)url
+{
+	NSURLComponents *components = [NSURLComponents componentsWithURL:url resolvingAgainstBaseURL:NO];
+	NSString *query = [components percentEncodedQuery];
+	if (query == nil || [query length] == 0) {
+		return url;
+	}
+
+	/* work on the encoded query so everything we keep goes back exactly as the site wrote it */
+	NSArray *pairs = [query componentsSeparatedByString:@"&"];
+	NSMutableArray *kept = [[NSMutableArray alloc] initWithCapacity:[pairs count]];
+
+	for (NSString *pair in pairs) {
+		NSString *name = [[pair componentsSeparatedByString:@"="] firstObject];
+		if (![[self class] isTrackingParameter:name]) {
+			[kept addObject:pair];
+		}
+	}
+
+	if ([kept count] == [pairs count]) {
+		return url;
+	}
+
+	[components setPercentEncodedQuery:([kept count] > 0 ? [kept componentsJoinedByString:@"&"] : nil)];
+
+	NSURL *stripped = [components URL];
+	return (stripped != nil ? stripped : url);
+}
+
+@end
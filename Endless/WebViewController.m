@@ -18,6 +18,7 @@
 #import "SSLCertificateViewController.h"
 #import "UpstreamProxySettings.h"
 #import "JAHPAuthenticatingHTTPProtocol.h"
+#import "JAHPJavaScriptPolicy.h"
 #import "WebViewController.h"
 #import "WebViewTab.h"
 #import "PsiphonClientCommonLibraryHelpers.h"
@@ -1085,6 +1086,17 @@ static BOOL (^safeStringsEqual)(NSString *, NSString *) = ^BOOL(NSString *a, NSS
 			NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^www\\d*\\." options:NSRegularExpressionCaseInsensitive error:nil];
 			NSString *hostNoWWW = [regex stringByReplacingMatchesInString:host options:0 range:NSMakeRange(0, [host length]) withTemplate:@""];
 
+			/* text-only pages show what they cost next to the host */
+			long long textOnlyBytes = [self.curWebViewTab textOnlyBytes];
+			if (textOnlyBytes > 0) {
+				NSString *size = [NSByteCountFormatter stringFromByteCount:textOnlyBytes countStyle:NSByteCountFormatterCountStyleFile];
+				NSTimeInterval timeToReadable = [self.curWebViewTab textOnlyTimeToReadable];
+				if (timeToReadable > 0)
+					hostNoWWW = [NSString stringWithFormat:NSLocalizedStringWithDefaultValue(@"TEXT_ONLY_PAGE_READABLE", nil, [NSBundle mainBundle], @"%1$@ · %2$@, readable in %3$.1fs", @"Shown in the address bar for a text-only page. %1$@ will be replaced with the website's name, %2$@ with an amount of data such as '12 KB', and %3$.1f with a number of seconds"), hostNoWWW, size, timeToReadable];
+				else
+					hostNoWWW = [NSString stringWithFormat:NSLocalizedStringWithDefaultValue(@"TEXT_ONLY_PAGE_LOADING", nil, [NSBundle mainBundle], @"%1$@ · %2$@", @"Shown in the address bar while a text-only page loads. %1$@ will be replaced with the website's name, %2$@ with an amount of data such as '12 KB'"), hostNoWWW, size];
+			}
+
 			[urlField setText:hostNoWWW];
 
 			if ([urlField.text isEqualToString:@""]) {
@@ -1467,11 +1479,9 @@ static BOOL (^safeStringsEqual)(NSString *, NSString *) = ^BOOL(NSString *a, NSS
 	if (forceReconnect) {
 		[[AppDelegate sharedAppDelegate] scheduleRunningTunnelServiceRestart];
 	}
-	// Check if settings which have changed require reload tabs
-	if ([self isTabsReloadRequired]) {
-		for (int i = 0; i < webViewTabs.count; i++) {
-			[(WebViewTab *)webViewTabs[i] refresh];
-		}
+	// Reload the tabs whose settings have changed
+	for (WebViewTab *wvt in [self tabsRequiringReload]) {
+		[wvt refresh];
 	}
 }
 
@@ -1492,18 +1502,17 @@ static BOOL (^safeStringsEqual)(NSString *, NSString *) = ^BOOL(NSString *a, NSS
 	return NO;
 }
 
-- (BOOL) isTabsReloadRequired {
-
-	return NO; // TODO-DISABLE-JAVASCRIPT: disable javascript hardcoded off until fixed
-//	if (preferencesSnapshot) {
-//		// Check if "disable Javascript" has changed
-//		BOOL disableJavascript = [[preferencesSnapshot objectForKey:kDisableJavascript] boolValue];
-//
-//		if (disableJavascript != [[NSUserDefaults standardUserDefaults] boolForKey:kDisableJavascript]) {
-//			return YES;
-//		}
-//	}
-//	return NO;
+- (NSArray<WebViewTab *> *) tabsRequiringReload {
+	NSMutableArray<WebViewTab *> *tabs = [[NSMutableArray alloc] init];
+	if (preferencesSnapshot) {
+		// Only the tabs whose site's JavaScript setting has changed
+		for (WebViewTab *wvt in webViewTabs) {
+			if ([JAHPJavaScriptPolicy settingForURL:[wvt url] inPreferences:preferencesSnapshot] != [JAHPJavaScriptPolicy settingForURL:[wvt url]]) {
+				[tabs addObject:wvt];
+			}
+		}
+	}
+	return tabs;
 }
 
 #pragma mark - FeedbackViewControllerDelegate methods
@@ -1735,9 +1744,10 @@ static BOOL (^safeStringsEqual)(NSString *, NSString *) = ^BOOL(NSString *a, NSS
 {
 	ConnectionState state = [[notification.userInfo objectForKey:kPsiphonConnectionState] unsignedIntegerValue];
 	[psiphonConnectionIndicator displayConnectionState:state];
-	if (state != ConnectionStateConnected) {
+	/* loads in progress ride out a reconnect; JAHPAuthenticatingHTTPProtocol replays their requests once it's back */
+	if (state == ConnectionStateDisconnected) {
 		[self stopLoading];
-	} else {
+	} else if (state == ConnectionStateConnected) {
 		for (WebViewTab *wvt in webViewTabs) {
 			if ([wvt shouldReloadOnConnected]) {
 				[wvt refresh];
@@ -68,6 +68,15 @@ typedef NS_ENUM(NSInteger, WebViewTabFileDownloadState) {
 @property WebViewTabSecureMode secureMode;
 @property (strong, nonatomic) SSLCertificate *SSLCertificate;
 @property NSMutableDictionary *applicableHTTPSEverywhereRules;
+// Bytes data saver kept this tab from loading since its last navigation
+@property long long dataSaverBytesSaved;
+// Requests the URL blocker answered locally since the tab's last navigation
+@property NSUInteger blockedRequests;
+// Tracking redirector round trips skipped by unwrapping links locally, over the life of the tab
+@property NSUInteger redirectorHopsSkipped;
+// Bytes fetched for a text-only page, and how long it took to have something to read (0 until then)
+@property (readonly) long long textOnlyBytes;
+@property (readonly) NSTimeInterval textOnlyTimeToReadable;
 
 /* for javascript IPC */
 @property (strong, atomic) NSNumber *openedByTabHash;
@@ -89,6 +98,7 @@ typedef NS_ENUM(NSInteger, WebViewTabFileDownloadState) {
 - (void)zoomOut;
 - (void)zoomNormal;
 - (void)clearEquivalentURLs;
+- (void)setTextOnlyBytes:(long long)bytes timeToReadable:(NSTimeInterval)timeToReadable;
 - (void)initLocalizables;
 
 @end
@@ -25,6 +25,7 @@
 #import <Photos/Photos.h>
 #import "PsiphonData.h"
 #import "JAHPAuthenticatingHTTPProtocol.h"
+#import "JAHPSnapshotStore.h"
 #import "WebViewTab.h"
 
 #import "NSString+JavascriptEscape.h"
@@ -272,6 +273,10 @@
 {
 	[[self applicableHTTPSEverywhereRules] removeAllObjects];
 	[self setSSLCertificate:nil];
+	[self setDataSaverBytesSaved:0];
+	[self setBlockedRequests:0];
+	_textOnlyBytes = 0;
+	_textOnlyTimeToReadable = 0;
 }
 
 - (void)loadURL:(NSURL *)u
@@ -372,15 +377,26 @@
 
 	if (![[url scheme] isEqualToString:@"endlessipc"]) {
 		if ([AppDelegate sharedAppDelegate].psiphonConectionState != ConnectionStateConnected) {
+			BOOL isMainDocument = [[[request mainDocumentURL] absoluteString] isEqualToString:[[request URL] absoluteString]];
+
 			// We are not connected:
-			// 1. Show dismissable modal with the connection status if request is for
+			// 1. If we have a snapshot of the document, let JAHPAuthenticatingHTTPProtocol
+			//    serve it from there (it reads the archive off the main thread) and reload
+			//    this tab with live content when we get connected
+			// 2. Otherwise show dismissable modal with the connection status if request is for
 			//    mainDocumentURL and mark this tab for reload when we get connected
-			// 2. Cancel loading the request by returning NO
-			if ([[[request mainDocumentURL] absoluteString] isEqualToString:[[request URL] absoluteString]]) {
-				[[[AppDelegate sharedAppDelegate] webViewController] showPsiphonConnectionStatusAlert];
-				[self setShouldReloadOnConnected:YES];
+			// 3. Cancel loading the request by returning NO
+			if ([[JAHPSnapshotStore sharedStore] hasSnapshotOfDocument:([request mainDocumentURL] ?: url)]) {
+				if (isMainDocument) {
+					[self setShouldReloadOnConnected:YES];
+				}
+			} else {
+				if (isMainDocument) {
+					[[[AppDelegate sharedAppDelegate] webViewController] showPsiphonConnectionStatusAlert];
+					[self setShouldReloadOnConnected:YES];
+				}
+				return NO;
 			}
-			return NO;
 		}
 
 		/* Taken from upstream:
@@ -691,6 +707,18 @@
 	}
 }
 
+- (void)setTextOnlyBytes:(long long)bytes timeToReadable:(NSTimeInterval)timeToReadable
+{
+	_textOnlyBytes = bytes;
+	_textOnlyTimeToReadable = timeToReadable;
+	dispatch_async(dispatch_get_main_queue(), ^{
+		WebViewController *wvc = [[AppDelegate sharedAppDelegate] webViewController];
+		if ([wvc curWebViewTab] == self) {
+			[wvc updateSearchBarDetails];
+		}
+	});
+}
+
 - (void)setProgress:(NSNumber *)pr
 {
 	_progress = pr;
@@ -109,7 +109,9 @@
 - (void)resolvePendingAuthenticationChallengeWithCredential:(nonnull NSURLCredential *)credential;
 - (void)cancelPendingAuthenticationChallenge;
 
-/*! Call when NSURLSession configuration changes to reset the shared instance
+/*! Call when NSURLSession configuration changes to reset the shared instance.
+ *  New requests use a session with the new configuration; requests already in flight
+ *  finish on the old one, which is then invalidated.
  */
 + (void)resetSharedDemux;
 
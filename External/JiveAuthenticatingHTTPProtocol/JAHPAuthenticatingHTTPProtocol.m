@@ -46,14 +46,28 @@
 
  */
 
+#import "AdblockCosmeticFilterList.h"
+#import "AdblockFilterList.h"
 #import "CookieJar.h"
 #import "HSTSCache.h"
 #import "HTTPSEverywhere.h"
+#import "URLUnwrapper.h"
 #import "OCSPAuthURLSessionDelegate.h"
 
 #import "JAHPAuthenticatingHTTPProtocol.h"
 #import "JAHPCanonicalRequest.h"
+#import "JAHPContentSecurityPolicy.h"
 #import "JAHPCacheStoragePolicy.h"
+#import "JAHPDiskCache.h"
+#import "JAHPHTMLRewriter.h"
+#import "JAHPHostVerdictCache.h"
+#import "JAHPJavaScriptPolicy.h"
+#import "JAHPLatencyTracker.h"
+#import "JAHPMIMEType.h"
+#import "JAHPRequestBodySpool.h"
+#import "JAHPSnapshotStore.h"
+#import "JAHPDataSaver.h"
+#import "JAHPTextOnlyReducer.h"
 #import "JAHPQNSURLSessionDemux.h"
 
 // I use the following typedef to keep myself sane in the face of the wacky
@@ -97,9 +111,111 @@ typedef void (^JAHPChallengeCompletionHandler)(NSURLSessionAuthChallengeDisposit
 
 @end
 
+/*! The response headers we act on, found in one pass over allHeaderFields.
+ */
+
+typedef struct {
+	NSString *contentType;                      // lowercased
+	NSString *contentSecurityPolicy;            // Content-Security-Policy, or X-WebKit-CSP if there's none
+	NSMutableArray<NSString *> *contentSecurityPolicyFields;  // the names of every CSP header, as sent
+	NSString *setCookie;
+	NSString *strictTransportSecurity;
+	NSString *contentEncoding;
+	NSString *contentRange;
+	NSString *etag;
+	NSString *lastModified;
+} JAHPResponseHeaders;
+
+typedef NS_ENUM(NSInteger, JAHPResponseHeaderField) {
+	JAHPResponseHeaderFieldContentType,
+	JAHPResponseHeaderFieldContentSecurityPolicy,
+	JAHPResponseHeaderFieldWebKitCSP,
+	JAHPResponseHeaderFieldSetCookie,
+	JAHPResponseHeaderFieldStrictTransportSecurity,
+	JAHPResponseHeaderFieldContentEncoding,
+	JAHPResponseHeaderFieldContentRange,
+	JAHPResponseHeaderFieldETag,
+	JAHPResponseHeaderFieldLastModified,
+};
+
+static JAHPResponseHeaders JAHPClassifyResponseHeaders(NSHTTPURLResponse *response)
+{
+	static NSDictionary<NSString *, NSNumber *> *fieldsByName;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		fieldsByName = @{
+						 @"content-type": @(JAHPResponseHeaderFieldContentType),
+						 @"content-security-policy": @(JAHPResponseHeaderFieldContentSecurityPolicy),
+						 @"x-webkit-csp": @(JAHPResponseHeaderFieldWebKitCSP),
+						 @"set-cookie": @(JAHPResponseHeaderFieldSetCookie),
+						 [HSTS_HEADER lowercaseString]: @(JAHPResponseHeaderFieldStrictTransportSecurity),
+						 @"content-encoding": @(JAHPResponseHeaderFieldContentEncoding),
+						 @"content-range": @(JAHPResponseHeaderFieldContentRange),
+						 @"etag": @(JAHPResponseHeaderFieldETag),
+						 @"last-modified": @(JAHPResponseHeaderFieldLastModified),
+						 };
+	});
+
+	JAHPResponseHeaders headers = { nil };
+	NSString *webKitCSP = nil;
+	NSDictionary *allHeaderFields = [response allHeaderFields];
+
+	for (NSString *name in allHeaderFields) {
+		NSNumber *field = fieldsByName[[name lowercaseString]];
+		if (field == nil) {
+			continue;
+		}
+
+		NSString *value = allHeaderFields[name];
+		switch ((JAHPResponseHeaderField) [field integerValue]) {
+			case JAHPResponseHeaderFieldContentType:
+				headers.contentType = [value lowercaseString];
+				break;
+			case JAHPResponseHeaderFieldContentSecurityPolicy:
+			case JAHPResponseHeaderFieldWebKitCSP:
+				if (headers.contentSecurityPolicyFields == nil) {
+					headers.contentSecurityPolicyFields = [[NSMutableArray alloc] initWithCapacity:2];
+				}
+				[headers.contentSecurityPolicyFields addObject:name];
+				if ([field integerValue] == JAHPResponseHeaderFieldContentSecurityPolicy) {
+					headers.contentSecurityPolicy = value;
+				} else {
+					webKitCSP = value;
+				}
+				break;
+			case JAHPResponseHeaderFieldSetCookie:
+				headers.setCookie = value;
+				break;
+			case JAHPResponseHeaderFieldStrictTransportSecurity:
+				headers.strictTransportSecurity = value;
+				break;
+			case JAHPResponseHeaderFieldContentEncoding:
+				headers.contentEncoding = value;
+				break;
+			case JAHPResponseHeaderFieldContentRange:
+				headers.contentRange = value;
+				break;
+			case JAHPResponseHeaderFieldETag:
+				headers.etag = value;
+				break;
+			case JAHPResponseHeaderFieldLastModified:
+				headers.lastModified = value;
+				break;
+		}
+	}
+
+	if (headers.contentSecurityPolicy == nil) {
+		headers.contentSecurityPolicy = webKitCSP;
+	}
+
+	return headers;
+}
+
 @interface JAHPAuthenticatingHTTPProtocol () <NSURLSessionDataDelegate> {
 	NSUInteger _contentType;
-	Boolean _isFirstChunk;
+	JAHPHTMLRewriter *_htmlRewriter;
+	JAHPTextOnlyReducer *_textOnlyReducer;
+	NSTimeInterval _textOnlyTimeToReadable;
 	NSString * _cspNonce;
 	WebViewTab *_wvt;
 	NSString *_userAgent;
@@ -107,6 +223,41 @@ typedef void (^JAHPChallengeCompletionHandler)(NSURLSessionAuthChallengeDisposit
 	BOOL _isOrigin;
 	BOOL _isTemporarilyAllowed;
 	BOOL _isOCSPRequest;
+	BOOL _recordsLatency;
+
+	// State for replaying the request if the tunnel goes away mid-load; see -holdForReconnectWithError:.
+	BOOL _didSendResponse;
+	BOOL _resumable;
+	NSInteger _responseStatusCode;
+	NSString *_resumeValidator;
+	int64_t _receivedLength;
+	int64_t _bytesToDiscard;
+	NSUInteger _replayCount;
+	NSError *_heldError;
+
+	JAHPRequestBodySpool *_bodySpool;
+	BOOL _isStopped;
+
+	// The response, while we wait for the body to show what it really is; see -sniffContentOfData:.
+	NSURLResponse *_heldResponse;
+	NSURLCacheStoragePolicy _heldCacheStoragePolicy;
+	BOOL _heldResponseIsLabeled;    // it came with a Content-Type
+	NSFileHandle *_sniffedDownload;
+	NSURL *_sniffedDownloadURL;
+	int64_t _sniffedDownloadExpectedLength;
+
+	// The response as given to the client, and its body so far, while recording them for
+	// an offline snapshot; see -beginSnapshotRecordOfResponse:.
+	NSHTTPURLResponse *_snapshotResponse;
+	NSMutableData *_snapshotData;
+
+	// Whether data saver is on for the page this request belongs to, and where to cut off
+	// the body if it is; see -applyDataSaverToResponse:headers:.
+	BOOL _dataSaver;
+	int64_t _dataSaverLimit;
+
+	// The company or filter that blocked the request, or nil if it isn't blocked; see -serveBlockedResponse.
+	NSString *_blockedBy;
 }
 
 @property (atomic, strong, readwrite) NSThread *                        clientThread;       ///< The thread on which we should call the client.
@@ -123,6 +274,12 @@ typedef void (^JAHPChallengeCompletionHandler)(NSURLSessionAuthChallengeDisposit
 @property (atomic, copy,   readwrite) NSArray *                         modes;
 @property (atomic, assign, readwrite) NSTimeInterval                    startTime;          ///< The start time of the request; written by client thread only; read by any thread.
 @property (atomic, strong, readwrite) NSURLSessionTask *                task;               ///< The NSURLSession task for that request; client thread only.
+@property (atomic, strong, readwrite) JAHPQNSURLSessionDemux *          demux;              ///< The demux that created the task; client thread only.
+@property (atomic, strong, readwrite) NSURLSessionTask *                hedgeTask;          ///< A duplicate of task racing it for the first response; client thread only.
+@property (atomic, strong, readwrite) NSTimer *                         hedgeTimer;         ///< Fires when it's time to send hedgeTask; client thread only.
+@property (atomic, assign, readwrite) NSTimeInterval                    hedgeStartTime;     ///< The start time of hedgeTask; client thread only.
+@property (atomic, strong, readwrite) NSTimer *                         holdTimer;          ///< Fires when a request held for a reconnect gives up; client thread only.
+@property (atomic, strong, readwrite) id                                connectionStateObserver;    ///< Observes the tunnel while a request is held; client thread only.
 @property (atomic, strong, readwrite) NSURLAuthenticationChallenge *    pendingChallenge;
 @property (atomic, copy,   readwrite) JAHPChallengeCompletionHandler        pendingChallengeCompletionHandler;  ///< The completion handler that matches pendingChallenge; main thread only.
 @property (atomic, copy,   readwrite) JAHPDidCancelAuthenticationChallengeHandler pendingDidCancelAuthenticationChallengeHandler;  ///< The handler that runs when we cancel the pendingChallenge; main thread only.
@@ -140,16 +297,54 @@ static JAHPWeakDelegateHolder* weakDelegateHolder;
 
 static NSMutableArray<TemporarilyAllowedURL*> *tmpAllowed;
 
-static NSString *_javascriptToInject;
+static dispatch_data_t JAHPDispatchDataWithBytes(const void *bytes, size_t length)
+{
+	return dispatch_data_create(bytes, length, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+}
+
+/*! Returns the script injected at the start of every HTML document.
+ *  \details injected.js is read and encoded once; the result is made by splicing the nonce
+ *  and URL proxy port between the shared constant parts, so nothing but those few bytes is
+ *  copied per response.
+ *  \param dataSaver Whether injected.js should load the page's deferred images lazily.
+ */
 
-+ (NSString *)javascriptToInject
++ (dispatch_data_t)injectedScriptWithNonce:(NSString *)nonce urlProxyPort:(NSInteger)urlProxyPort dataSaver:(BOOL)dataSaver
 {
-	if (!_javascriptToInject) {
-		NSString *path = [[NSBundle mainBundle] pathForResource:@"injected" ofType:@"js"];
-		_javascriptToInject = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
-	}
+	static dispatch_data_t scriptOpen;      // <script ... nonce="
+	static dispatch_data_t scriptBody;      // ">injected.js;\n __psiphon.urlProxyPort=
+	static dispatch_data_t scriptClose;     // ;</script>
+	static dispatch_data_t dataSaverClose;  // ;\n __psiphon.dataSaver=true;</script>
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		static const char openBytes[] = "<script type=\"text/javascript\" nonce=\"";
+		static const char bodyOpen[] = "\">";
+		static const char bodyClose[] = ";\n __psiphon.urlProxyPort=";
+		static const char closeBytes[] = ";</script>";
+		static const char dataSaverCloseBytes[] = ";\n __psiphon.dataSaver=true;</script>";
 
-	return _javascriptToInject;
+		NSString *path = [[NSBundle mainBundle] pathForResource:@"injected" ofType:@"js"];
+		NSData *javascript = [NSData dataWithContentsOfFile:path] ?: [NSData data];
+
+		NSMutableData *body = [[NSMutableData alloc] initWithCapacity:[javascript length] + sizeof(bodyOpen) + sizeof(bodyClose)];
+		[body appendBytes:bodyOpen length:sizeof(bodyOpen) - 1];
+		[body appendData:javascript];
+		[body appendBytes:bodyClose length:sizeof(bodyClose) - 1];
+
+		scriptOpen = JAHPDispatchDataWithBytes(openBytes, sizeof(openBytes) - 1);
+		scriptBody = JAHPDispatchDataWithBytes([body bytes], [body length]);
+		scriptClose = JAHPDispatchDataWithBytes(closeBytes, sizeof(closeBytes) - 1);
+		dataSaverClose = JAHPDispatchDataWithBytes(dataSaverCloseBytes, sizeof(dataSaverCloseBytes) - 1);
+	});
+
+	const char *nonceBytes = [nonce UTF8String];
+	char port[24];
+	int portLength = snprintf(port, sizeof(port), "%d", (int)urlProxyPort);
+
+	dispatch_data_t script = dispatch_data_create_concat(scriptOpen, JAHPDispatchDataWithBytes(nonceBytes, strlen(nonceBytes)));
+	script = dispatch_data_create_concat(script, scriptBody);
+	script = dispatch_data_create_concat(script, JAHPDispatchDataWithBytes(port, (size_t)portLength));
+	return dispatch_data_create_concat(script, (dataSaver ? dataSaverClose : scriptClose));
 }
 
 + (void)temporarilyAllowURL:(NSURL *)url
@@ -196,71 +391,6 @@ static NSString *_javascriptToInject;
 	return ret;
 }
 
-+ (NSString *)prependDirectivesIfExisting:(NSDictionary *)directives inCSPHeader:(NSString *)header
-{
-	/*
-	 * CSP guide says apostrophe can't be in a bare string, so it should be safe to assume
-	 * splitting on ; will not catch any ; inside of an apostrophe-enclosed value, since those
-	 * can only be constant things like 'self', 'unsafe-inline', etc.
-	 *
-	 * https://www.w3.org/TR/CSP2/#source-list-parsing
-	 */
-
-	NSMutableDictionary *curDirectives = [[NSMutableDictionary alloc] init];
-	NSArray *td = [header componentsSeparatedByString:@";"];
-	for (int i = 0; i < [td count]; i++) {
-		NSString *t = [(NSString *)[td objectAtIndex:i] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-		NSRange r = [t rangeOfString:@" "];
-		if (r.length > 0) {
-			NSString *dir = [[t substringToIndex:r.location] lowercaseString];
-			NSString *val = [[t substringFromIndex:r.location] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-			[curDirectives setObject:val forKey:dir];
-		}
-	}
-
-	for (NSString *newDir in [directives allKeys]) {
-		NSArray *newvals = [directives objectForKey:newDir];
-		NSString *curval = [curDirectives objectForKey:newDir];
-		if (curval) {
-			NSString *newval = [newvals objectAtIndex:0];
-
-			/*
-			 * If none of the existing values for this directive have a nonce or hash,
-			 * then inserting our value with a nonce will cause the directive to become
-			 * strict, so "'nonce-abcd' 'self' 'unsafe-inline'" causes the browser to
-			 * ignore 'self' and 'unsafe-inline', requiring that all scripts have a
-			 * nonce or hash.  Since the site would probably only ever have nonce values
-			 * in its <script> tags if it was in the CSP policy, only include our nonce
-			 * value if the CSP policy already has them.
-			 */
-			if ([curval containsString:@"'nonce-"] || [curval containsString:@"'sha"])
-				newval = [newvals objectAtIndex:1];
-
-			if ([curval containsString:@"'none'"]) {
-				newval = [newvals objectAtIndex:1];
-				/*
-				 * CSP spec says if 'none' is encountered to ignore anything else,
-				 * so if 'none' is there, just replace it with newval rather than
-				 * prepending.
-				 */
-			} else {
-				if ([newval isEqualToString:@""])
-					newval = curval;
-				else
-					newval = [NSString stringWithFormat:@"%@ %@", newval, curval];
-			}
-
-			[curDirectives setObject:newval forKey:newDir];
-		}
-	}
-
-	NSMutableString *ret = [[NSMutableString alloc] init];
-	for (NSString *dir in [[curDirectives allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)])
-		[ret appendString:[NSString stringWithFormat:@"%@%@ %@;", ([ret length] > 0 ? @" " : @""), dir, [curDirectives objectForKey:dir]]];
-
-	return [NSString stringWithString:ret];
-}
-
 + (void)start
 {
 	[NSURLProtocol registerClass:self];
@@ -316,9 +446,16 @@ static JAHPQNSURLSessionDemux *sharedDemuxInstance = nil;
 
 + (void)resetSharedDemux
 {
+	JAHPQNSURLSessionDemux *oldDemux;
+
 	@synchronized(self) {
+		oldDemux = sharedDemuxInstance;
 		sharedDemuxInstance = nil;
 	}
+
+	// New requests get a session with the new configuration.  Loads already running on
+	// the old session carry on there, and it's invalidated once they've finished.
+	[oldDemux finishTasksAndInvalidate];
 }
 
 #pragma mark - Proxied session configuration
@@ -372,6 +509,10 @@ static JAHPQNSURLSessionDemux *sharedDemuxInstance = nil;
 								};
 	config.connectionProxyDictionary = proxyDict;
 
+	// Keep responses in our own encrypted cache rather than the system's, which stores
+	// them in the clear.  If it can't be opened this is nil, and nothing is cached on disk.
+	config.URLCache = [JAHPDiskCache sharedCache];
+
 	return config;
 }
 
@@ -574,15 +715,30 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 		_isOrigin = NO;
 	}
 
+	/* skip past any tracking redirectors locally rather than paying a tunnel round trip for each */
+	if (_isOrigin && [[mutableRequest HTTPMethod] isEqualToString:@"GET"]) {
+		NSUInteger hops = 0;
+		[mutableRequest setURL:[URLUnwrapper unwrappedURLForURL:[mutableRequest URL] hops:&hops]];
+		if (hops > 0) {
+			[[self class] authenticatingHTTPProtocol:self logWithFormat:@"[Tab %@] unwrapped %lu redirector hop(s) in front of %@", _wvt.tabIndex, (unsigned long)hops, [[mutableRequest URL] absoluteString]];
+			[self noteRedirectorHopsSkipped:hops];
+		}
+	}
+
+	/* the HSTS, HTTPS Everywhere and blocking lookups for this host, usually made by an earlier request */
+	JAHPHostVerdictCache *verdicts = [JAHPHostVerdictCache sharedCache];
+	JAHPHostVerdict *verdict = [verdicts verdictForHost:[[mutableRequest URL] host]];
+
 	/* check HSTS cache first to see if scheme needs upgrading */
-	[mutableRequest setURL:[[[AppDelegate sharedAppDelegate] hstsCache] rewrittenURI:[request URL]]];
+	if (verdict.upgradesToHTTPS) {
+		[mutableRequest setURL:[[[AppDelegate sharedAppDelegate] hstsCache] upgradedURI:[mutableRequest URL]]];
+	}
 
 	/* then check HTTPS Everywhere (must pass all URLs since some rules are not just scheme changes */
-	NSArray *HTErules = [HTTPSEverywhere potentiallyApplicableRulesForHost:[[request URL] host]];
-	if (HTErules != nil && [HTErules count] > 0) {
-		[mutableRequest setURL:[HTTPSEverywhere rewrittenURI:[request URL] withRules:HTErules]];
+	if ([verdict.HTTPSEverywhereRules count] > 0) {
+		[mutableRequest setURL:[HTTPSEverywhere rewrittenURI:[mutableRequest URL] withEnabledRules:verdict.enabledHTTPSEverywhereRules]];
 
-		for (HTTPSEverywhereRule *HTErule in HTErules) {
+		for (HTTPSEverywhereRule *HTErule in verdict.HTTPSEverywhereRules) {
 			[[_wvt applicableHTTPSEverywhereRules] setObject:@YES forKey:[HTErule name]];
 		}
 	}
@@ -595,29 +751,20 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 		return nil;
 	}
 
-	/* we're handling cookies ourself */
-	[mutableRequest setHTTPShouldHandleCookies:NO];
-	NSString *cookiePolicy = [CookieJar cookiePolicy];
-
-	// Do not send any cookies if current policy is to block all
-	if (![cookiePolicy isEqualToString:kAlwaysBlock]) {
-		NSArray<NSHTTPCookie *> *cookies = nil;
-
-		if ([cookiePolicy isEqualToString:kAllowWebsitesIVisit] || [cookiePolicy isEqualToString:kAlwaysAllow]) {
-			// always send if matching cookies found in the jar
-			cookies = [CookieJar cookiesForURL:[mutableRequest URL]];
-		} else if ([cookiePolicy isEqualToString:kAllowCurrentWebsiteOnly]) {
-			// only send if request URL is of same origin as mainDocumentURL
-			if([CookieJar isSameOrigin:[mutableRequest URL] toURL: [mutableRequest mainDocumentURL]]) {
-				cookies = [CookieJar cookiesForURL:[mutableRequest URL]];
-			}
+	/* known ads and trackers get an empty response in -startLoading instead of a trip through the tunnel */
+	if (!_isOrigin && !_isTemporarilyAllowed) {
+		_blockedBy = [verdicts blockingTargetForURL:[mutableRequest URL] fromMainDocumentURL:[mutableRequest mainDocumentURL]];
+		if (_blockedBy == nil) {
+			_blockedBy = [[AdblockFilterList sharedList] filterBlockingURL:[mutableRequest URL] type:[AdblockFilterList typeOfRequest:mutableRequest] mainDocumentURL:[mutableRequest mainDocumentURL]];
 		}
+	}
 
-		if (cookies != nil && [cookies count] > 0) {
-			[[self class] authenticatingHTTPProtocol:self logWithFormat:@"[Tab %@] sending %lu cookie(s) to %@", _wvt.tabIndex, (unsigned long)[cookies count], [mutableRequest URL]];
-			NSDictionary *headers = [NSHTTPCookie requestHeaderFieldsWithCookies:cookies];
-			[mutableRequest setAllHTTPHeaderFields:headers];
-		}
+	/* we're handling cookies ourself */
+	[mutableRequest setHTTPShouldHandleCookies:NO];
+	NSString *cookieHeader = [CookieJar cookieHeaderForURL:[mutableRequest URL] mainDocumentURL:[mutableRequest mainDocumentURL]];
+	if (cookieHeader != nil) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"[Tab %@] sending cookies to %@", _wvt.tabIndex, [mutableRequest URL]];
+		[mutableRequest setValue:cookieHeader forHTTPHeaderField:@"Cookie"];
 	}
 
 	/* add "do not track" header if it's enabled in the settings */
@@ -635,6 +782,7 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	// can be called on any thread
 	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"dealloc"];
 	assert(self->_task == nil);                     // we should have cleared it by now
+	assert(self->_hedgeTask == nil);                // likewise
 	assert(self->_pendingChallenge == nil);         // we should have cancelled it by now
 	assert(self->_pendingChallengeCompletionHandler == nil);    // we should have cancelled it by now
 }
@@ -680,6 +828,10 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	///set *recursive* flag
 	[[self class] setProperty:@YES forKey:kJAHPRecursiveRequestFlagProperty inRequest:recursiveRequest];
 
+	// Don't let a request stall indefinitely on a bad tunnel path; hosts we've seen before
+	// get a timeout based on how long they normally take to respond.
+	recursiveRequest.timeoutInterval = [[JAHPLatencyTracker sharedTracker] timeoutIntervalForHost:[[recursiveRequest URL] host] requestedTimeout:[recursiveRequest timeoutInterval]];
+
 	self.startTime = [NSDate timeIntervalSinceReferenceDate];
 	if (currentMode == nil) {
 		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"start %@", [recursiveRequest URL]];
@@ -690,11 +842,84 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	// Latch the thread we were called on, primarily for debugging purposes.
 	self.clientThread = [NSThread currentThread];
 
+	if (_blockedBy != nil) {
+		[self serveBlockedResponse];
+		return;
+	}
+
+	// While the tunnel is down, show what we kept of the document instead of failing.
+	if ([[AppDelegate sharedAppDelegate] psiphonConectionState] != ConnectionStateConnected && [self serveFromSnapshot]) {
+		return;
+	}
+
+	// Anything the user asked to load themselves is exempt from data saver.
+	_dataSaver = !_isTemporarilyAllowed && [JAHPDataSaver isEnabledForURL:([recursiveRequest mainDocumentURL] ?: [recursiveRequest URL])];
+	if (_dataSaver && !_isOrigin && [JAHPDataSaver shouldSkipRequestForURL:[recursiveRequest URL]]) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"data saver skipped %@", [recursiveRequest URL]];
+		[self failWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+		return;
+	}
+
+	// A streamed body (which is how UIWebView passes form posts to us) can only be read
+	// once and has no length, so copy it to disk first.  It's then uploaded from there with
+	// a Content-Length, and can be rewound for redirects and authentication retries.
+	if ([recursiveRequest HTTPBodyStream] != nil) {
+		NSInputStream *bodyStream = [recursiveRequest HTTPBodyStream];
+		[recursiveRequest setHTTPBodyStream:nil];
+
+		[JAHPRequestBodySpool spoolStream:bodyStream completion:^(JAHPRequestBodySpool *spool, NSError *error) {
+			[self performOnThread:self.clientThread modes:self.modes block:^{
+				[self startTaskWithRequest:recursiveRequest bodySpool:spool error:error];
+			}];
+		}];
+		return;
+	}
+
+	[self startTaskWithRequest:recursiveRequest bodySpool:nil error:nil];
+}
+
+/*! Creates and starts the task for the request, once its body (if any) is ready.
+ *  \param bodySpool The spooled request body, or nil if the request has no streamed body.
+ *  \param error The error spooling the body, if any.
+ */
+
+- (void)startTaskWithRequest:(NSMutableURLRequest *)recursiveRequest bodySpool:(JAHPRequestBodySpool *)bodySpool error:(NSError *)error
+{
+	assert([NSThread currentThread] == self.clientThread);
+
+	if (_isStopped) {
+		return;
+	}
+	if (error != nil) {
+		[self failWithError:error];
+		return;
+	}
+
+	if (bodySpool != nil) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"spooled %lld byte request body", bodySpool.length];
+		_bodySpool = bodySpool;
+		[recursiveRequest setHTTPBodyStream:[bodySpool inputStream]];
+		[recursiveRequest setValue:[NSString stringWithFormat:@"%lld", bodySpool.length] forHTTPHeaderField:@"Content-Length"];
+	}
+
 	// Once everything is ready to go, create a data task with the new request.
-	self.task = [[[self class] sharedDemux] dataTaskWithRequest:recursiveRequest delegate:self modes:self.modes];
+	// Subresources are shared with any identical request already in flight from another
+	// tab or frame; origin requests have per-tab side effects so they always get their own.
+	self.demux = [[self class] sharedDemux];
+	if (_isOrigin || _isTemporarilyAllowed) {
+		self.task = [self.demux dataTaskWithRequest:recursiveRequest delegate:self modes:self.modes];
+	} else {
+		self.task = [self.demux coalescedDataTaskWithRequest:recursiveRequest delegate:self modes:self.modes];
+	}
 	assert(self.task != nil);
 
+	// A task we joined may already have its response, in which case the time until we
+	// see it says nothing about the host.
+	_recordsLatency = (self.task.response == nil);
+
 	[self.task resume];
+
+	[self scheduleHedgeIfNeeded];
 }
 
 - (void)stopLoading
@@ -717,9 +942,13 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 
 	assert([NSThread currentThread] == self.clientThread);
 
+	_isStopped = YES;
+	[self cancelSniffedDownload];
 	[self cancelPendingChallenge];
+	[self cancelHedge];
+	[self endHold];
 	if (self.task != nil) {
-		[self.task cancel];
+		[self.demux cancelDataTask:self.task delegate:self];
 		self.task = nil;
 		// The following ends up calling -URLSession:task:didCompleteWithError: with NSURLErrorDomain / NSURLErrorCancelled,
 		// which specificallys traps and ignores the error.
@@ -727,6 +956,742 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	// Don't nil out self.modes; see property declaration comments for a a discussion of this.
 }
 
+#pragma mark * Hedged requests
+
+/*! Arranges for a duplicate of the request to be sent if the original hasn't started
+ *  responding within the time the host normally takes.
+ *  \details Only idempotent requests without a body are hedged, and never OCSP or
+ *  temporarily allowed requests, which have side effects on other state.  Whichever
+ *  task responds first wins and the other is cancelled; see -settleHedgeWithWinner:.
+ */
+
+- (void)scheduleHedgeIfNeeded
+{
+	NSString *method;
+	NSTimeInterval delay;
+
+	assert([NSThread currentThread] == self.clientThread);
+
+	if (_isOCSPRequest || _isTemporarilyAllowed) {
+		return;
+	}
+
+	method = [_actualRequest HTTPMethod];
+	if (![method isEqualToString:@"GET"] && ![method isEqualToString:@"HEAD"]) {
+		return;
+	}
+	if ([_actualRequest HTTPBody] != nil || [_actualRequest HTTPBodyStream] != nil) {
+		return;
+	}
+
+	delay = [[JAHPLatencyTracker sharedTracker] hedgeDelayForHost:[[_actualRequest URL] host]];
+	if (delay <= 0) {
+		return;
+	}
+
+	self.hedgeTimer = [NSTimer timerWithTimeInterval:delay target:self selector:@selector(hedgeTimerFired:) userInfo:nil repeats:NO];
+	for (NSString *mode in self.modes) {
+		[[NSRunLoop currentRunLoop] addTimer:self.hedgeTimer forMode:mode];
+	}
+}
+
+- (void)hedgeTimerFired:(NSTimer *)timer
+{
+#pragma unused(timer)
+	assert([NSThread currentThread] == self.clientThread);
+
+	self.hedgeTimer = nil;
+
+	if (self.task == nil || self.task.state != NSURLSessionTaskStateRunning || self.task.response != nil || self.hedgeTask != nil) {
+		return;
+	}
+	if (self.demux != [[self class] sharedDemux]) {
+		// our session is draining and can't take new tasks
+		return;
+	}
+	if (![[JAHPLatencyTracker sharedTracker] beginHedge]) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"not hedging; no budget"];
+		return;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"hedging %@ (elapsed %.1f)", [_actualRequest URL], [NSDate timeIntervalSinceReferenceDate] - self.startTime];
+
+	self.hedgeStartTime = [NSDate timeIntervalSinceReferenceDate];
+	self.hedgeTask = [self.demux dataTaskWithRequest:_actualRequest delegate:self modes:self.modes];
+	[self.hedgeTask resume];
+}
+
+/*! Called when task has started responding, or has failed.  If a hedge is racing it,
+ *  the winner becomes self.task and the loser is cancelled.
+ */
+
+- (void)settleHedgeWithWinner:(NSURLSessionTask *)task
+{
+	NSURLSessionTask *loser;
+
+	assert([NSThread currentThread] == self.clientThread);
+
+	[self.hedgeTimer invalidate];
+	self.hedgeTimer = nil;
+
+	if (self.hedgeTask == nil) {
+		return;
+	}
+
+	if (task == self.hedgeTask) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"hedge won"];
+		loser = self.task;
+		self.task = self.hedgeTask;
+		self.startTime = self.hedgeStartTime;
+		_recordsLatency = YES;
+	} else {
+		loser = self.hedgeTask;
+	}
+	self.hedgeTask = nil;
+
+	[self.demux cancelDataTask:loser delegate:self];
+	[[JAHPLatencyTracker sharedTracker] endHedge];
+}
+
+- (void)cancelHedge
+{
+	assert([NSThread currentThread] == self.clientThread);
+
+	[self.hedgeTimer invalidate];
+	self.hedgeTimer = nil;
+
+	if (self.hedgeTask != nil) {
+		[self.demux cancelDataTask:self.hedgeTask delegate:self];
+		self.hedgeTask = nil;
+		[[JAHPLatencyTracker sharedTracker] endHedge];
+	}
+}
+
+/*! Returns YES if callbacks for task should be acted on, i.e. it's our task or a hedge
+ *  that is still racing it.  Callbacks for the loser of a race are dropped.
+ */
+
+- (BOOL)isCurrentTask:(NSURLSessionTask *)task
+{
+	return (self.task != nil) && (task == self.task || task == self.hedgeTask);
+}
+
+#pragma mark * Replay across reconnects
+
+/* how long a request that failed because the tunnel went away waits for it to come back */
+static const NSTimeInterval kJAHPReconnectWindow = 30;
+
+/* how long to wait for the tunnel to report a reconnect when it still looks connected */
+static const NSTimeInterval kJAHPReconnectGrace = 2;
+
+static const NSUInteger kJAHPMaxReplays = 2;
+
+/*! Returns YES if error is the kind of failure a tunnel reconnect causes.
+ *  \details Timeouts aren't: a slow origin times out too, and replaying it would only add
+ *  load that the hedge budget doesn't see.
+ */
+
++ (BOOL)isReconnectError:(NSError *)error
+{
+	if (![[error domain] isEqualToString:NSURLErrorDomain]) {
+		return NO;
+	}
+
+	switch ([error code]) {
+		case NSURLErrorNetworkConnectionLost:
+		case NSURLErrorNotConnectedToInternet:
+		case NSURLErrorCannotConnectToHost:
+		case NSURLErrorCannotFindHost:
+		case NSURLErrorDNSLookupFailed:
+			return YES;
+		default:
+			return NO;
+	}
+}
+
+/*! Remembers what's needed to resume the response later: the status, and a validator
+ *  for If-Range if the body bytes we count are the bytes on the wire.
+ */
+
+- (void)noteResponseForReplay:(NSHTTPURLResponse *)response headers:(const JAHPResponseHeaders *)headers
+{
+	NSString *encoding = headers->contentEncoding;
+	NSString *etag = headers->etag;
+
+	_didSendResponse = YES;
+	_responseStatusCode = [response statusCode];
+
+	// If-Range needs a strong validator
+	if (etag != nil && ![etag hasPrefix:@"W/"]) {
+		_resumeValidator = etag;
+	} else {
+		_resumeValidator = headers->lastModified;
+	}
+
+	// NSURLSession decodes content-encodings for us, so byte offsets only line up with
+	// the server's when there wasn't one.
+	_resumable = (_responseStatusCode == 200 && _resumeValidator != nil && (encoding == nil || [[encoding lowercaseString] isEqualToString:@"identity"]));
+}
+
+/*! Called when our task fails with error.  If the failure looks like the tunnel going away
+ *  and the request can safely be sent again, holds on to the load instead of failing it,
+ *  and reissues it once the tunnel is back.
+ *  \returns YES if the request is being held; NO if the caller should report the error.
+ */
+
+- (BOOL)holdForReconnectWithError:(NSError *)error
+{
+	NSString *method;
+	NSTimeInterval window;
+
+	assert([NSThread currentThread] == self.clientThread);
+
+	if (![[self class] isReconnectError:error] || _isOCSPRequest || _replayCount >= kJAHPMaxReplays) {
+		return NO;
+	}
+	if (![self.task isKindOfClass:[NSURLSessionDataTask class]]) {
+		return NO;
+	}
+
+	method = [_actualRequest HTTPMethod];
+	if (![method isEqualToString:@"GET"] && ![method isEqualToString:@"HEAD"]) {
+		return NO;
+	}
+	if ([_actualRequest HTTPBody] != nil || [_actualRequest HTTPBodyStream] != nil) {
+		return NO;
+	}
+
+	// The client has seen part of the body; we can only carry on if we can ask for the rest.
+	if (_receivedLength > 0 && !_resumable) {
+		return NO;
+	}
+
+	// If the tunnel still looks healthy this may be an ordinary failure, so only wait
+	// briefly for it to report that it's reconnecting.
+	if ([[AppDelegate sharedAppDelegate] psiphonConectionState] == ConnectionStateConnected && [[self class] sharedDemux] == self.demux) {
+		window = kJAHPReconnectGrace;
+	} else {
+		window = kJAHPReconnectWindow;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"holding after %@ / %d (%lld bytes received)", [error domain], (int) [error code], _receivedLength];
+
+	_heldError = error;
+	self.task = nil;
+
+	__weak JAHPAuthenticatingHTTPProtocol *weakSelf = self;
+	self.connectionStateObserver = [[NSNotificationCenter defaultCenter] addObserverForName:kPsiphonConnectionStateNotification object:nil queue:nil usingBlock:^(NSNotification *note) {
+		JAHPAuthenticatingHTTPProtocol *strongSelf = weakSelf;
+		ConnectionState state = [[note.userInfo objectForKey:kPsiphonConnectionState] unsignedIntegerValue];
+		if (strongSelf == nil) {
+			return;
+		}
+		[strongSelf performOnThread:strongSelf.clientThread modes:strongSelf.modes block:^{
+			[strongSelf heldRequestConnectionStateChanged:state];
+		}];
+	}];
+
+	[self scheduleHoldTimeout:window];
+
+	if (window == kJAHPReconnectWindow && [[AppDelegate sharedAppDelegate] psiphonConectionState] == ConnectionStateConnected) {
+		// the tunnel has already come back on a new session
+		[self replayHeldRequest];
+	}
+
+	return YES;
+}
+
+- (void)scheduleHoldTimeout:(NSTimeInterval)timeout
+{
+	[self.holdTimer invalidate];
+	self.holdTimer = [NSTimer timerWithTimeInterval:timeout target:self selector:@selector(holdTimerFired:) userInfo:nil repeats:NO];
+	for (NSString *mode in self.modes) {
+		[[NSRunLoop currentRunLoop] addTimer:self.holdTimer forMode:mode];
+	}
+}
+
+- (void)heldRequestConnectionStateChanged:(ConnectionState)state
+{
+	assert([NSThread currentThread] == self.clientThread);
+
+	if (_heldError == nil) {
+		return;
+	}
+
+	if (state == ConnectionStateConnected) {
+		[self replayHeldRequest];
+	} else if (state == ConnectionStateDisconnected) {
+		// the user stopped the tunnel; it isn't coming back
+		[self holdTimerFired:nil];
+	} else {
+		// the tunnel is reconnecting, give it the full window
+		[self scheduleHoldTimeout:kJAHPReconnectWindow];
+	}
+}
+
+- (void)holdTimerFired:(NSTimer *)timer
+{
+#pragma unused(timer)
+	NSError *error = _heldError;
+
+	assert([NSThread currentThread] == self.clientThread);
+
+	if (error == nil) {
+		return;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"giving up on held request"];
+
+	[self endHold];
+	[self failWithError:error];
+}
+
+- (void)endHold
+{
+	[self.holdTimer invalidate];
+	self.holdTimer = nil;
+
+	if (self.connectionStateObserver != nil) {
+		[[NSNotificationCenter defaultCenter] removeObserver:self.connectionStateObserver];
+		self.connectionStateObserver = nil;
+	}
+
+	_heldError = nil;
+}
+
+/*! Reissues a held request on the current session, asking for only the part of the body
+ *  the client hasn't seen yet.
+ */
+
+- (void)replayHeldRequest
+{
+	NSMutableURLRequest *request;
+
+	assert([NSThread currentThread] == self.clientThread);
+	assert(self.task == nil);
+
+	[self endHold];
+
+	_replayCount++;
+	_recordsLatency = NO;
+	_bytesToDiscard = 0;
+
+	request = [_actualRequest mutableCopy];
+	if (_receivedLength > 0) {
+		[request setValue:[NSString stringWithFormat:@"bytes=%lld-", _receivedLength] forHTTPHeaderField:@"Range"];
+		[request setValue:_resumeValidator forHTTPHeaderField:@"If-Range"];
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"replaying %@ from byte %lld", [request URL], _receivedLength];
+
+	self.demux = [[self class] sharedDemux];
+	self.task = [self.demux dataTaskWithRequest:request delegate:self modes:self.modes];
+	[self.task resume];
+}
+
+/*! Handles the response to a replayed request whose original response the client has
+ *  already seen.  The new response isn't passed on; it has to continue the old one exactly.
+ *  \returns YES if the body should be passed on; NO if the load has failed.
+ */
+
+- (BOOL)acceptReplayedResponse:(NSHTTPURLResponse *)response headers:(const JAHPResponseHeaders *)headers
+{
+	NSString *contentRange = headers->contentRange;
+	NSString *etag = headers->etag;
+	NSString *lastModified = headers->lastModified;
+	BOOL sameEntity = (_resumeValidator == nil) || [_resumeValidator isEqualToString:etag] || [_resumeValidator isEqualToString:lastModified];
+
+	if (_receivedLength > 0 && [response statusCode] == 206 && [contentRange hasPrefix:[NSString stringWithFormat:@"bytes %lld-", _receivedLength]]) {
+		return YES;
+	}
+
+	// The server ignored our range but sent the same entity; skip what the client has.
+	if ([response statusCode] == _responseStatusCode && sameEntity) {
+		_bytesToDiscard = _receivedLength;
+		return YES;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"can't resume from %zd response", (ssize_t) [response statusCode]];
+	return NO;
+}
+
+/*! Tells the client the load failed with error.
+ */
+
+- (void)failWithError:(NSError *)error
+{
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"error %@ / %d", [error domain], (int) [error code]];
+
+	NSMutableDictionary *ui = [[NSMutableDictionary alloc] initWithDictionary:[error userInfo]];
+	[ui setObject:(_isOrigin ? @YES : @NO) forKeyedSubscript:ORIGIN_KEY];
+
+	[self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:[error domain] code:[error code] userInfo:ui]];
+}
+
+#pragma mark * Data saver
+
+/*! Decides whether data saver holds back a subresource's body.
+ *  \returns NO if the response has been dropped and the load failed; otherwise YES, with
+ *  _dataSaverLimit set if the body is to be cut off.
+ */
+
+- (BOOL)applyDataSaverToResponse:(NSURLResponse *)response headers:(JAHPResponseHeaders *)headers
+{
+	_dataSaverLimit = 0;
+	if (!_dataSaver || _isOrigin) {
+		return YES;
+	}
+
+	long long expectedLength = [response expectedContentLength];
+	int64_t limit = 0;
+	switch ([JAHPDataSaver actionForContentType:headers->contentType expectedLength:expectedLength limit:&limit]) {
+		case JAHPDataSaverActionAllow:
+			return YES;
+		case JAHPDataSaverActionCap:
+			_dataSaverLimit = limit;
+			return YES;
+		case JAHPDataSaverActionSkip:
+			break;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"data saver skipped %@ (%@, %lld bytes)", [response URL], headers->contentType, expectedLength];
+	[self noteDataSaverSavedBytes:MAX(expectedLength, 0)];
+	[self.demux cancelDataTask:self.task delegate:self];
+	self.task = nil;
+	[self failWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+	return NO;
+}
+
+- (void)noteDataSaverSavedBytes:(long long)length
+{
+	WebViewTab *wvt = _wvt;
+	if (wvt == nil || length <= 0) {
+		return;
+	}
+	dispatch_async(dispatch_get_main_queue(), ^{
+		wvt.dataSaverBytesSaved += length;
+	});
+}
+
+#pragma mark * URL blocker
+
+/*! Answers a blocked request with an empty response, and counts it against its tab.
+ *  \details Failing the request instead would leave pages waiting on error handlers and
+ *  retries, and log errors for every tracker; an empty success lets them carry on at once.
+ */
+
+- (void)serveBlockedResponse
+{
+	NSURLRequest *request = [self request];
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"[Tab %@] blocked %@ (%@)", _wvt.tabIndex, [request URL], _blockedBy];
+
+	/* a wildcard origin is refused for credentialed requests, so name the page's own */
+	NSMutableDictionary *headers = [@{ @"Content-Length": @"0", @"Cache-Control": @"no-store", @"Access-Control-Allow-Origin": @"*" } mutableCopy];
+	NSString *origin = [request valueForHTTPHeaderField:@"Origin"];
+	if (origin != nil) {
+		headers[@"Access-Control-Allow-Origin"] = origin;
+		headers[@"Access-Control-Allow-Credentials"] = @"true";
+		headers[@"Vary"] = @"Origin";
+	}
+	NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[request URL] statusCode:204 HTTPVersion:@"HTTP/1.1" headerFields:headers];
+
+	[[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+	[[self client] URLProtocolDidFinishLoading:self];
+
+	WebViewTab *wvt = _wvt;
+	if (wvt == nil) {
+		return;
+	}
+	dispatch_async(dispatch_get_main_queue(), ^{
+		wvt.blockedRequests += 1;
+	});
+}
+
+#pragma mark * Element hiding
+
+/*! Returns bootstrap followed by a style element hiding what the filters for url's host
+ *  hide, or bootstrap itself if they hide nothing.
+ */
+
+- (dispatch_data_t)bootstrapByAddingElementHidingTo:(dispatch_data_t)bootstrap forURL:(NSURL *)url
+{
+	NSArray<NSString *> *selectors = [[AdblockCosmeticFilterList sharedList] selectorsForHost:[url host]];
+	NSData *style = [AdblockCosmeticFilterList styleElementHidingSelectors:selectors nonce:[self cspNonce]];
+	if (style == nil) {
+		return bootstrap;
+	}
+	return dispatch_data_create_concat(bootstrap, JAHPDispatchDataWithBytes([style bytes], [style length]));
+}
+
+/*! Returns the block that gives JAHPHTMLRewriter a style element for the generic filters
+ *  that apply to each new class and id in a document from url.
+ */
+
+- (NSData *(^)(NSArray<NSString *> *))elementHidingMarkupForURL:(NSURL *)url
+{
+	AdblockCosmeticFilterList *list = [AdblockCosmeticFilterList sharedList];
+	NSString *host = [url host];
+	NSString *nonce = [self cspNonce];
+
+	return ^NSData *(NSArray<NSString *> *classesAndIDs) {
+		NSMutableArray<NSString *> *selectors = [[NSMutableArray alloc] init];
+		for (NSString *key in classesAndIDs) {
+			[selectors addObjectsFromArray:[list genericSelectorsForKey:key host:host]];
+		}
+		return [AdblockCosmeticFilterList styleElementHidingSelectors:selectors nonce:nonce];
+	};
+}
+
+#pragma mark * Redirectors
+
+- (void)noteRedirectorHopsSkipped:(NSUInteger)hops
+{
+	WebViewTab *wvt = _wvt;
+	if (wvt == nil) {
+		return;
+	}
+	dispatch_async(dispatch_get_main_queue(), ^{
+		wvt.redirectorHopsSkipped += hops;
+	});
+}
+
+#pragma mark * Text-only pages
+
+/*! Shows the tab how much of a text-only page has been fetched, and how long it took for
+ *  there to be something to read.
+ */
+
+- (void)noteTextOnlyProgress
+{
+	if (_textOnlyTimeToReadable == 0 && [_textOnlyReducer hasReadableText]) {
+		_textOnlyTimeToReadable = [NSDate timeIntervalSinceReferenceDate] - self.startTime;
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"text-only page readable after %.2fs, %lld bytes", _textOnlyTimeToReadable, _receivedLength];
+	}
+
+	WebViewTab *wvt = _wvt;
+	long long bytes = _receivedLength;
+	NSTimeInterval timeToReadable = _textOnlyTimeToReadable;
+	dispatch_async(dispatch_get_main_queue(), ^{
+		[wvt setTextOnlyBytes:bytes timeToReadable:timeToReadable];
+	});
+}
+
+#pragma mark * Content sniffing
+
+/*! Returns the response to give the client in place of one that's being downloaded: an
+ *  empty, uncacheable HTML page, so that the URL still enters the tab's history.
+ */
+
++ (NSHTTPURLResponse *)downloadPlaceholderForResponse:(NSHTTPURLResponse *)response
+{
+	// Create a fake response for the client with all headers but content type preserved
+	NSMutableDictionary *fakeHeaders = [[NSMutableDictionary alloc] initWithDictionary:[response allHeaderFields]];
+	// allHeaderFields canonicalizes header field names to their standard form.
+	// E.g. "content-type" will be automatically adjusted to "Content-Type".
+	// See: https://developer.apple.com/documentation/foundation/httpurlresponse/1417930-allheaderfields
+	[fakeHeaders setObject:@"text/html" forKey:@"Content-Type"];
+	[fakeHeaders setObject:@"0" forKey:@"Content-Length"];
+	[fakeHeaders setObject:@"Cache-Control: no-cache, no-store, must-revalidate" forKey:@"Cache-Control"];
+	return [[NSHTTPURLResponse alloc] initWithURL:[response URL] statusCode:200 HTTPVersion:@"1.1" headerFields:fakeHeaders];
+}
+
+/*! Decides what a held response really is from the first bytes of its body, and tells
+ *  the client about it.
+ *  \details Binary data is never passed through the HTML rewriter.  A response labeled
+ *  as HTML only loses that for a known file signature: a stray control byte is common in
+ *  real pages, and skipping the rewriter would leave their media outside the tunnel.  A
+ *  main document that turns out to be a file we can preview is downloaded, just like one
+ *  that was labeled as such; as it's too late to turn the task into a download task, we write the
+ *  body out ourselves.
+ */
+
+- (void)sniffContentOfData:(NSData *)data
+{
+	NSURLResponse *response = _heldResponse;
+	NSString *sniffedType = [JAHPMIMEType sniffMIMETypeOfData:data];
+
+	_heldResponse = nil;
+
+	if (sniffedType != nil || (!_heldResponseIsLabeled && [JAHPMIMEType isBinaryData:data])) {
+		if (_htmlRewriter != nil) {
+			[[self class] authenticatingHTTPProtocol:self logWithFormat:@"body is %@, not HTML", sniffedType ?: @"binary"];
+		}
+		_htmlRewriter = nil;
+		_textOnlyReducer = nil;
+		_contentType = CONTENT_TYPE_OTHER;
+	}
+
+	if (sniffedType != nil &&
+		[JAHPMIMEType classifyContentType:sniffedType] == CONTENT_TYPE_FILE &&
+		_isOrigin && !_isTemporarilyAllowed &&
+		[response isKindOfClass:[NSHTTPURLResponse class]] &&
+		[self startSniffedDownloadOfType:sniffedType expectedLength:[response expectedContentLength]]) {
+		_contentType = CONTENT_TYPE_FILE;
+		_snapshotData = nil;
+		[[self client] URLProtocol:self didReceiveResponse:[[self class] downloadPlaceholderForResponse:(NSHTTPURLResponse *)response] cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+		return;
+	}
+
+	[[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:_heldCacheStoragePolicy];
+}
+
+- (BOOL)startSniffedDownloadOfType:(NSString *)mimeType expectedLength:(int64_t)expectedLength
+{
+	NSString *name = [[[NSUUID UUID] UUIDString] stringByAppendingPathExtension:[JAHPMIMEType fileExtensionForMIMEType:mimeType]];
+	NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+
+	if (![[NSFileManager defaultManager] createFileAtPath:[url path] contents:nil attributes:@{ NSFileProtectionKey: NSFileProtectionCompleteUnlessOpen }]) {
+		return NO;
+	}
+	_sniffedDownload = [NSFileHandle fileHandleForWritingToURL:url error:NULL];
+	if (_sniffedDownload == nil) {
+		[[NSFileManager defaultManager] removeItemAtURL:url error:NULL];
+		return NO;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"downloading sniffed %@", mimeType];
+
+	_sniffedDownloadURL = url;
+	_sniffedDownloadExpectedLength = expectedLength;
+	if (_wvt != nil) {
+		[_wvt didStartDownloadingFile];
+	}
+	return YES;
+}
+
+- (void)writeSniffedDownloadData:(NSData *)data
+{
+	@try {
+		[_sniffedDownload writeData:data];
+	} @catch (NSException *exception) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"sniffed download write failed: %@", exception];
+		[self cancelSniffedDownload];
+		[self.demux cancelDataTask:self.task delegate:self];
+		self.task = nil;
+		[self failWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:nil]];
+		return;
+	}
+
+	if (_wvt != nil && _sniffedDownloadExpectedLength > 0) {
+		[_wvt setProgress:[NSNumber numberWithDouble:(double)_receivedLength/(double)_sniffedDownloadExpectedLength]];
+	}
+}
+
+- (void)finishSniffedDownload
+{
+	NSURL *url = _sniffedDownloadURL;
+
+	[_sniffedDownload closeFile];
+	_sniffedDownload = nil;
+	_sniffedDownloadURL = nil;
+
+	// the tab owns the file from here, and deletes it when it's done with it
+	if (_wvt != nil) {
+		[_wvt didFinishDownloadingToURL:url];
+	} else {
+		[[NSFileManager defaultManager] removeItemAtURL:url error:NULL];
+	}
+}
+
+- (void)cancelSniffedDownload
+{
+	if (_sniffedDownload == nil) {
+		return;
+	}
+
+	[_sniffedDownload closeFile];
+	[[NSFileManager defaultManager] removeItemAtURL:_sniffedDownloadURL error:NULL];
+	_sniffedDownload = nil;
+	_sniffedDownloadURL = nil;
+}
+
+#pragma mark * Offline snapshots
+
+/*! Serves the request from the snapshot of its document, if there is one.
+ *  \returns YES if the request was served, and needs no task.
+ */
+
+- (BOOL)serveFromSnapshot
+{
+	NSURLRequest *request = [self request];
+
+	if (_isTemporarilyAllowed || ![[request HTTPMethod] isEqualToString:@"GET"]) {
+		return NO;
+	}
+
+	NSURL *documentURL = ([request mainDocumentURL] ?: [request URL]);
+	if (![[JAHPSnapshotStore sharedStore] hasSnapshotOfDocument:documentURL]) {
+		return NO;
+	}
+
+	NSCachedURLResponse *snapshot = [[JAHPSnapshotStore sharedStore] responseForURL:[request URL] inSnapshotOfDocument:documentURL];
+	if (snapshot == nil) {
+		return NO;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"[Tab %@] serving %@ from snapshot", _wvt.tabIndex, [request URL]];
+
+	if (_isOrigin) {
+		[_wvt setUrl:[request URL]];
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[[[AppDelegate sharedAppDelegate] webViewController] adjustLayoutForNewHTTPResponse:_wvt];
+		});
+	}
+
+	[[self client] URLProtocol:self didReceiveResponse:[snapshot response] cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+	[[self client] URLProtocol:self didLoadData:[snapshot data]];
+	[[self client] URLProtocolDidFinishLoading:self];
+	return YES;
+}
+
+/*! Starts recording a response for the snapshot of its document, if snapshots are on and
+ *  it's worth keeping.  An origin response starts a new snapshot.
+ *  \details What's recorded is what the client is given, so that a snapshot's script
+ *  nonces match its CSP headers.
+ */
+
+- (void)beginSnapshotRecordOfResponse:(NSURLResponse *)response
+{
+	_snapshotResponse = nil;
+	_snapshotData = nil;
+
+	if (![JAHPSnapshotStore isEnabled] || _isTemporarilyAllowed || _isOCSPRequest ||
+		![[_actualRequest HTTPMethod] isEqualToString:@"GET"] ||
+		![response isKindOfClass:[NSHTTPURLResponse class]] ||
+		[(NSHTTPURLResponse *)response statusCode] != 200 ||
+		![JAHPSnapshotStore shouldRecordResourceOfLength:[response expectedContentLength]]) {
+		return;
+	}
+
+	if (_isOrigin) {
+		[[JAHPSnapshotStore sharedStore] beginSnapshotOfDocument:([[self request] mainDocumentURL] ?: [[self request] URL])];
+	}
+	_snapshotResponse = (NSHTTPURLResponse *)response;
+	_snapshotData = [NSMutableData data];
+}
+
+- (void)recordSnapshotData:(NSData *)data
+{
+	if (_snapshotData == nil) {
+		return;
+	}
+	if (![JAHPSnapshotStore shouldRecordResourceOfLength:[_snapshotData length] + [data length]]) {
+		_snapshotData = nil;
+		return;
+	}
+	[_snapshotData appendData:data];
+}
+
+- (void)finishSnapshotRecord
+{
+	if (_snapshotData != nil) {
+		[[JAHPSnapshotStore sharedStore] addResponse:_snapshotResponse data:_snapshotData toSnapshotOfDocument:([[self request] mainDocumentURL] ?: [[self request] URL])];
+	}
+	_snapshotResponse = nil;
+	_snapshotData = nil;
+}
+
 #pragma mark * Authentication challenge handling
 
 /*! Performs the block on the specified thread in one of specified modes.
@@ -991,19 +1956,19 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	// which is a different thread than self.clientThread.
 	// It is possible that -stopLoading was called on self.clientThread
 	// just before this method if so, ignore this callback
-	if (!self.task) { return; }
+	if (![self isCurrentTask:task]) { return; }
 
 	NSMutableURLRequest *    redirectRequest;
 
 #pragma unused(session)
-#pragma unused(task)
-	assert(task == self.task);
 	assert(response != nil);
 	assert(newRequest != nil);
 #pragma unused(completionHandler)
 	assert(completionHandler != nil);
 	assert([NSThread currentThread] == self.clientThread);
 
+	[self settleHedgeWithWinner:task];
+
 	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"will redirect from %@ to %@", [response URL], [newRequest URL]];
 
 	// The new request was copied from our old request, so it has our magic property.  We actually
@@ -1017,7 +1982,10 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	assert([[self class] propertyForKey:kJAHPRecursiveRequestFlagProperty inRequest:newRequest] != nil);
 
 	/* save any cookies we just received */
-	[CookieJar setCookies:[NSHTTPCookie cookiesWithResponseHeaderFields:[response allHeaderFields] forURL:[_actualRequest URL]] forURL:[_actualRequest URL] mainDocumentURL:[_actualRequest mainDocumentURL]];
+	NSString *setCookie = JAHPClassifyResponseHeaders(response).setCookie;
+	if (setCookie != nil) {
+		[CookieJar setCookies:[NSHTTPCookie cookiesWithResponseHeaderFields:@{ @"Set-Cookie": setCookie } forURL:[_actualRequest URL]] forURL:[_actualRequest URL] mainDocumentURL:[_actualRequest mainDocumentURL]];
+	}
 
 	redirectRequest = [newRequest mutableCopy];
 
@@ -1042,7 +2010,7 @@ static NSString * kJAHPRecursiveRequestFlagProperty = @"com.jivesoftware.JAHPAut
 	// The following ends up calling -URLSession:task:didCompleteWithError: with NSURLErrorDomain / NSURLErrorCancelled,
 	// which specificallys traps and ignores the error.
 
-	[self.task cancel];
+	[self.demux cancelDataTask:self.task delegate:self];
 
 	[[self client] URLProtocol:self didFailWithError:[NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:@{ ORIGIN_KEY: (_isOrigin ? @YES : @NO )}]];
 }
@@ -1057,14 +2025,12 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	// which is a different thread than self.clientThread.
 	// It is possible that -stopLoading was called on self.clientThread
 	// just before this method if so, ignore this callback
-	if (!self.task) { return; }
+	if (![self isCurrentTask:task]) { return; }
 
 	BOOL        result;
 	id<JAHPAuthenticatingHTTPProtocolDelegate> strongDelegate;
 
 #pragma unused(session)
-#pragma unused(task)
-	assert(task == self.task);
 	assert(challenge != nil);
 	assert(completionHandler != nil);
 	assert([NSThread currentThread] == self.clientThread);
@@ -1105,7 +2071,7 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 			BOOL successfulAuth =
 			[authURLSessionDelegate evaluateTrust:trust
 							modifyOCSPURLOverride:modifyOCSPURL
-								  sessionOverride:sharedDemuxInstance.session
+								  sessionOverride:[[self class] sharedDemux].session
 								completionHandler:completionHandler];
 
 			if (successfulAuth) {
@@ -1152,6 +2118,35 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	}
 }
 
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task needNewBodyStream:(void (^)(NSInputStream *))completionHandler
+{
+#pragma unused(session)
+	assert([NSThread currentThread] == self.clientThread);
+
+	// NSURLSession needs to send the body again, typically after a redirect or an
+	// authentication challenge.  Only a spooled body can be rewound.
+	if (![self isCurrentTask:task] || _bodySpool == nil) {
+		completionHandler(nil);
+		return;
+	}
+
+	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"rewinding request body"];
+
+	completionHandler([_bodySpool inputStream]);
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didSendBodyData:(int64_t)bytesSent totalBytesSent:(int64_t)totalBytesSent totalBytesExpectedToSend:(int64_t)totalBytesExpectedToSend
+{
+#pragma unused(session)
+#pragma unused(bytesSent)
+	if (![self isCurrentTask:task]) { return; }
+
+	// Show upload progress for form posts; the page's own progress takes over once it starts loading.
+	if (_wvt != nil && _isOrigin && totalBytesExpectedToSend > 0) {
+		[_wvt setProgress:[NSNumber numberWithDouble:(double)totalBytesSent/(double)totalBytesExpectedToSend]];
+	}
+}
+
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler
 {
 	// rdar://21484589
@@ -1160,18 +2155,41 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	// which is a different thread than self.clientThread.
 	// It is possible that -stopLoading was called on self.clientThread
 	// just before this method if so, ignore this callback
-	if (!self.task) { return; }
+	if (![self isCurrentTask:dataTask]) { return; }
 
 	NSURLCacheStoragePolicy cacheStoragePolicy;
 	NSInteger               statusCode;
 
 #pragma unused(session)
-#pragma unused(dataTask)
-	assert(dataTask == self.task);
 	assert(response != nil);
 	assert(completionHandler != nil);
 	assert([NSThread currentThread] == self.clientThread);
 
+	[self settleHedgeWithWinner:dataTask];
+	assert(dataTask == self.task);
+
+	if (_recordsLatency) {
+		[[JAHPLatencyTracker sharedTracker] recordLatency:[NSDate timeIntervalSinceReferenceDate] - self.startTime forHost:[[_actualRequest URL] host]];
+	}
+
+	// Everything below reads the headers it needs from here.
+	JAHPResponseHeaders headers = { nil };
+	if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+		headers = JAHPClassifyResponseHeaders((NSHTTPURLResponse *) response);
+	}
+
+	// A replay continues the response the client already has.
+	if (_didSendResponse) {
+		if ([response isKindOfClass:[NSHTTPURLResponse class]] && [self acceptReplayedResponse:(NSHTTPURLResponse *)response headers:&headers]) {
+			completionHandler(NSURLSessionResponseAllow);
+		} else {
+			// The following ends up calling -URLSession:task:didCompleteWithError: with NSURLErrorCancelled.
+			completionHandler(NSURLSessionResponseCancel);
+			[self failWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil]];
+		}
+		return;
+	}
+
 	// Pass the call on to our client.  The only tricky thing is that we have to decide on a
 	// cache storage policy, which is based on the actual request we issued, not the request
 	// we were given.
@@ -1188,7 +2206,11 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"received response %zd / %@ with cache storage policy %zu", (ssize_t) statusCode, [response URL], (size_t) cacheStoragePolicy];
 
 	_contentType = CONTENT_TYPE_OTHER;
-	_isFirstChunk = YES;
+	_htmlRewriter = nil;
+	_textOnlyReducer = nil;
+	_textOnlyTimeToReadable = 0;
+	_heldResponse = nil;
+	_snapshotData = nil;
 
 	if(_wvt && [[dataTask.currentRequest URL] isEqual:[dataTask.currentRequest mainDocumentURL]]) {
 		[_wvt setUrl:[dataTask.currentRequest URL]];
@@ -1198,42 +2220,12 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	}
 
 	NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse*)response;
-	NSString *ctype = [[self caseInsensitiveHeader:@"content-type" inResponse:httpResponse] lowercaseString];
-	if (ctype != nil) {
-		if ([ctype hasPrefix:@"text/html"] || [ctype hasPrefix:@"application/html"] || [ctype hasPrefix:@"application/xhtml+xml"]) {
-			_contentType = CONTENT_TYPE_HTML;
-		} else {
-			// TODO: keep adding new content types as needed
-			// Determine if the content type is a file type
-			// we can present.
-			NSArray *types = @[
-							   @"application/x-apple-diskimage",
-							   @"application/binary",
-							   @"application/octet-stream",
-							   @"application/pdf",
-							   @"application/x-gzip",
-							   @"application/x-xz",
-							   @"application/zip",
-							   @"audio/",
-							   @"audio/mpeg",
-							   @"image/",
-							   @"image/gif",
-							   @"image/jpg",
-							   @"image/jpeg",
-							   @"image/png",
-							   @"video/",
-							   @"video/x-flv",
-							   @"video/ogg",
-							   @"video/webm"
-							   ];
-			// TODO: (performance) could use a dictionary of dictionaries matching on type and subtype
-			for (NSString *type in types) {
-				if ([ctype hasPrefix:type]) {
-					_contentType = CONTENT_TYPE_FILE;
-				}
-			}
-		}
-	}
+	_contentType = [JAHPMIMEType classifyContentType:headers.contentType];
+
+	// A missing type could be anything, and a file mislabeled as HTML mustn't have our
+	// javascript injected into it; hold on to the response until the body's first bytes show
+	// what it really is.  See -sniffContentOfData:.
+	BOOL sniffsContent = (_contentType == CONTENT_TYPE_HTML || headers.contentType == nil);
 
 	if (_contentType == CONTENT_TYPE_FILE && _isOrigin && !_isTemporarilyAllowed) {
 		/*
@@ -1243,87 +2235,76 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 		 * to the original request.
 		 */
 
-		// Create a fake response for the client with all headers but content type preserved
-		NSMutableDictionary *fakeHeaders = [[NSMutableDictionary alloc] initWithDictionary:[httpResponse allHeaderFields]];
-		// allHeaderFields canonicalizes header field names to their standard form.
-		// E.g. "content-type" will be automatically adjusted to "Content-Type".
-		// See: https://developer.apple.com/documentation/foundation/httpurlresponse/1417930-allheaderfields
-		[fakeHeaders setObject:@"text/html" forKey:@"Content-Type"];
-		[fakeHeaders setObject:@"0" forKey:@"Content-Length"];
-		[fakeHeaders setObject:@"Cache-Control: no-cache, no-store, must-revalidate" forKey:@"Cache-Control"];
-		NSURLResponse *fakeResponse = [[NSHTTPURLResponse alloc] initWithURL:[httpResponse URL] statusCode:200 HTTPVersion:@"1.1" headerFields:fakeHeaders];
-
 		// Notify the client that the request finished loading so that
 		// the requests's url enters its navigation history.
-		[self.client URLProtocol:self didReceiveResponse:fakeResponse cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+		[self.client URLProtocol:self didReceiveResponse:[[self class] downloadPlaceholderForResponse:httpResponse] cacheStoragePolicy:NSURLCacheStorageNotAllowed];
 
 		// Turn the request into a download
 		completionHandler(NSURLSessionResponseBecomeDownload);
 		return;
 	}
 
+	/* in text-only mode the document is replaced by what there is to read in it; see JAHPTextOnlyReducer */
+	BOOL textOnly = (_contentType == CONTENT_TYPE_HTML && _isOrigin && !_isTemporarilyAllowed && _wvt != nil && [JAHPTextOnlyReducer isEnabled]);
+	BOOL textOnlyImages = (textOnly && [JAHPTextOnlyReducer showsImages]);
+
 	/* rewrite or inject Content-Security-Policy (and X-Webkit-CSP just in case) headers */
 	NSString *CSPheader = nil;
 
-	BOOL disableJavascript = NO; // TODO-DISABLE-JAVASCRIPT: hardcode off until fixed
-	if (disableJavascript) {
-		CSPheader = @"script-src 'none';";
+	/* scripts the page's JavaScript setting allows, if it restricts them; only documents can run scripts */
+	NSString *scriptSources = nil;
+	if (sniffsContent && !_isTemporarilyAllowed) {
+		scriptSources = [JAHPJavaScriptPolicy scriptSourcesForURL:([_actualRequest mainDocumentURL] ?: [_actualRequest URL])];
 	}
 
-	NSString *curCSP = [self caseInsensitiveHeader:@"content-security-policy" inResponse:httpResponse];
-	if(curCSP == nil) {
-		curCSP = [self caseInsensitiveHeader:@"x-webkit-csp" inResponse:httpResponse];
+	if (textOnly) {
+		/* nothing but the reduced document's own images may load */
+		CSPheader = [JAHPTextOnlyReducer contentSecurityPolicyWithImages:textOnlyImages];
+		scriptSources = nil;
 	}
 
-	NSMutableDictionary *responseHeaders = [[NSMutableDictionary alloc] initWithDictionary:[httpResponse allHeaderFields]];
-
-	/* directives and their values (normal and nonced versions) to prepend */
-	NSDictionary *wantedDirectives = @{
-									   @"child-src": @[ @"endlessipc:", @"endlessipc:" ],
-									   @"media-src": @[ @"http://127.0.0.1:*/tunneled-rewrite/", @"http://127.0.0.1:*/tunneled-rewrite/"], // for URL proxy
-									   @"default-src" : @[ @"endlessipc:", [NSString stringWithFormat:@"'nonce-%@' endlessipc:", [self cspNonce]] ],
-									   @"frame-src": @[ @"endlessipc:", @"endlessipc:" ],
-									   @"script-src" : @[ @"", [NSString stringWithFormat:@"'nonce-%@'", [self cspNonce]] ],
-									   };
+	NSString *curCSP = headers.contentSecurityPolicy;
+	NSMutableDictionary *responseHeaders = nil;
 
 	/* don't bother rewriting with the header if we don't want a restrictive one (CSPheader) and the site doesn't have one (curCSP) */
 	if (curCSP != nil) {
-		for (id h in [responseHeaders allKeys]) {
-			NSString *hv = (NSString *)[[httpResponse allHeaderFields] valueForKey:h];
-
-			if ([[h lowercaseString] isEqualToString:@"content-security-policy"] || [[h lowercaseString] isEqualToString:@"x-webkit-csp"]) {
-				/* merge in the things we require for any policy in case exiting policies would block them */
-				if(CSPheader != nil) {
-					// Override existing CSP with ours
-					hv = [[self class] prependDirectivesIfExisting:wantedDirectives inCSPHeader:CSPheader];
-				} else {
-					hv = [[self class] prependDirectivesIfExisting:wantedDirectives inCSPHeader:hv];
-				}
-
-				[responseHeaders setObject:hv forKey:h];
+		responseHeaders = [[NSMutableDictionary alloc] initWithDictionary:[httpResponse allHeaderFields]];
+		for (NSString *h in headers.contentSecurityPolicyFields) {
+			/* merge in the things we require for any policy in case exiting policies would block them */
+			if(CSPheader != nil) {
+				// Override existing CSP with ours
+				[responseHeaders setObject:[JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:CSPheader nonce:[self cspNonce]] forKey:h];
+			} else if (scriptSources != nil) {
+				// Keep the site's policy and add ours for scripts
+				[responseHeaders setObject:[JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:[responseHeaders objectForKey:h] restrictingScriptsTo:scriptSources nonce:[self cspNonce]] forKey:h];
+			} else {
+				[responseHeaders setObject:[JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:[responseHeaders objectForKey:h] nonce:[self cspNonce]] forKey:h];
 			}
-			else
-				[responseHeaders setObject:hv forKey:h];
 		}
 	}
-	else if (CSPheader != nil) {
+	else if (CSPheader != nil || scriptSources != nil) {
 		// No CSP present in the original response, so we set our own
-		NSString *newCSPValue = [[self class] prependDirectivesIfExisting:wantedDirectives inCSPHeader:CSPheader];
+		NSString *newCSPValue = (CSPheader != nil ? [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:CSPheader nonce:[self cspNonce]] : [JAHPContentSecurityPolicy headerValueByAddingRequiredSourcesTo:nil restrictingScriptsTo:scriptSources nonce:[self cspNonce]]);
+		responseHeaders = [[NSMutableDictionary alloc] initWithDictionary:[httpResponse allHeaderFields]];
 		[responseHeaders setObject:newCSPValue forKey:@"Content-Security-Policy"];
 		[responseHeaders setObject:newCSPValue forKey:@"X-WebKit-CSP"];
 	}
 
-	/* rebuild our response with any modified headers */
-	response = [[NSHTTPURLResponse alloc] initWithURL:[httpResponse URL] statusCode:[httpResponse statusCode] HTTPVersion:@"1.1" headerFields:responseHeaders];
+	/* rebuild our response if we modified its headers */
+	if (responseHeaders != nil) {
+		response = [[NSHTTPURLResponse alloc] initWithURL:[httpResponse URL] statusCode:[httpResponse statusCode] HTTPVersion:@"1.1" headerFields:responseHeaders];
+	}
 
 	/* save any cookies we just received
 	 Note that we need to do the same thing in the
 	 - (void)URLSession:task:willPerformHTTPRedirection
 	 */
-	[CookieJar setCookies:[NSHTTPCookie cookiesWithResponseHeaderFields:responseHeaders forURL:[_actualRequest URL]] forURL:[_actualRequest URL] mainDocumentURL:[_actualRequest mainDocumentURL]];
+	if (headers.setCookie != nil) {
+		[CookieJar setCookies:[NSHTTPCookie cookiesWithResponseHeaderFields:@{ @"Set-Cookie": headers.setCookie } forURL:[_actualRequest URL]] forURL:[_actualRequest URL] mainDocumentURL:[_actualRequest mainDocumentURL]];
+	}
 
 	if ([[[self.request URL] scheme] isEqualToString:@"https"]) {
-		NSString *hsts = [[(NSHTTPURLResponse *)response allHeaderFields] objectForKey:HSTS_HEADER];
+		NSString *hsts = headers.strictTransportSecurity;
 		if (hsts != nil && ![hsts isEqualToString:@""]) {
 			[[[AppDelegate sharedAppDelegate] hstsCache] parseHSTSHeader:hsts forHost:[[self.request URL] host]];
 		}
@@ -1339,7 +2320,40 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 		}
 	}
 
-	[[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:cacheStoragePolicy];
+	[self noteResponseForReplay:httpResponse headers:&headers];
+
+	if (![self applyDataSaverToResponse:response headers:&headers]) {
+		completionHandler(NSURLSessionResponseAllow);
+		return;
+	}
+
+	if (_contentType == CONTENT_TYPE_HTML) {
+		NSInteger urlProxyPort = [[AppDelegate sharedAppDelegate] httpProxyPort];
+		dispatch_data_t bootstrap = [[self class] injectedScriptWithNonce:[self cspNonce] urlProxyPort:urlProxyPort dataSaver:_dataSaver];
+		if (textOnly) {
+			_textOnlyReducer = [[JAHPTextOnlyReducer alloc] initWithDocumentURL:[httpResponse URL] bootstrap:bootstrap images:textOnlyImages];
+			[self noteTextOnlyProgress];
+		} else {
+			if (!_isTemporarilyAllowed) {
+				bootstrap = [self bootstrapByAddingElementHidingTo:bootstrap forURL:[httpResponse URL]];
+			}
+			_htmlRewriter = [[JAHPHTMLRewriter alloc] initWithDocumentURL:[httpResponse URL] bootstrap:bootstrap urlProxyPort:urlProxyPort];
+			_htmlRewriter.dataSaver = _dataSaver;
+			if (!_isTemporarilyAllowed) {
+				_htmlRewriter.markupForNewClassesAndIDs = [self elementHidingMarkupForURL:[httpResponse URL]];
+			}
+		}
+	}
+
+	[self beginSnapshotRecordOfResponse:response];
+
+	if (sniffsContent) {
+		_heldResponse = response;
+		_heldCacheStoragePolicy = cacheStoragePolicy;
+		_heldResponseIsLabeled = (headers.contentType != nil);
+	} else {
+		[[self client] URLProtocol:self didReceiveResponse:response cacheStoragePolicy:cacheStoragePolicy];
+	}
 
 	completionHandler(NSURLSessionResponseAllow);
 }
@@ -1352,35 +2366,61 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	// which is a different thread than self.clientThread.
 	// It is possible that -stopLoading was called on self.clientThread
 	// just before this method if so, ignore this callback
-	if (!self.task) { return; }
+	if (!self.task || dataTask != self.task) { return; }
 
 #pragma unused(session)
-#pragma unused(dataTask)
-	assert(dataTask == self.task);
 	assert(data != nil);
 	assert([NSThread currentThread] == self.clientThread);
 
-	if (_contentType == CONTENT_TYPE_HTML) {
-		NSMutableData *tData = [[NSMutableData alloc] init];
-		if (_isFirstChunk) {
-			// Prepend a doctype to force into standards mode and throw in any javascript overrides
-			[tData appendData:[[NSString stringWithFormat:@"<!DOCTYPE html><script type=\"text/javascript\" nonce=\"%@\">%@;\n __psiphon.urlProxyPort=%d;</script>",
-								[self cspNonce],
-								[[self class] javascriptToInject],
-								(int)[[AppDelegate sharedAppDelegate] httpProxyPort]
-								] dataUsingEncoding:NSUTF8StringEncoding]
-				];
-			[tData appendData:data];
-			data = tData;
+	// Drop the part of a replayed body that the client already has.
+	if (_bytesToDiscard > 0) {
+		NSUInteger skip = (NSUInteger) MIN((int64_t) [data length], _bytesToDiscard);
+		_bytesToDiscard -= skip;
+		if (skip == [data length]) {
+			return;
 		}
+		data = [data subdataWithRange:NSMakeRange(skip, [data length] - skip)];
 	}
+	_receivedLength += [data length];
 
-	_isFirstChunk = NO;
+	if (_dataSaverLimit > 0 && _receivedLength > _dataSaverLimit) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"data saver cut off %@ at %lld bytes", [_actualRequest URL], _receivedLength];
+		[self.demux cancelDataTask:self.task delegate:self];
+		self.task = nil;
+		[self failWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+		return;
+	}
+
+	if (_heldResponse != nil) {
+		[self sniffContentOfData:data];
+	}
+	if (_sniffedDownload != nil) {
+		[self writeSniffedDownloadData:data];
+		return;
+	}
+
+	// Inject our javascript and point media at the URL proxy as the document streams through.
+	if (_htmlRewriter != nil) {
+		data = [_htmlRewriter rewriteData:data];
+		if ([data length] == 0) {
+			return;
+		}
+	}
+
+	// Or reduce it to its text.
+	if (_textOnlyReducer != nil) {
+		data = [_textOnlyReducer reduceData:data];
+		[self noteTextOnlyProgress];
+		if ([data length] == 0) {
+			return;
+		}
+	}
 
 	// Just pass the call on to our client.
 
 	[[self class] authenticatingHTTPProtocol:self logWithFormat:@"received %zu bytes of data", (size_t) [data length]];
 
+	[self recordSnapshotData:data];
 	[[self client] URLProtocol:self didLoadData:data];
 }
 
@@ -1392,11 +2432,9 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 	// which is a different thread than self.clientThread.
 	// It is possible that -stopLoading was called on self.clientThread
 	// just before this method if so, ignore this callback
-	if (!self.task) { return; }
+	if (!self.task || dataTask != self.task) { return; }
 
 #pragma unused(session)
-#pragma unused(dataTask)
-	assert(dataTask == self.task);
 	assert(proposedResponse != nil);
 	assert(completionHandler != nil);
 	assert([NSThread currentThread] == self.clientThread);
@@ -1412,15 +2450,46 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 // An NSURLSession delegate callback.  We pass this on to the client.
 {
 #pragma unused(session)
-#pragma unused(task)
-	assert( (self.task == nil) || (task == self.task) );        // can be nil in the 'cancel from -stopLoading' case
 	assert([NSThread currentThread] == self.clientThread);
 
+	// self.task can be nil in the 'cancel from -stopLoading' case.  Otherwise, ignore the
+	// loser of a hedged race, and if one of two racing tasks fails let the other carry on.
+
+	if (self.task != nil && ![self isCurrentTask:task]) {
+		return;
+	}
+	if (self.hedgeTask != nil && error != nil) {
+		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"%@ failed with %@ / %d; continuing with the other", (task == self.hedgeTask ? @"hedge" : @"original"), [error domain], (int) [error code]];
+		if (task == self.task) {
+			self.task = self.hedgeTask;
+			self.startTime = self.hedgeStartTime;
+			_recordsLatency = YES;
+		}
+		self.hedgeTask = nil;
+		[[JAHPLatencyTracker sharedTracker] endHedge];
+		return;
+	}
+
 	// Just log and then, in most cases, pass the call on to our client.
 
 	if (error == nil) {
 		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"success"];
 
+		if (_heldResponse != nil) {
+			// an empty body
+			[self sniffContentOfData:[NSData data]];
+		}
+		if (_sniffedDownload != nil) {
+			[self finishSniffedDownload];
+		}
+
+		NSData *tail = (_textOnlyReducer != nil ? [_textOnlyReducer finish] : [_htmlRewriter finish]);
+		if ([tail length] > 0) {
+			[self recordSnapshotData:tail];
+			[[self client] URLProtocol:self didLoadData:tail];
+		}
+		[self finishSnapshotRecord];
+
 		[[self client] URLProtocolDidFinishLoading:self];
 	} else if ( [[error domain] isEqual:NSURLErrorDomain] && ([error code] == NSURLErrorCancelled) ) {
 		// Do nothing.  This happens in two cases:
@@ -1430,13 +2499,10 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 		//
 		// o if the request is cancelled by a call to -stopLoading, in which case the client doesn't
 		//   want to know about the failure
+	} else if (self.task != nil && [self holdForReconnectWithError:error]) {
+		// We'll replay the request when the tunnel comes back, or fail it then.
 	} else {
-		[[self class] authenticatingHTTPProtocol:self logWithFormat:@"error %@ / %d", [error domain], (int) [error code]];
-
-		NSMutableDictionary *ui = [[NSMutableDictionary alloc] initWithDictionary:[error userInfo]];
-		[ui setObject:(_isOrigin ? @YES : @NO) forKeyedSubscript:ORIGIN_KEY];
-
-		[self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:[error domain] code:[error code] userInfo:ui]];
+		[self failWithError:error];
 	}
 
 	// We don't need to clean up the connection here; the system will call, or has already called,
@@ -1444,21 +2510,6 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
 }
 
 
-- (NSString *)caseInsensitiveHeader:(NSString *)header inResponse:(NSHTTPURLResponse *)response
-{
-	NSString *o;
-	for (id h in [response allHeaderFields]) {
-		if ([[h lowercaseString] isEqualToString:[header lowercaseString]]) {
-			o = [[response allHeaderFields] objectForKey:h];
-
-			/* XXX: does webview always honor the first matching header or the last one? */
-			break;
-		}
-	}
-
-	return o;
-}
-
 - (NSString *)cspNonce
 {
 	if (!_cspNonce) {
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! One directive of a Content-Security-Policy, e.g. "script-src 'self' example.com".
+ */
+
+@interface JAHPCSPDirective : NSObject
+
+/*! The directive's name, lowercased.
+ */
+
+@property (nonatomic, readonly, nonnull) NSString *name;
+
+/*! The directive's source expressions (or other values), in order.
+ */
+
+@property (nonatomic, readonly, nonnull) NSArray<NSString *> *values;
+
+- (nonnull instancetype)initWithName:(nonnull NSString *)name values:(nonnull NSArray<NSString *> *)values;
+
+/*! Returns YES if any value is a nonce or hash source, which makes the browser ignore
+ *  'unsafe-inline' in the directive.
+ */
+
+- (BOOL)hasNonceOrHash;
+
+/*! Returns YES if the directive's source list is 'none'.
+ */
+
+- (BOOL)isNone;
+
+@end
+
+/*! A parsed Content-Security-Policy header value.
+ *  \details Parsing follows https://w3c.github.io/webappsec-csp/#parse-serialized-policy-list:
+ *  the value is a comma separated list of policies, each a semicolon separated list of
+ *  directives.  Directive names are case-insensitive and, as in the browser, only the first
+ *  directive with a given name in a policy counts.  Invalid directive names are dropped.
+ */
+
+@interface JAHPContentSecurityPolicy : NSObject
+
+/*! The policies in the header value, each a list of directives in order.
+ */
+
+@property (nonatomic, readonly, nonnull) NSArray<NSArray<JAHPCSPDirective *> *> *policies;
+
+- (nonnull instancetype)initWithHeaderValue:(nonnull NSString *)value;
+
+/*! Returns the policies serialized as a header value.
+ */
+
+- (nonnull NSString *)headerValue;
+
+/*! Returns value with the sources that pages need for our injected javascript, the URL
+ *  proxy and endlessipc: merged into any directives that would block them.
+ *  \details Rewriting is done once per distinct header value: the result is kept in an LRU
+ *  cache as a template, and only the nonce is filled in per call.  Sites tend to send the
+ *  same policy on every response.
+ *
+ *  Can be called on any thread.
+ *  \param nonce The nonce of the script we inject into the document.
+ */
+
++ (nonnull NSString *)headerValueByAddingRequiredSourcesTo:(nonnull NSString *)value nonce:(nonnull NSString *)nonce;
+
+/*! Returns value with the required sources merged in as above, followed by a policy that
+ *  only lets scripts from scriptSources and our injected script run.
+ *  \details The browser enforces every policy in the list, so the site's own policy can't
+ *  loosen ours, and ours only ever takes away from what the site's allows.
+ *  \param value The site's policy, or nil if it has none.
+ *  \param scriptSources The allowed script sources; empty for none but ours.
+ */
+
++ (nonnull NSString *)headerValueByAddingRequiredSourcesTo:(nullable NSString *)value restrictingScriptsTo:(nonnull NSString *)scriptSources nonce:(nonnull NSString *)nonce;
+
+@end
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPContentSecurityPolicy.h"
+
+/* distinct header values whose rewrites are kept */
+#define CSP_TEMPLATE_CACHE_SIZE 128
+
+/* stands in for the nonce in cached templates; control characters can't be in header values */
+#define CSP_NONCE_PLACEHOLDER @"\x1f"
+
+/*! The sources that must be allowed for pages to keep working in the browser, for each
+ *  directive that could block them.  The nonced value is used instead of the plain one when
+ *  the directive already has a nonce or hash, because then adding ours can't make it any
+ *  stricter, or when it is 'none'.
+ */
+
+static const struct {
+	__unsafe_unretained NSString *name;
+	__unsafe_unretained NSString *plain;
+	__unsafe_unretained NSString *nonced;
+} JAHPCSPRequiredSources[] = {
+	{ @"child-src",   @"endlessipc:", @"endlessipc:" },
+	{ @"default-src", @"endlessipc:", @"'nonce-" CSP_NONCE_PLACEHOLDER @"' endlessipc:" },
+	{ @"frame-src",   @"endlessipc:", @"endlessipc:" },
+	{ @"media-src",   @"http://127.0.0.1:*/tunneled-rewrite/", @"http://127.0.0.1:*/tunneled-rewrite/" },   // for the URL proxy
+	{ @"script-src",  @"",            @"'nonce-" CSP_NONCE_PLACEHOLDER @"'" },
+	{ @"style-src",   @"",            @"'nonce-" CSP_NONCE_PLACEHOLDER @"'" },   // for element hiding
+};
+
+static BOOL JAHPIsCSPWhitespace(unichar c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+/*! Splits s on ASCII whitespace, dropping empty tokens.
+ */
+
+static NSArray<NSString *> *JAHPCSPTokens(NSString *s)
+{
+	NSMutableArray<NSString *> *tokens = [[NSMutableArray alloc] init];
+	NSUInteger length = [s length];
+	NSUInteger start = NSNotFound;
+
+	for (NSUInteger i = 0; i <= length; i++) {
+		BOOL space = (i == length) || JAHPIsCSPWhitespace([s characterAtIndex:i]);
+		if (space && start != NSNotFound) {
+			[tokens addObject:[s substringWithRange:NSMakeRange(start, i - start)]];
+			start = NSNotFound;
+		} else if (!space && start == NSNotFound) {
+			start = i;
+		}
+	}
+
+	return tokens;
+}
+
+static BOOL JAHPIsValidCSPDirectiveName(NSString *name)
+{
+	static NSCharacterSet *invalid;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		invalid = [[NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-"] invertedSet];
+	});
+
+	return [name length] > 0 && [name rangeOfCharacterFromSet:invalid].location == NSNotFound;
+}
+
+@implementation JAHPCSPDirective
+
+- (instancetype)initWithName:(NSString *)name values:(NSArray<NSString *> *)values
+{
+	self = [super init];
+	if (self != nil) {
+		_name = [name copy];
+		_values = [values copy];
+	}
+	return self;
+}
+
+- (BOOL)hasNonceOrHash
+{
+	for (NSString *value in _values) {
+		NSString *v = [value lowercaseString];
+		if ([v hasPrefix:@"'nonce-"] || [v hasPrefix:@"'sha256-"] || [v hasPrefix:@"'sha384-"] || [v hasPrefix:@"'sha512-"]) {
+			return YES;
+		}
+	}
+	return NO;
+}
+
+- (BOOL)isNone
+{
+	return [_values count] == 1 && [[_values[0] lowercaseString] isEqualToString:@"'none'"];
+}
+
+- (NSString *)description
+{
+	if ([_values count] == 0) {
+		return _name;
+	}
+	return [NSString stringWithFormat:@"%@ %@", _name, [_values componentsJoinedByString:@" "]];
+}
+
+@end
+
+@implementation JAHPContentSecurityPolicy
+
+- (instancetype)initWithHeaderValue:(NSString *)value
+{
+	self = [super init];
+	if (self != nil) {
+		NSMutableArray *policies = [[NSMutableArray alloc] init];
+
+		for (NSString *serializedPolicy in [value componentsSeparatedByString:@","]) {
+			NSMutableArray<JAHPCSPDirective *> *directives = [[NSMutableArray alloc] init];
+			NSMutableSet<NSString *> *seen = [[NSMutableSet alloc] init];
+
+			for (NSString *serializedDirective in [serializedPolicy componentsSeparatedByString:@";"]) {
+				NSArray<NSString *> *tokens = JAHPCSPTokens(serializedDirective);
+				if ([tokens count] == 0) {
+					continue;
+				}
+
+				NSString *name = [tokens[0] lowercaseString];
+				if (!JAHPIsValidCSPDirectiveName(name) || [seen containsObject:name]) {
+					continue;
+				}
+				[seen addObject:name];
+
+				[directives addObject:[[JAHPCSPDirective alloc] initWithName:name values:[tokens subarrayWithRange:NSMakeRange(1, [tokens count] - 1)]]];
+			}
+
+			if ([directives count] > 0) {
+				[policies addObject:directives];
+			}
+		}
+
+		_policies = policies;
+	}
+	return self;
+}
+
+- (NSString *)headerValue
+{
+	NSMutableArray<NSString *> *policies = [[NSMutableArray alloc] initWithCapacity:[_policies count]];
+
+	for (NSArray<JAHPCSPDirective *> *directives in _policies) {
+		NSMutableArray<NSString *> *serialized = [[NSMutableArray alloc] initWithCapacity:[directives count]];
+		for (JAHPCSPDirective *directive in directives) {
+			[serialized addObject:[directive description]];
+		}
+		[policies addObject:[serialized componentsJoinedByString:@"; "]];
+	}
+
+	return [policies componentsJoinedByString:@", "];
+}
+
+#pragma mark - Rewriting
+
+/*! Returns the policy with the required sources merged in, with CSP_NONCE_PLACEHOLDER
+ *  where the nonce goes.
+ */
+
+- (JAHPContentSecurityPolicy *)policyByAddingRequiredSources
+{
+	JAHPContentSecurityPolicy *rewritten = [[JAHPContentSecurityPolicy alloc] init];
+	NSMutableArray *policies = [[NSMutableArray alloc] initWithCapacity:[_policies count]];
+
+	for (NSArray<JAHPCSPDirective *> *directives in _policies) {
+		NSMutableArray<JAHPCSPDirective *> *newDirectives = [[NSMutableArray alloc] initWithCapacity:[directives count]];
+
+		for (JAHPCSPDirective *directive in directives) {
+			JAHPCSPDirective *newDirective = directive;
+
+			for (size_t i = 0; i < sizeof(JAHPCSPRequiredSources) / sizeof(JAHPCSPRequiredSources[0]); i++) {
+				if (![directive.name isEqualToString:JAHPCSPRequiredSources[i].name]) {
+					continue;
+				}
+
+				if ([directive isNone]) {
+					// Nothing else is allowed, so ours replace it rather than being added.
+					newDirective = [[JAHPCSPDirective alloc] initWithName:directive.name values:JAHPCSPTokens(JAHPCSPRequiredSources[i].nonced)];
+				} else {
+					NSString *sources = [directive hasNonceOrHash] ? JAHPCSPRequiredSources[i].nonced : JAHPCSPRequiredSources[i].plain;
+					NSArray<NSString *> *values = [JAHPCSPTokens(sources) arrayByAddingObjectsFromArray:directive.values];
+					newDirective = [[JAHPCSPDirective alloc] initWithName:directive.name values:values];
+				}
+				break;
+			}
+
+			[newDirectives addObject:newDirective];
+		}
+
+		[policies addObject:newDirectives];
+	}
+
+	rewritten->_policies = policies;
+	return rewritten;
+}
+
+/*! Returns the rewritten form of value split at the nonce, from the cache if possible.
+ */
+
++ (NSArray<NSString *> *)rewriteTemplateForHeaderValue:(NSString *)value
+{
+	static NSMutableDictionary<NSString *, NSArray<NSString *> *> *templates;
+	static NSMutableOrderedSet<NSString *> *recentlyUsed;    // least recently used first
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		templates = [[NSMutableDictionary alloc] initWithCapacity:CSP_TEMPLATE_CACHE_SIZE];
+		recentlyUsed = [[NSMutableOrderedSet alloc] initWithCapacity:CSP_TEMPLATE_CACHE_SIZE];
+	});
+
+	NSArray<NSString *> *template;
+
+	@synchronized (templates) {
+		template = templates[value];
+		if (template != nil) {
+			[recentlyUsed removeObject:value];
+			[recentlyUsed addObject:value];
+			return template;
+		}
+	}
+
+	NSString *rewritten = [[[[JAHPContentSecurityPolicy alloc] initWithHeaderValue:value] policyByAddingRequiredSources] headerValue];
+	template = [rewritten componentsSeparatedByString:CSP_NONCE_PLACEHOLDER];
+	value = [value copy];
+
+	@synchronized (templates) {
+		if ([recentlyUsed count] >= CSP_TEMPLATE_CACHE_SIZE && templates[value] == nil) {
+			[templates removeObjectForKey:[recentlyUsed firstObject]];
+			[recentlyUsed removeObjectAtIndex:0];
+		}
+		templates[value] = template;
+		[recentlyUsed removeObject:value];
+		[recentlyUsed addObject:value];
+	}
+
+	return template;
+}
+
++ (NSString *)headerValueByAddingRequiredSourcesTo:(NSString *)value nonce:(NSString *)nonce
+{
+	NSArray<NSString *> *template = [self rewriteTemplateForHeaderValue:value];
+
+	if ([template count] == 1) {
+		return template[0];
+	}
+	return [template componentsJoinedByString:nonce];
+}
+
++ (NSString *)headerValueByAddingRequiredSourcesTo:(NSString *)value restrictingScriptsTo:(NSString *)scriptSources nonce:(NSString *)nonce
+{
+	NSString *scriptPolicy = ([scriptSources length] > 0 ? [NSString stringWithFormat:@"script-src %@ 'nonce-%@'", scriptSources, nonce] : [NSString stringWithFormat:@"script-src 'nonce-%@'", nonce]);
+
+	NSString *sitePolicy = (value != nil ? [self headerValueByAddingRequiredSourcesTo:value nonce:nonce] : nil);
+	if ([sitePolicy length] == 0) {
+		return scriptPolicy;
+	}
+	return [NSString stringWithFormat:@"%@, %@", sitePolicy, scriptPolicy];
+}
+
+@end
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! The cookies JAHPAuthenticatingHTTPProtocol sends and stores, indexed by site.
+ *  \details Cookies are kept in memory in buckets keyed by registrable domain (see
+ *  PublicSuffixList), so finding the cookies for a request looks at one site's cookies
+ *  rather than all of them.  Each cookie's name=value pair is serialized when it's stored
+ *  and bucket order is kept as RFC 6265 wants it, so a Cookie header is a single pass
+ *  that joins strings.
+ *
+ *  Third-party cookies can be partitioned: stored and sent only under the top-level site
+ *  they were set on.  A site's partitions hang off the site itself, so removing a site
+ *  removes the third-party cookies set on it too, and removing a site or everything is a
+ *  dictionary operation however many cookies there are.
+ *
+ *  Changes are written behind, batched, to a single file on a background queue.  The web
+ *  view's scripts only see NSHTTPCookieStorage, so cookies that scripts may read are
+ *  mirrored into it, and cookies that scripts set there are picked up.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface JAHPCookieStore : NSObject
+
+/*! Returns the store in Library/Cookies, mirrored to the shared NSHTTPCookieStorage.  The
+ *  first time, it's filled from NSHTTPCookieStorage.
+ */
+
++ (nonnull instancetype)sharedStore;
+
+/*! Opens or creates a store.
+ *  \param path The file the store is kept in, or nil for one that's only in memory.
+ *  \param cookieStorage The storage scripts see, or nil for none.
+ */
+
+- (nonnull instancetype)initWithPath:(nullable NSString *)path cookieStorage:(nullable NSHTTPCookieStorage *)cookieStorage;
+
+/*! Returns the Cookie header for a request to url, or nil if it has no cookies.
+ *  \param partition The top-level site whose partition to use for a third-party request,
+ *  or nil for the cookies url's site set as a first party.
+ */
+
+- (nullable NSString *)cookieHeaderForURL:(nonnull NSURL *)url partition:(nullable NSString *)partition;
+
+/*! Stores cookies from a response to url, and removes those it expired.  Cookies that
+ *  url isn't allowed to set -- for another site, or for a public suffix -- are ignored.
+ *  \param partition As for -cookieHeaderForURL:partition:.
+ */
+
+- (void)setCookies:(nonnull NSArray<NSHTTPCookie *> *)cookies forURL:(nonnull NSURL *)url partition:(nullable NSString *)partition;
+
+/*! Returns every cookie stored, partitioned or not.
+ */
+
+- (nonnull NSArray<NSHTTPCookie *> *)cookies;
+
+/*! Removes the cookies of the site host is in, including third-party cookies partitioned
+ *  under it.
+ */
+
+- (void)removeCookiesForSite:(nonnull NSString *)host;
+
+/*! Removes the cookies of every site except those the given hosts are in.
+ */
+
+- (void)removeCookiesExceptForSites:(nonnull NSSet<NSString *> *)hosts;
+
+- (void)removeAllCookies;
+
+/*! If YES, cookies are only kept in memory and the file is removed, so that none outlive
+ *  the app.  Clearing them is then only ever a dictionary operation.
+ */
+
+@property (nonatomic) BOOL inMemoryOnly;
+
+/*! Writes any changes not yet written.  Returns once they're on disk.
+ */
+
+- (void)flush;
+
+/*! Returns the site a host's cookies are filed under: its registrable domain, or the host
+ *  itself if it has none.
+ */
+
++ (nonnull NSString *)siteOfHost:(nonnull NSString *)host;
+
+@end
@@ -0,0 +1,773 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPCookieStore.h"
+
+#import "PublicSuffixList.h"
+
+/* changes are written this long after the first one that isn't on disk yet */
+#define COOKIE_WRITE_DELAY 2.0
+
+/* changes scripts make to NSHTTPCookieStorage are picked up this long after they're made */
+#define COOKIE_IMPORT_DELAY 0.25
+
+/* like other browsers, keep at most this many cookies per site, dropping the oldest */
+#define MAX_COOKIES_PER_BUCKET 180
+
+#define COOKIE_FILE_VERSION 1
+
+static const void *JAHPCookieMirrorQueueKey = &JAHPCookieMirrorQueueKey;
+
+/*! A stored cookie, with what matching and sending it takes worked out once.
+ */
+
+@interface JAHPStoredCookie : NSObject {
+@public
+	NSHTTPCookie *cookie;
+	NSString *pair;         // name=value, as it goes in a Cookie header
+	NSString *domain;       // lowercased, without a leading dot
+	NSString *path;
+	NSDate *expires;        // nil for a session cookie
+	uint64_t created;       // the store's sequence number when the cookie was first set
+	BOOL hostOnly;
+	BOOL secure;
+	BOOL seenInStorage;     // NSHTTPCookieStorage has had it, so if it's gone a script removed it
+}
+@end
+
+@implementation JAHPStoredCookie
+
+- (instancetype)initWithCookie:(NSHTTPCookie *)c
+{
+	self = [super init];
+	if (self != nil) {
+		cookie = c;
+		pair = [NSString stringWithFormat:@"%@=%@", [c name], [c value]];
+		hostOnly = ![[c domain] hasPrefix:@"."];
+		domain = [(hostOnly ? [c domain] : [[c domain] substringFromIndex:1]) lowercaseString];
+		path = ([[c path] length] > 0 ? [c path] : @"/");
+		expires = [c expiresDate];
+		secure = [c isSecure];
+	}
+	return self;
+}
+
+- (BOOL)isExpired
+{
+	return expires != nil && [expires timeIntervalSinceNow] <= 0;
+}
+
+- (BOOL)isSameCookieAs:(JAHPStoredCookie *)other
+{
+	return [[cookie name] isEqualToString:[other->cookie name]] && [domain isEqualToString:other->domain] && [path isEqualToString:other->path];
+}
+
+@end
+
+/*! The cookies of one site, in the order they're sent: longest path first, then oldest.
+ */
+
+@interface JAHPCookieBucket : NSObject {
+@public
+	NSMutableArray<JAHPStoredCookie *> *cookies;
+	NSDate *nextExpiry;
+}
+@end
+
+@implementation JAHPCookieBucket
+@end
+
+/*! The cookies a site set as a first party, and those third parties set on it.
+ */
+
+@interface JAHPCookieSite : NSObject {
+@public
+	JAHPCookieBucket *own;
+	NSMutableDictionary<NSString *, JAHPCookieBucket *> *partitions;
+}
+@end
+
+@implementation JAHPCookieSite
+@end
+
+static BOOL domainMatches(NSString *host, NSString *domain, BOOL hostOnly)
+{
+	if ([host isEqualToString:domain]) {
+		return YES;
+	}
+	if (hostOnly || [host length] <= [domain length] || ![host hasSuffix:domain]) {
+		return NO;
+	}
+	return [host characterAtIndex:([host length] - [domain length] - 1)] == '.';
+}
+
+static BOOL pathMatches(NSString *requestPath, NSString *cookiePath)
+{
+	if (![requestPath hasPrefix:cookiePath]) {
+		return NO;
+	}
+	return [requestPath length] == [cookiePath length] || [cookiePath hasSuffix:@"/"] || [requestPath characterAtIndex:[cookiePath length]] == '/';
+}
+
+/* the path of url as it's sent, unlike -[NSURL path] which drops a trailing slash */
+static NSString *requestPathOfURL(NSURL *url)
+{
+	NSString *path = CFBridgingRelease(CFURLCopyPath((__bridge CFURLRef)[url absoluteURL]));
+	return ([path length] > 0 ? path : @"/");
+}
+
+/* the properties of a cookie that can go in a property list */
+static NSDictionary *propertyListOfCookie(NSHTTPCookie *cookie)
+{
+	NSMutableDictionary *properties = [[NSMutableDictionary alloc] init];
+	[[cookie properties] enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+		if ([value isKindOfClass:[NSURL class]]) {
+			value = [value absoluteString];
+		}
+		if ([value isKindOfClass:[NSString class]] || [value isKindOfClass:[NSNumber class]] || [value isKindOfClass:[NSDate class]]) {
+			[properties setObject:value forKey:key];
+		}
+	}];
+	return properties;
+}
+
+@implementation JAHPCookieStore {
+	NSString *_path;
+	NSHTTPCookieStorage *_cookieStorage;
+	NSMutableDictionary<NSString *, JAHPCookieSite *> *_sites;
+	uint64_t _generation;               // bumped by every change
+	uint64_t _sequence;
+	BOOL _inMemoryOnly;
+	BOOL _writeScheduled;
+	BOOL _importScheduled;
+	NSUInteger _storageChangesPending;  // changes to NSHTTPCookieStorage not made yet
+
+	dispatch_queue_t _queue;            // writes the file and picks up scripts' cookies
+	dispatch_queue_t _mirrorQueue;      // changes NSHTTPCookieStorage
+}
+
++ (instancetype)sharedStore
+{
+	static JAHPCookieStore *store;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSString *library = [NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES) firstObject];
+		NSString *directory = [library stringByAppendingPathComponent:@"Cookies"];
+		[[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+		store = [[JAHPCookieStore alloc] initWithPath:[directory stringByAppendingPathComponent:@"JAHPCookieStore.plist"] cookieStorage:[NSHTTPCookieStorage sharedHTTPCookieStorage]];
+	});
+	return store;
+}
+
++ (NSString *)siteOfHost:(NSString *)host
+{
+	return [[PublicSuffixList sharedList] registrableDomainForHost:host] ?: [host lowercaseString];
+}
+
+- (instancetype)initWithPath:(NSString *)path cookieStorage:(NSHTTPCookieStorage *)cookieStorage
+{
+	self = [super init];
+	if (self == nil) {
+		return nil;
+	}
+
+	_path = path;
+	_cookieStorage = cookieStorage;
+	_sites = [[NSMutableDictionary alloc] init];
+	_queue = dispatch_queue_create("JAHPCookieStore", DISPATCH_QUEUE_SERIAL);
+	_mirrorQueue = dispatch_queue_create("JAHPCookieStore.mirror", DISPATCH_QUEUE_SERIAL);
+	dispatch_queue_set_specific(_mirrorQueue, JAHPCookieMirrorQueueKey, (__bridge void *)self, NULL);
+
+	[self load];
+
+	if (_cookieStorage != nil) {
+		[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(cookieStorageChanged:) name:NSHTTPCookieManagerCookiesChangedNotification object:_cookieStorage];
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark - Buckets
+
+/*! Returns the bucket for a site's cookies.  Call with the lock held.
+ *  \param partition The top-level site for third-party cookies, or nil.
+ */
+
+- (JAHPCookieBucket *)bucketForSite:(NSString *)site partition:(NSString *)partition create:(BOOL)create
+{
+	if ([partition isEqualToString:site]) {
+		partition = nil;
+	}
+
+	JAHPCookieSite *owner = [_sites objectForKey:(partition ?: site)];
+	if (owner == nil) {
+		if (!create) {
+			return nil;
+		}
+		owner = [[JAHPCookieSite alloc] init];
+		[_sites setObject:owner forKey:(partition ?: site)];
+	}
+
+	JAHPCookieBucket *bucket = (partition == nil ? owner->own : [owner->partitions objectForKey:site]);
+	if (bucket == nil && create) {
+		bucket = [[JAHPCookieBucket alloc] init];
+		bucket->cookies = [[NSMutableArray alloc] init];
+		if (partition == nil) {
+			owner->own = bucket;
+		} else {
+			if (owner->partitions == nil) {
+				owner->partitions = [[NSMutableDictionary alloc] init];
+			}
+			[owner->partitions setObject:bucket forKey:site];
+		}
+	}
+	return bucket;
+}
+
+- (void)updateNextExpiryOfBucket:(JAHPCookieBucket *)bucket
+{
+	bucket->nextExpiry = nil;
+	for (JAHPStoredCookie *c in bucket->cookies) {
+		if (c->expires != nil && (bucket->nextExpiry == nil || [c->expires compare:bucket->nextExpiry] == NSOrderedAscending)) {
+			bucket->nextExpiry = c->expires;
+		}
+	}
+}
+
+- (void)removeExpiredCookiesFromBucket:(JAHPCookieBucket *)bucket
+{
+	if (bucket == nil || bucket->nextExpiry == nil || [bucket->nextExpiry timeIntervalSinceNow] > 0) {
+		return;
+	}
+
+	NSIndexSet *expired = [bucket->cookies indexesOfObjectsPassingTest:^BOOL(JAHPStoredCookie *c, NSUInteger i, BOOL *stop) {
+		return [c isExpired];
+	}];
+	[bucket->cookies removeObjectsAtIndexes:expired];
+	[self updateNextExpiryOfBucket:bucket];
+}
+
+/*! Puts a cookie in its bucket, replacing the same cookie if it's there, or just removes
+ *  that if the new one has expired.  Call with the lock held.
+ *  \returns The cookie that was replaced or removed, or nil.
+ */
+
+- (JAHPStoredCookie *)storeCookie:(JAHPStoredCookie *)c site:(NSString *)site partition:(NSString *)partition
+{
+	JAHPCookieBucket *bucket = [self bucketForSite:site partition:partition create:![c isExpired]];
+	if (bucket == nil) {
+		return nil;
+	}
+
+	JAHPStoredCookie *old = nil;
+	NSUInteger i = [bucket->cookies indexOfObjectPassingTest:^BOOL(JAHPStoredCookie *existing, NSUInteger idx, BOOL *stop) {
+		return [existing isSameCookieAs:c];
+	}];
+	if (i != NSNotFound) {
+		old = [bucket->cookies objectAtIndex:i];
+		[bucket->cookies removeObjectAtIndex:i];
+	}
+
+	if (![c isExpired]) {
+		c->created = (old != nil ? old->created : ++_sequence);
+		if (old != nil) {
+			// keeps its place among cookies with the same path
+			[bucket->cookies insertObject:c atIndex:i];
+		} else {
+			NSUInteger at = [bucket->cookies indexOfObjectPassingTest:^BOOL(JAHPStoredCookie *existing, NSUInteger idx, BOOL *stop) {
+				return [existing->path length] < [c->path length];
+			}];
+			[bucket->cookies insertObject:c atIndex:(at != NSNotFound ? at : [bucket->cookies count])];
+		}
+
+		if ([bucket->cookies count] > MAX_COOKIES_PER_BUCKET) {
+			JAHPStoredCookie *oldest = [bucket->cookies firstObject];
+			for (JAHPStoredCookie *existing in bucket->cookies) {
+				if (existing->created < oldest->created) {
+					oldest = existing;
+				}
+			}
+			[bucket->cookies removeObjectIdenticalTo:oldest];
+		}
+	}
+
+	[self updateNextExpiryOfBucket:bucket];
+	return old;
+}
+
+/*! Returns NO if a response from host can't set a cookie, possibly making a domain cookie
+ *  for a public suffix host-only as it would be for the suffix itself.
+ */
+
+- (BOOL)host:(NSString *)host secure:(BOOL)secure maySetCookie:(JAHPStoredCookie *)c
+{
+	if (!domainMatches(host, c->domain, NO) || (c->secure && !secure)) {
+		return NO;
+	}
+
+	if (!c->hostOnly && [[PublicSuffixList sharedList] registrableDomainForHost:c->domain] == nil) {
+		if (![host isEqualToString:c->domain]) {
+			return NO;
+		}
+		c->hostOnly = YES;
+	}
+	return YES;
+}
+
+#pragma mark - Cookies
+
+- (NSString *)cookieHeaderForURL:(NSURL *)url partition:(NSString *)partition
+{
+	NSString *host = [[url host] lowercaseString];
+	if (host == nil) {
+		return nil;
+	}
+
+	BOOL secure = ([[url scheme] caseInsensitiveCompare:@"https"] == NSOrderedSame);
+	NSString *path = requestPathOfURL(url);
+	NSString *site = [[self class] siteOfHost:host];
+	NSMutableString *header = nil;
+
+	@synchronized (self) {
+		JAHPCookieBucket *bucket = [self bucketForSite:site partition:partition create:NO];
+		if (bucket == nil) {
+			return nil;
+		}
+		[self removeExpiredCookiesFromBucket:bucket];
+
+		for (JAHPStoredCookie *c in bucket->cookies) {
+			if ((c->secure && !secure) || !domainMatches(host, c->domain, c->hostOnly) || !pathMatches(path, c->path)) {
+				continue;
+			}
+			if (header == nil) {
+				header = [[NSMutableString alloc] initWithString:c->pair];
+			} else {
+				[header appendString:@"; "];
+				[header appendString:c->pair];
+			}
+		}
+	}
+
+	return header;
+}
+
+- (void)setCookies:(NSArray<NSHTTPCookie *> *)cookies forURL:(NSURL *)url partition:(NSString *)partition
+{
+	NSString *host = [[url host] lowercaseString];
+	if (host == nil || [cookies count] == 0) {
+		return;
+	}
+
+	BOOL secure = ([[url scheme] caseInsensitiveCompare:@"https"] == NSOrderedSame);
+	BOOL mirrors = (_cookieStorage != nil && [_cookieStorage cookieAcceptPolicy] != NSHTTPCookieAcceptPolicyNever);
+	NSMutableArray<NSHTTPCookie *> *mirror = [[NSMutableArray alloc] init];
+	NSMutableArray<NSHTTPCookie *> *unmirror = [[NSMutableArray alloc] init];
+
+	@synchronized (self) {
+		for (NSHTTPCookie *cookie in cookies) {
+			JAHPStoredCookie *c = [[JAHPStoredCookie alloc] initWithCookie:cookie];
+			if (![self host:host secure:secure maySetCookie:c]) {
+				continue;
+			}
+
+			NSString *site = [[self class] siteOfHost:c->domain];
+			JAHPStoredCookie *old = [self storeCookie:c site:site partition:partition];
+
+			// scripts can see first-party cookies that aren't HttpOnly
+			BOOL firstParty = (partition == nil || [partition isEqualToString:site]);
+			if (firstParty && ![cookie isHTTPOnly]) {
+				if (![c isExpired]) {
+					c->seenInStorage = mirrors;
+					[mirror addObject:cookie];
+				} else if (old != nil) {
+					[unmirror addObject:old->cookie];
+				}
+			}
+		}
+		[self noteChanged];
+
+		if (!mirrors || ([mirror count] == 0 && [unmirror count] == 0)) {
+			return;
+		}
+		_storageChangesPending++;
+	}
+
+	[self changeCookieStorage:^(NSHTTPCookieStorage *storage) {
+		for (NSHTTPCookie *cookie in unmirror) {
+			[storage deleteCookie:cookie];
+		}
+		for (NSHTTPCookie *cookie in mirror) {
+			[storage setCookie:cookie];
+		}
+	}];
+
+	@synchronized (self) {
+		_storageChangesPending--;
+	}
+}
+
+- (NSArray<NSHTTPCookie *> *)cookies
+{
+	NSMutableArray<NSHTTPCookie *> *cookies = [[NSMutableArray alloc] init];
+
+	@synchronized (self) {
+		[self enumerateBucketsUsingBlock:^(JAHPCookieBucket *bucket, NSString *partition) {
+			for (JAHPStoredCookie *c in bucket->cookies) {
+				if (![c isExpired]) {
+					[cookies addObject:c->cookie];
+				}
+			}
+		}];
+	}
+
+	return cookies;
+}
+
+/*! Calls block with each bucket and the partition it's in, or nil.  Call with the lock held.
+ */
+
+- (void)enumerateBucketsUsingBlock:(void (^)(JAHPCookieBucket *bucket, NSString *partition))block
+{
+	[_sites enumerateKeysAndObjectsUsingBlock:^(NSString *site, JAHPCookieSite *owner, BOOL *stop) {
+		if (owner->own != nil) {
+			block(owner->own, nil);
+		}
+		for (JAHPCookieBucket *bucket in [owner->partitions objectEnumerator]) {
+			block(bucket, site);
+		}
+	}];
+}
+
+- (void)removeCookiesForSite:(NSString *)host
+{
+	NSString *site = [[self class] siteOfHost:host];
+
+	@synchronized (self) {
+		[_sites removeObjectForKey:site];
+		[self noteChanged];
+		_storageChangesPending++;
+	}
+
+	[self removeFromCookieStorageCookiesPassingTest:^BOOL(NSHTTPCookie *cookie) {
+		JAHPStoredCookie *c = [[JAHPStoredCookie alloc] initWithCookie:cookie];
+		return [[[self class] siteOfHost:c->domain] isEqualToString:site];
+	}];
+}
+
+- (void)removeCookiesExceptForSites:(NSSet<NSString *> *)hosts
+{
+	NSMutableSet<NSString *> *sites = [[NSMutableSet alloc] initWithCapacity:[hosts count]];
+	for (NSString *host in hosts) {
+		[sites addObject:[[self class] siteOfHost:host]];
+	}
+
+	@synchronized (self) {
+		for (NSString *site in [_sites allKeys]) {
+			if (![sites containsObject:site]) {
+				[_sites removeObjectForKey:site];
+			}
+		}
+		[self noteChanged];
+		_storageChangesPending++;
+	}
+
+	[self removeFromCookieStorageCookiesPassingTest:^BOOL(NSHTTPCookie *cookie) {
+		JAHPStoredCookie *c = [[JAHPStoredCookie alloc] initWithCookie:cookie];
+		return ![sites containsObject:[[self class] siteOfHost:c->domain]];
+	}];
+}
+
+- (void)removeAllCookies
+{
+	@synchronized (self) {
+		_sites = [[NSMutableDictionary alloc] init];
+		[self noteChanged];
+		_storageChangesPending++;
+	}
+
+	[self removeFromCookieStorageCookiesPassingTest:nil];
+}
+
+#pragma mark - NSHTTPCookieStorage
+
+/*! Changes NSHTTPCookieStorage in a way that we don't then mistake for a script's doing.
+ */
+
+- (void)changeCookieStorage:(void (^)(NSHTTPCookieStorage *storage))block
+{
+	dispatch_sync(_mirrorQueue, ^{
+		block(_cookieStorage);
+	});
+}
+
+/*! Removes cookies from NSHTTPCookieStorage in the background, or all of them if test is
+ *  nil.  The caller has counted it in _storageChangesPending.
+ */
+
+- (void)removeFromCookieStorageCookiesPassingTest:(BOOL (^)(NSHTTPCookie *cookie))test
+{
+	dispatch_async(_queue, ^{
+		if (_cookieStorage != nil) {
+			[self changeCookieStorage:^(NSHTTPCookieStorage *storage) {
+				if (test == nil) {
+					[storage removeCookiesSinceDate:[NSDate distantPast]];
+					return;
+				}
+				for (NSHTTPCookie *cookie in [storage cookies]) {
+					if (test(cookie)) {
+						[storage deleteCookie:cookie];
+					}
+				}
+			}];
+		}
+
+		@synchronized (self) {
+			_storageChangesPending--;
+		}
+	});
+}
+
+- (void)cookieStorageChanged:(NSNotification *)notification
+{
+	if (dispatch_get_specific(JAHPCookieMirrorQueueKey) == (__bridge void *)self) {
+		// our own doing
+		return;
+	}
+
+	@synchronized (self) {
+		if (_importScheduled) {
+			return;
+		}
+		_importScheduled = YES;
+	}
+
+	dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(COOKIE_IMPORT_DELAY * NSEC_PER_SEC)), _queue, ^{
+		[self importFromCookieStorage];
+	});
+}
+
+/*! Picks up the cookies scripts set or removed in NSHTTPCookieStorage.  Runs on _queue.
+ */
+
+- (void)importFromCookieStorage
+{
+	uint64_t generation;
+
+	@synchronized (self) {
+		_importScheduled = NO;
+		if (_storageChangesPending > 0) {
+			// the storage doesn't have what we have yet
+			[self cookieStorageChanged:nil];
+			return;
+		}
+		generation = _generation;
+	}
+
+	NSArray<NSHTTPCookie *> *scriptCookies = [_cookieStorage cookies];
+
+	@synchronized (self) {
+		if (_generation != generation || _storageChangesPending > 0) {
+			// our own change may not have been mirrored yet, so look again later
+			[self cookieStorageChanged:nil];
+			return;
+		}
+
+		NSMutableSet<NSString *> *present = [[NSMutableSet alloc] init];
+
+		for (NSHTTPCookie *cookie in scriptCookies) {
+			if ([cookie isHTTPOnly]) {
+				continue;
+			}
+
+			JAHPStoredCookie *c = [[JAHPStoredCookie alloc] initWithCookie:cookie];
+			NSString *site = [[self class] siteOfHost:c->domain];
+			[present addObject:[NSString stringWithFormat:@"%@\n%@\n%@", [cookie name], c->domain, c->path]];
+
+			// storeCookie: makes the bucket if the site has none yet
+			JAHPCookieBucket *bucket = [self bucketForSite:site partition:nil create:NO];
+			NSUInteger i = (bucket == nil ? NSNotFound : [bucket->cookies indexOfObjectPassingTest:^BOOL(JAHPStoredCookie *existing, NSUInteger idx, BOOL *stop) {
+				return [existing isSameCookieAs:c];
+			}]);
+
+			JAHPStoredCookie *existing = (i != NSNotFound ? [bucket->cookies objectAtIndex:i] : nil);
+			if (existing != nil && [[existing->cookie value] isEqualToString:[cookie value]] && (existing->expires == c->expires || [existing->expires isEqualToDate:c->expires])) {
+				existing->seenInStorage = YES;
+				continue;
+			}
+
+			c->seenInStorage = YES;
+			[self storeCookie:c site:site partition:nil];
+			_generation++;
+		}
+
+		[_sites enumerateKeysAndObjectsUsingBlock:^(NSString *site, JAHPCookieSite *owner, BOOL *stop) {
+			JAHPCookieBucket *bucket = owner->own;
+			if (bucket == nil) {
+				// only holds other sites' partitioned cookies, which scripts can't see
+				return;
+			}
+			NSIndexSet *removed = [bucket->cookies indexesOfObjectsPassingTest:^BOOL(JAHPStoredCookie *c, NSUInteger i, BOOL *stop) {
+				return c->seenInStorage && ![c->cookie isHTTPOnly] && ![present containsObject:[NSString stringWithFormat:@"%@\n%@\n%@", [c->cookie name], c->domain, c->path]]];
+			}];
+			if ([removed count] > 0) {
+				[bucket->cookies removeObjectsAtIndexes:removed];
+				[self updateNextExpiryOfBucket:bucket];
+			}
+		}];
+
+		if (_generation != generation) {
+			[self noteChanged];
+		}
+	}
+}
+
+#pragma mark - Persistence
+
+/*! Schedules a write.  Call with the lock held.
+ */
+
+- (void)noteChanged
+{
+	_generation++;
+
+	if (_path == nil || _writeScheduled) {
+		return;
+	}
+	_writeScheduled = YES;
+
+	dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(COOKIE_WRITE_DELAY * NSEC_PER_SEC)), _queue, ^{
+		[self write];
+	});
+}
+
+- (BOOL)inMemoryOnly
+{
+	@synchronized (self) {
+		return _inMemoryOnly;
+	}
+}
+
+- (void)setInMemoryOnly:(BOOL)inMemoryOnly
+{
+	@synchronized (self) {
+		if (_inMemoryOnly != inMemoryOnly) {
+			_inMemoryOnly = inMemoryOnly;
+			[self noteChanged];
+		}
+	}
+}
+
+- (void)flush
+{
+	dispatch_sync(_queue, ^{
+		[self write];
+	});
+}
+
+/*! Writes the cookies that outlive the session, if anything changed.  Runs on _queue.
+ */
+
+- (void)write
+{
+	NSMutableArray<JAHPStoredCookie *> *cookies = [[NSMutableArray alloc] init];
+	NSMutableArray *partitions = [[NSMutableArray alloc] init];
+
+	@synchronized (self) {
+		if (!_writeScheduled) {
+			return;
+		}
+		_writeScheduled = NO;
+
+		if (_inMemoryOnly) {
+			[[NSFileManager defaultManager] removeItemAtPath:_path error:nil];
+			return;
+		}
+
+		[self enumerateBucketsUsingBlock:^(JAHPCookieBucket *bucket, NSString *partition) {
+			for (JAHPStoredCookie *c in bucket->cookies) {
+				if (c->expires != nil && ![c isExpired]) {
+					[cookies addObject:c];
+					[partitions addObject:(partition ?: [NSNull null])];
+				}
+			}
+		}];
+	}
+
+	NSMutableArray<NSDictionary *> *records = [[NSMutableArray alloc] initWithCapacity:[cookies count]];
+	for (NSUInteger i = 0; i < [cookies count]; i++) {
+		NSMutableDictionary *record = [[NSMutableDictionary alloc] init];
+		[record setObject:propertyListOfCookie(cookies[i]->cookie) forKey:@"cookie"];
+		if (partitions[i] != [NSNull null]) {
+			[record setObject:partitions[i] forKey:@"partition"];
+		}
+		[records addObject:record];
+	}
+
+	NSError *error;
+	NSData *data = [NSPropertyListSerialization dataWithPropertyList:@{ @"version": @(COOKIE_FILE_VERSION), @"cookies": records } format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+	if (data == nil || ![data writeToFile:_path options:(NSDataWritingAtomic | NSDataWritingFileProtectionCompleteUntilFirstUserAuthentication) error:&error]) {
+		NSLog(@"[JAHPCookieStore] failed writing %@: %@", _path, error);
+	}
+}
+
+/*! Reads the file, or the first time, takes the cookies in NSHTTPCookieStorage.
+ */
+
+- (void)load
+{
+	NSData *data = (_path != nil ? [NSData dataWithContentsOfFile:_path] : nil);
+
+	if (data == nil) {
+		for (NSHTTPCookie *cookie in [_cookieStorage cookies]) {
+			JAHPStoredCookie *c = [[JAHPStoredCookie alloc] initWithCookie:cookie];
+			c->seenInStorage = YES;
+			[self storeCookie:c site:[[self class] siteOfHost:c->domain] partition:nil];
+		}
+		if (_cookieStorage != nil) {
+			[self noteChanged];
+		}
+		return;
+	}
+
+	NSDictionary *plist = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:nil];
+	if (![plist isKindOfClass:[NSDictionary class]] || [[plist objectForKey:@"version"] integerValue] != COOKIE_FILE_VERSION) {
+		NSLog(@"[JAHPCookieStore] ignoring unreadable %@", _path);
+		return;
+	}
+
+	for (NSDictionary *record in [plist objectForKey:@"cookies"]) {
+		NSHTTPCookie *cookie = [NSHTTPCookie cookieWithProperties:[record objectForKey:@"cookie"]];
+		if (cookie == nil) {
+			continue;
+		}
+
+		JAHPStoredCookie *c = [[JAHPStoredCookie alloc] initWithCookie:cookie];
+		if (![c isExpired]) {
+			[self storeCookie:c site:[[self class] siteOfHost:c->domain] partition:[record objectForKey:@"partition"]];
+		}
+	}
+}
+
+@end
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+typedef NS_ENUM(NSInteger, JAHPDataSaverAction) {
+	JAHPDataSaverActionAllow,
+	JAHPDataSaverActionCap,     // allow the response, but cut it off if it grows past the limit
+	JAHPDataSaverActionSkip,    // don't fetch the body at all
+};
+
+/*! Decides what data saver mode holds back from a page.
+ *  \details Data saver is on or off for all sites by default, and can be switched on or
+ *  off for single sites.  A page's setting covers everything it loads, wherever from.
+ *
+ *  On pages where it's on, JAHPAuthenticatingHTTPProtocol skips web fonts, and images and
+ *  media bigger than a limit; ones that don't say how big they are are cut off when they
+ *  reach it.  JAHPHTMLRewriter defers images in the markup until injected.js sees them
+ *  come near the viewport, and stops media from autoplaying or preloading.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface JAHPDataSaver : NSObject
+
+/*! Returns YES if data saver is on for the page at url.
+ */
+
++ (BOOL)isEnabledForURL:(nullable NSURL *)url;
+
+/*! Returns the own setting of the site host is in, or nil if it follows the default.
+ *  \details Sites are registrable domains, as for cookies and the JavaScript setting.
+ */
+
++ (nullable NSNumber *)settingForHost:(nonnull NSString *)host;
+
+/*! Sets whether data saver is on for a site, or makes it follow the default if enabled
+ *  is nil.
+ */
+
++ (void)setSetting:(nullable NSNumber *)enabled forHost:(nonnull NSString *)host;
+
+/*! Returns YES if a request can be skipped without fetching it, from its URL alone.
+ */
+
++ (BOOL)shouldSkipRequestForURL:(nonnull NSURL *)url;
+
+/*! Decides what to do with a response.
+ *  \param contentType The Content-Type header, if any.
+ *  \param expectedLength The Content-Length, or NSURLResponseUnknownLength.
+ *  \param limit Set to the number of bytes to cut the body off at for
+ *  JAHPDataSaverActionCap.
+ */
+
++ (JAHPDataSaverAction)actionForContentType:(nullable NSString *)contentType expectedLength:(long long)expectedLength limit:(nonnull int64_t *)limit;
+
+@end
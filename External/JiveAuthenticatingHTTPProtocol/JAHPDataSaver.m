@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPDataSaver.h"
+
+#import "JAHPCookieStore.h"
+#import "JAHPMIMEType.h"
+
+#define DATA_SAVER_IMAGE_LIMIT (150 * 1024)
+#define DATA_SAVER_MEDIA_LIMIT (512 * 1024)
+
+#define kDataSaverSites @"dataSaverSites"
+
+@implementation JAHPDataSaver
+
++ (BOOL)isEnabledForURL:(NSURL *)url
+{
+	NSString *host = [url host];
+	if (host != nil) {
+		NSNumber *setting = [self settingForHost:host];
+		if (setting != nil) {
+			return [setting boolValue];
+		}
+	}
+	return [[NSUserDefaults standardUserDefaults] boolForKey:kDataSaver];
+}
+
++ (NSNumber *)settingForHost:(NSString *)host
+{
+	NSDictionary *sites = [[NSUserDefaults standardUserDefaults] dictionaryForKey:kDataSaverSites];
+	NSNumber *setting = sites[[JAHPCookieStore siteOfHost:host]];
+	return ([setting isKindOfClass:[NSNumber class]] ? setting : nil);
+}
+
++ (void)setSetting:(NSNumber *)enabled forHost:(NSString *)host
+{
+	@synchronized (self) {
+		NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+		NSMutableDictionary *sites = [[defaults dictionaryForKey:kDataSaverSites] mutableCopy] ?: [NSMutableDictionary dictionary];
+		sites[[JAHPCookieStore siteOfHost:host]] = enabled;
+		[defaults setObject:sites forKey:kDataSaverSites];
+	}
+}
+
++ (BOOL)shouldSkipRequestForURL:(NSURL *)url
+{
+	static NSSet *fontExtensions;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		fontExtensions = [NSSet setWithObjects:@"woff", @"woff2", @"ttf", @"otf", @"eot", nil];
+	});
+
+	return [fontExtensions containsObject:[[url pathExtension] lowercaseString]];
+}
+
++ (JAHPDataSaverAction)actionForContentType:(NSString *)contentType expectedLength:(long long)expectedLength limit:(int64_t *)limit
+{
+	NSString *essence = [JAHPMIMEType essenceOfContentType:contentType];
+	int64_t cap;
+
+	if (essence == nil) {
+		return JAHPDataSaverActionAllow;
+	}
+
+	if ([essence hasPrefix:@"font/"] ||
+		[essence hasPrefix:@"application/font-"] ||
+		[essence hasPrefix:@"application/x-font-"] ||
+		[essence isEqualToString:@"application/vnd.ms-fontobject"]) {
+		return JAHPDataSaverActionSkip;
+	}
+
+	if ([essence hasPrefix:@"image/"]) {
+		cap = DATA_SAVER_IMAGE_LIMIT;
+	} else if ([essence hasPrefix:@"video/"] || [essence hasPrefix:@"audio/"]) {
+		cap = DATA_SAVER_MEDIA_LIMIT;
+	} else {
+		return JAHPDataSaverActionAllow;
+	}
+
+	if (expectedLength > cap) {
+		return JAHPDataSaverActionSkip;
+	}
+	*limit = cap;
+	return JAHPDataSaverActionCap;
+}
+
+@end
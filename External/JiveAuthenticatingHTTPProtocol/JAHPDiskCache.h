@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! An encrypted disk cache for the responses JAHPAuthenticatingHTTPProtocol fetches
+ *  through the tunnel, shared by all tabs.
+ *  \details This is installed as the URLCache of the proxied session, so NSURLSession
+ *  decides freshness and revalidates stale entries with If-None-Match and
+ *  If-Modified-Since itself; a 304 just updates the stored headers.  Responses are
+ *  cached before any of our rewriting, so CSP nonces and the injected script are
+ *  always fresh.
+ *
+ *  Bodies are content addressed, so the same asset served from several URLs is stored
+ *  once, and entries whose headers are updated by a revalidation don't rewrite their
+ *  bodies.  Both are encrypted with AES-256-CTR and authenticated with HMAC-SHA256
+ *  under keys derived from a per-install key kept in the keychain, and file names are
+ *  keyed hashes, so nothing on disk reveals which sites were visited.
+ *
+ *  The index is a fixed size array of records in a single mmap'd file.  Total size is
+ *  capped, and the least recently used entries are evicted to stay under it.  Each record
+ *  is tagged with a keyed hash of its site, so one site's entries can be removed.
+ *
+ *  Responses that set cookies, vary on anything but Accept-Encoding, or are marked
+ *  no-store or private are never cached.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface JAHPDiskCache : NSURLCache
+
+/*! Returns the cache in Library/Caches, or nil if its key can't be read from or stored
+ *  in the keychain.  If the app clears everything when backgrounded, the key is only kept
+ *  in memory, so nothing cached can be read after the app exits.
+ */
+
++ (nullable instancetype)sharedCache;
+
+/*! Opens or creates a cache.
+ *  \param directory The directory holding the index and entries; created if needed.
+ *  \param key A 32-byte key that bodies and metadata are encrypted under.
+ *  \param capacity The maximum size of the cache on disk, in bytes.
+ */
+
+- (nullable instancetype)initWithDirectory:(nonnull NSString *)directory key:(nonnull NSData *)key capacity:(NSUInteger)capacity;
+
+/*! Returns YES if a response to request may be stored.
+ */
+
++ (BOOL)isCacheableResponse:(nonnull NSURLResponse *)response forRequest:(nonnull NSURLRequest *)request;
+
+/*! Makes every cached response unreadable at once by switching to a new key, and throws
+ *  the files away to be deleted in the background.  This takes the same time however
+ *  much is cached, and is what -removeAllCachedResponses does.
+ */
+
+- (void)shred;
+
+/*! Removes the responses from the site host is in.
+ */
+
+- (void)removeCachedResponsesForSite:(nonnull NSString *)host;
+
+/*! Removes every response except those from the sites the given hosts are in.
+ */
+
+- (void)removeCachedResponsesExceptForSites:(nonnull NSSet<NSString *> *)hosts;
+
+/*! Returns a keyed hash of data under the cache's key, for naming files that mustn't
+ *  reveal what they hold.
+ */
+
+- (nonnull NSData *)keyedHashOfData:(nonnull NSData *)data;
+
+/*! Encrypts and authenticates plaintext under the cache's key, the same way cached
+ *  responses are, so that -shred makes it unreadable too.
+ *  \param name The keyed hash the data is stored under; it has to be given again to open it.
+ */
+
+- (nullable NSData *)sealData:(nonnull NSData *)plaintext name:(nonnull NSData *)name;
+
+/*! Returns the plaintext of data sealed by -sealData:name:, or nil if it has been damaged,
+ *  tampered with, or sealed under a key that has since been shredded.
+ */
+
+- (nullable NSData *)openData:(nonnull NSData *)sealed name:(nonnull NSData *)name;
+
+@end
@@ -0,0 +1,840 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPDiskCache.h"
+
+#import <CommonCrypto/CommonCrypto.h>
+#import <Security/Security.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+
+#import "JAHPCookieStore.h"
+#import "JAHPTrash.h"
+
+#define DISK_CACHE_CAPACITY (64 * 1024 * 1024)
+
+/* a single response bigger than this isn't worth evicting everything else for */
+#define DISK_CACHE_MAX_ENTRY_FRACTION 0.05
+
+#define DISK_CACHE_INDEX_RECORDS 4096
+#define DISK_CACHE_INDEX_MAGIC 0x4a484443 /* "JHDC" */
+#define DISK_CACHE_INDEX_VERSION 1
+
+#define DISK_CACHE_KEYCHAIN_SERVICE @"JAHPDiskCache"
+#define DISK_CACHE_KEY_LENGTH kCCKeySizeAES256
+
+#define DIGEST_LENGTH CC_SHA256_DIGEST_LENGTH
+#define IV_LENGTH kCCBlockSizeAES128
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t records;
+	uint32_t reserved;
+	uint8_t keyCheck[DIGEST_LENGTH];    /* so entries written under another key are dropped */
+} JAHPDiskCacheIndexHeader;
+
+typedef struct {
+	uint8_t key[DIGEST_LENGTH];         /* keyed hash of the request URL, naming the metadata file */
+	uint8_t body[DIGEST_LENGTH];        /* keyed hash of the body, naming the body file */
+	uint64_t metadataSize;
+	uint64_t bodySize;
+	double lastUsed;
+	uint32_t inUse;
+	uint32_t site;                      /* keyed hash of the request's site, 0 if not known */
+} JAHPDiskCacheRecord;
+
+static NSString *hexString(const uint8_t *bytes, size_t length)
+{
+	static const char digits[] = "0123456789abcdef";
+	char hex[2 * length];
+
+	for (size_t i = 0; i < length; i++) {
+		hex[2 * i] = digits[bytes[i] >> 4];
+		hex[2 * i + 1] = digits[bytes[i] & 0xf];
+	}
+	return [[NSString alloc] initWithBytes:hex length:sizeof(hex) encoding:NSASCIIStringEncoding];
+}
+
+static NSData *hmac(NSData *key, const void *bytes, size_t length)
+{
+	NSMutableData *digest = [NSMutableData dataWithLength:DIGEST_LENGTH];
+	CCHmac(kCCHmacAlgSHA256, [key bytes], [key length], bytes, length, [digest mutableBytes]);
+	return digest;
+}
+
+static NSData *randomKey(void)
+{
+	NSMutableData *key = [NSMutableData dataWithLength:DISK_CACHE_KEY_LENGTH];
+	if (SecRandomCopyBytes(kSecRandomDefault, [key length], [key mutableBytes]) != 0) {
+		return nil;
+	}
+	return key;
+}
+
+/* compares in constant time, so a forged MAC can't be found a byte at a time */
+static BOOL equalDigests(const uint8_t *a, const uint8_t *b)
+{
+	uint8_t difference = 0;
+
+	for (size_t i = 0; i < DIGEST_LENGTH; i++) {
+		difference |= a[i] ^ b[i];
+	}
+	return difference == 0;
+}
+
+@implementation JAHPDiskCache {
+	dispatch_queue_t _queue;
+
+	NSString *_entriesDirectory;
+	NSString *_bodiesDirectory;
+	NSUInteger _capacity;
+
+	NSData *_encryptionKey;
+	NSData *_macKey;
+	NSData *_nameKey;
+
+	int _indexFD;
+	void *_index;
+	size_t _indexLength;
+	JAHPDiskCacheRecord *_records;
+
+	BOOL _keyPersisted;                 // the key is in the keychain, not only in memory
+
+	NSMutableDictionary<NSData *, NSNumber *> *_slotsByKey;
+	NSMutableIndexSet *_freeSlots;
+	NSCountedSet<NSData *> *_bodyReferences;
+	uint64_t _totalSize;
+}
+
++ (instancetype)sharedCache
+{
+	static JAHPDiskCache *cache;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		/* when everything is cleared on backgrounding, nothing cached has to outlive us */
+		BOOL sessionKeyed = [[AppDelegate sharedAppDelegate] clearAllWhenBackgrounded];
+		NSData *key = (sessionKeyed ? randomKey() : [self persistedKey]);
+		if (key == nil) {
+			/* better no cache than one in the clear */
+			NSLog(@"[JAHPDiskCache] no key, not caching");
+			return;
+		}
+
+		NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+		cache = [[JAHPDiskCache alloc] initWithDirectory:[caches stringByAppendingPathComponent:@"JAHPDiskCache"] key:key capacity:DISK_CACHE_CAPACITY];
+		if (cache != nil) {
+			cache->_keyPersisted = !sessionKeyed;
+		}
+	});
+	return cache;
+}
+
+/*! Returns the per-install key from the keychain, creating it on first use.
+ */
+
++ (NSData *)persistedKey
+{
+	NSDictionary *item = @{
+						   (__bridge id)kSecClass : (__bridge id)kSecClassGenericPassword,
+						   (__bridge id)kSecAttrService : DISK_CACHE_KEYCHAIN_SERVICE,
+						   };
+
+	NSMutableDictionary *query = [item mutableCopy];
+	query[(__bridge id)kSecReturnData] = @YES;
+	query[(__bridge id)kSecMatchLimit] = (__bridge id)kSecMatchLimitOne;
+
+	CFTypeRef result = NULL;
+	if (SecItemCopyMatching((__bridge CFDictionaryRef)query, &result) == errSecSuccess) {
+		NSData *key = (__bridge_transfer NSData *)result;
+		if ([key isKindOfClass:[NSData class]] && [key length] == DISK_CACHE_KEY_LENGTH) {
+			return key;
+		}
+	}
+
+	return [self replacePersistedKey];
+}
+
+/*! Stores a new per-install key in the keychain in place of the old one.
+ */
+
++ (NSData *)replacePersistedKey
+{
+	NSDictionary *item = @{
+						   (__bridge id)kSecClass : (__bridge id)kSecClassGenericPassword,
+						   (__bridge id)kSecAttrService : DISK_CACHE_KEYCHAIN_SERVICE,
+						   };
+
+	NSData *key = randomKey();
+	if (key == nil) {
+		return nil;
+	}
+
+	SecItemDelete((__bridge CFDictionaryRef)item);
+
+	NSMutableDictionary *attributes = [item mutableCopy];
+	attributes[(__bridge id)kSecAttrAccessible] = (__bridge id)kSecAttrAccessibleAfterFirstUnlockThisDeviceOnly;
+	attributes[(__bridge id)kSecValueData] = key;
+	if (SecItemAdd((__bridge CFDictionaryRef)attributes, NULL) != errSecSuccess) {
+		return nil;
+	}
+
+	return key;
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory key:(NSData *)key capacity:(NSUInteger)capacity
+{
+	assert([key length] == DISK_CACHE_KEY_LENGTH);
+
+	/* we are the disk cache; don't let NSURLCache keep one of its own */
+	self = [super initWithMemoryCapacity:0 diskCapacity:0 diskPath:nil];
+	if (self == nil) {
+		return nil;
+	}
+
+	_queue = dispatch_queue_create("JAHPDiskCache", DISPATCH_QUEUE_SERIAL);
+	_capacity = capacity;
+	_indexFD = -1;
+
+	[self useKey:key];
+
+	_entriesDirectory = [directory stringByAppendingPathComponent:@"entries"];
+	_bodiesDirectory = [directory stringByAppendingPathComponent:@"bodies"];
+
+	NSFileManager *fm = [NSFileManager defaultManager];
+	if (![fm createDirectoryAtPath:_entriesDirectory withIntermediateDirectories:YES attributes:nil error:nil] ||
+		![fm createDirectoryAtPath:_bodiesDirectory withIntermediateDirectories:YES attributes:nil error:nil]) {
+		return nil;
+	}
+
+	if (![self openIndexAtPath:[directory stringByAppendingPathComponent:@"index"]]) {
+		return nil;
+	}
+
+	[self loadIndex];
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if (_index != NULL) {
+		munmap(_index, _indexLength);
+	}
+	if (_indexFD >= 0) {
+		close(_indexFD);
+	}
+}
+
+- (void)useKey:(NSData *)key
+{
+	_encryptionKey = hmac(key, "encryption", strlen("encryption"));
+	_macKey = hmac(key, "authentication", strlen("authentication"));
+	_nameKey = hmac(key, "naming", strlen("naming"));
+}
+
+#pragma mark - Index
+
+/*! Maps the index file, resetting the cache if it's missing, damaged or was written
+ *  under a different key.
+ */
+
+- (BOOL)openIndexAtPath:(NSString *)path
+{
+	struct stat st;
+	BOOL reset = NO;
+
+	_indexLength = sizeof(JAHPDiskCacheIndexHeader) + DISK_CACHE_INDEX_RECORDS * sizeof(JAHPDiskCacheRecord);
+
+	_indexFD = open([path fileSystemRepresentation], O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (_indexFD < 0 || fstat(_indexFD, &st) != 0) {
+		return NO;
+	}
+	if (st.st_size != (off_t)_indexLength) {
+		if (ftruncate(_indexFD, 0) != 0 || ftruncate(_indexFD, _indexLength) != 0) {
+			return NO;
+		}
+		reset = YES;
+	}
+
+	_index = mmap(NULL, _indexLength, PROT_READ | PROT_WRITE, MAP_SHARED, _indexFD, 0);
+	if (_index == MAP_FAILED) {
+		_index = NULL;
+		return NO;
+	}
+	_records = (JAHPDiskCacheRecord *)((uint8_t *)_index + sizeof(JAHPDiskCacheIndexHeader));
+
+	JAHPDiskCacheIndexHeader *header = _index;
+	NSData *keyCheck = hmac(_macKey, "index", strlen("index"));
+
+	if (reset ||
+		header->magic != DISK_CACHE_INDEX_MAGIC ||
+		header->version != DISK_CACHE_INDEX_VERSION ||
+		header->records != DISK_CACHE_INDEX_RECORDS ||
+		memcmp(header->keyCheck, [keyCheck bytes], DIGEST_LENGTH) != 0) {
+		[self resetIndex];
+	}
+
+	return YES;
+}
+
+/*! Empties the index, and marks it as written under the current key.
+ */
+
+- (void)resetIndex
+{
+	JAHPDiskCacheIndexHeader *header = _index;
+	NSData *keyCheck = hmac(_macKey, "index", strlen("index"));
+
+	memset(_index, 0, _indexLength);
+	header->magic = DISK_CACHE_INDEX_MAGIC;
+	header->version = DISK_CACHE_INDEX_VERSION;
+	header->records = DISK_CACHE_INDEX_RECORDS;
+	memcpy(header->keyCheck, [keyCheck bytes], DIGEST_LENGTH);
+}
+
+/*! Builds the in-memory lookup tables from the index and deletes any files it doesn't
+ *  reference, e.g. from a store interrupted by the app being killed.
+ */
+
+- (void)loadIndex
+{
+	_slotsByKey = [NSMutableDictionary dictionary];
+	_freeSlots = [NSMutableIndexSet indexSet];
+	_bodyReferences = [NSCountedSet set];
+	_totalSize = 0;
+
+	for (NSUInteger slot = 0; slot < DISK_CACHE_INDEX_RECORDS; slot++) {
+		JAHPDiskCacheRecord *record = &_records[slot];
+		if (!record->inUse) {
+			[_freeSlots addIndex:slot];
+			continue;
+		}
+
+		NSData *body = [NSData dataWithBytes:record->body length:DIGEST_LENGTH];
+		_slotsByKey[[NSData dataWithBytes:record->key length:DIGEST_LENGTH]] = @(slot);
+		if ([_bodyReferences countForObject:body] == 0) {
+			_totalSize += record->bodySize;
+		}
+		[_bodyReferences addObject:body];
+		_totalSize += record->metadataSize;
+	}
+
+	NSMutableSet *referenced = [NSMutableSet set];
+	for (NSData *key in _slotsByKey) {
+		[referenced addObject:hexString([key bytes], DIGEST_LENGTH)];
+	}
+	for (NSData *body in _bodyReferences) {
+		[referenced addObject:hexString([body bytes], DIGEST_LENGTH)];
+	}
+
+	if ([_slotsByKey count] == 0) {
+		/* e.g. the last run's key was only in memory: there could be a lot to delete */
+		[self emptyDirectories];
+		return;
+	}
+
+	NSFileManager *fm = [NSFileManager defaultManager];
+	for (NSString *directory in @[ _entriesDirectory, _bodiesDirectory ]) {
+		for (NSString *name in [fm contentsOfDirectoryAtPath:directory error:nil]) {
+			if (![referenced containsObject:name]) {
+				[fm removeItemAtPath:[directory stringByAppendingPathComponent:name] error:nil];
+			}
+		}
+	}
+}
+
+/*! Throws the entry and body files away, however many there are, in constant time.
+ */
+
+- (void)emptyDirectories
+{
+	NSFileManager *fm = [NSFileManager defaultManager];
+
+	for (NSString *directory in @[ _entriesDirectory, _bodiesDirectory ]) {
+		[JAHPTrash moveItemAtPathToTrash:directory];
+		[fm createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+	}
+	[JAHPTrash empty];
+}
+
+- (void)removeRecordAtSlot:(NSUInteger)slot
+{
+	JAHPDiskCacheRecord *record = &_records[slot];
+	NSData *key = [NSData dataWithBytes:record->key length:DIGEST_LENGTH];
+	NSData *body = [NSData dataWithBytes:record->body length:DIGEST_LENGTH];
+
+	[[NSFileManager defaultManager] removeItemAtPath:[self pathForEntry:key] error:nil];
+	[_slotsByKey removeObjectForKey:key];
+	_totalSize -= record->metadataSize;
+	[self releaseBody:body size:record->bodySize];
+
+	memset(record, 0, sizeof(*record));
+	[_freeSlots addIndex:slot];
+}
+
+- (void)releaseBody:(NSData *)body size:(uint64_t)size
+{
+	[_bodyReferences removeObject:body];
+	if ([_bodyReferences countForObject:body] == 0) {
+		[[NSFileManager defaultManager] removeItemAtPath:[self pathForBody:body] error:nil];
+		_totalSize -= size;
+	}
+}
+
+/*! Evicts least recently used entries until size more bytes and another record fit.
+ */
+
+- (void)evictToFit:(uint64_t)size
+{
+	while ((_totalSize + size > _capacity || [_freeSlots count] == 0) && [_slotsByKey count] > 0) {
+		NSUInteger oldest = NSNotFound;
+		for (NSNumber *slot in [_slotsByKey objectEnumerator]) {
+			NSUInteger i = [slot unsignedIntegerValue];
+			if (oldest == NSNotFound || _records[i].lastUsed < _records[oldest].lastUsed) {
+				oldest = i;
+			}
+		}
+		[self removeRecordAtSlot:oldest];
+	}
+}
+
+#pragma mark - Files
+
+- (NSString *)pathForEntry:(NSData *)key
+{
+	return [_entriesDirectory stringByAppendingPathComponent:hexString([key bytes], DIGEST_LENGTH)];
+}
+
+- (NSString *)pathForBody:(NSData *)body
+{
+	return [_bodiesDirectory stringByAppendingPathComponent:hexString([body bytes], DIGEST_LENGTH)];
+}
+
+/*! Returns the tag records of responses from the site host is in are marked with.
+ */
+
+- (uint32_t)tagForSite:(NSString *)host
+{
+	NSData *site = [[JAHPCookieStore siteOfHost:host] dataUsingEncoding:NSUTF8StringEncoding];
+	uint32_t tag;
+	memcpy(&tag, [hmac(_nameKey, [site bytes], [site length]) bytes], sizeof(tag));
+	return (tag != 0 ? tag : 1);
+}
+
+- (NSData *)keyForRequest:(NSURLRequest *)request
+{
+	NSData *url = [[[request URL] absoluteString] dataUsingEncoding:NSUTF8StringEncoding];
+	return hmac(_nameKey, [url bytes], [url length]);
+}
+
+/*! Encrypts plaintext as IV || AES-256-CTR ciphertext || HMAC-SHA256.
+ *  \details The MAC also covers name, the keyed hash the file is stored under, so that
+ *  files can't be swapped for one another.
+ */
+
+- (NSData *)encryptData:(NSData *)plaintext name:(NSData *)name
+{
+	NSMutableData *sealed = [NSMutableData dataWithLength:IV_LENGTH + [plaintext length] + DIGEST_LENGTH];
+	uint8_t *iv = [sealed mutableBytes];
+
+	if (SecRandomCopyBytes(kSecRandomDefault, IV_LENGTH, iv) != 0 ||
+		![self cryptBytes:[plaintext bytes] length:[plaintext length] into:iv + IV_LENGTH iv:iv operation:kCCEncrypt]) {
+		return nil;
+	}
+
+	[self authenticateBytes:iv length:IV_LENGTH + [plaintext length] name:name into:iv + IV_LENGTH + [plaintext length]];
+	return sealed;
+}
+
+/*! Returns the plaintext of data sealed by -encryptData:name:, or nil if it has been
+ *  damaged or tampered with.
+ */
+
+- (NSData *)decryptData:(NSData *)sealed name:(NSData *)name
+{
+	uint8_t mac[DIGEST_LENGTH];
+
+	if ([sealed length] < IV_LENGTH + DIGEST_LENGTH) {
+		return nil;
+	}
+
+	const uint8_t *iv = [sealed bytes];
+	size_t length = [sealed length] - IV_LENGTH - DIGEST_LENGTH;
+
+	[self authenticateBytes:iv length:IV_LENGTH + length name:name into:mac];
+	if (!equalDigests(mac, iv + IV_LENGTH + length)) {
+		return nil;
+	}
+
+	NSMutableData *plaintext = [NSMutableData dataWithLength:length];
+	if (![self cryptBytes:iv + IV_LENGTH length:length into:[plaintext mutableBytes] iv:iv operation:kCCDecrypt]) {
+		return nil;
+	}
+	return plaintext;
+}
+
+- (BOOL)cryptBytes:(const void *)bytes length:(size_t)length into:(void *)output iv:(const uint8_t *)iv operation:(CCOperation)operation
+{
+	CCCryptorRef cryptor;
+	size_t moved;
+
+	if (CCCryptorCreateWithMode(operation, kCCModeCTR, kCCAlgorithmAES, ccNoPadding, iv, [_encryptionKey bytes], [_encryptionKey length], NULL, 0, 0, kCCModeOptionCTR_BE, &cryptor) != kCCSuccess) {
+		return NO;
+	}
+	CCCryptorStatus status = CCCryptorUpdate(cryptor, bytes, length, output, length, &moved);
+	CCCryptorRelease(cryptor);
+
+	return status == kCCSuccess && moved == length;
+}
+
+- (void)authenticateBytes:(const void *)bytes length:(size_t)length name:(NSData *)name into:(uint8_t *)mac
+{
+	CCHmacContext context;
+
+	CCHmacInit(&context, kCCHmacAlgSHA256, [_macKey bytes], [_macKey length]);
+	CCHmacUpdate(&context, [name bytes], [name length]);
+	CCHmacUpdate(&context, bytes, length);
+	CCHmacFinal(&context, mac);
+}
+
+#pragma mark - Entries
+
++ (BOOL)isCacheableResponse:(NSURLResponse *)response forRequest:(NSURLRequest *)request
+{
+	if (![[request HTTPMethod] isEqualToString:@"GET"] || ![response isKindOfClass:[NSHTTPURLResponse class]]) {
+		return NO;
+	}
+
+	NSString *scheme = [[[request URL] scheme] lowercaseString];
+	if (![scheme isEqualToString:@"http"] && ![scheme isEqualToString:@"https"]) {
+		return NO;
+	}
+
+	if ([[[request valueForHTTPHeaderField:@"Cache-Control"] lowercaseString] containsString:@"no-store"]) {
+		return NO;
+	}
+
+	switch ([(NSHTTPURLResponse *)response statusCode]) {
+		case 200:
+		case 203:
+		case 301:
+		case 404:
+		case 410:
+			break;
+		default:
+			return NO;
+	}
+
+	__block BOOL cacheable = YES;
+	[[(NSHTTPURLResponse *)response allHeaderFields] enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *value, BOOL *stop) {
+		if ([name caseInsensitiveCompare:@"Set-Cookie"] == NSOrderedSame) {
+			/* cookies are the CookieJar's business, and must not come back from disk */
+			cacheable = NO;
+		} else if ([name caseInsensitiveCompare:@"Cache-Control"] == NSOrderedSame) {
+			/* private responses are meant for one user's browser, but this cache outlives their cookies */
+			NSString *directives = [value lowercaseString];
+			if ([directives containsString:@"no-store"] || [directives containsString:@"private"]) {
+				cacheable = NO;
+			}
+		} else if ([name caseInsensitiveCompare:@"Vary"] == NSOrderedSame) {
+			/* we key on the URL alone, which is only right if nothing else can change the body */
+			for (NSString *header in [value componentsSeparatedByString:@","]) {
+				NSString *trimmed = [header stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+				if ([trimmed length] > 0 && [trimmed caseInsensitiveCompare:@"Accept-Encoding"] != NSOrderedSame) {
+					cacheable = NO;
+				}
+			}
+		}
+		*stop = !cacheable;
+	}];
+
+	return cacheable;
+}
+
+- (NSCachedURLResponse *)lookupRequest:(NSURLRequest *)request
+{
+	NSData *key = [self keyForRequest:request];
+	NSNumber *slot = _slotsByKey[key];
+	if (slot == nil) {
+		return nil;
+	}
+
+	JAHPDiskCacheRecord *record = &_records[[slot unsignedIntegerValue]];
+	NSData *body = [NSData dataWithBytes:record->body length:DIGEST_LENGTH];
+
+	NSData *metadata = [self decryptData:[NSData dataWithContentsOfFile:[self pathForEntry:key]] name:key];
+	NSData *data = [self decryptData:[NSData dataWithContentsOfFile:[self pathForBody:body] options:NSDataReadingMappedIfSafe error:nil] name:body];
+
+	NSHTTPURLResponse *response = (metadata != nil && data != nil ? [[self class] responseFromArchive:metadata] : nil);
+
+	if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+		[self removeRecordAtSlot:[slot unsignedIntegerValue]];
+		return nil;
+	}
+
+	record->lastUsed = CFAbsoluteTimeGetCurrent();
+
+	return [[NSCachedURLResponse alloc] initWithResponse:response data:data userInfo:nil storagePolicy:NSURLCacheStorageAllowed];
+}
+
+/*! Decodes the response of an entry with secure coding, allowing nothing but an
+ *  NSHTTPURLResponse, and returns nil if that's not what the archive holds.
+ */
+
++ (NSHTTPURLResponse *)responseFromArchive:(NSData *)archive
+{
+	NSSet *classes = [NSSet setWithObject:[NSHTTPURLResponse class]];
+
+	@try {
+		if (@available(iOS 11, *)) {
+			return [NSKeyedUnarchiver unarchivedObjectOfClasses:classes fromData:archive error:nil];
+		}
+
+		NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:archive];
+		[unarchiver setRequiresSecureCoding:YES];
+		NSHTTPURLResponse *response = [unarchiver decodeObjectOfClasses:classes forKey:NSKeyedArchiveRootObjectKey];
+		[unarchiver finishDecoding];
+		return response;
+	} @catch (NSException *exception) {
+		return nil;
+	}
+}
+
+- (void)storeResponse:(NSCachedURLResponse *)cachedResponse forRequest:(NSURLRequest *)request
+{
+	NSData *data = [cachedResponse data];
+	NSData *key = [self keyForRequest:request];
+	NSData *body = hmac(_nameKey, [data bytes], [data length]);
+	uint64_t bodySize = IV_LENGTH + [data length] + DIGEST_LENGTH;
+
+	/* a revalidated entry has the same body, and only its headers need writing again */
+	BOOL newBody = [_bodyReferences countForObject:body] == 0;
+	if (newBody) {
+		NSData *sealed = [self encryptData:data name:body];
+		if (sealed == nil || ![sealed writeToFile:[self pathForBody:body] atomically:YES]) {
+			return;
+		}
+		_totalSize += bodySize;
+	}
+	[_bodyReferences addObject:body];
+
+	NSNumber *existing = _slotsByKey[key];
+	if (existing != nil) {
+		[self removeRecordAtSlot:[existing unsignedIntegerValue]];
+	}
+
+	NSData *metadata = [self encryptData:[NSKeyedArchiver archivedDataWithRootObject:[cachedResponse response]] name:key];
+	if (metadata == nil) {
+		[self releaseBody:body size:bodySize];
+		return;
+	}
+
+	[self evictToFit:[metadata length]];
+
+	if ([_freeSlots count] == 0 || ![metadata writeToFile:[self pathForEntry:key] atomically:YES]) {
+		[self releaseBody:body size:bodySize];
+		return;
+	}
+
+	NSUInteger slot = [_freeSlots firstIndex];
+	[_freeSlots removeIndex:slot];
+
+	JAHPDiskCacheRecord *record = &_records[slot];
+	memcpy(record->key, [key bytes], DIGEST_LENGTH);
+	memcpy(record->body, [body bytes], DIGEST_LENGTH);
+	record->metadataSize = [metadata length];
+	record->bodySize = bodySize;
+	record->lastUsed = CFAbsoluteTimeGetCurrent();
+	record->inUse = 1;
+	record->site = ([[request URL] host] != nil ? [self tagForSite:[[request URL] host]] : 0);
+
+	_slotsByKey[key] = @(slot);
+	_totalSize += record->metadataSize;
+}
+
+#pragma mark - NSURLCache
+
+- (NSCachedURLResponse *)cachedResponseForRequest:(NSURLRequest *)request
+{
+	__block NSCachedURLResponse *cachedResponse;
+
+	if (![[request HTTPMethod] isEqualToString:@"GET"]) {
+		return nil;
+	}
+
+	dispatch_sync(_queue, ^{
+		cachedResponse = [self lookupRequest:request];
+	});
+	return cachedResponse;
+}
+
+- (void)storeCachedResponse:(NSCachedURLResponse *)cachedResponse forRequest:(NSURLRequest *)request
+{
+	if ([cachedResponse storagePolicy] == NSURLCacheStorageNotAllowed ||
+		[[cachedResponse data] length] > _capacity * DISK_CACHE_MAX_ENTRY_FRACTION ||
+		![[self class] isCacheableResponse:[cachedResponse response] forRequest:request]) {
+		return;
+	}
+
+	dispatch_async(_queue, ^{
+		[self storeResponse:cachedResponse forRequest:request];
+	});
+}
+
+- (void)removeCachedResponseForRequest:(NSURLRequest *)request
+{
+	dispatch_async(_queue, ^{
+		NSNumber *slot = self->_slotsByKey[[self keyForRequest:request]];
+		if (slot != nil) {
+			[self removeRecordAtSlot:[slot unsignedIntegerValue]];
+		}
+	});
+}
+
+- (void)removeAllCachedResponses
+{
+	[self shred];
+}
+
+- (void)shred
+{
+	/* a new key even if the keychain can't store it: the old one mustn't survive */
+	NSData *key = (_keyPersisted ? [[self class] replacePersistedKey] : nil) ?: randomKey();
+
+	dispatch_sync(_queue, ^{
+		if (key != nil) {
+			[self useKey:key];
+		}
+		[self resetIndex];
+		[self loadIndex];
+	});
+}
+
+- (void)removeCachedResponsesForSite:(NSString *)host
+{
+	dispatch_sync(_queue, ^{
+		uint32_t tag = [self tagForSite:host];
+		for (NSNumber *slot in [self->_slotsByKey allValues]) {
+			if (self->_records[[slot unsignedIntegerValue]].site == tag) {
+				[self removeRecordAtSlot:[slot unsignedIntegerValue]];
+			}
+		}
+	});
+}
+
+- (void)removeCachedResponsesExceptForSites:(NSSet<NSString *> *)hosts
+{
+	dispatch_sync(_queue, ^{
+		NSMutableIndexSet *tags = [NSMutableIndexSet indexSet];
+		for (NSString *host in hosts) {
+			[tags addIndex:[self tagForSite:host]];
+		}
+		for (NSNumber *slot in [self->_slotsByKey allValues]) {
+			uint32_t tag = self->_records[[slot unsignedIntegerValue]].site;
+			if (tag == 0 || ![tags containsIndex:tag]) {
+				[self removeRecordAtSlot:[slot unsignedIntegerValue]];
+			}
+		}
+	});
+}
+
+- (void)getCachedResponseForDataTask:(NSURLSessionDataTask *)dataTask completionHandler:(void (^)(NSCachedURLResponse *))completionHandler
+{
+	NSURLRequest *request = [dataTask currentRequest];
+
+	if (![[request HTTPMethod] isEqualToString:@"GET"]) {
+		completionHandler(nil);
+		return;
+	}
+
+	/* decrypting a big body shouldn't hold up the session's delegate queue */
+	dispatch_async(_queue, ^{
+		completionHandler([self lookupRequest:request]);
+	});
+}
+
+- (void)storeCachedResponse:(NSCachedURLResponse *)cachedResponse forDataTask:(NSURLSessionDataTask *)dataTask
+{
+	[self storeCachedResponse:cachedResponse forRequest:[dataTask currentRequest]];
+}
+
+- (void)removeCachedResponseForDataTask:(NSURLSessionDataTask *)dataTask
+{
+	[self removeCachedResponseForRequest:[dataTask currentRequest]];
+}
+
+- (NSUInteger)currentDiskUsage
+{
+	__block uint64_t size;
+
+	dispatch_sync(_queue, ^{
+		size = self->_totalSize;
+	});
+	return (NSUInteger)size;
+}
+
+- (NSUInteger)diskCapacity
+{
+	return _capacity;
+}
+
+- (NSUInteger)currentMemoryUsage
+{
+	return 0;
+}
+
+- (NSUInteger)memoryCapacity
+{
+	return 0;
+}
+
+#pragma mark - Sealing
+
+- (NSData *)keyedHashOfData:(NSData *)data
+{
+	__block NSData *digest;
+
+	dispatch_sync(_queue, ^{
+		digest = hmac(self->_nameKey, [data bytes], [data length]);
+	});
+	return digest;
+}
+
+- (NSData *)sealData:(NSData *)plaintext name:(NSData *)name
+{
+	__block NSData *sealed;
+
+	dispatch_sync(_queue, ^{
+		sealed = [self encryptData:plaintext name:name];
+	});
+	return sealed;
+}
+
+- (NSData *)openData:(NSData *)sealed name:(NSData *)name
+{
+	__block NSData *plaintext;
+
+	dispatch_sync(_queue, ^{
+		plaintext = [self decryptData:sealed name:name];
+	});
+	return plaintext;
+}
+
+@end
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Rewrites an HTML response as it streams through, one chunk at a time.
+ *  \details A small tokenizer finds tags across chunk boundaries without building a DOM.
+ *  It holds back only the tag it's in the middle of. It does these things:
+ *
+ *  - puts the bootstrap script at the start of <head> (or where the parser would open an
+ *    implied head), with a <!DOCTYPE html> in front of the document if it has none, so
+ *    pages stay in standards mode;
+ *  - rewrites the src of <video>, <audio> and their <source> children to go through the
+ *    tunneled-rewrite URL proxy, because media is fetched outside NSURLProtocol.  Static
+ *    markup is covered before the media element can start loading; injected.js still
+ *    handles elements that scripts create later;
+ *  - honors <base href> when making media URLs absolute;
+ *  - in data saver mode, renames the src and srcset of images so that injected.js can
+ *    load them as they come near the viewport, and stops media autoplaying or preloading;
+ *  - asks for markup to put in front of the first element with each class and id, which
+ *    is how generic element hiding filters reach the page.
+ *
+ *  Everything else passes through untouched.  The output is built from subranges of the
+ *  input, so unmodified bytes are never copied.
+ */
+
+@interface JAHPHTMLRewriter : NSObject
+
+/*! \param url The URL of the document, for resolving relative media URLs.
+ *  \param bootstrap The markup to put at the start of the document's head.  It's spliced
+ *  into the output as is, so it can be assembled from shared buffers without copying them.
+ *  \param urlProxyPort The port of the local URL proxy that tunneled-rewrite URLs point at.
+ */
+
+- (nonnull instancetype)initWithDocumentURL:(nullable NSURL *)url bootstrap:(nonnull dispatch_data_t)bootstrap urlProxyPort:(NSInteger)urlProxyPort;
+
+/*! Whether to defer images and stop media autoplaying; see JAHPDataSaver.  Set it before
+ *  the first chunk.
+ */
+
+@property (nonatomic) BOOL dataSaver;
+
+/*! Called with the classes (".name") and ids ("#name") of each start tag that haven't
+ *  been seen earlier in the document.  Whatever it returns is put in front of the tag.
+ *  Set it before the first chunk.
+ */
+
+@property (nonatomic, copy, nullable) NSData * _Nullable (^markupForNewClassesAndIDs)(NSArray<NSString *> * _Nonnull classesAndIDs);
+
+/*! Returns the rewritten form of the next chunk of the document.  This may be shorter than
+ *  data, or empty, if the chunk ends in the middle of a tag.
+ */
+
+- (nonnull NSData *)rewriteData:(nonnull NSData *)data;
+
+/*! Returns anything still held back at the end of the document.
+ */
+
+- (nonnull NSData *)finish;
+
+/*! Returns url as a tunneled-rewrite URL for the URL proxy on port.
+ */
+
++ (nonnull NSString *)urlProxyURLStringForURL:(nonnull NSURL *)url port:(NSInteger)port;
+
+/*! Returns the lowercased name of a complete tag (from '<' to '>'), including a leading '!'
+ *  or '?' for declarations and processing instructions, or nil if it has none.
+ *  \param endTag Set to YES if it's an end tag.
+ */
+
++ (nullable NSString *)nameOfTag:(nonnull NSData *)tag endTag:(nonnull BOOL *)endTag;
+
+/*! Returns the value of an attribute in a complete tag.
+ *  \param range Set to the range of the attribute's value in tag, including any quotes.
+ *  \returns The attribute's value with character references decoded, or nil if the tag
+ *  doesn't have the attribute or it has no value.
+ */
+
++ (nullable NSString *)valueOfAttribute:(nonnull NSString *)attribute inTag:(nonnull NSData *)tag range:(nullable NSRange *)range;
+
+@end
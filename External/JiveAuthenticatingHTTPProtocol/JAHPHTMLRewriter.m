@@ -0,0 +1,717 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPHTMLRewriter.h"
+
+/* a tag longer than this makes us give up on the rest of the document */
+#define MAX_TAG_LENGTH (16 * 1024)
+
+typedef NS_ENUM(NSInteger, JAHPHTMLRewriterState) {
+	JAHPHTMLRewriterStateData,          // text
+	JAHPHTMLRewriterStateTag,           // in a tag, which is held back until it's complete
+	JAHPHTMLRewriterStateComment,       // in <!-- -->
+	JAHPHTMLRewriterStateRawText,       // in <script>, <style> etc., until the matching end tag
+	JAHPHTMLRewriterStateRawTextEnd,    // in the end tag of a raw text element
+	JAHPHTMLRewriterStatePlainText,     // after <plaintext>; nothing more is markup
+};
+
+static dispatch_data_t JAHPHTMLDoctype;
+
+@implementation JAHPHTMLRewriter {
+	NSURL *_baseURL;
+	BOOL _sawBase;
+	dispatch_data_t _bootstrap;
+	NSInteger _urlProxyPort;
+
+	JAHPHTMLRewriterState _state;
+	NSMutableData *_heldTag;            // the start of a tag that began in an earlier chunk
+	NSUInteger _tagLength;
+	char _tagHead[4];                   // the first bytes of the tag, to spot comments
+	char _quote;                        // the quote of the attribute value we're in, or 0
+	BOOL _afterEquals;                  // the last non-space character in the tag was '='
+	NSUInteger _dashes;                 // consecutive '-' in a comment
+	NSUInteger _commentLength;          // bytes of the comment after "<!--"
+	char _rawTextEndTag[16];            // e.g. "</script"
+	NSUInteger _rawTextEndTagLength;
+	NSUInteger _rawTextMatched;
+
+	uint64_t _bytesSeen;
+	BOOL _sawFirstToken;
+	BOOL _injected;
+	BOOL _gaveUp;                       // a tag overflowed; the rest passes through untouched
+	NSInteger _mediaDepth;
+	NSMutableSet<NSString *> *_classesAndIDsSeen;
+
+	// the chunk being rewritten, and the rewritten output so far
+	dispatch_data_t _input;
+	dispatch_data_t _output;
+}
+
++ (void)initialize
+{
+	if (self == [JAHPHTMLRewriter class]) {
+		static const char doctype[] = "<!DOCTYPE html>";
+		JAHPHTMLDoctype = dispatch_data_create(doctype, sizeof(doctype) - 1, NULL, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
+	}
+}
+
+- (instancetype)initWithDocumentURL:(NSURL *)url bootstrap:(dispatch_data_t)bootstrap urlProxyPort:(NSInteger)urlProxyPort
+{
+	self = [super init];
+	if (self != nil) {
+		_baseURL = url;
+		_bootstrap = bootstrap;
+		_urlProxyPort = urlProxyPort;
+		_state = JAHPHTMLRewriterStateData;
+	}
+	return self;
+}
+
+#pragma mark - Output
+
+- (void)emitData:(NSData *)data
+{
+	dispatch_data_t d;
+
+	if ([data length] == 0) {
+		return;
+	}
+	d = dispatch_data_create([data bytes], [data length], NULL, ^{
+		[data self];    // keeps data alive for as long as the output is
+	});
+	_output = dispatch_data_create_concat(_output, d);
+}
+
+- (void)emitInputFrom:(NSUInteger)from to:(NSUInteger)to
+{
+	if (to > from) {
+		_output = dispatch_data_create_concat(_output, dispatch_data_create_subrange(_input, from, to - from));
+	}
+}
+
+- (void)emitDispatchData:(dispatch_data_t)data
+{
+	_output = dispatch_data_create_concat(_output, data);
+}
+
+/*! Called before the first thing in the document that isn't a doctype, comment or whitespace.
+ */
+
+- (void)emitDoctypeIfFirstToken
+{
+	if (!_sawFirstToken) {
+		_sawFirstToken = YES;
+		[self emitDispatchData:JAHPHTMLDoctype];
+	}
+}
+
+- (void)emitBootstrap
+{
+	[self emitDoctypeIfFirstToken];
+	[self emitDispatchData:_bootstrap];
+	_injected = YES;
+}
+
+#pragma mark - Rewriting
+
+- (NSData *)rewriteData:(NSData *)data
+{
+	const uint8_t *bytes = [data bytes];
+	NSUInteger length = [data length];
+	NSUInteger passStart = 0;   // start of the bytes being passed through
+	NSUInteger tagStart = 0;    // start of the current tag's bytes in this chunk
+
+	_input = dispatch_data_create(bytes, length, NULL, ^{
+		[data self];
+	});
+	_output = dispatch_data_empty;
+
+	for (NSUInteger i = 0; i < length; i++) {
+		uint8_t c = bytes[i];
+
+		switch (_state) {
+			case JAHPHTMLRewriterStateData: {
+				const uint8_t *lt = memchr(bytes + i, '<', length - i);
+				NSUInteger end = (lt != NULL) ? (NSUInteger) (lt - bytes) : length;
+
+				if (!_injected) {
+					NSUInteger text = [self firstTextIn:bytes from:i to:end];
+					if (text < end) {
+						[self emitInputFrom:passStart to:text];
+						[self emitBootstrap];
+						passStart = text;
+					}
+				}
+
+				if (lt == NULL) {
+					i = length;
+					break;
+				}
+
+				i = end;
+				[self emitInputFrom:passStart to:i];
+				tagStart = i;
+				_heldTag = nil;
+				_tagLength = 1;
+				_tagHead[0] = '<';
+				_quote = 0;
+				_afterEquals = NO;
+				_state = JAHPHTMLRewriterStateTag;
+				break;
+			}
+
+			case JAHPHTMLRewriterStateTag:
+				if (_tagLength < sizeof(_tagHead)) {
+					_tagHead[_tagLength] = c;
+				}
+				_tagLength++;
+
+				if (_tagLength == 2 && !(isalpha(c) || c == '/' || c == '!' || c == '?')) {
+					// A '<' that doesn't start a tag is just text.
+					if (!_injected) {
+						[self emitBootstrap];
+					}
+					[self emitHeldTagFrom:tagStart to:i];
+					passStart = i;
+					_state = JAHPHTMLRewriterStateData;
+					i--;
+					break;
+				}
+
+				if (_tagLength == 4 && memcmp(_tagHead, "<!--", 4) == 0) {
+					[self emitHeldTagFrom:tagStart to:i + 1];
+					passStart = i + 1;
+					_dashes = 0;
+					_commentLength = 0;
+					_state = JAHPHTMLRewriterStateComment;
+					break;
+				}
+
+				if (_quote != 0) {
+					if (c == _quote) {
+						_quote = 0;
+					}
+				} else if ((c == '"' || c == '\'') && _afterEquals) {
+					_quote = c;
+				} else if (c == '>') {
+					[self endTagFrom:tagStart to:i + 1 bytes:bytes];
+					passStart = i + 1;
+					break;
+				} else if (!isspace(c)) {
+					_afterEquals = (c == '=');
+				}
+
+				if (_tagLength > MAX_TAG_LENGTH) {
+					// Not worth holding on to.  We no longer know where we are (maybe in an
+					// attribute value, maybe in front of a <script>), so nothing after this
+					// can be safely touched: let the rest of the document through as is.
+					[self emitHeldTagFrom:tagStart to:i + 1];
+					passStart = i + 1;
+					_gaveUp = YES;
+					_state = JAHPHTMLRewriterStatePlainText;
+				}
+				break;
+
+			case JAHPHTMLRewriterStateComment:
+				// "-->" ends a comment, and so do "<!-->" and "<!--->".
+				if (c == '>' && (_dashes >= 2 || _commentLength == _dashes)) {
+					_state = JAHPHTMLRewriterStateData;
+				}
+				_dashes = (c == '-') ? _dashes + 1 : 0;
+				_commentLength++;
+				break;
+
+			case JAHPHTMLRewriterStateRawText:
+				if (_rawTextMatched == _rawTextEndTagLength) {
+					// "</script" has to be followed by something that ends the tag name.
+					if (isspace(c) || c == '/' || c == '>') {
+						_state = (c == '>') ? JAHPHTMLRewriterStateData : JAHPHTMLRewriterStateRawTextEnd;
+						break;
+					}
+					_rawTextMatched = 0;
+				}
+				if (tolower(c) == _rawTextEndTag[_rawTextMatched]) {
+					_rawTextMatched++;
+				} else {
+					_rawTextMatched = (c == '<') ? 1 : 0;
+				}
+				break;
+
+			case JAHPHTMLRewriterStateRawTextEnd:
+				if (c == '>') {
+					_state = JAHPHTMLRewriterStateData;
+				}
+				break;
+
+			case JAHPHTMLRewriterStatePlainText:
+				i = length;
+				break;
+		}
+	}
+
+	if (_state == JAHPHTMLRewriterStateTag) {
+		// Hold on to the partial tag until the rest of it arrives.
+		if (_heldTag == nil) {
+			_heldTag = [[NSMutableData alloc] init];
+		}
+		[_heldTag appendBytes:bytes + tagStart length:length - tagStart];
+	} else {
+		[self emitInputFrom:passStart to:length];
+	}
+
+	_bytesSeen += length;
+
+	dispatch_data_t output = _output;
+	_input = nil;
+	_output = nil;
+	return (NSData *) output;
+}
+
+- (NSData *)finish
+{
+	dispatch_data_t output;
+
+	_output = dispatch_data_empty;
+	if (_heldTag != nil) {
+		[self emitData:_heldTag];
+		_heldTag = nil;
+	}
+	if (!_injected && !_gaveUp) {
+		// a document with nothing but whitespace, comments and a doctype still gets our javascript
+		[self emitBootstrap];
+	}
+	_state = JAHPHTMLRewriterStateData;
+
+	output = _output;
+	_output = nil;
+	return (NSData *) output;
+}
+
+/*! Returns the index of the first byte in [from, to) that isn't whitespace (or a byte order
+ *  mark at the start of the document), or to if there isn't one.
+ */
+
+- (NSUInteger)firstTextIn:(const uint8_t *)bytes from:(NSUInteger)from to:(NSUInteger)to
+{
+	for (NSUInteger i = from; i < to; i++) {
+		if (_bytesSeen + i == 0 && to - i >= 3 && memcmp(bytes + i, "\xEF\xBB\xBF", 3) == 0) {
+			i += 2;
+			continue;
+		}
+		if (!isspace(bytes[i])) {
+			return i;
+		}
+	}
+	return to;
+}
+
+/*! Passes the bytes of the current tag through unchanged.
+ */
+
+- (void)emitHeldTagFrom:(NSUInteger)from to:(NSUInteger)to
+{
+	if (_heldTag != nil) {
+		[self emitData:_heldTag];
+		_heldTag = nil;
+	}
+	[self emitInputFrom:from to:to];
+}
+
+/*! Called when a tag is complete.  Decides what goes in front of it and whether it needs
+ *  rewriting, then emits it and moves on to the state that follows it.
+ */
+
+- (void)endTagFrom:(NSUInteger)from to:(NSUInteger)to bytes:(const uint8_t *)bytes
+{
+	NSData *tag;
+	NSData *rewritten;
+	NSString *name;
+	BOOL endTag;
+	BOOL selfClosing;
+
+	if (_heldTag != nil) {
+		[_heldTag appendBytes:bytes + from length:to - from];
+		tag = _heldTag;
+	} else {
+		tag = [NSData dataWithBytesNoCopy:(void *) (bytes + from) length:to - from freeWhenDone:NO];
+	}
+
+	name = [[self class] nameOfTag:tag endTag:&endTag];
+	selfClosing = ([tag length] >= 3 && ((const char *) [tag bytes])[[tag length] - 2] == '/');
+	rewritten = nil;
+
+	_state = JAHPHTMLRewriterStateData;
+
+	if ([name isEqualToString:@"!doctype"]) {
+		_sawFirstToken = YES;
+	} else if ([name hasPrefix:@"!"] || [name hasPrefix:@"?"] || name == nil) {
+		// other markup declarations and processing instructions don't affect anything
+	} else if (!_injected) {
+		if (([name isEqualToString:@"html"] || [name isEqualToString:@"head"]) && !endTag) {
+			[self emitDoctypeIfFirstToken];
+		} else {
+			// The parser would open an implied head here.
+			[self emitBootstrap];
+		}
+	}
+
+	if (!endTag && _injected && _markupForNewClassesAndIDs != nil && name != nil && ![name hasPrefix:@"!"] && ![name hasPrefix:@"?"]) {
+		NSArray<NSString *> *classesAndIDs = [self newClassesAndIDsOfTag:tag];
+		if ([classesAndIDs count] > 0) {
+			[self emitData:_markupForNewClassesAndIDs(classesAndIDs)];
+		}
+	}
+
+	if (!endTag) {
+		if ([name isEqualToString:@"video"] || [name isEqualToString:@"audio"]) {
+			rewritten = [self tagByProxyingSrcOfTag:tag];
+			if (_dataSaver) {
+				rewritten = [self tagByStoppingAutoplay:(rewritten ?: tag) name:name];
+			}
+			if (!selfClosing) {
+				_mediaDepth++;
+			}
+		} else if ([name isEqualToString:@"source"] && _mediaDepth > 0) {
+			rewritten = [self tagByProxyingSrcOfTag:tag];
+		} else if ([name isEqualToString:@"img"] && _dataSaver) {
+			rewritten = [self tagByDeferringImage:tag];
+		} else if ([name isEqualToString:@"base"] && !_sawBase) {
+			NSString *href = [[self class] valueOfAttribute:@"href" inTag:tag range:NULL];
+			if (href != nil) {
+				_sawBase = YES;
+				_baseURL = [NSURL URLWithString:href relativeToURL:_baseURL] ?: _baseURL;
+			}
+		} else if (!selfClosing) {
+			[self enterRawTextIfNeededForTag:name];
+		}
+	} else if (([name isEqualToString:@"video"] || [name isEqualToString:@"audio"]) && _mediaDepth > 0) {
+		_mediaDepth--;
+	}
+
+	if (rewritten != nil) {
+		[self emitData:rewritten];
+	} else if (_heldTag != nil) {
+		[self emitData:_heldTag];
+	} else {
+		[self emitInputFrom:from to:to];
+	}
+	_heldTag = nil;
+
+	if (!_injected && [name isEqualToString:@"head"] && !endTag) {
+		[self emitBootstrap];
+	}
+}
+
+/*! Returns the classes (".name") and ids ("#name") of a start tag that haven't been seen
+ *  before, and remembers them.
+ */
+
+- (NSArray<NSString *> *)newClassesAndIDsOfTag:(NSData *)tag
+{
+	NSMutableArray<NSString *> *candidates = [[NSMutableArray alloc] init];
+	NSMutableArray<NSString *> *classesAndIDs = [[NSMutableArray alloc] init];
+	NSString *classes = [[self class] valueOfAttribute:@"class" inTag:tag range:NULL];
+	NSString *ID = [[self class] valueOfAttribute:@"id" inTag:tag range:NULL];
+
+	for (NSString *name in [classes componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]]) {
+		if ([name length] > 0) {
+			[candidates addObject:[@"." stringByAppendingString:name]];
+		}
+	}
+	if ([ID length] > 0) {
+		[candidates addObject:[@"#" stringByAppendingString:ID]];
+	}
+
+	if (_classesAndIDsSeen == nil && [candidates count] > 0) {
+		_classesAndIDsSeen = [[NSMutableSet alloc] init];
+	}
+	for (NSString *key in candidates) {
+		if (![_classesAndIDsSeen containsObject:key]) {
+			[_classesAndIDsSeen addObject:key];
+			[classesAndIDs addObject:key];
+		}
+	}
+
+	return classesAndIDs;
+}
+
+- (void)enterRawTextIfNeededForTag:(NSString *)name
+{
+	static NSSet *rawTextElements;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		rawTextElements = [NSSet setWithObjects:@"script", @"style", @"textarea", @"title", @"xmp", @"iframe", @"noembed", @"noframes", @"noscript", nil];
+	});
+
+	if ([name isEqualToString:@"plaintext"]) {
+		_state = JAHPHTMLRewriterStatePlainText;
+	} else if ([rawTextElements containsObject:name]) {
+		NSString *endTag = [@"</" stringByAppendingString:name];
+		_rawTextEndTagLength = [endTag length];
+		memcpy(_rawTextEndTag, [endTag UTF8String], _rawTextEndTagLength);
+		_rawTextMatched = 0;
+		_state = JAHPHTMLRewriterStateRawText;
+	}
+}
+
+#pragma mark - Tags and attributes
+
++ (NSString *)nameOfTag:(NSData *)tag endTag:(BOOL *)endTag
+{
+	const uint8_t *bytes = [tag bytes];
+	NSUInteger length = [tag length];
+	NSUInteger start = 1;
+	NSUInteger end;
+
+	*endTag = (length > 1 && bytes[1] == '/');
+	if (*endTag) {
+		start = 2;
+	}
+
+	for (end = start; end < length; end++) {
+		uint8_t c = bytes[end];
+		if (isspace(c) || c == '>' || (c == '/' && end > start)) {
+			break;
+		}
+	}
+	if (end == start) {
+		return nil;
+	}
+
+	return [[[NSString alloc] initWithBytes:bytes + start length:end - start encoding:NSISOLatin1StringEncoding] lowercaseString];
+}
+
+/*! Finds an attribute in a tag.
+ *  \param nameRange Set to the range of the attribute's name in tag.
+ *  \param valueRange Set to the range of the attribute's value in tag, including any quotes,
+ *  or to {NSNotFound, 0} if it has no value.
+ *  \returns YES if the tag has the attribute.
+ */
+
++ (BOOL)findAttribute:(NSString *)attribute inTag:(NSData *)tag nameRange:(NSRange *)nameRange valueRange:(NSRange *)valueRange
+{
+	const uint8_t *bytes = [tag bytes];
+	NSUInteger length = [tag length];
+	const char *want = [attribute UTF8String];
+	size_t wantLength = strlen(want);
+	NSUInteger i = 1;
+
+	// skip the tag name
+	while (i < length && !isspace(bytes[i]) && bytes[i] != '>') {
+		i++;
+	}
+
+	while (i < length) {
+		NSUInteger nameStart, nameEnd, valueStart;
+		BOOL matches;
+
+		while (i < length && (isspace(bytes[i]) || bytes[i] == '/')) {
+			i++;
+		}
+		if (i >= length || bytes[i] == '>') {
+			break;
+		}
+
+		nameStart = i;
+		while (i < length && !isspace(bytes[i]) && bytes[i] != '=' && bytes[i] != '>' && bytes[i] != '/') {
+			i++;
+		}
+		nameEnd = i;
+		matches = (nameEnd - nameStart == wantLength && strncasecmp((const char *) bytes + nameStart, want, wantLength) == 0);
+
+		while (i < length && isspace(bytes[i])) {
+			i++;
+		}
+		if (i >= length || bytes[i] != '=') {
+			// an attribute without a value
+			if (matches) {
+				*nameRange = NSMakeRange(nameStart, nameEnd - nameStart);
+				*valueRange = NSMakeRange(NSNotFound, 0);
+				return YES;
+			}
+			continue;
+		}
+		i++;
+		while (i < length && isspace(bytes[i])) {
+			i++;
+		}
+
+		valueStart = i;
+		if (i < length && (bytes[i] == '"' || bytes[i] == '\'')) {
+			uint8_t q = bytes[i++];
+			while (i < length && bytes[i] != q) {
+				i++;
+			}
+			i++;
+		} else {
+			while (i < length && !isspace(bytes[i]) && bytes[i] != '>') {
+				i++;
+			}
+		}
+
+		if (matches) {
+			*nameRange = NSMakeRange(nameStart, nameEnd - nameStart);
+			*valueRange = NSMakeRange(valueStart, MIN(i, length) - valueStart);
+			return YES;
+		}
+	}
+
+	return NO;
+}
+
++ (NSString *)valueOfAttribute:(NSString *)attribute inTag:(NSData *)tag range:(NSRange *)range
+{
+	const uint8_t *bytes = [tag bytes];
+	NSRange nameRange, valueRange;
+
+	if (![self findAttribute:attribute inTag:tag nameRange:&nameRange valueRange:&valueRange] || valueRange.location == NSNotFound) {
+		return nil;
+	}
+
+	BOOL quoted = (valueRange.length > 0 && (bytes[valueRange.location] == '"' || bytes[valueRange.location] == '\''));
+	NSUInteger innerStart = valueRange.location + (quoted ? 1 : 0);
+	NSUInteger innerEnd = NSMaxRange(valueRange);
+	if (quoted && innerEnd > innerStart && bytes[innerEnd - 1] == bytes[valueRange.location]) {
+		innerEnd--;
+	}
+	NSString *value = [[NSString alloc] initWithBytes:bytes + innerStart length:innerEnd - innerStart encoding:NSUTF8StringEncoding];
+
+	if (range != NULL) {
+		*range = valueRange;
+	}
+	return [self stringByDecodingCharacterReferences:value];
+}
+
+/*! Decodes the character references that turn up in URLs.
+ */
+
++ (NSString *)stringByDecodingCharacterReferences:(NSString *)s
+{
+	if (s == nil || [s rangeOfString:@"&"].location == NSNotFound) {
+		return s;
+	}
+
+	s = [s stringByReplacingOccurrencesOfString:@"&quot;" withString:@"\""];
+	s = [s stringByReplacingOccurrencesOfString:@"&#39;" withString:@"'"];
+	s = [s stringByReplacingOccurrencesOfString:@"&#x27;" withString:@"'"];
+	s = [s stringByReplacingOccurrencesOfString:@"&apos;" withString:@"'"];
+	s = [s stringByReplacingOccurrencesOfString:@"&lt;" withString:@"<"];
+	s = [s stringByReplacingOccurrencesOfString:@"&gt;" withString:@">"];
+	s = [s stringByReplacingOccurrencesOfString:@"&amp;" withString:@"&"];
+	return s;
+}
+
+/*! Returns tag with its src pointed at the URL proxy, or nil if it should be left alone.
+ */
+
+- (NSData *)tagByProxyingSrcOfTag:(NSData *)tag
+{
+	NSRange range;
+	NSString *src = [[self class] valueOfAttribute:@"src" inTag:tag range:&range];
+	NSString *prefix = [NSString stringWithFormat:@"http://127.0.0.1:%ld/tunneled-rewrite/", (long) _urlProxyPort];
+	NSURL *url;
+	NSMutableData *rewritten;
+
+	if (src == nil || [src length] == 0 || [src hasPrefix:@"data:"] || [src hasPrefix:@"blob:"] || [src hasPrefix:prefix]) {
+		return nil;
+	}
+
+	url = [NSURL URLWithString:[src stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] relativeToURL:_baseURL];
+	if (url == nil || [url scheme] == nil) {
+		return nil;
+	}
+
+	rewritten = [[NSMutableData alloc] initWithCapacity:[tag length] + 128];
+	[rewritten appendBytes:[tag bytes] length:range.location];
+	[rewritten appendData:[[NSString stringWithFormat:@"\"%@\"", [[self class] urlProxyURLStringForURL:url port:_urlProxyPort]] dataUsingEncoding:NSUTF8StringEncoding]];
+	[rewritten appendBytes:(const uint8_t *) [tag bytes] + NSMaxRange(range) length:[tag length] - NSMaxRange(range)];
+	return rewritten;
+}
+
+/*! Returns tag with an attribute renamed, or nil if it doesn't have the attribute.
+ */
+
+- (NSData *)tag:(NSData *)tag byRenamingAttribute:(NSString *)attribute to:(NSString *)newName
+{
+	NSRange nameRange, valueRange;
+	NSMutableData *rewritten;
+	const char *replacement = [newName UTF8String];
+
+	if (![[self class] findAttribute:attribute inTag:tag nameRange:&nameRange valueRange:&valueRange]) {
+		return nil;
+	}
+
+	rewritten = [tag mutableCopy];
+	[rewritten replaceBytesInRange:nameRange withBytes:replacement length:strlen(replacement)];
+	return rewritten;
+}
+
+/*! Returns an <img> with its src and srcset renamed, so that it doesn't load until
+ *  injected.js gives them back, or nil if there's nothing to defer.
+ */
+
+- (NSData *)tagByDeferringImage:(NSData *)tag
+{
+	NSString *src = [[self class] valueOfAttribute:@"src" inTag:tag range:NULL];
+	NSData *rewritten = tag;
+	BOOL deferred = NO;
+
+	if ([src hasPrefix:@"data:"]) {
+		// it's already here
+		return nil;
+	}
+
+	for (NSString *attribute in @[ @"srcset", @"src" ]) {
+		NSData *renamed = [self tag:rewritten byRenamingAttribute:attribute to:[@"data-psiphon-" stringByAppendingString:attribute]];
+		if (renamed != nil) {
+			rewritten = renamed;
+			deferred = YES;
+		}
+	}
+
+	return (deferred ? rewritten : nil);
+}
+
+/*! Returns a <video> or <audio> that neither autoplays nor preloads.
+ */
+
+- (NSData *)tagByStoppingAutoplay:(NSData *)tag name:(NSString *)name
+{
+	static const char preload[] = " preload=\"none\"";
+	NSMutableData *rewritten = [([self tag:tag byRenamingAttribute:@"autoplay" to:@"data-psiphon-autoplay"] ?: tag) mutableCopy];
+
+	// The first of repeated attributes wins, so this overrides any preload the tag has.
+	[rewritten replaceBytesInRange:NSMakeRange(1 + [name length], 0) withBytes:preload length:sizeof(preload) - 1];
+	return rewritten;
+}
+
++ (NSString *)urlProxyURLStringForURL:(NSURL *)url port:(NSInteger)port
+{
+	static NSCharacterSet *unreserved;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		// the characters encodeURIComponent() leaves alone, as injected.js uses that
+		unreserved = [NSCharacterSet characterSetWithCharactersInString:@"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_.!~*'()"];
+	});
+
+	NSString *encoded = [[url absoluteString] stringByAddingPercentEncodingWithAllowedCharacters:unreserved];
+	return [NSString stringWithFormat:@"http://127.0.0.1:%ld/tunneled-rewrite/%@?m3u8=true", (long) port, encoded];
+}
+
+@end
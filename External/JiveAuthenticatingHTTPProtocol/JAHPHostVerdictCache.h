@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+@class HSTSCache;
+
+/*! What the request path decided about one host.
+ */
+
+@interface JAHPHostVerdict : NSObject
+
+/*! YES if an HSTS entry upgrades the host's http URLs to https.
+ */
+
+@property (nonatomic, readonly) BOOL upgradesToHTTPS;
+
+/*! The HTTPS Everywhere rulesets that target the host, disabled or not.
+ */
+
+@property (nonatomic, readonly, nonnull) NSArray *HTTPSEverywhereRules;
+
+/*! The rulesets in HTTPSEverywhereRules that aren't disabled, to rewrite its URLs with.
+ */
+
+@property (nonatomic, readonly, nonnull) NSArray *enabledHTTPSEverywhereRules;
+
+/*! The company URLBlocker blocks the host as belonging to, or nil if it isn't blocked.
+ */
+
+@property (nonatomic, readonly, nullable) NSString *blockingTarget;
+
+@end
+
+/*! Caches, per host, the HSTS, HTTPS Everywhere and URL blocker lookups that every request
+ *  makes.
+ *  \details A busy page makes hundreds of requests to a few hosts, and each used to walk
+ *  the host's suffixes in HSTSCache, HTTPSEverywhere's targets and URLBlocker's index in
+ *  turn.  Verdicts are kept for a bounded number of recently used hosts.
+ *
+ *  Every verdict is stamped with a global generation, which HSTSCache, HTTPSEverywhere and
+ *  URLBlocker bump through +invalidate whenever an HSTS entry is added or removed, a rule is
+ *  enabled or disabled, or the block list is reloaded; verdicts from an older generation
+ *  are worked out again.  A verdict that relies on an HSTS entry also lapses when the entry
+ *  expires.
+ *
+ *  Adblock filters match whole URLs and request types, so they aren't part of a verdict.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface JAHPHostVerdictCache : NSObject
+
++ (nonnull instancetype)sharedCache;
+
+/*! \param hstsCache The HSTS entries to decide upgrades with, or nil for the app's.
+ */
+
+- (nonnull instancetype)initWithHSTSCache:(nullable HSTSCache *)hstsCache;
+
+/*! Makes every cache work out its verdicts again.
+ */
+
++ (void)invalidate;
+
+/*! Returns the verdict for host, working it out if it isn't cached.
+ */
+
+- (nullable JAHPHostVerdict *)verdictForHost:(nullable NSString *)host;
+
+/*! Returns +[URLBlocker blockingTargetForURL:fromMainDocumentURL:], remembered in the
+ *  verdict for url's host per main document host.
+ */
+
+- (nullable NSString *)blockingTargetForURL:(nonnull NSURL *)url fromMainDocumentURL:(nullable NSURL *)mainDocumentURL;
+
+@end
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPHostVerdictCache.h"
+
+#import <stdatomic.h>
+
+#import "HSTSCache.h"
+#import "HTTPSEverywhere.h"
+#import "URLBlocker.h"
+
+#define HOST_VERDICT_CACHE_SIZE 256
+
+static atomic_ulong JAHPHostVerdictGeneration;
+
+@interface JAHPHostVerdict () {
+@public
+	unsigned long generation;
+	NSTimeInterval expires;     // since the reference date
+
+	/* main document host (or "") -> URLBlocker's answer for a request to this host */
+	NSMutableDictionary<NSString *, id> *blockingTargetsByDocument;
+}
+
+@property (nonatomic, readwrite) BOOL upgradesToHTTPS;
+@property (nonatomic, readwrite, nonnull) NSArray *HTTPSEverywhereRules;
+@property (nonatomic, readwrite, nonnull) NSArray *enabledHTTPSEverywhereRules;
+@property (nonatomic, readwrite, nullable) NSString *blockingTarget;
+
+@end
+
+@implementation JAHPHostVerdict
+@end
+
+@implementation JAHPHostVerdictCache {
+	HSTSCache *_hstsCache;
+	NSCache *_verdicts;
+}
+
++ (instancetype)sharedCache
+{
+	static JAHPHostVerdictCache *cache;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		cache = [[JAHPHostVerdictCache alloc] initWithHSTSCache:nil];
+	});
+	return cache;
+}
+
+- (instancetype)initWithHSTSCache:(HSTSCache *)hstsCache
+{
+	self = [super init];
+	if (self != nil) {
+		_hstsCache = hstsCache;
+		_verdicts = [[NSCache alloc] init];
+		[_verdicts setCountLimit:HOST_VERDICT_CACHE_SIZE];
+	}
+	return self;
+}
+
++ (void)invalidate
+{
+	atomic_fetch_add(&JAHPHostVerdictGeneration, 1);
+}
+
+- (JAHPHostVerdict *)verdictForHost:(NSString *)host
+{
+	if ([host length] == 0) {
+		return nil;
+	}
+	host = [host lowercaseString];
+
+	/* read before working anything out, so that a change made meanwhile isn't missed */
+	unsigned long generation = atomic_load(&JAHPHostVerdictGeneration);
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+	JAHPHostVerdict *verdict = [_verdicts objectForKey:host];
+	if (verdict != nil && verdict->generation == generation && now < verdict->expires) {
+		return verdict;
+	}
+
+	verdict = [[JAHPHostVerdict alloc] init];
+	verdict->generation = generation;
+	verdict->expires = DBL_MAX;
+
+	NSDate *hstsExpiration = [(_hstsCache ?: [[AppDelegate sharedAppDelegate] hstsCache]) upgradeExpirationForHost:host];
+	if (hstsExpiration != nil) {
+		verdict.upgradesToHTTPS = YES;
+		verdict->expires = [hstsExpiration timeIntervalSinceReferenceDate];
+	}
+
+	NSArray *rules = [HTTPSEverywhere potentiallyApplicableRulesForHost:host] ?: @[];
+	NSMutableArray *enabledRules = [[NSMutableArray alloc] initWithCapacity:[rules count]];
+	for (HTTPSEverywhereRule *rule in rules) {
+		if (![HTTPSEverywhere ruleNameIsDisabled:[rule name]]) {
+			[enabledRules addObject:rule];
+		}
+	}
+	verdict.HTTPSEverywhereRules = rules;
+	verdict.enabledHTTPSEverywhereRules = enabledRules;
+
+	verdict.blockingTarget = [URLBlocker blockingTargetForHost:host];
+
+	[_verdicts setObject:verdict forKey:host];
+	return verdict;
+}
+
+- (NSString *)blockingTargetForURL:(NSURL *)url fromMainDocumentURL:(NSURL *)mainDocumentURL
+{
+	/* most hosts aren't blocked from any page */
+	JAHPHostVerdict *verdict = [self verdictForHost:[url host]];
+	if (verdict.blockingTarget == nil) {
+		return nil;
+	}
+
+	NSString *document = [[mainDocumentURL host] lowercaseString] ?: @"";
+	@synchronized (verdict) {
+		if (verdict->blockingTargetsByDocument == nil) {
+			verdict->blockingTargetsByDocument = [[NSMutableDictionary alloc] init];
+		}
+
+		id company = verdict->blockingTargetsByDocument[document];
+		if (company == nil) {
+			company = [URLBlocker blockingTargetForURL:url fromMainDocumentURL:mainDocumentURL] ?: [NSNull null];
+			verdict->blockingTargetsByDocument[document] = company;
+		}
+		return (company != [NSNull null] ? company : nil);
+	}
+}
+
+@end
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+typedef NS_ENUM(NSInteger, JAHPJavaScriptSetting) {
+	JAHPJavaScriptSettingOn,
+	JAHPJavaScriptSettingFirstPartyOnly,    // only scripts from the page's own site
+	JAHPJavaScriptSettingOff,
+};
+
+/*! Decides which scripts a page may run.
+ *  \details JavaScript is on for all sites unless it's switched off, or limited to the
+ *  site's own scripts, for a single site.  A page's setting covers its frames too, and
+ *  "first-party" means the page's registrable domain, so that a site's scripts from its
+ *  static subdomains keep working.
+ *
+ *  JAHPAuthenticatingHTTPProtocol enforces the setting by adding a policy with only the
+ *  allowed script sources and our injected script's nonce to documents' Content-Security-
+ *  Policy.  Policies in a header are all enforced, so whatever the site's own policy allows,
+ *  ours still holds.
+ *
+ *  Settings are kept in memory as a table from site to setting, with only the sites that
+ *  aren't on, and written through to the user defaults.  All methods can be called on any
+ *  thread.
+ */
+
+@interface JAHPJavaScriptPolicy : NSObject
+
+/*! Returns the setting for the page at url.
+ */
+
++ (JAHPJavaScriptSetting)settingForURL:(nullable NSURL *)url;
+
+/*! Returns the setting for the page at url as it was in a copy of the user defaults,
+ *  such as the one taken when the settings are opened.
+ */
+
++ (JAHPJavaScriptSetting)settingForURL:(nullable NSURL *)url inPreferences:(nonnull NSDictionary *)preferences;
+
+/*! Sets the setting for the site of host.
+ */
+
++ (void)setSetting:(JAHPJavaScriptSetting)setting forHost:(nonnull NSString *)host;
+
+/*! Returns the script sources allowed on the page at url, not counting our injected
+ *  script, or nil if scripts aren't restricted there.
+ *  \returns An empty string if no scripts may run, or a source list such as
+ *  "'self' example.com *.example.com".
+ */
+
++ (nullable NSString *)scriptSourcesForURL:(nullable NSURL *)url;
+
+@end
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPJavaScriptPolicy.h"
+
+#import "JAHPCookieStore.h"
+
+#define kJavaScriptSites @"javaScriptSites"
+
+static JAHPJavaScriptSetting settingForHostInSites(NSString *host, NSDictionary *sites)
+{
+	if (host == nil || [sites count] == 0) {
+		/* the usual case; don't bother working out the site */
+		return JAHPJavaScriptSettingOn;
+	}
+
+	id setting = sites[[JAHPCookieStore siteOfHost:host]];
+	if (![setting isKindOfClass:[NSNumber class]]) {
+		return JAHPJavaScriptSettingOn;
+	}
+
+	switch ([setting integerValue]) {
+		case JAHPJavaScriptSettingFirstPartyOnly:
+			return JAHPJavaScriptSettingFirstPartyOnly;
+		case JAHPJavaScriptSettingOff:
+			return JAHPJavaScriptSettingOff;
+		default:
+			return JAHPJavaScriptSettingOn;
+	}
+}
+
+@interface JAHPJavaScriptPolicy ()
+
+/* the sites that aren't on; never mutated, only replaced, so readers don't need the lock */
+@property (atomic, copy) NSDictionary<NSString *, NSNumber *> *sites;
+
+@end
+
+@implementation JAHPJavaScriptPolicy
+
++ (instancetype)sharedPolicy
+{
+	static JAHPJavaScriptPolicy *policy;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSMutableDictionary *sites = [[NSMutableDictionary alloc] init];
+		[[[NSUserDefaults standardUserDefaults] dictionaryForKey:kJavaScriptSites] enumerateKeysAndObjectsUsingBlock:^(id site, id setting, BOOL *stop) {
+			if ([site isKindOfClass:[NSString class]] && [setting isKindOfClass:[NSNumber class]]) {
+				sites[site] = setting;
+			}
+		}];
+
+		policy = [[JAHPJavaScriptPolicy alloc] init];
+		policy.sites = sites;
+	});
+	return policy;
+}
+
++ (JAHPJavaScriptSetting)settingForURL:(NSURL *)url
+{
+	return settingForHostInSites([url host], [[self sharedPolicy] sites]);
+}
+
++ (JAHPJavaScriptSetting)settingForURL:(NSURL *)url inPreferences:(NSDictionary *)preferences
+{
+	NSDictionary *sites = preferences[kJavaScriptSites];
+	return settingForHostInSites([url host], ([sites isKindOfClass:[NSDictionary class]] ? sites : nil));
+}
+
++ (void)setSetting:(JAHPJavaScriptSetting)setting forHost:(NSString *)host
+{
+	NSString *site = [JAHPCookieStore siteOfHost:host];
+	JAHPJavaScriptPolicy *policy = [self sharedPolicy];
+
+	/* only writers take the lock, so two of them can't lose each other's change */
+	@synchronized (policy) {
+		NSMutableDictionary *sites = [[policy sites] mutableCopy];
+		sites[site] = (setting == JAHPJavaScriptSettingOn ? nil : @(setting));
+		policy.sites = sites;
+		[[NSUserDefaults standardUserDefaults] setObject:sites forKey:kJavaScriptSites];
+	}
+}
+
++ (NSString *)scriptSourcesForURL:(NSURL *)url
+{
+	switch ([self settingForURL:url]) {
+		case JAHPJavaScriptSettingOn:
+			return nil;
+		case JAHPJavaScriptSettingOff:
+			return @"";
+		case JAHPJavaScriptSettingFirstPartyOnly:
+			break;
+	}
+
+	NSString *site = [JAHPCookieStore siteOfHost:[url host]];
+	if ([site rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@":[]"]].location != NSNotFound) {
+		/* IPv6 literals can't be host sources */
+		return @"'self'";
+	}
+	return [NSString stringWithFormat:@"'self' %@ *.%@", site, site];
+}
+
+@end
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Tracks how long each host takes to start responding through the tunnel.
+ *  \details JAHPAuthenticatingHTTPProtocol records the time to first response of every
+ *  completed task here.  The samples drive adaptive timeouts, so that a request stuck on
+ *  a bad tunnel path fails instead of hanging the page, and decide when an idempotent
+ *  request has been waiting long enough that a hedged duplicate is worth sending.
+ *
+ *  Hedging is limited by a global budget so that it can't amplify load on a struggling
+ *  tunnel: hedges earn credit as a small fraction of normal requests, and only a few may
+ *  be in flight at once.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface JAHPLatencyTracker : NSObject
+
++ (nonnull instancetype)sharedTracker;
+
+/*! Records the time a request to host took to start responding.
+ */
+
+- (void)recordLatency:(NSTimeInterval)latency forHost:(nullable NSString *)host;
+
+/*! Returns the timeout to use for a request to host.
+ *  \details This is a multiple of the host's high-percentile latency, clamped to a sane
+ *  range, or the requested timeout if that is shorter or nothing is known about the host.
+ *  \param timeout The timeout the request was created with.
+ */
+
+- (NSTimeInterval)timeoutIntervalForHost:(nullable NSString *)host requestedTimeout:(NSTimeInterval)timeout;
+
+/*! Returns how long to wait for a response from host before sending a hedged request,
+ *  or 0 if too little is known about the host to hedge.
+ */
+
+- (NSTimeInterval)hedgeDelayForHost:(nullable NSString *)host;
+
+/*! Takes one hedge from the global budget.
+ *  \returns YES if a hedged request may be sent; it must later be returned with -endHedge.
+ */
+
+- (BOOL)beginHedge;
+
+/*! Returns a hedge taken with -beginHedge.
+ */
+
+- (void)endHedge;
+
+@end
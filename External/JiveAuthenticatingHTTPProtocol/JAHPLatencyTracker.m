@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPLatencyTracker.h"
+
+#define LATENCY_SAMPLES_PER_HOST 32
+#define LATENCY_TRACKED_HOSTS 256
+
+/* need this many samples before we trust the percentiles */
+#define LATENCY_MIN_SAMPLES 8
+
+/* hedge once a request has waited longer than this percentile of the host's latencies */
+#define HEDGE_PERCENTILE 0.95
+
+/* adaptive timeouts are this multiple of the hedge percentile, within these bounds */
+#define TIMEOUT_LATENCY_MULTIPLIER 8
+#define TIMEOUT_MIN_SECONDS 15
+#define TIMEOUT_MAX_SECONDS 120
+
+/* hedges earn this much credit per completed request, up to HEDGE_MAX_CREDIT */
+#define HEDGE_CREDIT_PER_REQUEST 0.05
+#define HEDGE_MAX_CREDIT 5.0
+#define HEDGE_MAX_IN_FLIGHT 4
+
+/*! A ring buffer of the most recent latencies for one host.
+ */
+
+@interface JAHPHostLatencySamples : NSObject {
+@public
+	NSTimeInterval samples[LATENCY_SAMPLES_PER_HOST];
+	NSUInteger count;
+	NSUInteger next;
+}
+@end
+
+@implementation JAHPHostLatencySamples
+@end
+
+static int compareLatencies(const void *a, const void *b)
+{
+	NSTimeInterval x = *(const NSTimeInterval *)a;
+	NSTimeInterval y = *(const NSTimeInterval *)b;
+	return (x > y) - (x < y);
+}
+
+@implementation JAHPLatencyTracker {
+	NSCache *_samplesByHost;
+	double _hedgeCredit;
+	NSUInteger _hedgesInFlight;
+}
+
++ (instancetype)sharedTracker
+{
+	static JAHPLatencyTracker *tracker;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		tracker = [[JAHPLatencyTracker alloc] init];
+	});
+	return tracker;
+}
+
+- (instancetype)init
+{
+	self = [super init];
+	if (self != nil) {
+		_samplesByHost = [[NSCache alloc] init];
+		[_samplesByHost setCountLimit:LATENCY_TRACKED_HOSTS];
+	}
+	return self;
+}
+
+- (void)recordLatency:(NSTimeInterval)latency forHost:(NSString *)host
+{
+	if (host == nil || latency < 0) {
+		return;
+	}
+	host = [host lowercaseString];
+
+	@synchronized (self) {
+		JAHPHostLatencySamples *s = [_samplesByHost objectForKey:host];
+		if (s == nil) {
+			s = [[JAHPHostLatencySamples alloc] init];
+			[_samplesByHost setObject:s forKey:host];
+		}
+
+		s->samples[s->next] = latency;
+		s->next = (s->next + 1) % LATENCY_SAMPLES_PER_HOST;
+		if (s->count < LATENCY_SAMPLES_PER_HOST) {
+			s->count++;
+		}
+
+		_hedgeCredit = MIN(_hedgeCredit + HEDGE_CREDIT_PER_REQUEST, HEDGE_MAX_CREDIT);
+	}
+}
+
+/*! Returns the given percentile of the host's latencies, or 0 if there are too few samples.
+ */
+
+- (NSTimeInterval)latencyPercentile:(double)percentile forHost:(NSString *)host
+{
+	NSTimeInterval sorted[LATENCY_SAMPLES_PER_HOST];
+	NSUInteger count;
+
+	if (host == nil) {
+		return 0;
+	}
+
+	@synchronized (self) {
+		JAHPHostLatencySamples *s = [_samplesByHost objectForKey:[host lowercaseString]];
+		if (s == nil || s->count < LATENCY_MIN_SAMPLES) {
+			return 0;
+		}
+		count = s->count;
+		memcpy(sorted, s->samples, sizeof(NSTimeInterval) * count);
+	}
+
+	qsort(sorted, count, sizeof(NSTimeInterval), compareLatencies);
+
+	NSUInteger i = (NSUInteger)(percentile * (count - 1) + 0.5);
+	return sorted[MIN(i, count - 1)];
+}
+
+- (NSTimeInterval)timeoutIntervalForHost:(NSString *)host requestedTimeout:(NSTimeInterval)timeout
+{
+	NSTimeInterval latency = [self latencyPercentile:HEDGE_PERCENTILE forHost:host];
+	if (latency <= 0) {
+		/* nothing known about this host, but never wait forever */
+		return MIN(timeout, TIMEOUT_MAX_SECONDS);
+	}
+
+	NSTimeInterval adaptive = MAX(MIN(latency * TIMEOUT_LATENCY_MULTIPLIER, TIMEOUT_MAX_SECONDS), TIMEOUT_MIN_SECONDS);
+	return MIN(timeout, adaptive);
+}
+
+- (NSTimeInterval)hedgeDelayForHost:(NSString *)host
+{
+	return [self latencyPercentile:HEDGE_PERCENTILE forHost:host];
+}
+
+- (BOOL)beginHedge
+{
+	@synchronized (self) {
+		if (_hedgeCredit < 1.0 || _hedgesInFlight >= HEDGE_MAX_IN_FLIGHT) {
+			return NO;
+		}
+		_hedgeCredit -= 1.0;
+		_hedgesInFlight++;
+		return YES;
+	}
+}
+
+- (void)endHedge
+{
+	@synchronized (self) {
+		assert(_hedgesInFlight > 0);
+		if (_hedgesInFlight > 0) {
+			_hedgesInFlight--;
+		}
+	}
+}
+
+@end
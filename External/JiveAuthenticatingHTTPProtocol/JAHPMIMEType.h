@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Classifies responses by MIME type, and sniffs the types of their bodies.
+ *  \details Content types are looked up by their essence ("type/subtype", without
+ *  parameters) in a table built once, falling back to an entry for the whole top-level
+ *  type, e.g. "image/".  The results are the CONTENT_TYPE_* values from
+ *  JAHPAuthenticatingHTTPProtocol.h.
+ *
+ *  Sniffing looks at the first bytes of a body for the signatures of the file formats we
+ *  can preview, so that files served with a missing or wrong Content-Type still go down
+ *  the download path, and binary data without a Content-Type is never treated as HTML.
+ */
+
+@interface JAHPMIMEType : NSObject
+
+/*! Returns the lowercased essence of a Content-Type header value, or nil if it has none.
+ */
+
++ (nullable NSString *)essenceOfContentType:(nullable NSString *)contentType;
+
+/*! Returns CONTENT_TYPE_HTML, CONTENT_TYPE_FILE or CONTENT_TYPE_OTHER for a Content-Type
+ *  header value.
+ */
+
++ (NSUInteger)classifyContentType:(nullable NSString *)contentType;
+
+/*! Returns the MIME type of the file format data starts with, or nil if it isn't one
+ *  we recognize.
+ *  \param data The start of a body; the first 512 bytes are plenty.
+ */
+
++ (nullable NSString *)sniffMIMETypeOfData:(nonnull NSData *)data;
+
+/*! Returns YES if data contains bytes that never appear in text, as in
+ *  https://mimesniff.spec.whatwg.org/#binary-data-byte.
+ */
+
++ (BOOL)isBinaryData:(nonnull NSData *)data;
+
+/*! Returns the usual file extension for a MIME type returned by +sniffMIMETypeOfData:.
+ */
+
++ (nullable NSString *)fileExtensionForMIMEType:(nonnull NSString *)mimeType;
+
+@end
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPMIMEType.h"
+#import "JAHPAuthenticatingHTTPProtocol.h"
+
+/* sniffing only looks this far into a body */
+#define SNIFF_LENGTH 512
+
+/*! A file format's signature: pattern at offset, with mask applied to the data first
+ *  (0xFF where every bit matters).
+ */
+
+typedef struct {
+	size_t offset;
+	size_t length;
+	const char *pattern;
+	const char *mask;
+	__unsafe_unretained NSString *mimeType;
+	__unsafe_unretained NSString *extension;
+} JAHPFileSignature;
+
+static const JAHPFileSignature JAHPFileSignatures[] = {
+	{ 0, 5, "%PDF-", NULL, @"application/pdf", @"pdf" },
+	{ 0, 4, "PK\x03\x04", NULL, @"application/zip", @"zip" },
+	{ 0, 3, "\x1F\x8B\x08", NULL, @"application/x-gzip", @"gz" },
+	{ 0, 6, "\xFD" "7zXZ\x00", NULL, @"application/x-xz", @"xz" },
+	{ 0, 8, "\x89PNG\r\n\x1A\n", NULL, @"image/png", @"png" },
+	{ 0, 6, "GIF87a", NULL, @"image/gif", @"gif" },
+	{ 0, 6, "GIF89a", NULL, @"image/gif", @"gif" },
+	{ 0, 3, "\xFF\xD8\xFF", NULL, @"image/jpeg", @"jpg" },
+	{ 0, 12, "RIFF\0\0\0\0WEBP", "\xFF\xFF\xFF\xFF\0\0\0\0\xFF\xFF\xFF\xFF", @"image/webp", @"webp" },
+	{ 0, 3, "ID3", NULL, @"audio/mpeg", @"mp3" },
+	{ 0, 2, "\xFF\xFB", NULL, @"audio/mpeg", @"mp3" },
+	{ 0, 5, "OggS\0", NULL, @"video/ogg", @"ogg" },
+	{ 0, 4, "\x1A\x45\xDF\xA3", NULL, @"video/webm", @"webm" },
+	{ 0, 4, "FLV\x01", NULL, @"video/x-flv", @"flv" },
+	{ 4, 4, "ftyp", NULL, @"video/mp4", @"mp4" },
+};
+
+@implementation JAHPMIMEType
+
++ (NSString *)essenceOfContentType:(NSString *)contentType
+{
+	NSRange semicolon;
+
+	if (contentType == nil) {
+		return nil;
+	}
+
+	semicolon = [contentType rangeOfString:@";"];
+	if (semicolon.location != NSNotFound) {
+		contentType = [contentType substringToIndex:semicolon.location];
+	}
+	contentType = [[contentType stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+
+	return ([contentType length] > 0) ? contentType : nil;
+}
+
++ (NSUInteger)classifyContentType:(NSString *)contentType
+{
+	static NSDictionary<NSString *, NSNumber *> *classByType;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSNumber *html = @(CONTENT_TYPE_HTML);
+		NSNumber *file = @(CONTENT_TYPE_FILE);
+
+		// TODO: keep adding new content types as needed
+		classByType = @{
+						@"text/html": html,
+						@"application/html": html,
+						@"application/xhtml+xml": html,
+
+						// file types we can present
+						@"application/x-apple-diskimage": file,
+						@"application/binary": file,
+						@"application/octet-stream": file,
+						@"application/pdf": file,
+						@"application/x-gzip": file,
+						@"application/x-xz": file,
+						@"application/zip": file,
+						@"audio/": file,
+						@"image/": file,
+						@"video/": file,
+						};
+	});
+
+	NSString *essence = [self essenceOfContentType:contentType];
+	NSNumber *classification;
+	NSRange slash;
+
+	if (essence == nil) {
+		return CONTENT_TYPE_OTHER;
+	}
+
+	classification = classByType[essence];
+	if (classification == nil) {
+		slash = [essence rangeOfString:@"/"];
+		if (slash.location != NSNotFound) {
+			classification = classByType[[essence substringToIndex:slash.location + 1]];
+		}
+	}
+
+	return (classification != nil) ? [classification unsignedIntegerValue] : CONTENT_TYPE_OTHER;
+}
+
+static const JAHPFileSignature *JAHPSniffFileSignature(NSData *data)
+{
+	const uint8_t *bytes = [data bytes];
+	size_t length = MIN([data length], (NSUInteger) SNIFF_LENGTH);
+
+	for (size_t i = 0; i < sizeof(JAHPFileSignatures) / sizeof(JAHPFileSignatures[0]); i++) {
+		const JAHPFileSignature *signature = &JAHPFileSignatures[i];
+		size_t j;
+
+		if (signature->offset + signature->length > length) {
+			continue;
+		}
+		for (j = 0; j < signature->length; j++) {
+			uint8_t mask = (signature->mask != NULL) ? (uint8_t) signature->mask[j] : 0xFF;
+			if ((bytes[signature->offset + j] & mask) != ((uint8_t) signature->pattern[j] & mask)) {
+				break;
+			}
+		}
+		if (j == signature->length) {
+			return signature;
+		}
+	}
+
+	return NULL;
+}
+
++ (NSString *)sniffMIMETypeOfData:(NSData *)data
+{
+	const JAHPFileSignature *signature = JAHPSniffFileSignature(data);
+	return (signature != NULL) ? signature->mimeType : nil;
+}
+
++ (BOOL)isBinaryData:(NSData *)data
+{
+	const uint8_t *bytes = [data bytes];
+	size_t length = MIN([data length], (NSUInteger) SNIFF_LENGTH);
+
+	for (size_t i = 0; i < length; i++) {
+		uint8_t c = bytes[i];
+		if (c <= 0x08 || c == 0x0B || (c >= 0x0E && c <= 0x1A) || (c >= 0x1C && c <= 0x1F)) {
+			return YES;
+		}
+	}
+
+	return NO;
+}
+
++ (NSString *)fileExtensionForMIMEType:(NSString *)mimeType
+{
+	for (size_t i = 0; i < sizeof(JAHPFileSignatures) / sizeof(JAHPFileSignatures[0]); i++) {
+		if ([JAHPFileSignatures[i].mimeType isEqualToString:mimeType]) {
+			return JAHPFileSignatures[i].extension;
+		}
+	}
+
+	return nil;
+}
+
+@end
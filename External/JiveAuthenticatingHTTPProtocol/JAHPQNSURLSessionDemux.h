@@ -68,6 +68,20 @@
 @property (atomic, copy,   readonly ) NSURLSessionConfiguration *   configuration;  ///< A copy of the configuration passed to -initWithConfiguration:.
 @property (atomic, strong, readonly ) NSURLSession *                session;        ///< The session created from the configuration passed to -initWithConfiguration:.
 
+/*! The most data passed to a delegate in one -URLSession:dataTask:didReceiveData: callback.
+ *  \details Data that arrives while earlier data for the same delegate is still waiting for
+ *  its thread is merged into one callback, up to this many bytes.  The default is 256KB.
+ */
+
+@property (atomic, assign, readwrite) NSUInteger                    maxDataBatchLength;
+
+/*! How long received data may be held back so that following data can be merged with it.
+ *  \details The default is 0, which passes data on as soon as it arrives and only merges
+ *  data that arrives while the delegate's thread is busy.
+ */
+
+@property (atomic, assign, readwrite) NSTimeInterval                maxDataBatchDelay;
+
 /*! Creates a new data task whose delegate callbacks are routed to the supplied delegate.
  *  \details The callbacks are run on the current thread (that is, the thread that called this
  *  method) in the specified modes.
@@ -88,4 +102,43 @@
 
 - (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request delegate:(id<NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>)delegate modes:(NSArray *)modes;
 
+/*! Like -dataTaskWithRequest:delegate:modes: but coalesces identical cacheable GET requests.
+ *  \details If an identical request (same URL and all the same headers) is already in
+ *  flight, the delegate is attached to that task instead of a new one being created.  Its
+ *  delegate callbacks are then fanned out to every attached delegate.  A delegate that
+ *  joins after the response has started arriving is first replayed the response and all
+ *  of the data received so far.
+ *
+ *  Only the first attached delegate is asked to resolve challenges, provide body streams
+ *  and decide on caching; the others see a response disposition handler that does nothing.
+ *
+ *  Requests that can't be coalesced are passed through to -dataTaskWithRequest:delegate:modes:.
+ *  Tasks returned by this method must be cancelled with -cancelDataTask:delegate:.
+ *
+ *  \param request The request that the data task executes; must not be nil.
+ *  \param delegate The delegate to receive the data task's delegate callbacks; must not be nil.
+ *  \param modes The run loop modes in which to run the data task's delegate callbacks.
+ *  \returns A data task that you must resume; it may already be running.
+ */
+
+- (NSURLSessionDataTask *)coalescedDataTaskWithRequest:(NSURLRequest *)request delegate:(id<NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>)delegate modes:(NSArray *)modes;
+
+/*! Detaches the delegate from the task, cancelling the task if no other delegate is attached to it.
+ *  \details The detached delegate receives -URLSession:task:didCompleteWithError: with
+ *  NSURLErrorCancelled, just as if the task itself had been cancelled.  Must be called
+ *  on the thread that created the task.
+ *  \param task The task to cancel; must not be nil.
+ *  \param delegate The delegate that was passed in when the task was created.
+ */
+
+- (void)cancelDataTask:(NSURLSessionTask *)task delegate:(id<NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>)delegate;
+
+/*! Invalidates the session once the tasks already running in it have finished.
+ *  \details Callbacks for those tasks continue to be delivered as normal, so a demux being
+ *  replaced by one with a new configuration can drain its in-flight loads instead of
+ *  failing them.  No new tasks may be created after this is called.
+ */
+
+- (void)finishTasksAndInvalidate;
+
 @end
@@ -58,6 +58,9 @@
 
 - (void)performBlock:(dispatch_block_t)block;
 
+- (void)enqueueReceivedData:(NSData *)data session:(NSURLSession *)session maxBatchLength:(NSUInteger)maxBatchLength maxBatchDelay:(NSTimeInterval)maxBatchDelay;
+- (void)flushReceivedData;
+
 - (void)invalidate;
 
 @end
@@ -69,7 +72,14 @@
 
 @end
 
-@implementation JAHPQNSURLSessionDemuxTaskInfo
+@implementation JAHPQNSURLSessionDemuxTaskInfo {
+	// Received data waiting for the client thread.  Protected by @synchronized (self).
+	dispatch_data_t     _pendingData;
+	NSURLSession *      _pendingSession;
+	NSUInteger          _pendingMaxBatchLength;
+	BOOL                _deliveryQueued;        // a delivery has been performed on the client thread
+	BOOL                _deliveryDelayed;       // a delivery will be performed once maxBatchDelay passes
+}
 
 - (instancetype)initWithTask:(NSURLSessionDataTask *)task delegate:(id<NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>)delegate modes:(NSArray *)modes
 {
@@ -100,6 +110,113 @@
 	block();
 }
 
+/*! Queues data for the delegate's -URLSession:dataTask:didReceiveData:.
+ *  \details Data that arrives while an earlier delivery is still waiting for the client
+ *  thread is merged into it, so a busy client thread gets fewer, larger callbacks.  The
+ *  data isn't copied; batches are built with dispatch_data.
+ *  \param maxBatchLength The largest batch to pass to the delegate in one callback.
+ *  \param maxBatchDelay How long to hold the first chunk of a batch back in the hope of
+ *  merging more into it; 0 queues it immediately.
+ */
+
+- (void)enqueueReceivedData:(NSData *)data session:(NSURLSession *)session maxBatchLength:(NSUInteger)maxBatchLength maxBatchDelay:(NSTimeInterval)maxBatchDelay
+{
+	dispatch_data_t chunk;
+	BOOL            deliverNow;
+	BOOL            deliverLater;
+
+	assert(data != nil);
+
+	chunk = dispatch_data_create([data bytes], [data length], NULL, ^{
+		[data self];    // keeps data alive for as long as the chunk is
+	});
+
+	deliverNow = NO;
+	deliverLater = NO;
+
+	@synchronized (self) {
+		self->_pendingData = (self->_pendingData == nil) ? chunk : dispatch_data_create_concat(self->_pendingData, chunk);
+		self->_pendingSession = session;
+		self->_pendingMaxBatchLength = maxBatchLength;
+
+		if (self->_deliveryQueued) {
+			// The queued delivery will pick this up.
+		} else if (maxBatchDelay > 0 && dispatch_data_get_size(self->_pendingData) < maxBatchLength) {
+			deliverLater = !self->_deliveryDelayed;
+			self->_deliveryDelayed = YES;
+		} else {
+			self->_deliveryDelayed = NO;
+			self->_deliveryQueued = YES;
+			deliverNow = YES;
+		}
+	}
+
+	if (deliverNow && self.delegate != nil) {
+		[self performBlock:^{
+			[self deliverReceivedData];
+		}];
+	}
+	if (deliverLater) {
+		dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (maxBatchDelay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+			[self flushReceivedData];
+		});
+	}
+}
+
+/*! Queues any data held back by maxBatchDelay.  Called before queueing any callback that
+ *  must not overtake it, such as -URLSession:task:didCompleteWithError:.
+ */
+
+- (void)flushReceivedData
+{
+	BOOL    deliver;
+
+	@synchronized (self) {
+		deliver = self->_deliveryDelayed;
+		if (deliver) {
+			self->_deliveryDelayed = NO;
+			self->_deliveryQueued = YES;
+		}
+	}
+
+	if (deliver && self.delegate != nil) {
+		[self performBlock:^{
+			[self deliverReceivedData];
+		}];
+	}
+}
+
+- (void)deliverReceivedData
+{
+	dispatch_data_t pendingData;
+	NSURLSession *  session;
+	size_t          size;
+	size_t          batchLength;
+
+	@synchronized (self) {
+		pendingData = self->_pendingData;
+		session = self->_pendingSession;
+		batchLength = self->_pendingMaxBatchLength;
+		self->_pendingData = nil;
+		self->_deliveryQueued = NO;
+	}
+
+	size = (pendingData != nil) ? dispatch_data_get_size(pendingData) : 0;
+	if (batchLength == 0) {
+		batchLength = size;
+	}
+
+	for (size_t offset = 0; offset < size; offset += batchLength) {
+		dispatch_data_t batch = dispatch_data_create_subrange(pendingData, offset, MIN(batchLength, size - offset));
+
+		// The delegate may have been detached by an earlier batch.
+		if (![self.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveData:)]) {
+			break;
+		}
+		[self.delegate URLSession:session dataTask:self.task didReceiveData:(NSData *) batch];
+	}
+}
+
 - (void)invalidate
 {
 	self.delegate = nil;
@@ -108,13 +225,109 @@
 
 @end
 
+/*! The maximum number of response bytes buffered for replay to delegates that join a
+ *  coalesced request mid-stream.  Once a response grows past this it stops accepting joiners.
+ */
+
+static const NSUInteger kJAHPCoalescingMaxReplayLength = 1024 * 1024;
+
+/*! Request headers that servers commonly Vary on.  Responses that Vary on anything else
+ *  stop accepting joiners.
+ */
+
+static NSArray<NSString *> *JAHPCoalescingVaryHeaders(void)
+{
+	static NSArray<NSString *> *headers;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		headers = @[ @"accept", @"accept-encoding", @"accept-language", @"authorization", @"cookie", @"origin", @"user-agent" ];
+	});
+	return headers;
+}
+
+/*! An upstream task shared by several delegates that issued the same request.
+ */
+
+@interface JAHPQNSURLSessionDemuxCoalescedFetch : NSObject
+
+- (instancetype)initWithKey:(NSString *)key task:(NSURLSessionDataTask *)task;
+
+@property (atomic, copy,   readonly ) NSString *                    key;
+@property (atomic, strong, readonly ) NSURLSessionDataTask *        task;
+@property (atomic, strong, readonly ) NSMutableArray *              taskInfos;          // attached delegates; the first one is the primary
+@property (atomic, strong, readwrite) NSURLResponse *               response;           // for replay to late joiners
+@property (atomic, strong, readonly ) NSMutableArray *              receivedData;       // for replay to late joiners
+@property (atomic, assign, readwrite) NSUInteger                    receivedLength;
+@property (atomic, assign, readwrite) BOOL                          acceptsJoiners;
+
+- (void)appendReceivedData:(NSData *)data;
+
+@end
+
+@implementation JAHPQNSURLSessionDemuxCoalescedFetch
+
+- (instancetype)initWithKey:(NSString *)key task:(NSURLSessionDataTask *)task
+{
+	assert(key != nil);
+	assert(task != nil);
+
+	self = [super init];
+	if (self != nil) {
+		self->_key = [key copy];
+		self->_task = task;
+		self->_taskInfos = [[NSMutableArray alloc] initWithCapacity:2];
+		self->_receivedData = [[NSMutableArray alloc] init];
+		self->_acceptsJoiners = YES;
+	}
+	return self;
+}
+
+- (void)appendReceivedData:(NSData *)data
+{
+	if (!self.acceptsJoiners) {
+		return;
+	}
+	self.receivedLength += [data length];
+	if (self.receivedLength > kJAHPCoalescingMaxReplayLength) {
+		// Too big to replay; let late requests fetch it themselves.
+		self.acceptsJoiners = NO;
+		[self.receivedData removeAllObjects];
+	} else {
+		[self.receivedData addObject:data];
+	}
+}
+
+@end
+
 @interface JAHPQNSURLSessionDemux () <NSURLSessionDataDelegate>
 
-@property (atomic, strong, readonly ) NSMutableDictionary * taskInfoByTaskID;       // keys NSURLSessionTask taskIdentifier, values are SessionManager
+// The task tables are read on every delegate callback but only change when tasks start and
+// finish, so they're immutable snapshots that are replaced, under @synchronized (self), rather
+// than mutated.  Readers just load the current snapshot without taking the lock.
+
+@property (atomic, strong, readwrite) NSDictionary *        taskInfoByTaskID;       // keys NSURLSessionTask taskIdentifier, values are SessionManager
+@property (atomic, strong, readonly ) NSMutableDictionary * coalescedFetchByKey;    // keys are coalescing keys, values are JAHPQNSURLSessionDemuxCoalescedFetch; protected by @synchronized (self)
+@property (atomic, strong, readwrite) NSDictionary *        coalescedFetchByTaskID; // keys NSURLSessionTask taskIdentifier, values are JAHPQNSURLSessionDemuxCoalescedFetch
 @property (atomic, strong, readonly ) NSOperationQueue *    sessionDelegateQueue;
 
 @end
 
+/*! Returns a copy of a task table with the task's entry set to object, or removed if object is nil.
+ */
+
+static NSDictionary *JAHPTaskTableBySettingObject(NSDictionary *table, id object, NSURLSessionTask *task)
+{
+	NSMutableDictionary *   newTable;
+
+	newTable = [table mutableCopy];
+	if (object != nil) {
+		newTable[@(task.taskIdentifier)] = object;
+	} else {
+		[newTable removeObjectForKey:@(task.taskIdentifier)];
+	}
+	return [newTable copy];
+}
+
 @implementation JAHPQNSURLSessionDemux
 
 - (instancetype)init
@@ -132,7 +345,12 @@
 		}
 		self->_configuration = [configuration copy];
 
-		self->_taskInfoByTaskID = [[NSMutableDictionary alloc] init];
+		self->_taskInfoByTaskID = @{};
+		self->_coalescedFetchByKey = [[NSMutableDictionary alloc] init];
+		self->_coalescedFetchByTaskID = @{};
+
+		self->_maxDataBatchLength = 256 * 1024;
+		self->_maxDataBatchDelay = 0;
 
 		self->_sessionDelegateQueue = [[NSOperationQueue alloc] init];
 		[self->_sessionDelegateQueue setMaxConcurrentOperationCount:1];
@@ -163,12 +381,251 @@
 	taskInfo = [[JAHPQNSURLSessionDemuxTaskInfo alloc] initWithTask:task delegate:delegate modes:modes];
 
 	@synchronized (self) {
-		self.taskInfoByTaskID[@(task.taskIdentifier)] = taskInfo;
+		self.taskInfoByTaskID = JAHPTaskTableBySettingObject(self.taskInfoByTaskID, taskInfo, task);
 	}
 
 	return task;
 }
 
+/*! Returns the key under which a request may be coalesced, or nil if it must not be.
+ *  \details Only plain GETs that the client is happy to have answered from a cache
+ *  are coalesced, and only with requests whose headers are all the same: whatever the
+ *  response turns out to Vary on, or however private it is, it's the response each of
+ *  them would have got on its own.
+ */
+
++ (NSString *)coalescingKeyForRequest:(NSURLRequest *)request
+{
+	NSMutableString *   key;
+	NSString *          cacheControl;
+	NSDictionary *      headers;
+
+	if (![[request HTTPMethod] isEqualToString:@"GET"]) {
+		return nil;
+	}
+	if ([request HTTPBody] != nil || [request HTTPBodyStream] != nil) {
+		return nil;
+	}
+	if ([request cachePolicy] == NSURLRequestReloadIgnoringLocalCacheData || [request cachePolicy] == NSURLRequestReloadIgnoringLocalAndRemoteCacheData) {
+		return nil;
+	}
+
+	cacheControl = [[request valueForHTTPHeaderField:@"Cache-Control"] lowercaseString];
+	if ([cacheControl containsString:@"no-cache"] || [cacheControl containsString:@"no-store"]) {
+		return nil;
+	}
+	if ([request valueForHTTPHeaderField:@"Range"] != nil) {
+		return nil;
+	}
+
+	key = [NSMutableString stringWithString:[[request URL] absoluteString]];
+	headers = [request allHTTPHeaderFields];
+	for (NSString *header in [[headers allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)]) {
+		[key appendFormat:@"\n%@:%@", [header lowercaseString], headers[header]];
+	}
+
+	return key;
+}
+
+/*! Returns the value of a response header, whatever the case of its name.
+ *  \details allHeaderFields is a plain dictionary, so looking a name up in it directly
+ *  misses a server's "cache-control".
+ */
+
++ (NSString *)caseInsensitiveHeader:(NSString *)name inResponse:(NSHTTPURLResponse *)response
+{
+	__block NSString *  value;
+
+	[[response allHeaderFields] enumerateKeysAndObjectsUsingBlock:^(NSString *field, NSString *fieldValue, BOOL *stop) {
+		if ([field caseInsensitiveCompare:name] == NSOrderedSame) {
+			value = fieldValue;
+			*stop = YES;
+		}
+	}];
+	return value;
+}
+
+/*! Returns YES if late requests may still be given this response.
+ */
+
++ (BOOL)isCoalescableResponse:(NSURLResponse *)response
+{
+	NSHTTPURLResponse * httpResponse;
+	NSString *          cacheControl;
+	NSString *          vary;
+
+	if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+		return NO;
+	}
+	httpResponse = (NSHTTPURLResponse *) response;
+
+	cacheControl = [[self caseInsensitiveHeader:@"Cache-Control" inResponse:httpResponse] lowercaseString];
+	if ([cacheControl containsString:@"no-store"] || [cacheControl containsString:@"private"]) {
+		return NO;
+	}
+
+	vary = [[self caseInsensitiveHeader:@"Vary" inResponse:httpResponse] lowercaseString];
+	if (vary != nil) {
+		for (NSString *field in [vary componentsSeparatedByString:@","]) {
+			NSString *header = [field stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+			if ([header length] > 0 && ![JAHPCoalescingVaryHeaders() containsObject:header]) {
+				// This includes "*".
+				return NO;
+			}
+		}
+	}
+
+	return YES;
+}
+
+- (NSURLSessionDataTask *)coalescedDataTaskWithRequest:(NSURLRequest *)request delegate:(id<NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>)delegate modes:(NSArray *)modes
+{
+	NSString *                              key;
+	NSURLSessionDataTask *                  task;
+	JAHPQNSURLSessionDemuxTaskInfo *        taskInfo;
+	JAHPQNSURLSessionDemuxCoalescedFetch *  fetch;
+
+	assert(request != nil);
+	assert(delegate != nil);
+	// modes may be nil
+
+	key = [[self class] coalescingKeyForRequest:request];
+	if (key == nil) {
+		return [self dataTaskWithRequest:request delegate:delegate modes:modes];
+	}
+
+	if ([modes count] == 0) {
+		modes = @[ NSDefaultRunLoopMode ];
+	}
+
+	@synchronized (self) {
+		fetch = self.coalescedFetchByKey[key];
+		if (fetch != nil && fetch.acceptsJoiners) {
+			task = fetch.task;
+			taskInfo = [[JAHPQNSURLSessionDemuxTaskInfo alloc] initWithTask:task delegate:delegate modes:modes];
+			[fetch.taskInfos addObject:taskInfo];
+
+			// Catch the new delegate up with everything the others have already seen.  This
+			// is done while holding the lock so that it's queued before any later callbacks.
+
+			if (fetch.response != nil) {
+				NSURLSession *  session = self.session;
+				NSURLResponse * response = fetch.response;
+				NSArray *       receivedData = [fetch.receivedData copy];
+
+				[taskInfo performBlock:^{
+					if ([taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveResponse:completionHandler:)]) {
+						[taskInfo.delegate URLSession:session dataTask:task didReceiveResponse:response completionHandler:^(NSURLSessionResponseDisposition disposition) {
+#pragma unused(disposition)
+						}];
+					}
+					if ([taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveData:)]) {
+						for (NSData *data in receivedData) {
+							[taskInfo.delegate URLSession:session dataTask:task didReceiveData:data];
+						}
+					}
+				}];
+			}
+		} else {
+			task = [self.session dataTaskWithRequest:request];
+			assert(task != nil);
+
+			taskInfo = [[JAHPQNSURLSessionDemuxTaskInfo alloc] initWithTask:task delegate:delegate modes:modes];
+
+			fetch = [[JAHPQNSURLSessionDemuxCoalescedFetch alloc] initWithKey:key task:task];
+			[fetch.taskInfos addObject:taskInfo];
+
+			self.taskInfoByTaskID = JAHPTaskTableBySettingObject(self.taskInfoByTaskID, taskInfo, task);
+			self.coalescedFetchByKey[key] = fetch;
+			self.coalescedFetchByTaskID = JAHPTaskTableBySettingObject(self.coalescedFetchByTaskID, fetch, task);
+		}
+	}
+
+	return task;
+}
+
+- (void)cancelDataTask:(NSURLSessionTask *)task delegate:(id<NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>)delegate
+{
+	JAHPQNSURLSessionDemuxCoalescedFetch *  fetch;
+	JAHPQNSURLSessionDemuxTaskInfo *        leavingTaskInfo;
+	NSURLSession *                          session;
+	NSError *                               error;
+
+	assert(task != nil);
+	assert(delegate != nil);
+
+	leavingTaskInfo = nil;
+
+	@synchronized (self) {
+		fetch = self.coalescedFetchByTaskID[@(task.taskIdentifier)];
+		if (fetch != nil) {
+			for (JAHPQNSURLSessionDemuxTaskInfo *taskInfo in fetch.taskInfos) {
+				if (taskInfo.delegate == delegate) {
+					leavingTaskInfo = taskInfo;
+					break;
+				}
+			}
+			if (leavingTaskInfo == nil) {
+				// Already detached, for example by a redirect.
+				return;
+			}
+			if ([fetch.taskInfos count] == 1) {
+				// The task is about to be cancelled, so don't let anyone else join it.
+				fetch.acceptsJoiners = NO;
+				leavingTaskInfo = nil;
+			} else {
+				[fetch.taskInfos removeObject:leavingTaskInfo];
+				self.taskInfoByTaskID = JAHPTaskTableBySettingObject(self.taskInfoByTaskID, fetch.taskInfos[0], task);
+			}
+		}
+	}
+
+	if (leavingTaskInfo == nil) {
+		// Nobody else is interested in this task.
+		[task cancel];
+		return;
+	}
+
+	// Other delegates still want the response, so leave the task running and just tell
+	// this delegate what it would have been told had the task been cancelled.
+
+	session = self.session;
+	error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+	if ([leavingTaskInfo.delegate respondsToSelector:@selector(URLSession:task:didCompleteWithError:)]) {
+		[leavingTaskInfo performBlock:^{
+			[leavingTaskInfo.delegate URLSession:session task:task didCompleteWithError:error];
+			[leavingTaskInfo invalidate];
+		}];
+	} else {
+		[leavingTaskInfo invalidate];
+	}
+}
+
+- (void)finishTasksAndInvalidate
+{
+	// The session keeps us alive until it's invalidated, and our task infos keep the
+	// delegates alive until their tasks complete, so nothing more is needed here.
+	[self.session finishTasksAndInvalidate];
+}
+
+/*! Returns every delegate attached to the task, primary first.
+ *  \details Must be called with self locked, since a coalesced task's delegates can change.
+ */
+
+- (NSArray *)taskInfosForTaskLocked:(NSURLSessionTask *)task
+{
+	JAHPQNSURLSessionDemuxCoalescedFetch *  fetch;
+	JAHPQNSURLSessionDemuxTaskInfo *        taskInfo;
+
+	fetch = self.coalescedFetchByTaskID[@(task.taskIdentifier)];
+	if (fetch != nil) {
+		return [fetch.taskInfos copy];
+	}
+
+	taskInfo = self.taskInfoByTaskID[@(task.taskIdentifier)];
+	return (taskInfo != nil) ? @[ taskInfo ] : @[];
+}
+
 - (JAHPQNSURLSessionDemuxTaskInfo *)taskInfoForTask:(NSURLSessionTask *)task
 {
 	// rdar://21484589
@@ -188,23 +645,35 @@
 	// (self.taskInfoByTaskID[@(task.taskIdentifier)] != nil)
 	// because [self.taskInfoByTaskID removeObjectForKey:@(taskInfo.task.taskIdentifier)]
 	// is called in URLSession:task:didCompleteWithError:.
-	JAHPQNSURLSessionDemuxTaskInfo *    result;
-
-	@synchronized (self) {
-		result = self.taskInfoByTaskID[@(task.taskIdentifier)];
-	}
-	return result;
+	return self.taskInfoByTaskID[@(task.taskIdentifier)];
 }
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task willPerformHTTPRedirection:(NSHTTPURLResponse *)response newRequest:(NSURLRequest *)newRequest completionHandler:(void (^)(NSURLRequest *))completionHandler
 {
+	NSArray *                           taskInfos;
 	JAHPQNSURLSessionDemuxTaskInfo *    taskInfo;
 
-	taskInfo = [self taskInfoForTask:task];
+	// Every attached delegate has to see the redirect so that it can redirect its own
+	// client, but only the primary gets to decide what happens to the task.
+
+	@synchronized (self) {
+		[self.coalescedFetchByTaskID[@(task.taskIdentifier)] setAcceptsJoiners:NO];
+		taskInfos = [self taskInfosForTaskLocked:task];
+	}
+
+	taskInfo = [taskInfos firstObject];
 	if (taskInfo && [taskInfo.delegate respondsToSelector:@selector(URLSession:task:willPerformHTTPRedirection:newRequest:completionHandler:)]) {
-		[taskInfo performBlock:^{
-			[taskInfo.delegate URLSession:session task:task willPerformHTTPRedirection:response newRequest:newRequest completionHandler:completionHandler];
-		}];
+		for (JAHPQNSURLSessionDemuxTaskInfo *follower in taskInfos) {
+			void (^handler)(NSURLRequest *) = completionHandler;
+			if (follower != taskInfo) {
+				handler = ^(NSURLRequest *request) {
+#pragma unused(request)
+				};
+			}
+			[follower performBlock:^{
+				[follower.delegate URLSession:session task:task willPerformHTTPRedirection:response newRequest:newRequest completionHandler:handler];
+			}];
+		}
 	} else {
 		completionHandler(newRequest);
 	}
@@ -252,53 +721,111 @@
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error
 {
-	JAHPQNSURLSessionDemuxTaskInfo *    taskInfo;
-
-	taskInfo = [self taskInfoForTask:task];
+	NSArray *                               taskInfos;
+	JAHPQNSURLSessionDemuxCoalescedFetch *  fetch;
 
 	// This is our last delegate callback so we remove our task info record.
 
 	@synchronized (self) {
-		[self.taskInfoByTaskID removeObjectForKey:@(taskInfo.task.taskIdentifier)];
+		taskInfos = [self taskInfosForTaskLocked:task];
+		self.taskInfoByTaskID = JAHPTaskTableBySettingObject(self.taskInfoByTaskID, nil, task);
+
+		fetch = self.coalescedFetchByTaskID[@(task.taskIdentifier)];
+		if (fetch != nil) {
+			self.coalescedFetchByTaskID = JAHPTaskTableBySettingObject(self.coalescedFetchByTaskID, nil, task);
+			if (self.coalescedFetchByKey[fetch.key] == fetch) {
+				[self.coalescedFetchByKey removeObjectForKey:fetch.key];
+			}
+		}
 	}
 
 	// Call the delegate if required.  In that case we invalidate the task info on the client thread
 	// after calling the delegate, otherwise the client thread side of the -performBlock: code can
 	// find itself with an invalidated task info.
 
-	if ([taskInfo.delegate respondsToSelector:@selector(URLSession:task:didCompleteWithError:)]) {
-		[taskInfo performBlock:^{
-			[taskInfo.delegate URLSession:session task:task didCompleteWithError:error];
+	for (JAHPQNSURLSessionDemuxTaskInfo *taskInfo in taskInfos) {
+		[taskInfo flushReceivedData];
+		if ([taskInfo.delegate respondsToSelector:@selector(URLSession:task:didCompleteWithError:)]) {
+			[taskInfo performBlock:^{
+				[taskInfo.delegate URLSession:session task:task didCompleteWithError:error];
+				[taskInfo invalidate];
+			}];
+		} else {
 			[taskInfo invalidate];
-		}];
-	} else {
-		[taskInfo invalidate];
+		}
 	}
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler
 {
-	JAHPQNSURLSessionDemuxTaskInfo *    taskInfo;
+	JAHPQNSURLSessionDemuxCoalescedFetch *  fetch;
+	JAHPQNSURLSessionDemuxTaskInfo *        taskInfo;
 
-	taskInfo = [self taskInfoForTask:dataTask];
-	if (taskInfo && [taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveResponse:completionHandler:)]) {
-		[taskInfo performBlock:^{
-			[taskInfo.delegate URLSession:session dataTask:dataTask didReceiveResponse:response completionHandler:completionHandler];
-		}];
-	} else {
-		completionHandler(NSURLSessionResponseAllow);
+	// The fan out is queued while holding the lock so that it can't race with a late
+	// joiner being replayed the response.
+
+	@synchronized (self) {
+		NSArray *taskInfos = [self taskInfosForTaskLocked:dataTask];
+
+		fetch = self.coalescedFetchByTaskID[@(dataTask.taskIdentifier)];
+		if (fetch != nil) {
+			fetch.response = response;
+			if (![[self class] isCoalescableResponse:response]) {
+				fetch.acceptsJoiners = NO;
+			}
+		}
+
+		taskInfo = [taskInfos firstObject];
+		if (taskInfo && [taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveResponse:completionHandler:)]) {
+			for (JAHPQNSURLSessionDemuxTaskInfo *follower in taskInfos) {
+				void (^handler)(NSURLSessionResponseDisposition) = completionHandler;
+				if (follower != taskInfo) {
+					handler = ^(NSURLSessionResponseDisposition disposition) {
+#pragma unused(disposition)
+					};
+				}
+				[follower performBlock:^{
+					[follower.delegate URLSession:session dataTask:dataTask didReceiveResponse:response completionHandler:handler];
+				}];
+			}
+			return;
+		}
 	}
+
+	completionHandler(NSURLSessionResponseAllow);
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data
 {
-	JAHPQNSURLSessionDemuxTaskInfo *    taskInfo;
+	JAHPQNSURLSessionDemuxCoalescedFetch *  fetch;
+	JAHPQNSURLSessionDemuxTaskInfo *        taskInfo;
+	NSUInteger                              maxBatchLength;
+	NSTimeInterval                          maxBatchDelay;
+
+	maxBatchLength = self.maxDataBatchLength;
+	maxBatchDelay = self.maxDataBatchDelay;
+
+	fetch = self.coalescedFetchByTaskID[@(dataTask.taskIdentifier)];
+	if (fetch == nil) {
+		// The common case: the task has a single delegate, so there's nothing to lock.
+		taskInfo = self.taskInfoByTaskID[@(dataTask.taskIdentifier)];
+		if ([taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveData:)]) {
+			[taskInfo enqueueReceivedData:data session:session maxBatchLength:maxBatchLength maxBatchDelay:maxBatchDelay];
+		}
+		return;
+	}
 
-	taskInfo = [self taskInfoForTask:dataTask];
-	if (taskInfo && [taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveData:)]) {
-		[taskInfo performBlock:^{
-			[taskInfo.delegate URLSession:session dataTask:dataTask didReceiveData:data];
-		}];
+	// Fan out while holding the lock so that this can't race with a late joiner being
+	// replayed the data received so far.
+
+	@synchronized (self) {
+		[fetch appendReceivedData:data];
+
+		for (JAHPQNSURLSessionDemuxTaskInfo *follower in [self taskInfosForTaskLocked:dataTask]) {
+			if ([follower.delegate respondsToSelector:@selector(URLSession:dataTask:didReceiveData:)]) {
+				[follower enqueueReceivedData:data session:session maxBatchLength:maxBatchLength maxBatchDelay:maxBatchDelay];
+			}
+		}
 	}
 }
 
@@ -307,6 +834,7 @@
 	JAHPQNSURLSessionDemuxTaskInfo *    taskInfo;
 
 	taskInfo = [self taskInfoForTask:dataTask];
+	[taskInfo flushReceivedData];
 	if (taskInfo && [taskInfo.delegate respondsToSelector:@selector(URLSession:dataTask:willCacheResponse:completionHandler:)]) {
 		[taskInfo performBlock:^{
 			[taskInfo.delegate URLSession:session dataTask:dataTask willCacheResponse:proposedResponse completionHandler:completionHandler];
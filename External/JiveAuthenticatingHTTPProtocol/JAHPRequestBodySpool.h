@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! A request body copied to a temporary file.
+ *  \details UIWebView hands us request bodies as streams, which can only be read once and
+ *  whose length isn't known.  Spooling the body to disk through a fixed-size buffer lets us
+ *  upload it with a Content-Length, and rewind it whenever NSURLSession needs to send it
+ *  again (after a redirect or an authentication challenge), without ever holding more than
+ *  the buffer in memory.
+ *
+ *  The file is deleted when the spool is deallocated.
+ */
+
+@interface JAHPRequestBodySpool : NSObject
+
+/*! Copies stream to a new spool on a background queue.
+ *  \param stream An unopened stream; must not be nil.
+ *  \param completion Called on an arbitrary thread with the spool, or with nil and an
+ *  error if the stream couldn't be read or the file couldn't be written.
+ */
+
++ (void)spoolStream:(nonnull NSInputStream *)stream completion:(nonnull void (^)(JAHPRequestBodySpool * _Nullable spool, NSError * _Nullable error))completion;
+
+@property (nonatomic, readonly) int64_t length;     ///< The length of the body in bytes.
+
+/*! Returns a new, unopened stream that reads the body from the start.
+ */
+
+- (nonnull NSInputStream *)inputStream;
+
+@end
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPRequestBodySpool.h"
+
+/* bodies are copied through a buffer of this size, so this is all the memory an upload uses */
+#define SPOOL_BUFFER_LENGTH (64 * 1024)
+
+@interface JAHPRequestBodySpool ()
+
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, readwrite) int64_t length;
+
+@end
+
+@implementation JAHPRequestBodySpool
+
+/*! The directory spools live in.  Anything left there by a previous run is removed the
+ *  first time it's used.
+ */
+
++ (NSString *)spoolDirectory
+{
+	static NSString *directory;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSFileManager *fm = [NSFileManager defaultManager];
+		directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"JAHPRequestBodies"];
+		[fm removeItemAtPath:directory error:nil];
+		[fm createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:@{ NSFileProtectionKey: NSFileProtectionComplete } error:nil];
+	});
+	return directory;
+}
+
++ (dispatch_queue_t)spoolQueue
+{
+	static dispatch_queue_t queue;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		queue = dispatch_queue_create("JAHPRequestBodySpool", DISPATCH_QUEUE_SERIAL);
+	});
+	return queue;
+}
+
++ (void)spoolStream:(NSInputStream *)stream completion:(void (^)(JAHPRequestBodySpool *spool, NSError *error))completion
+{
+	assert(stream != nil);
+	assert(completion != nil);
+
+	dispatch_async([self spoolQueue], ^{
+		NSError *error = nil;
+		JAHPRequestBodySpool *spool = [[JAHPRequestBodySpool alloc] init];
+		spool.path = [[self spoolDirectory] stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+
+		if (![spool copyStream:stream error:&error]) {
+			spool = nil;
+		}
+		completion(spool, error);
+	});
+}
+
+- (BOOL)copyStream:(NSInputStream *)stream error:(NSError **)error
+{
+	NSMutableData *buffer = [NSMutableData dataWithLength:SPOOL_BUFFER_LENGTH];
+	uint8_t *bytes = [buffer mutableBytes];
+	NSOutputStream *file = [NSOutputStream outputStreamToFileAtPath:self.path append:NO];
+	BOOL ok = YES;
+
+	[stream open];
+	[file open];
+
+	for (;;) {
+		NSInteger nread = [stream read:bytes maxLength:SPOOL_BUFFER_LENGTH];
+		if (nread < 0) {
+			*error = [stream streamError];
+			ok = NO;
+			break;
+		}
+		if (nread == 0) {
+			break;
+		}
+
+		for (NSInteger off = 0; off < nread; ) {
+			NSInteger nwritten = [file write:bytes + off maxLength:nread - off];
+			if (nwritten <= 0) {
+				*error = [file streamError];
+				ok = NO;
+				break;
+			}
+			off += nwritten;
+		}
+		if (!ok) {
+			break;
+		}
+
+		self.length += nread;
+	}
+
+	[stream close];
+	[file close];
+
+	if (ok) {
+		[[NSFileManager defaultManager] setAttributes:@{ NSFileProtectionKey: NSFileProtectionComplete } ofItemAtPath:self.path error:nil];
+	} else if (*error == nil) {
+		*error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotDecodeRawData userInfo:nil];
+	}
+
+	return ok;
+}
+
+- (NSInputStream *)inputStream
+{
+	return [NSInputStream inputStreamWithFileAtPath:self.path];
+}
+
+- (void)dealloc
+{
+	if (self.path != nil) {
+		[[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+	}
+}
+
+@end
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Snapshots of the documents open in tabs, kept so that they can be shown while the
+ *  tunnel is down.
+ *  \details JAHPAuthenticatingHTTPProtocol records each response exactly as it passed it
+ *  to the web view -- after our script injection and header rewriting -- into an archive
+ *  for the document the request belongs to.  Each archive is a WARC file, one "response"
+ *  record per resource.  While the tunnel is down, requests for a document with a
+ *  snapshot and its subresources are served from the archive instead of failing.
+ *
+ *  Archives hold the same browsing history the disk cache does, so they're kept the same
+ *  way: each record is sealed under JAHPDiskCache's key and prefixed with its sealed
+ *  length, and files are named by a keyed hash of their document.  Shredding the cache
+ *  makes every archive unreadable along with it, and without a cache nothing is recorded.
+ *
+ *  Archives are written on a background queue and read on whatever thread asks.  Only a
+ *  limited number of documents are kept, oldest first out, and resources too big to be
+ *  worth keeping are skipped.
+ *
+ *  Recording is off unless the user turns it on in the privacy settings.
+ */
+
+@interface JAHPSnapshotStore : NSObject
+
++ (nonnull instancetype)sharedStore;
+
+/*! Returns YES if responses should be recorded.
+ */
+
++ (BOOL)isEnabled;
+
+/*! Returns YES if a resource of this length is small enough to record.
+ *  \param length The expected length of the body, or NSURLResponseUnknownLength.
+ */
+
++ (BOOL)shouldRecordResourceOfLength:(long long)length;
+
+/*! Starts a new snapshot of a document, replacing any it already had.
+ */
+
+- (void)beginSnapshotOfDocument:(nonnull NSURL *)documentURL;
+
+/*! Adds a response to the snapshot of a document.
+ */
+
+- (void)addResponse:(nonnull NSHTTPURLResponse *)response data:(nonnull NSData *)data toSnapshotOfDocument:(nonnull NSURL *)documentURL;
+
+/*! Returns YES if a document has a snapshot that includes the document itself.
+ *  \details This only looks at an in-memory index, so it can be called on the main
+ *  thread; the archive itself is only read by -responseForURL:inSnapshotOfDocument:.
+ */
+
+- (BOOL)hasSnapshotOfDocument:(nonnull NSURL *)documentURL;
+
+/*! Returns the recorded response for a resource of a document, or nil if there isn't one.
+ *  \details This may read and decrypt the whole archive, so it shouldn't be called on the
+ *  main thread.
+ */
+
+- (nullable NSCachedURLResponse *)responseForURL:(nonnull NSURL *)url inSnapshotOfDocument:(nonnull NSURL *)documentURL;
+
+/*! Deletes every snapshot.
+ */
+
+- (void)removeAllSnapshots;
+
+/*! Returns a WARC "response" record for a response and its body.
+ *  \details The body is stored as it was delivered, so any Content-Encoding and
+ *  Content-Length headers are replaced with the length of data.  Set-Cookie headers are
+ *  dropped.
+ */
+
++ (nonnull NSData *)WARCRecordForResponse:(nonnull NSHTTPURLResponse *)response data:(nonnull NSData *)data;
+
+/*! Returns the responses in a WARC archive, keyed by their target URI strings.  Later
+ *  records for the same URI replace earlier ones, and parsing stops at the first
+ *  damaged record.
+ */
+
++ (nonnull NSDictionary<NSString *, NSCachedURLResponse *> *)responsesInWARCArchive:(nonnull NSData *)archive;
+
+@end
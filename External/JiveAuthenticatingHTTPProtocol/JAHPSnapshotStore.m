@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPSnapshotStore.h"
+
+#import "JAHPDiskCache.h"
+#import "JAHPTrash.h"
+
+#define SNAPSHOT_MAX_DOCUMENTS 32
+#define SNAPSHOT_MAX_ARCHIVE_SIZE (16 * 1024 * 1024)
+#define SNAPSHOT_MAX_RESOURCE_SIZE (4 * 1024 * 1024)
+
+static NSData *crlfcrlf;
+
+/*! Returns the URL string a document or resource is filed under; fragments never reach
+ *  the server, so they're ignored.
+ */
+
+static NSString *snapshotKeyForURL(NSURL *url)
+{
+	NSURLComponents *components = [NSURLComponents componentsWithURL:url resolvingAgainstBaseURL:NO];
+	[components setFragment:nil];
+	return [[components URL] absoluteString] ?: [url absoluteString];
+}
+
+static NSString *hexString(NSData *data)
+{
+	const uint8_t *bytes = [data bytes];
+	NSMutableString *hex = [NSMutableString stringWithCapacity:2 * [data length]];
+
+	for (size_t i = 0; i < [data length]; i++) {
+		[hex appendFormat:@"%02x", bytes[i]];
+	}
+	return hex;
+}
+
+@implementation JAHPSnapshotStore {
+	dispatch_queue_t _queue;
+	NSString *_directory;
+	NSString *_indexPath;
+	NSCache<NSString *, NSDictionary *> *_parsedArchives;
+
+	/* document -> archive path, for each archive holding its document's own response */
+	NSMutableDictionary<NSString *, NSString *> *_archivedDocuments;
+}
+
++ (void)initialize
+{
+	if (self == [JAHPSnapshotStore class]) {
+		crlfcrlf = [NSData dataWithBytes:"\r\n\r\n" length:4];
+	}
+}
+
++ (instancetype)sharedStore
+{
+	static JAHPSnapshotStore *store;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		store = [[JAHPSnapshotStore alloc] init];
+	});
+	return store;
+}
+
++ (BOOL)isEnabled
+{
+	return [[NSUserDefaults standardUserDefaults] boolForKey:kOfflineSnapshots];
+}
+
++ (BOOL)shouldRecordResourceOfLength:(long long)length
+{
+	return length <= SNAPSHOT_MAX_RESOURCE_SIZE;
+}
+
+- (instancetype)init
+{
+	self = [super init];
+	if (self != nil) {
+		NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+		_directory = [caches stringByAppendingPathComponent:@"JAHPSnapshots"];
+		[[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:@{ NSFileProtectionKey: NSFileProtectionComplete } error:nil];
+
+		_indexPath = [_directory stringByAppendingPathExtension:@"index"];
+
+		_queue = dispatch_queue_create("JAHPSnapshotStore", DISPATCH_QUEUE_SERIAL);
+		_parsedArchives = [[NSCache alloc] init];
+		[_parsedArchives setCountLimit:4];
+		_archivedDocuments = [NSMutableDictionary dictionary];
+
+		dispatch_async(_queue, ^{
+			[self loadIndex];
+		});
+	}
+	return self;
+}
+
+/*! Returns the keyed hash a document's archive is named by and its records are sealed
+ *  with, or nil if there's no disk cache key to keep it under.
+ */
+
+- (NSData *)nameOfDocument:(NSURL *)documentURL
+{
+	NSData *key = [[@"snapshot:" stringByAppendingString:snapshotKeyForURL(documentURL)] dataUsingEncoding:NSUTF8StringEncoding];
+	return [[JAHPDiskCache sharedCache] keyedHashOfData:key];
+}
+
+- (NSString *)pathForName:(NSData *)name
+{
+	return [_directory stringByAppendingPathComponent:hexString(name)];
+}
+
+#pragma mark - Index
+
+/*! Reads back which documents have snapshots.  The index is sealed like the archives,
+ *  so it's unreadable, and so empty, once the disk cache has been shredded.
+ */
+
+- (void)loadIndex
+{
+	NSData *name = [[JAHPDiskCache sharedCache] keyedHashOfData:[@"snapshot-index" dataUsingEncoding:NSUTF8StringEncoding]];
+	NSData *sealed = [NSData dataWithContentsOfFile:_indexPath];
+	if (name == nil || sealed == nil) {
+		return;
+	}
+
+	NSData *plist = [[JAHPDiskCache sharedCache] openData:sealed name:name];
+	NSDictionary *documents = (plist != nil ? [NSPropertyListSerialization propertyListWithData:plist options:0 format:NULL error:nil] : nil);
+	if (![documents isKindOfClass:[NSDictionary class]]) {
+		return;
+	}
+
+	NSFileManager *fm = [NSFileManager defaultManager];
+	@synchronized (self) {
+		[documents enumerateKeysAndObjectsUsingBlock:^(NSString *document, NSString *file, BOOL *stop) {
+			NSString *path = [self->_directory stringByAppendingPathComponent:file];
+			if ([document isKindOfClass:[NSString class]] && [file isKindOfClass:[NSString class]] && [fm fileExistsAtPath:path]) {
+				self->_archivedDocuments[document] = path;
+			}
+		}];
+	}
+}
+
+- (void)saveIndex
+{
+	NSMutableDictionary<NSString *, NSString *> *documents = [NSMutableDictionary dictionary];
+	@synchronized (self) {
+		[_archivedDocuments enumerateKeysAndObjectsUsingBlock:^(NSString *document, NSString *path, BOOL *stop) {
+			documents[document] = [path lastPathComponent];
+		}];
+	}
+
+	NSData *name = [[JAHPDiskCache sharedCache] keyedHashOfData:[@"snapshot-index" dataUsingEncoding:NSUTF8StringEncoding]];
+	NSData *plist = [NSPropertyListSerialization dataWithPropertyList:documents format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+	NSData *sealed = (name != nil && plist != nil ? [[JAHPDiskCache sharedCache] sealData:plist name:name] : nil);
+	if (sealed != nil) {
+		[sealed writeToFile:_indexPath options:(NSDataWritingAtomic | NSDataWritingFileProtectionComplete) error:nil];
+	}
+}
+
+/*! Forgets the documents whose archive is at path.
+ */
+
+- (void)forgetArchiveAtPath:(NSString *)path
+{
+	@synchronized (self) {
+		[_archivedDocuments removeObjectsForKeys:[_archivedDocuments allKeysForObject:path]];
+	}
+}
+
+#pragma mark - Archives
+
+/*! Returns the WARC records in an archive, opened, up to the first one that can't be.
+ */
+
+- (NSData *)openArchive:(NSData *)archive name:(NSData *)name
+{
+	JAHPDiskCache *cache = [JAHPDiskCache sharedCache];
+	NSMutableData *warc = [NSMutableData data];
+	NSUInteger offset = 0;
+	uint32_t length;
+
+	while (offset + sizeof(length) <= [archive length]) {
+		[archive getBytes:&length range:NSMakeRange(offset, sizeof(length))];
+		length = CFSwapInt32BigToHost(length);
+		offset += sizeof(length);
+		if (length > [archive length] - offset) {
+			break;
+		}
+
+		NSData *record = [cache openData:[archive subdataWithRange:NSMakeRange(offset, length)] name:name];
+		if (record == nil) {
+			break;
+		}
+		[warc appendData:record];
+		offset += length;
+	}
+
+	return warc;
+}
+
+#pragma mark - Recording
+
+- (void)beginSnapshotOfDocument:(NSURL *)documentURL
+{
+	/* better no snapshot than one in the clear */
+	NSData *name = [self nameOfDocument:documentURL];
+	if (name == nil) {
+		return;
+	}
+	NSString *path = [self pathForName:name];
+
+	dispatch_async(_queue, ^{
+		NSFileManager *fm = [NSFileManager defaultManager];
+
+		[self->_parsedArchives removeObjectForKey:path];
+		[self forgetArchiveAtPath:path];
+		[fm createFileAtPath:path contents:nil attributes:@{ NSFileProtectionKey: NSFileProtectionComplete }];
+
+		/* only keep the most recently loaded documents */
+		NSArray<NSURL *> *archives = [fm contentsOfDirectoryAtURL:[NSURL fileURLWithPath:self->_directory] includingPropertiesForKeys:@[ NSURLContentModificationDateKey ] options:0 error:nil];
+		if ([archives count] <= SNAPSHOT_MAX_DOCUMENTS) {
+			[self saveIndex];
+			return;
+		}
+
+		archives = [archives sortedArrayUsingComparator:^NSComparisonResult(NSURL *a, NSURL *b) {
+			NSDate *aDate, *bDate;
+			[a getResourceValue:&aDate forKey:NSURLContentModificationDateKey error:nil];
+			[b getResourceValue:&bDate forKey:NSURLContentModificationDateKey error:nil];
+			return [aDate compare:bDate];
+		}];
+		for (NSUInteger i = 0; i < [archives count] - SNAPSHOT_MAX_DOCUMENTS; i++) {
+			[self->_parsedArchives removeObjectForKey:[archives[i] path]];
+			[self forgetArchiveAtPath:[archives[i] path]];
+			[fm removeItemAtURL:archives[i] error:nil];
+		}
+		[self saveIndex];
+	});
+}
+
+- (void)addResponse:(NSHTTPURLResponse *)response data:(NSData *)data toSnapshotOfDocument:(NSURL *)documentURL
+{
+	if (![[self class] shouldRecordResourceOfLength:[data length]]) {
+		return;
+	}
+
+	NSData *name = [self nameOfDocument:documentURL];
+	if (name == nil) {
+		return;
+	}
+	NSString *path = [self pathForName:name];
+
+	dispatch_async(_queue, ^{
+		/* the document's snapshot was never begun, or has been pruned */
+		NSFileHandle *archive = [NSFileHandle fileHandleForWritingAtPath:path];
+		if (archive == nil) {
+			return;
+		}
+
+		/* each record is sealed on its own, so the archive can still be appended to */
+		NSData *record = [[JAHPDiskCache sharedCache] sealData:[[self class] WARCRecordForResponse:response data:data] name:name];
+		if (record == nil) {
+			[archive closeFile];
+			return;
+		}
+		uint32_t length = CFSwapInt32HostToBig((uint32_t)[record length]);
+		BOOL written = NO;
+		@try {
+			if ([archive seekToEndOfFile] + sizeof(length) + [record length] <= SNAPSHOT_MAX_ARCHIVE_SIZE) {
+				[archive writeData:[NSData dataWithBytes:&length length:sizeof(length)]];
+				[archive writeData:record];
+				written = YES;
+			}
+		} @catch (NSException *exception) {
+			NSLog(@"[JAHPSnapshotStore] failed writing snapshot: %@", exception);
+		}
+		[archive closeFile];
+
+		[self->_parsedArchives removeObjectForKey:path];
+
+		NSString *document = snapshotKeyForURL(documentURL);
+		if (written && [snapshotKeyForURL([response URL]) isEqualToString:document]) {
+			@synchronized (self) {
+				self->_archivedDocuments[document] = path;
+			}
+			[self saveIndex];
+		}
+	});
+}
+
+#pragma mark - Serving
+
+- (NSDictionary<NSString *, NSCachedURLResponse *> *)responsesInSnapshotOfDocument:(NSURL *)documentURL
+{
+	NSData *name = [self nameOfDocument:documentURL];
+	if (name == nil) {
+		return nil;
+	}
+	NSString *path = [self pathForName:name];
+	__block NSDictionary *responses;
+
+	dispatch_sync(_queue, ^{
+		responses = [self->_parsedArchives objectForKey:path];
+		if (responses == nil) {
+			NSData *archive = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+			if (archive == nil) {
+				return;
+			}
+			responses = [[self class] responsesInWARCArchive:[self openArchive:archive name:name]];
+			[self->_parsedArchives setObject:responses forKey:path];
+		}
+	});
+
+	return responses;
+}
+
+- (BOOL)hasSnapshotOfDocument:(NSURL *)documentURL
+{
+	@synchronized (self) {
+		return _archivedDocuments[snapshotKeyForURL(documentURL)] != nil;
+	}
+}
+
+- (NSCachedURLResponse *)responseForURL:(NSURL *)url inSnapshotOfDocument:(NSURL *)documentURL
+{
+	return [self responsesInSnapshotOfDocument:documentURL][snapshotKeyForURL(url)];
+}
+
+- (void)removeAllSnapshots
+{
+	dispatch_sync(_queue, ^{
+		@synchronized (self) {
+			[self->_archivedDocuments removeAllObjects];
+		}
+		[[NSFileManager defaultManager] removeItemAtPath:self->_indexPath error:nil];
+		[JAHPTrash moveItemAtPathToTrash:self->_directory];
+		[[NSFileManager defaultManager] createDirectoryAtPath:self->_directory withIntermediateDirectories:YES attributes:@{ NSFileProtectionKey: NSFileProtectionComplete } error:nil];
+		[self->_parsedArchives removeAllObjects];
+	});
+}
+
+#pragma mark - WARC
+
++ (NSData *)WARCRecordForResponse:(NSHTTPURLResponse *)response data:(NSData *)data
+{
+	static NSDateFormatter *dateFormatter;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		dateFormatter = [[NSDateFormatter alloc] init];
+		[dateFormatter setLocale:[NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]];
+		[dateFormatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"UTC"]];
+		[dateFormatter setDateFormat:@"yyyy-MM-dd'T'HH:mm:ss'Z'"];
+	});
+
+	NSMutableString *http = [NSMutableString stringWithFormat:@"HTTP/1.1 %ld \r\n", (long)[response statusCode]];
+	[[response allHeaderFields] enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *value, BOOL *stop) {
+		/* cookies live in the CookieJar, not on disk in the clear */
+		if ([name caseInsensitiveCompare:@"Content-Encoding"] == NSOrderedSame ||
+			[name caseInsensitiveCompare:@"Content-Length"] == NSOrderedSame ||
+			[name caseInsensitiveCompare:@"Transfer-Encoding"] == NSOrderedSame ||
+			[name caseInsensitiveCompare:@"Set-Cookie"] == NSOrderedSame) {
+			return;
+		}
+		[http appendFormat:@"%@: %@\r\n", name, value];
+	}];
+	[http appendFormat:@"Content-Length: %lu\r\n\r\n", (unsigned long)[data length]];
+	NSData *httpHeader = [http dataUsingEncoding:NSUTF8StringEncoding];
+
+	NSString *warc = [NSString stringWithFormat:
+					  @"WARC/1.0\r\n"
+					  @"WARC-Type: response\r\n"
+					  @"WARC-Record-ID: <urn:uuid:%@>\r\n"
+					  @"WARC-Date: %@\r\n"
+					  @"WARC-Target-URI: %@\r\n"
+					  @"Content-Type: application/http; msgtype=response\r\n"
+					  @"Content-Length: %lu\r\n"
+					  @"\r\n",
+					  [[[NSUUID UUID] UUIDString] lowercaseString],
+					  [dateFormatter stringFromDate:[NSDate date]],
+					  snapshotKeyForURL([response URL]),
+					  (unsigned long)([httpHeader length] + [data length])];
+
+	NSMutableData *record = [[warc dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+	[record appendData:httpHeader];
+	[record appendData:data];
+	[record appendData:crlfcrlf];
+	return record;
+}
+
+/*! Parses a block of "Name: value" lines, after a first line that's returned separately.
+ */
+
++ (NSDictionary<NSString *, NSString *> *)headerFieldsInData:(NSData *)data range:(NSRange)range firstLine:(NSString **)firstLine
+{
+	NSString *block = [[NSString alloc] initWithData:[data subdataWithRange:range] encoding:NSUTF8StringEncoding];
+	NSArray<NSString *> *lines = [block componentsSeparatedByString:@"\r\n"];
+	NSMutableDictionary *fields = [NSMutableDictionary dictionary];
+
+	*firstLine = [lines firstObject];
+
+	for (NSUInteger i = 1; i < [lines count]; i++) {
+		NSRange colon = [lines[i] rangeOfString:@":"];
+		if (colon.location == NSNotFound) {
+			continue;
+		}
+		NSString *name = [lines[i] substringToIndex:colon.location];
+		NSString *value = [[lines[i] substringFromIndex:NSMaxRange(colon)] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+		fields[name] = (fields[name] != nil ? [NSString stringWithFormat:@"%@, %@", fields[name], value] : value);
+	}
+
+	return fields;
+}
+
++ (NSDictionary<NSString *, NSCachedURLResponse *> *)responsesInWARCArchive:(NSData *)archive
+{
+	NSMutableDictionary *responses = [NSMutableDictionary dictionary];
+	NSUInteger length = [archive length];
+	NSUInteger offset = 0;
+
+	while (offset < length) {
+		NSRange end = [archive rangeOfData:crlfcrlf options:0 range:NSMakeRange(offset, length - offset)];
+		if (end.location == NSNotFound) {
+			break;
+		}
+
+		NSString *version;
+		NSDictionary *warcFields = [self headerFieldsInData:archive range:NSMakeRange(offset, end.location - offset) firstLine:&version];
+		long long blockLength = [warcFields[@"Content-Length"] longLongValue];
+		NSUInteger blockStart = NSMaxRange(end);
+
+		if (![version hasPrefix:@"WARC/"] || blockLength < 0 || (unsigned long long)blockLength > length - blockStart) {
+			break;
+		}
+		NSRange block = NSMakeRange(blockStart, (NSUInteger)blockLength);
+		offset = NSMaxRange(block) + [crlfcrlf length];
+
+		NSString *uri = warcFields[@"WARC-Target-URI"];
+		NSURL *url = (uri != nil ? [NSURL URLWithString:uri] : nil);
+		if (![warcFields[@"WARC-Type"] isEqualToString:@"response"] || url == nil) {
+			continue;
+		}
+
+		NSRange httpEnd = [archive rangeOfData:crlfcrlf options:0 range:block];
+		if (httpEnd.location == NSNotFound) {
+			continue;
+		}
+
+		NSString *statusLine;
+		NSDictionary *headerFields = [self headerFieldsInData:archive range:NSMakeRange(block.location, httpEnd.location - block.location) firstLine:&statusLine];
+		NSArray<NSString *> *status = [statusLine componentsSeparatedByString:@" "];
+		if ([status count] < 2 || ![status[0] hasPrefix:@"HTTP/"]) {
+			continue;
+		}
+
+		NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:url statusCode:[status[1] integerValue] HTTPVersion:status[0] headerFields:headerFields];
+		NSData *body = [archive subdataWithRange:NSMakeRange(NSMaxRange(httpEnd), NSMaxRange(block) - NSMaxRange(httpEnd))];
+		responses[uri] = [[NSCachedURLResponse alloc] initWithResponse:response data:body userInfo:nil storagePolicy:NSURLCacheStorageNotAllowed];
+	}
+
+	return responses;
+}
+
+@end
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Reduces an HTML document, as it streams through, to what there is to read in it.
+ *  \details This is for text-only pages on slow tunnels, where a page's scripts, styles and
+ *  third party content cost much more than its text.  It uses the same kind of tokenizer as
+ *  JAHPHTMLRewriter, and never builds a DOM:
+ *
+ *  - headings, paragraphs, lists, quotes, preformatted text, tables and inline emphasis are
+ *    kept, without their attributes;
+ *  - links are kept, with their href made absolute; links to scripts lose their href;
+ *  - images from the document's own origin are kept if images are wanted; others are
+ *    replaced by their alt text;
+ *  - scripts, styles, forms, embedded content, navigation, sidebars and footers are dropped
+ *    along with everything in them;
+ *  - any other element is dropped, but its content is kept.
+ *
+ *  The output is a new document with a plain stylesheet and the bootstrap script, meant to
+ *  be served under +contentSecurityPolicyWithImages: so that nothing else is loaded.
+ */
+
+@interface JAHPTextOnlyReducer : NSObject
+
+/*! Returns YES if the user has turned text-only pages on.
+ */
+
++ (BOOL)isEnabled;
+
+/*! Returns YES if the user wants images in text-only pages.
+ */
+
++ (BOOL)showsImages;
+
+/*! Returns the policy to serve a reduced document under.  It still needs the sources for
+ *  our own javascript merged in; see JAHPContentSecurityPolicy.
+ */
+
++ (nonnull NSString *)contentSecurityPolicyWithImages:(BOOL)images;
+
+/*! \param url The URL of the document, for making links absolute.
+ *  \param bootstrap The markup to put at the end of the reduced document's head.
+ *  \param images Whether to keep the document's own images.
+ */
+
+- (nonnull instancetype)initWithDocumentURL:(nullable NSURL *)url bootstrap:(nonnull dispatch_data_t)bootstrap images:(BOOL)images;
+
+/*! Returns the reduced form of the next chunk of the document, which is often empty.
+ */
+
+- (nonnull NSData *)reduceData:(nonnull NSData *)data;
+
+/*! Returns the end of the reduced document.
+ */
+
+- (nonnull NSData *)finish;
+
+/*! YES once the output has some text in it to read.
+ */
+
+@property (nonatomic, readonly) BOOL hasReadableText;
+
+@end
@@ -0,0 +1,639 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPTextOnlyReducer.h"
+
+#import "JAHPHTMLRewriter.h"
+
+/* a tag longer than this is dropped without being looked at */
+#define MAX_TAG_LENGTH (16 * 1024)
+
+/* a title longer than this is cut short */
+#define MAX_TITLE_LENGTH 1024
+#define MAX_TITLE_COLLECTED (MAX_TITLE_LENGTH + 16)
+
+typedef NS_ENUM(NSInteger, JAHPTextOnlyReducerState) {
+	JAHPTextOnlyReducerStateData,           // text
+	JAHPTextOnlyReducerStateTag,            // in a tag, which is collected until it's complete
+	JAHPTextOnlyReducerStateComment,        // in <!-- -->
+	JAHPTextOnlyReducerStateRawText,        // in <script>, <style> etc., until the matching end tag
+	JAHPTextOnlyReducerStateRawTextEnd,     // in the end tag of a raw text element
+};
+
+static NSSet *keptElements;         // kept, without attributes
+static NSSet *voidElements;         // kept elements that have no end tag
+static NSSet *droppedElements;      // dropped with their content
+static NSSet *rawTextElements;      // elements whose content isn't markup
+
+static const char JAHPTextOnlyStyle[] =
+	"<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">"
+	"<style>"
+	"body{font:17px/1.5 -apple-system,Georgia,serif;color:#222;max-width:40em;margin:0 auto;padding:0 1em;word-wrap:break-word}"
+	"img{max-width:100%;height:auto}"
+	"pre{white-space:pre-wrap}"
+	"table{border-collapse:collapse}"
+	"td,th{border:1px solid #ccc;padding:.2em}"
+	"</style>";
+
+@implementation JAHPTextOnlyReducer {
+	NSURL *_documentURL;
+	NSURL *_baseURL;
+	BOOL _sawBase;
+	dispatch_data_t _bootstrap;
+	BOOL _images;
+
+	JAHPTextOnlyReducerState _state;
+	NSMutableData *_tag;                // the tag being collected, from its '<'
+	char _quote;                        // the quote of the attribute value we're in, or 0
+	BOOL _afterEquals;                  // the last non-space character in the tag was '='
+	NSUInteger _dashes;                 // consecutive '-' in a comment
+	NSString *_rawTextName;
+	char _rawTextEndTag[16];            // e.g. "</script"
+	NSUInteger _rawTextEndTagLength;
+	NSUInteger _rawTextMatched;
+
+	NSString *_droppedName;             // the element being dropped, and how deeply it's nested
+	NSUInteger _droppedDepth;
+	NSMutableData *_title;              // the title, while in it
+	BOOL _sawTitle;
+
+	uint64_t _bytesSeen;
+	BOOL _startedDocument;
+	BOOL _openedBody;
+
+	NSMutableData *_output;
+}
+
++ (void)initialize
+{
+	if (self == [JAHPTextOnlyReducer class]) {
+		keptElements = [NSSet setWithObjects:
+						@"h1", @"h2", @"h3", @"h4", @"h5", @"h6", @"p", @"br", @"hr",
+						@"ul", @"ol", @"li", @"dl", @"dt", @"dd", @"blockquote", @"pre", @"code",
+						@"em", @"strong", @"b", @"i", @"u", @"s", @"sub", @"sup", @"small", @"mark", @"q", @"cite",
+						@"figure", @"figcaption", @"table", @"caption", @"thead", @"tbody", @"tfoot", @"tr", @"th", @"td",
+						@"div", @"section", @"article", @"main", @"header", @"details", @"summary",
+						nil];
+		voidElements = [NSSet setWithObjects:@"br", @"hr", @"img", nil];
+		droppedElements = [NSSet setWithObjects:
+						   @"script", @"style", @"noscript", @"template", @"svg", @"math",
+						   @"iframe", @"frameset", @"object", @"embed", @"applet", @"video", @"audio", @"canvas",
+						   @"form", @"select", @"textarea", @"button", @"dialog", @"nav", @"aside", @"footer",
+						   @"xmp", @"noembed", @"noframes",
+						   nil];
+		rawTextElements = [NSSet setWithObjects:@"script", @"style", @"textarea", @"title", @"xmp", @"iframe", @"noembed", @"noframes", @"noscript", nil];
+	}
+}
+
++ (BOOL)isEnabled
+{
+	return [[NSUserDefaults standardUserDefaults] boolForKey:kTextOnly];
+}
+
++ (BOOL)showsImages
+{
+	return [[NSUserDefaults standardUserDefaults] boolForKey:kTextOnlyImages];
+}
+
++ (NSString *)contentSecurityPolicyWithImages:(BOOL)images
+{
+	if (images) {
+		return @"default-src 'none'; style-src 'unsafe-inline'; img-src 'self' data:;";
+	}
+	return @"default-src 'none'; style-src 'unsafe-inline';";
+}
+
+- (instancetype)initWithDocumentURL:(NSURL *)url bootstrap:(dispatch_data_t)bootstrap images:(BOOL)images
+{
+	self = [super init];
+	if (self != nil) {
+		_documentURL = url;
+		_baseURL = url;
+		_bootstrap = bootstrap;
+		_images = images;
+		_state = JAHPTextOnlyReducerStateData;
+	}
+	return self;
+}
+
+#pragma mark - Output
+
+- (void)emitBytes:(const void *)bytes length:(NSUInteger)length
+{
+	[_output appendBytes:bytes length:length];
+}
+
+- (void)emitString:(NSString *)s
+{
+	[_output appendData:[s dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)emitEscapedString:(NSString *)s
+{
+	s = [s stringByReplacingOccurrencesOfString:@"&" withString:@"&amp;"];
+	s = [s stringByReplacingOccurrencesOfString:@"<" withString:@"&lt;"];
+	s = [s stringByReplacingOccurrencesOfString:@">" withString:@"&gt;"];
+	s = [s stringByReplacingOccurrencesOfString:@"\"" withString:@"&quot;"];
+	[self emitString:s];
+}
+
+- (void)startDocumentIfNeeded
+{
+	static const char start[] = "<!DOCTYPE html><html><head>";
+
+	if (!_startedDocument) {
+		_startedDocument = YES;
+		[self emitBytes:start length:sizeof(start) - 1];
+	}
+}
+
+/*! Called before the first thing that goes in the body.  The head is left open until then
+ *  so that the document's <meta charset> and <title> can go in it.
+ */
+
+- (void)openBodyIfNeeded
+{
+	static const char end[] = "</head><body>";
+
+	if (_openedBody) {
+		return;
+	}
+	_openedBody = YES;
+
+	[self startDocumentIfNeeded];
+	[self emitBytes:JAHPTextOnlyStyle length:sizeof(JAHPTextOnlyStyle) - 1];
+	dispatch_data_apply(_bootstrap, ^bool(dispatch_data_t region, size_t offset, const void *buffer, size_t size) {
+		[self emitBytes:buffer length:size];
+		return true;
+	});
+	[self emitBytes:end length:sizeof(end) - 1];
+}
+
+/*! Passes text through, unless it's in something being dropped.
+ */
+
+- (void)emitText:(const uint8_t *)bytes from:(NSUInteger)from to:(NSUInteger)to
+{
+	if (_droppedDepth > 0 || to <= from) {
+		return;
+	}
+
+	if (!_openedBody) {
+		// Whitespace (and a byte order mark) before the body has nothing to read in it.
+		NSUInteger i = from;
+		if (_bytesSeen + from == 0 && to - from >= 3 && memcmp(bytes + from, "\xEF\xBB\xBF", 3) == 0) {
+			i += 3;
+		}
+		while (i < to && isspace(bytes[i])) {
+			i++;
+		}
+		if (i == to) {
+			return;
+		}
+		from = i;
+		[self openBodyIfNeeded];
+	}
+
+	if (!_hasReadableText) {
+		for (NSUInteger i = from; i < to; i++) {
+			if (!isspace(bytes[i])) {
+				_hasReadableText = YES;
+				break;
+			}
+		}
+	}
+
+	[self emitBytes:bytes + from length:to - from];
+}
+
+#pragma mark - Reducing
+
+- (NSData *)reduceData:(NSData *)data
+{
+	const uint8_t *bytes = [data bytes];
+	NSUInteger length = [data length];
+	NSUInteger textStart = 0;       // start of the text being passed through
+	NSUInteger tagStart = 0;        // start of the current tag's bytes in this chunk
+
+	_output = [[NSMutableData alloc] init];
+	[self startDocumentIfNeeded];
+
+	for (NSUInteger i = 0; i < length; i++) {
+		uint8_t c = bytes[i];
+
+		switch (_state) {
+			case JAHPTextOnlyReducerStateData: {
+				const uint8_t *lt = memchr(bytes + i, '<', length - i);
+				if (lt == NULL) {
+					i = length;
+					break;
+				}
+
+				i = (NSUInteger) (lt - bytes);
+				[self emitText:bytes from:textStart to:i];
+				tagStart = i;
+				_tag = [[NSMutableData alloc] init];
+				_quote = 0;
+				_afterEquals = NO;
+				_state = JAHPTextOnlyReducerStateTag;
+				break;
+			}
+
+			case JAHPTextOnlyReducerStateTag: {
+				NSUInteger tagLength = [_tag length] + (i - tagStart) + 1;
+
+				if (tagLength == 2 && !(isalpha(c) || c == '/' || c == '!' || c == '?')) {
+					// A '<' that doesn't start a tag is just text.
+					if (_droppedDepth == 0) {
+						[self openBodyIfNeeded];
+						[self emitBytes:"&lt;" length:4];
+					}
+					textStart = i;
+					_state = JAHPTextOnlyReducerStateData;
+					i--;
+					break;
+				}
+
+				if (tagLength == 4 && [self tagStartsComment:bytes from:tagStart to:i + 1]) {
+					_dashes = 0;
+					_state = JAHPTextOnlyReducerStateComment;
+					break;
+				}
+
+				if (_quote != 0) {
+					if (c == _quote) {
+						_quote = 0;
+					}
+				} else if ((c == '"' || c == '\'') && _afterEquals) {
+					_quote = c;
+				} else if (c == '>') {
+					[_tag appendBytes:bytes + tagStart length:i + 1 - tagStart];
+					_state = JAHPTextOnlyReducerStateData;
+					[self endTag];
+					textStart = i + 1;
+					break;
+				} else if (!isspace(c)) {
+					_afterEquals = (c == '=');
+				}
+
+				if (tagLength > MAX_TAG_LENGTH) {
+					// Not worth holding on to; drop it.
+					_tag = nil;
+					textStart = i + 1;
+					_state = JAHPTextOnlyReducerStateData;
+				}
+				break;
+			}
+
+			case JAHPTextOnlyReducerStateComment:
+				if (c == '>' && _dashes >= 2) {
+					textStart = i + 1;
+					_state = JAHPTextOnlyReducerStateData;
+				}
+				_dashes = (c == '-') ? _dashes + 1 : 0;
+				break;
+
+			case JAHPTextOnlyReducerStateRawText:
+				if (_rawTextMatched == _rawTextEndTagLength) {
+					// "</script" has to be followed by something that ends the tag name.
+					if (isspace(c) || c == '/' || c == '>') {
+						if (_title != nil) {
+							[self collectTitle:bytes from:textStart to:i + 1];
+							[self trimTitleEndTag];
+							textStart = i + 1;
+						}
+						if (c == '>') {
+							[self endRawText];
+							textStart = i + 1;
+						} else {
+							_state = JAHPTextOnlyReducerStateRawTextEnd;
+						}
+						break;
+					}
+					_rawTextMatched = 0;
+				}
+				if (tolower(c) == _rawTextEndTag[_rawTextMatched]) {
+					_rawTextMatched++;
+				} else {
+					_rawTextMatched = (c == '<') ? 1 : 0;
+				}
+				break;
+
+			case JAHPTextOnlyReducerStateRawTextEnd:
+				if (c == '>') {
+					[self endRawText];
+					textStart = i + 1;
+				}
+				break;
+		}
+	}
+
+	switch (_state) {
+		case JAHPTextOnlyReducerStateData:
+			[self emitText:bytes from:textStart to:length];
+			break;
+		case JAHPTextOnlyReducerStateTag:
+			// Hold on to the partial tag until the rest of it arrives.
+			[_tag appendBytes:bytes + tagStart length:length - tagStart];
+			break;
+		case JAHPTextOnlyReducerStateRawText:
+			if (_title != nil) {
+				[self collectTitle:bytes from:textStart to:length];
+			}
+			break;
+		default:
+			break;
+	}
+
+	_bytesSeen += length;
+
+	NSData *output = _output;
+	_output = nil;
+	return output;
+}
+
+- (NSData *)finish
+{
+	static const char end[] = "</body></html>";
+	NSData *output;
+
+	_output = [[NSMutableData alloc] init];
+	[self startDocumentIfNeeded];
+	if (_title != nil) {
+		[self endTitle];
+	}
+	[self openBodyIfNeeded];
+	[self emitBytes:end length:sizeof(end) - 1];
+
+	_tag = nil;
+	_state = JAHPTextOnlyReducerStateData;
+
+	output = _output;
+	_output = nil;
+	return output;
+}
+
+- (BOOL)tagStartsComment:(const uint8_t *)bytes from:(NSUInteger)from to:(NSUInteger)to
+{
+	uint8_t head[4];
+	NSUInteger held = MIN([_tag length], sizeof(head));
+
+	memcpy(head, [_tag bytes], held);
+	memcpy(head + held, bytes + from, MIN(to - from, sizeof(head) - held));
+	return memcmp(head, "<!--", 4) == 0;
+}
+
+#pragma mark - Tags
+
+/*! Called when a tag is complete.
+ */
+
+- (void)endTag
+{
+	NSData *tag = _tag;
+	BOOL endTag;
+	NSString *name = [JAHPHTMLRewriter nameOfTag:tag endTag:&endTag];
+	BOOL selfClosing = ([tag length] >= 3 && ((const char *) [tag bytes])[[tag length] - 2] == '/');
+
+	_tag = nil;
+
+	if (name == nil || [name hasPrefix:@"!"] || [name hasPrefix:@"?"]) {
+		return;
+	}
+
+	if (endTag) {
+		if (_droppedDepth > 0) {
+			if ([name isEqualToString:_droppedName]) {
+				_droppedDepth--;
+			}
+		} else if (_openedBody && [keptElements containsObject:name] && ![voidElements containsObject:name]) {
+			[self emitString:[NSString stringWithFormat:@"</%@>", name]];
+		} else if (_openedBody && [name isEqualToString:@"a"]) {
+			[self emitString:@"</a>"];
+		}
+		return;
+	}
+
+	if (_droppedDepth > 0) {
+		if ([name isEqualToString:_droppedName] && !selfClosing) {
+			_droppedDepth++;
+		}
+		[self enterRawTextIfNeededForTag:name];
+		return;
+	}
+
+	if ([droppedElements containsObject:name]) {
+		if (!selfClosing) {
+			_droppedName = name;
+			_droppedDepth = 1;
+			[self enterRawTextIfNeededForTag:name];
+		}
+		return;
+	}
+
+	if ([name isEqualToString:@"title"]) {
+		if (!_sawTitle && !selfClosing) {
+			_title = [[NSMutableData alloc] init];
+		}
+		[self enterRawTextIfNeededForTag:name];
+	} else if ([name isEqualToString:@"meta"]) {
+		[self reduceMetaTag:tag];
+	} else if ([name isEqualToString:@"base"] && !_sawBase) {
+		NSString *href = [JAHPHTMLRewriter valueOfAttribute:@"href" inTag:tag range:NULL];
+		if (href != nil) {
+			_sawBase = YES;
+			_baseURL = [NSURL URLWithString:href relativeToURL:_baseURL] ?: _baseURL;
+		}
+	} else if ([name isEqualToString:@"a"]) {
+		[self reduceLinkTag:tag];
+	} else if ([name isEqualToString:@"img"]) {
+		[self reduceImageTag:tag];
+	} else if ([keptElements containsObject:name]) {
+		[self openBodyIfNeeded];
+		[self emitString:[NSString stringWithFormat:@"<%@>", name]];
+	} else if (!selfClosing) {
+		[self enterRawTextIfNeededForTag:name];
+	}
+}
+
+- (void)enterRawTextIfNeededForTag:(NSString *)name
+{
+	if ([rawTextElements containsObject:name]) {
+		NSString *endTag = [@"</" stringByAppendingString:name];
+		_rawTextName = name;
+		_rawTextEndTagLength = [endTag length];
+		memcpy(_rawTextEndTag, [endTag UTF8String], _rawTextEndTagLength);
+		_rawTextMatched = 0;
+		_state = JAHPTextOnlyReducerStateRawText;
+	}
+}
+
+/*! Called at the end tag of a raw text element, which is handled here rather than by
+ *  -endTag.
+ */
+
+- (void)endRawText
+{
+	_state = JAHPTextOnlyReducerStateData;
+
+	if (_title != nil && [_rawTextName isEqualToString:@"title"]) {
+		[self endTitle];
+	} else if (_droppedDepth > 0 && [_rawTextName isEqualToString:_droppedName]) {
+		_droppedDepth--;
+	}
+	_rawTextName = nil;
+}
+
+- (void)collectTitle:(const uint8_t *)bytes from:(NSUInteger)from to:(NSUInteger)to
+{
+	if (to > from && [_title length] < MAX_TITLE_COLLECTED) {
+		[_title appendBytes:bytes + from length:MIN(to - from, MAX_TITLE_COLLECTED - [_title length])];
+	}
+}
+
+/*! Takes the "</title" and the character after it back off the collected title.
+ */
+
+- (void)trimTitleEndTag
+{
+	NSUInteger length = [_title length];
+	NSUInteger tail = _rawTextEndTagLength + 1;
+
+	if (length >= tail && strncasecmp((const char *) [_title bytes] + length - tail, _rawTextEndTag, _rawTextEndTagLength) == 0) {
+		[_title setLength:length - tail];
+	}
+}
+
+- (void)endTitle
+{
+	static const char open[] = "<title>";
+	static const char close[] = "</title>";
+
+	// The title's text is already escaped as it should be, and "</title" can't be in it.
+	if ([_title length] > MAX_TITLE_LENGTH) {
+		[_title setLength:MAX_TITLE_LENGTH];
+	}
+	[self emitBytes:open length:sizeof(open) - 1];
+	[_output appendData:_title];
+	[self emitBytes:close length:sizeof(close) - 1];
+
+	_title = nil;
+	_sawTitle = YES;
+}
+
+/*! Keeps a <meta> that says what the document's encoding is, as long as the head is
+ *  still open.
+ */
+
+- (void)reduceMetaTag:(NSData *)tag
+{
+	if (_openedBody) {
+		return;
+	}
+
+	NSString *charset = [JAHPHTMLRewriter valueOfAttribute:@"charset" inTag:tag range:NULL];
+	if (charset != nil) {
+		[self emitString:@"<meta charset=\""];
+		[self emitEscapedString:charset];
+		[self emitString:@"\">"];
+		return;
+	}
+
+	NSString *httpEquiv = [JAHPHTMLRewriter valueOfAttribute:@"http-equiv" inTag:tag range:NULL];
+	NSString *content = [JAHPHTMLRewriter valueOfAttribute:@"content" inTag:tag range:NULL];
+	if ([httpEquiv caseInsensitiveCompare:@"content-type"] == NSOrderedSame && content != nil) {
+		[self emitString:@"<meta http-equiv=\"Content-Type\" content=\""];
+		[self emitEscapedString:content];
+		[self emitString:@"\">"];
+	}
+}
+
+- (void)reduceLinkTag:(NSData *)tag
+{
+	NSString *href = [JAHPHTMLRewriter valueOfAttribute:@"href" inTag:tag range:NULL];
+	NSURL *url = nil;
+
+	[self openBodyIfNeeded];
+
+	if (href != nil) {
+		url = [NSURL URLWithString:[href stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] relativeToURL:_baseURL];
+	}
+
+	NSString *scheme = [[url scheme] lowercaseString];
+	if ([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"] || [scheme isEqualToString:@"mailto"]) {
+		[self emitString:@"<a href=\""];
+		[self emitEscapedString:[url absoluteString]];
+		[self emitString:@"\">"];
+	} else {
+		[self emitString:@"<a>"];
+	}
+}
+
+/*! Keeps an image from the document's origin if images are wanted, otherwise puts its alt
+ *  text in its place.
+ */
+
+- (void)reduceImageTag:(NSData *)tag
+{
+	NSString *alt = [JAHPHTMLRewriter valueOfAttribute:@"alt" inTag:tag range:NULL];
+	NSURL *url = nil;
+
+	if (_images) {
+		NSString *src = [JAHPHTMLRewriter valueOfAttribute:@"src" inTag:tag range:NULL];
+		if (src == nil || [src hasPrefix:@"data:"]) {
+			// lazy loaders keep the real source aside until a script puts it in place
+			src = [JAHPHTMLRewriter valueOfAttribute:@"data-src" inTag:tag range:NULL] ?: src;
+		}
+		if (src != nil) {
+			url = [NSURL URLWithString:[src stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] relativeToURL:_baseURL];
+		}
+		if (url != nil && ![[[url scheme] lowercaseString] isEqualToString:@"data"] && ![self isSameOriginAsDocument:url]) {
+			url = nil;
+		}
+	}
+
+	if (url != nil) {
+		[self openBodyIfNeeded];
+		[self emitString:@"<img src=\""];
+		[self emitEscapedString:[url absoluteString]];
+		if (alt != nil) {
+			[self emitString:@"\" alt=\""];
+			[self emitEscapedString:alt];
+		}
+		[self emitString:@"\">"];
+	} else if ([[alt stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] length] > 0) {
+		[self openBodyIfNeeded];
+		[self emitEscapedString:alt];
+		_hasReadableText = YES;
+	}
+}
+
+- (BOOL)isSameOriginAsDocument:(NSURL *)url
+{
+	NSString *scheme = [[url scheme] lowercaseString];
+	NSNumber *port = [url port] ?: @([scheme isEqualToString:@"https"] ? 443 : 80);
+	NSString *documentScheme = [[_documentURL scheme] lowercaseString];
+	NSNumber *documentPort = [_documentURL port] ?: @([documentScheme isEqualToString:@"https"] ? 443 : 80);
+
+	return ([scheme isEqualToString:documentScheme] &&
+			[[url host] caseInsensitiveCompare:[_documentURL host]] == NSOrderedSame &&
+			[port isEqualToNumber:documentPort]);
+}
+
+@end
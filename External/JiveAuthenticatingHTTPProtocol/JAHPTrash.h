@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+@import Foundation;
+
+/*! Deletes files and directories lazily.
+ *  \details Deleting a large directory takes time proportional to what's in it, which
+ *  clearing data when the app is backgrounded can't afford.  Moving it into the trash is
+ *  a single rename however big it is, and frees its path for reuse at once; the trash is
+ *  then emptied in the background, and again at the next launch if the app was suspended
+ *  before it finished.
+ *
+ *  Anything whose contents must become unreadable at once should be encrypted under a
+ *  key that's forgotten before it's thrown away, as JAHPDiskCache does.
+ *
+ *  All methods can be called on any thread.
+ */
+
+@interface JAHPTrash : NSObject
+
+/*! Moves the file or directory at path into the trash, or deletes it if it can't be
+ *  moved.  Does nothing if there's nothing at path.
+ */
+
++ (void)moveItemAtPathToTrash:(nonnull NSString *)path;
+
+/*! Deletes everything in the trash on a background queue.
+ */
+
++ (void)empty;
+
+@end
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026, Psiphon Inc.
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#import "JAHPTrash.h"
+
+@implementation JAHPTrash
+
++ (NSString *)trashDirectory
+{
+	static NSString *directory;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+		directory = [caches stringByAppendingPathComponent:@"JAHPTrash"];
+	});
+	return directory;
+}
+
++ (dispatch_queue_t)queue
+{
+	static dispatch_queue_t queue;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		queue = dispatch_queue_create("JAHPTrash", DISPATCH_QUEUE_SERIAL);
+		dispatch_set_target_queue(queue, dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0));
+	});
+	return queue;
+}
+
++ (void)moveItemAtPathToTrash:(NSString *)path
+{
+	NSFileManager *fm = [NSFileManager defaultManager];
+	NSString *trash = [self trashDirectory];
+
+	[fm createDirectoryAtPath:trash withIntermediateDirectories:YES attributes:nil error:nil];
+
+	/* the app's container is one volume, so this is a rename */
+	NSString *destination = [trash stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+	if (rename([path fileSystemRepresentation], [destination fileSystemRepresentation]) != 0 && errno != ENOENT) {
+		NSLog(@"[JAHPTrash] can't move %@ to the trash (%s), deleting it", path, strerror(errno));
+		[fm removeItemAtPath:path error:nil];
+	}
+}
+
++ (void)empty
+{
+	dispatch_async([self queue], ^{
+		NSFileManager *fm = [NSFileManager defaultManager];
+		NSString *trash = [self trashDirectory];
+
+		for (NSString *name in [fm contentsOfDirectoryAtPath:trash error:nil]) {
+			[fm removeItemAtPath:[trash stringByAppendingPathComponent:name] error:nil];
+		}
+	});
+}
+
+@end
@@ -18,6 +18,56 @@ HTTPS_E_RULES_PLIST = "Endless/Resources/https-everywhere_rules.plist"
 URLBLOCKER_JSON = "urlblocker.json"
 URLBLOCKER_TARGETS_PLIST = "Endless/Resources/urlblocker_targets.plist"
 
+REDIRECTORS_JSON = "redirectors.json"
+REDIRECTORS_PLIST = "Endless/Resources/redirectors.plist"
+
+# Adblock Plus filter lists, local or remote, merged in this order
+ADBLOCK_LISTS = [
+  "adblock.txt",
+  "https://easylist.to/easylist/easylist.txt",
+  "https://easylist.to/easylist/easyprivacy.txt",
+]
+ADBLOCK_NETWORK_FILTERS = "Endless/Resources/adblock_network_filters.txt"
+ADBLOCK_COSMETIC_FILTERS = "Endless/Resources/adblock_cosmetic_filters.txt"
+
+# these must match the flags in Endless/AdblockFilterList.m
+ADBLOCK_EXCEPTION = 0x0001
+ADBLOCK_THIRD_PARTY = 0x0002
+ADBLOCK_FIRST_PARTY = 0x0004
+ADBLOCK_DOCUMENT = 0x0008
+ADBLOCK_TYPES = {
+  "script" => 0x0010,
+  "image" => 0x0020,
+  "stylesheet" => 0x0040,
+  "css" => 0x0040,
+  "xmlhttprequest" => 0x0080,
+  "xhr" => 0x0080,
+  "subdocument" => 0x0100,
+  "frame" => 0x0100,
+  "font" => 0x0200,
+  "media" => 0x0400,
+  "object" => 0x0800,
+  "object-subrequest" => 0x0800,
+  "other" => 0x1000,
+}
+ADBLOCK_ALL_TYPES = 0x1ff0
+ADBLOCK_HOST_ANCHOR = 0x2000
+ADBLOCK_START_ANCHOR = 0x4000
+ADBLOCK_END_ANCHOR = 0x8000
+
+# request types a browser can't see through NSURLProtocol; filters only for
+# these can never match, and negating them changes nothing
+ADBLOCK_UNSEEN_TYPES = [ "popup", "websocket", "webrtc", "ping" ]
+
+PUBLIC_SUFFIX_LIST = "https://publicsuffix.org/list/public_suffix_list.dat"
+PUBLIC_SUFFIX_LIST_DAT = "Endless/Resources/public_suffix_list.dat"
+
+# these must match Endless/PublicSuffixList.m
+PUBLIC_SUFFIX_MAGIC = "PSL1"
+PUBLIC_SUFFIX_RULE = 0x01
+PUBLIC_SUFFIX_WILDCARD = 0x02
+PUBLIC_SUFFIX_EXCEPTION = 0x04
+
 # in b64 for some reason
 HSTS_PRELOAD_LIST = "https://chromium.googlesource.com/chromium/src/net/+/master/http/transport_security_state_static.json?format=TEXT"
 HSTS_PRELOAD_HOSTS_PLIST = "Endless/Resources/hsts_preload.plist"
@@ -124,6 +174,405 @@ def convert_urlblocker
     targets.to_plist)
 end
 
+# convert JSON list of tracking redirectors and tracking query parameters,
+# splitting out "utm_*"-style parameter prefixes so they needn't be matched as
+# patterns at runtime
+def convert_redirectors
+  json = JSON.parse(File.read(REDIRECTORS_JSON))
+
+  params = json["tracking_parameters"].reject{|p| p.end_with?("*") }
+  prefixes = json["tracking_parameters"].select{|p| p.end_with?("*") }.
+    map{|p| p.chomp("*") }
+
+  File.write(REDIRECTORS_PLIST,
+    "<!-- generated from #{REDIRECTORS_JSON} - do not directly edit this " +
+      "file -->\n" +
+    {
+      "redirectors" => json["redirectors"],
+      "tracking_parameters" => params,
+      "tracking_parameter_prefixes" => prefixes,
+    }.to_plist)
+end
+
+# parse one Adblock Plus network filter into [ flags, pattern, domains ], or
+# nil if it is a kind of filter we don't support
+def parse_adblock_filter(line)
+  flags = 0
+
+  if line.start_with?("@@")
+    flags |= ADBLOCK_EXCEPTION
+    line = line[2 .. -1]
+  end
+
+  pattern = line
+  options = []
+  if m = line.match(/\$(~?[\w-]+(=[^,]*)?(,~?[\w-]+(=[^,]*)?)*)$/)
+    pattern = m.pre_match
+    options = m[1].split(",")
+  end
+
+  # regular expressions
+  return nil if pattern.length > 1 && pattern.start_with?("/") &&
+    pattern.end_with?("/")
+
+  types = 0
+  negated_types = 0
+  domains = []
+
+  options.each do |opt|
+    name, value = opt.downcase.split("=", 2)
+    negated = name.start_with?("~")
+    name = name.sub(/^~/, "")
+
+    if ADBLOCK_TYPES[name]
+      if negated
+        negated_types |= ADBLOCK_TYPES[name]
+      else
+        types |= ADBLOCK_TYPES[name]
+      end
+    elsif ADBLOCK_UNSEEN_TYPES.include?(name)
+      return nil if !negated
+    elsif name == "third-party" || name == "3p"
+      flags |= (negated ? ADBLOCK_FIRST_PARTY : ADBLOCK_THIRD_PARTY)
+    elsif name == "first-party" || name == "1p"
+      flags |= (negated ? ADBLOCK_THIRD_PARTY : ADBLOCK_FIRST_PARTY)
+    elsif name == "domain" && value
+      domains = value.split("|")
+    elsif name == "document" && (flags & ADBLOCK_EXCEPTION) != 0
+      # whitelists everything on matching pages
+      flags |= ADBLOCK_DOCUMENT
+    elsif name == "important"
+      # we don't let exceptions be overridden
+    else
+      # match-case, popup, csp, redirect, elemhide, etc.
+      return nil
+    end
+  end
+
+  types = ADBLOCK_ALL_TYPES if types == 0
+  types &= ~negated_types
+  return nil if types == 0 && (flags & ADBLOCK_DOCUMENT) == 0
+  flags |= types
+
+  pattern = pattern.downcase
+  if pattern.start_with?("||")
+    flags |= ADBLOCK_HOST_ANCHOR
+    pattern = pattern[2 .. -1]
+  elsif pattern.start_with?("|")
+    flags |= ADBLOCK_START_ANCHOR
+    pattern = pattern[1 .. -1]
+  end
+  if pattern.end_with?("|")
+    flags |= ADBLOCK_END_ANCHOR
+    pattern = pattern[0 .. -2]
+  end
+
+  # leading and trailing wildcards only undo the anchors
+  while pattern.start_with?("*")
+    flags &= ~(ADBLOCK_HOST_ANCHOR | ADBLOCK_START_ANCHOR)
+    pattern = pattern[1 .. -1]
+  end
+  while pattern.end_with?("*")
+    flags &= ~ADBLOCK_END_ANCHOR
+    pattern = pattern[0 .. -2]
+  end
+
+  # an empty pattern would block everything
+  return nil if pattern == "" && domains.empty? &&
+    (flags & ADBLOCK_DOCUMENT) == 0
+  return nil if pattern.match(/[\t\s|]/) || !pattern.ascii_only?
+
+  [ flags, pattern, domains.join("|") ]
+end
+
+# split a selector list on its top-level commas
+def split_selector_list(selectors)
+  list = [ "" ]
+  depth = 0
+
+  selectors.each_char do |c|
+    depth += 1 if c == "(" || c == "["
+    depth -= 1 if c == ")" || c == "]"
+
+    if c == "," && depth == 0
+      list.push ""
+    else
+      list[-1] += c
+    end
+  end
+
+  list.map{|sel| sel.strip }.reject{|sel| sel == "" }
+end
+
+# the class (".name") or id ("#name") that an element must have for selector
+# to match it, taken from the selector's last compound, or nil if it has none
+def adblock_selector_key(selector)
+  compound = selector.gsub(/\[[^\]]*\]|\([^)]*\)/, "").split(/[\s>+~]+/).last
+
+  if compound && m = compound.match(/([#.])([\w-]+)/)
+    m[1] + m[2]
+  end
+end
+
+# parse one element hiding filter into [ key, selector ] pairs, where key is a
+# domain the selector applies to, "@" and a domain it is excepted on, or for
+# generic filters the class or id that elements it hides must have; generic
+# exceptions come back with a nil key
+def parse_adblock_cosmetic_filter(line)
+  m = line.match(/^([^#]*)#(@?)#(.+)$/) or return nil
+  domains = m[1].downcase.split(",").map{|d| d.strip }.reject{|d| d == "" }
+  exception = (m[2] == "@")
+
+  included = domains.reject{|d| d.start_with?("~") }
+  excluded = domains.select{|d| d.start_with?("~") }.map{|d| d[1 .. -1] }
+
+  pairs = []
+
+  split_selector_list(m[3]).each do |selector|
+    # procedural selectors aren't CSS, and nothing may break out of the
+    # <style> element or the rule the selector goes in
+    next if selector.match(/:(-abp-[\w-]+|has-text|contains|xpath|matches-css[\w-]*|upward|remove|style|watch-attr|min-text-length|nth-ancestor|matches-path|others|if|if-not)\(/)
+    next if selector.match(/[{};\\]|<\//) || !selector.ascii_only?
+
+    if exception
+      if included.empty?
+        pairs.push [ nil, selector ]
+      else
+        included.each{|d| pairs.push [ "@" + d, selector ] }
+      end
+      next
+    end
+
+    if included.empty?
+      # generic filters only go to pages that have an element they could hide
+      key = adblock_selector_key(selector) or next
+      pairs.push [ key, selector ]
+    else
+      included.each{|d| pairs.push [ d, selector ] }
+    end
+    excluded.each{|d| pairs.push [ "@" + d, selector ] }
+  end
+
+  pairs
+end
+
+# the runs of token characters in a pattern that must appear whole in any URL
+# the pattern matches; a run next to a wildcard or an unanchored end could be
+# part of a longer run in the URL
+def adblock_filter_tokens(flags, pattern)
+  tokens = []
+
+  pattern.to_enum(:scan, /[a-z0-9%]+/).each do
+    m = Regexp.last_match
+    before = (m.begin(0) == 0 ? nil : pattern[m.begin(0) - 1])
+    after = (m.end(0) == pattern.length ? nil : pattern[m.end(0)])
+
+    next if before == "*" || after == "*"
+    next if before == nil &&
+      (flags & (ADBLOCK_HOST_ANCHOR | ADBLOCK_START_ANCHOR)) == 0
+    next if after == nil && (flags & ADBLOCK_END_ANCHOR) == 0
+
+    tokens.push m[0]
+  end
+
+  tokens
+end
+
+# compile all network filters from the Adblock Plus lists into one line each of
+# "token<tab>flags<tab>pattern<tab>domains", where token is the rarest token
+# of the filter across all lists, so that each request URL only has to be
+# checked against the few filters indexed under its own tokens; element hiding
+# filters go to another file as "key<tab>selector" lines
+def convert_adblock_filters
+  filters = []
+  cosmetic = []
+
+  ADBLOCK_LISTS.each do |list|
+    text = (list.match(/^https?:/) ? Net::HTTP.get(URI(list)) : File.read(list))
+
+    text.force_encoding("utf-8").split("\n").each do |line|
+      line.strip!
+
+      # comments and headers
+      next if line == "" || line.start_with?("!") || line.start_with?("[")
+
+      if line.match(/#@?#/)
+        cosmetic += parse_adblock_cosmetic_filter(line).to_a
+        next
+      end
+
+      # snippets, extended css, etc.
+      next if line.match(/#[?$%]#/)
+
+      if f = parse_adblock_filter(line)
+        filters.push f
+      end
+    end
+  end
+
+  filters.uniq!
+
+  frequency = Hash.new(0)
+  filters.each do |flags,pattern,domains|
+    adblock_filter_tokens(flags, pattern).uniq.each do |t|
+      frequency[t] += 1
+    end
+  end
+
+  lines = filters.map do |flags,pattern,domains|
+    token = adblock_filter_tokens(flags, pattern).
+      min_by{|t| [ frequency[t], -t.length ] }.to_s
+
+    [ token, flags.to_s(16), pattern, domains ].join("\t")
+  end
+
+  File.write(ADBLOCK_NETWORK_FILTERS,
+    "! generated from #{ADBLOCK_LISTS.join(", ")} - do not directly edit " +
+      "this file\n" +
+    lines.sort.join("\n") + "\n")
+
+  # a generic exception just means leaving the generic filter out
+  generic_exceptions = {}
+  cosmetic.each do |key,selector|
+    generic_exceptions[selector] = true if key == nil
+  end
+  cosmetic.reject!{|key,selector| key == nil ||
+    (key.match(/^[#.]/) && generic_exceptions[selector]) }
+
+  File.write(ADBLOCK_COSMETIC_FILTERS,
+    "! generated from #{ADBLOCK_LISTS.join(", ")} - do not directly edit " +
+      "this file\n" +
+    cosmetic.uniq.map{|pair| pair.join("\t") }.sort.join("\n") + "\n")
+end
+
+def punycode_digit(d)
+  (d < 26 ? 97 + d : 22 + d).chr
+end
+
+def punycode_adapt(delta, points, first)
+  delta = (first ? delta / 700 : delta / 2)
+  delta += delta / points
+  k = 0
+  while delta > 455
+    delta /= 35
+    k += 36
+  end
+  k + (36 * delta) / (delta + 38)
+end
+
+# the ascii (RFC 3492) form of one label of an internationalized domain name
+def punycode_label(label)
+  return label if label.ascii_only?
+
+  cps = label.codepoints
+  out = cps.select{|c| c < 128 }.pack("U*")
+  basic = handled = out.length
+  out << "-" if basic > 0
+  n, delta, bias = 128, 0, 72
+
+  while handled < cps.length
+    m = cps.select{|c| c >= n }.min
+    delta += (m - n) * (handled + 1)
+    n = m
+
+    cps.each do |c|
+      delta += 1 if c < n
+      next if c != n
+
+      q = delta
+      k = 36
+      loop do
+        t = (k <= bias ? 1 : (k >= bias + 26 ? 26 : k - bias))
+        break if q < t
+        out << punycode_digit(t + (q - t) % (36 - t))
+        q = (q - t) / (36 - t)
+        k += 36
+      end
+      out << punycode_digit(q)
+
+      bias = punycode_adapt(delta, handled + 1, handled == basic)
+      delta = 0
+      handled += 1
+    end
+
+    delta += 1
+    n += 1
+  end
+
+  "xn--" + out
+end
+
+# compile the public suffix list into a trie of reversed labels, so that the
+# registrable domain of a host can be found in one pass from its end.  the
+# file is a header (magic, number of top-level edges, number of edges, length
+# of the label strings), then the edges, then the strings.  each node's edges
+# are contiguous and sorted by label, and each edge is 12 bytes: uint32 label
+# offset, uint8 label length, uint8 flags, uint16 child count, uint32 index of
+# the first child edge.  everything is little-endian.
+def convert_public_suffix_list
+  text = (PUBLIC_SUFFIX_LIST.match(/^https?:/) ?
+    Net::HTTP.get(URI(PUBLIC_SUFFIX_LIST)) : File.read(PUBLIC_SUFFIX_LIST))
+
+  # nested hashes of label => [flags, children]
+  root = {}
+
+  text.force_encoding("utf-8").split("\n").each do |line|
+    rule = line.strip.split(/\s/).first.to_s
+    next if rule == "" || rule.start_with?("//")
+
+    flag = PUBLIC_SUFFIX_RULE
+    if rule.start_with?("!")
+      flag = PUBLIC_SUFFIX_EXCEPTION
+      rule = rule[1 .. -1]
+    elsif rule.start_with?("*.")
+      flag = PUBLIC_SUFFIX_WILDCARD
+      rule = rule[2 .. -1]
+    end
+
+    # hosts can turn up in either form, so rules go in under both
+    labels = rule.downcase.split(".").reverse
+    [ labels, labels.map{|l| punycode_label(l) } ].uniq.each do |ls|
+      node = root
+      ls.each_with_index do |l, i|
+        node[l] ||= [ 0, {} ]
+        node[l][0] |= flag if i == ls.length - 1
+        node = node[l][1]
+      end
+    end
+  end
+
+  # lay out each node's edges contiguously, breadth first
+  edges = []
+  strings = "".b
+  string_offsets = {}
+  queue = [ root ]
+  first_child = { root.object_id => 0 }
+  next_edge = root.length
+
+  while node = queue.shift
+    node.keys.sort_by{|l| l.b }.each do |l|
+      flags, children = node[l]
+      first_child[children.object_id] = next_edge
+      next_edge += children.length
+      queue.push children
+
+      if !string_offsets[l]
+        string_offsets[l] = strings.length
+        strings << l.b
+      end
+
+      edges.push [ string_offsets[l], l.bytesize, flags, children.length,
+        (children.length > 0 ? first_child[children.object_id] : 0) ]
+    end
+  end
+
+  File.binwrite(PUBLIC_SUFFIX_LIST_DAT,
+    PUBLIC_SUFFIX_MAGIC +
+    [ root.length, edges.length, strings.length ].pack("V*") +
+    edges.map{|e| e.pack("VCCvV") }.join +
+    strings)
+end
+
 def convert_hsts_preload
   domains = {}
 
@@ -142,4 +591,7 @@ end
 
 convert_https_e
 convert_urlblocker
+convert_redirectors
+convert_adblock_filters
+convert_public_suffix_list
 convert_hsts_preload